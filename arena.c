@@ -0,0 +1,102 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGNMENT 64
+#define ARENA_DEFAULT_BLOCK ((size_t)1 << 20)
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t size;              // usable bytes from data
+    size_t used;
+    unsigned char *data;      // aligned start inside the allocation
+};
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+void arena_init(Arena *arena, size_t block_size) {
+    memset(arena, 0, sizeof(Arena));
+    arena->block_size = align_up(block_size > 0 ? block_size : ARENA_DEFAULT_BLOCK);
+}
+
+void arena_free(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = arena->current = NULL;
+    arena->reserved = 0;
+}
+
+void arena_reset(Arena *arena) {
+    arena->current = arena->head;
+    if (arena->current) arena->current->used = 0;
+}
+
+// New block of at least size bytes, linked in after the current one
+static ArenaBlock *add_block(Arena *arena, size_t size) {
+    size_t usable = size > arena->block_size ? size : arena->block_size;
+    if (usable > SIZE_MAX - sizeof(ArenaBlock) - ARENA_ALIGNMENT) return NULL;
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + ARENA_ALIGNMENT + usable);
+    if (!block) return NULL;
+    uintptr_t start = (uintptr_t)(block + 1);
+    block->data = (unsigned char *)((start + ARENA_ALIGNMENT - 1) & ~(uintptr_t)(ARENA_ALIGNMENT - 1));
+    block->size = usable;
+    block->used = 0;
+    if (arena->current) {
+        block->next = arena->current->next;
+        arena->current->next = block;
+    } else {
+        block->next = arena->head;
+        arena->head = block;
+    }
+    arena->reserved += usable;
+    return block;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    if (size > SIZE_MAX - ARENA_ALIGNMENT) return NULL;
+    size = align_up(size > 0 ? size : 1);
+    ArenaBlock *block = arena->current;
+    if (!block || block->size - block->used < size) {
+        // Blocks after current are free since the last reset or release
+        ArenaBlock *next = block ? block->next : arena->head;
+        if (next && next->size >= size) {
+            block = next;
+            block->used = 0;
+        } else if (!(block = add_block(arena, size))) {
+            return NULL;
+        }
+        arena->current = block;
+    }
+    void *memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+void *arena_calloc(Arena *arena, size_t count, size_t size) {
+    if (size > 0 && count > SIZE_MAX / size) return NULL;
+    void *memory = arena_alloc(arena, count * size);
+    if (memory) memset(memory, 0, count * size);
+    return memory;
+}
+
+ArenaMark arena_mark(const Arena *arena) {
+    ArenaMark mark = {arena->current, arena->current ? arena->current->used : 0};
+    return mark;
+}
+
+void arena_release(Arena *arena, ArenaMark mark) {
+    if (mark.block) {
+        arena->current = mark.block;
+        mark.block->used = mark.used;
+    } else {
+        arena_reset(arena);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef DELIVERY_ARENA_H
+#define DELIVERY_ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+// Bump allocator for solve scratch. Allocations are carved from large
+// blocks and never freed one by one: a solve takes a mark, allocates what
+// it needs and releases back to the mark, or the owner resets the whole
+// arena between solves. Both are O(1) and keep the blocks, so back-to-back
+// solves of similar size stop allocating after the first. Not thread safe;
+// use one arena per thread.
+typedef struct {
+    ArenaBlock *head;         // blocks in the order they are used
+    ArenaBlock *current;      // block allocations come from
+    size_t block_size;        // size of new blocks, larger requests get their own
+    size_t reserved;          // bytes held in blocks
+} Arena;
+
+typedef struct {
+    ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+// block_size 0 uses the default (1 MiB). Allocates nothing yet.
+void arena_init(Arena *arena, size_t block_size);
+// Returns every block to the system.
+void arena_free(Arena *arena);
+// Forgets all allocations but keeps the blocks for reuse.
+void arena_reset(Arena *arena);
+
+// size bytes aligned to a cache line, or NULL on allocation failure.
+// Contents are undefined; arena_calloc zeroes them.
+void *arena_alloc(Arena *arena, size_t size);
+void *arena_calloc(Arena *arena, size_t count, size_t size);
+
+// Position to come back to; arena_release drops everything allocated since.
+ArenaMark arena_mark(const Arena *arena);
+void arena_release(Arena *arena, ArenaMark mark);
+
+#endif
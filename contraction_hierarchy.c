@@ -0,0 +1,697 @@
+#include "contraction_hierarchy.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "solver_clock.h"
+
+// Witness searches give up after settling this many nodes and then add the
+// shortcut anyway, which is always safe. Priority estimates only need a
+// rough shortcut count and use the smaller limit.
+#define WITNESS_SETTLE_LIMIT 500
+#define ESTIMATE_SETTLE_LIMIT 5
+// Weight of the edge difference against the contracted neighbour count and
+// level in the contraction order
+#define PRIORITY_DIFFERENCE_WEIGHT 4
+
+// Arcs of one node in the graph being contracted
+typedef struct {
+    int *node;
+    double *weight;
+    int count;
+    int capacity;
+} Adjacency;
+
+typedef struct {
+    int num_nodes;
+    Adjacency *out;
+    Adjacency *in;
+    int *contracted_neighbours;
+    int *level;  // longest chain of contracted nodes below each node
+    // Witness search scratch
+    MinHeap heap;
+    double *dist;
+    unsigned int *reached;
+    unsigned int stamp;
+    unsigned int *target;  // target_stamp marks the nodes a search must settle
+    unsigned int target_stamp;
+    // Shortcuts found while contracting one node, added once it is done
+    int *shortcut_from;
+    int *shortcut_to;
+    double *shortcut_weight;
+    int shortcut_count;
+    int shortcut_capacity;
+} Contraction;
+
+// Adds the arc to node, or shortens the existing one. Returns 0 or -1.
+static int adjacency_set_min(Adjacency *list, int node, double weight) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->node[i] == node) {
+            if (weight < list->weight[i]) list->weight[i] = weight;
+            return 0;
+        }
+    }
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? 2 * list->capacity : 4;
+        int *nodes = realloc(list->node, capacity * sizeof(int));
+        if (!nodes) return -1;
+        list->node = nodes;
+        double *weights = realloc(list->weight, capacity * sizeof(double));
+        if (!weights) return -1;
+        list->weight = weights;
+        list->capacity = capacity;
+    }
+    list->node[list->count] = node;
+    list->weight[list->count++] = weight;
+    return 0;
+}
+
+static void adjacency_remove(Adjacency *list, int node) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->node[i] == node) {
+            list->count--;
+            list->node[i] = list->node[list->count];
+            list->weight[i] = list->weight[list->count];
+            return;
+        }
+    }
+}
+
+static void contraction_free(Contraction *work) {
+    for (int v = 0; work->out && v < work->num_nodes; v++) {
+        free(work->out[v].node);
+        free(work->out[v].weight);
+    }
+    for (int v = 0; work->in && v < work->num_nodes; v++) {
+        free(work->in[v].node);
+        free(work->in[v].weight);
+    }
+    free(work->out);
+    free(work->in);
+    free(work->contracted_neighbours);
+    free(work->level);
+    min_heap_free(&work->heap);
+    free(work->dist);
+    free(work->reached);
+    free(work->target);
+    free(work->shortcut_from);
+    free(work->shortcut_to);
+    free(work->shortcut_weight);
+}
+
+static int contraction_init(Contraction *work, const RoadGraph *graph) {
+    memset(work, 0, sizeof(Contraction));
+    int n = graph->num_nodes;
+    int count = n > 0 ? n : 1;
+    work->num_nodes = n;
+    work->out = calloc(count, sizeof(Adjacency));
+    work->in = calloc(count, sizeof(Adjacency));
+    work->contracted_neighbours = calloc(count, sizeof(int));
+    work->level = calloc(count, sizeof(int));
+    work->dist = malloc(count * sizeof(double));
+    work->reached = calloc(count, sizeof(unsigned int));
+    work->target = calloc(count, sizeof(unsigned int));
+    if (!work->out || !work->in || !work->contracted_neighbours || !work->level || !work->dist || !work->reached ||
+        !work->target ||
+        min_heap_init(&work->heap, n) != 0) {
+        return -1;
+    }
+    for (int u = 0; u < n; u++) {
+        for (int arc = graph->offsets[u]; arc < graph->offsets[u + 1]; arc++) {
+            int v = graph->targets[arc];
+            if (v == u) continue;
+            if (adjacency_set_min(&work->out[u], v, graph->weights[arc]) != 0 ||
+                adjacency_set_min(&work->in[v], u, graph->weights[arc]) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static unsigned int next_stamp(unsigned int *stamp, unsigned int *reached, int num_nodes) {
+    if (++*stamp == 0) {
+        memset(reached, 0, num_nodes * sizeof(unsigned int));
+        *stamp = 1;
+    }
+    return *stamp;
+}
+
+// Bounded Dijkstra from source over the uncontracted graph without skip,
+// stopping early once the num_targets marked nodes are settled. Afterwards
+// dist[w] is valid where reached[w] == stamp.
+static void witness_search(Contraction *work, int source, int skip, double limit,
+                           int num_targets, int settle_limit) {
+    unsigned int stamp = next_stamp(&work->stamp, work->reached, work->num_nodes);
+    MinHeap *heap = &work->heap;
+    min_heap_clear(heap);
+    work->dist[source] = 0;
+    work->reached[source] = stamp;
+    min_heap_push(heap, source, 0);
+    int settled = 0;
+    while (!min_heap_empty(heap) && settled++ < settle_limit) {
+        double d;
+        int u = min_heap_pop(heap, &d);
+        if (work->target[u] == work->target_stamp && --num_targets == 0) break;
+        const Adjacency *out = &work->out[u];
+        for (int i = 0; i < out->count; i++) {
+            int v = out->node[i];
+            if (v == skip) continue;
+            double candidate = d + out->weight[i];
+            if (candidate > limit) continue;
+            if (work->reached[v] != stamp || candidate < work->dist[v]) {
+                work->reached[v] = stamp;
+                work->dist[v] = candidate;
+                min_heap_push(heap, v, candidate);
+            }
+        }
+    }
+    min_heap_clear(heap);
+}
+
+static int buffer_shortcut(Contraction *work, int from, int to, double weight) {
+    if (work->shortcut_count == work->shortcut_capacity) {
+        int capacity = work->shortcut_capacity ? 2 * work->shortcut_capacity : 64;
+        int *froms = realloc(work->shortcut_from, capacity * sizeof(int));
+        if (!froms) return -1;
+        work->shortcut_from = froms;
+        int *tos = realloc(work->shortcut_to, capacity * sizeof(int));
+        if (!tos) return -1;
+        work->shortcut_to = tos;
+        double *weights = realloc(work->shortcut_weight, capacity * sizeof(double));
+        if (!weights) return -1;
+        work->shortcut_weight = weights;
+        work->shortcut_capacity = capacity;
+    }
+    work->shortcut_from[work->shortcut_count] = from;
+    work->shortcut_to[work->shortcut_count] = to;
+    work->shortcut_weight[work->shortcut_count++] = weight;
+    return 0;
+}
+
+// Shortcuts needed to contract v, buffered when record is set. Returns -1 on
+// allocation failure.
+static int find_shortcuts(Contraction *work, int v, int record) {
+    const Adjacency *in = &work->in[v], *out = &work->out[v];
+    double max_out = 0;
+    for (int j = 0; j < out->count; j++) {
+        if (out->weight[j] > max_out) max_out = out->weight[j];
+    }
+    unsigned int mark = next_stamp(&work->target_stamp, work->target, work->num_nodes);
+    for (int j = 0; j < out->count; j++) work->target[out->node[j]] = mark;
+    work->shortcut_count = 0;
+    int shortcuts = 0;
+    for (int i = 0; i < in->count; i++) {
+        int u = in->node[i];
+        double to_v = in->weight[i];
+        witness_search(work, u, v, to_v + max_out, out->count,
+                       record ? WITNESS_SETTLE_LIMIT : ESTIMATE_SETTLE_LIMIT);
+        for (int j = 0; j < out->count; j++) {
+            int w = out->node[j];
+            if (w == u) continue;
+            double via = to_v + out->weight[j];
+            if (work->reached[w] == work->stamp && work->dist[w] <= via) continue;
+            shortcuts++;
+            if (record && buffer_shortcut(work, u, w, via) != 0) return -1;
+        }
+    }
+    return shortcuts;
+}
+
+// Edge difference plus the number of contracted neighbours and the level,
+// which spread contraction evenly over the graph and keep the upper levels
+// from filling with shortcuts
+static double priority(Contraction *work, int v) {
+    int shortcuts = find_shortcuts(work, v, 0);
+    int difference = shortcuts - work->in[v].count - work->out[v].count;
+    return PRIORITY_DIFFERENCE_WEIGHT * difference + work->contracted_neighbours[v] + work->level[v];
+}
+
+// Converts one side of the contracted graph to CSR. Every node's lists hold
+// exactly the arcs to nodes contracted after it, i.e. the upward arcs.
+static int extract_upward(const Adjacency *lists, int n, int **offsets, int **targets,
+                          double **weights) {
+    *offsets = malloc((n + 1) * sizeof(int));
+    if (!*offsets) return -1;
+    size_t total = 0;
+    for (int v = 0; v < n; v++) {
+        (*offsets)[v] = (int)total;
+        total += lists[v].count;
+    }
+    (*offsets)[n] = (int)total;
+    *targets = malloc((total > 0 ? total : 1) * sizeof(int));
+    *weights = malloc((total > 0 ? total : 1) * sizeof(double));
+    if (!*targets || !*weights) return -1;
+    for (int v = 0; v < n; v++) {
+        if (lists[v].count == 0) continue;
+        memcpy(*targets + (*offsets)[v], lists[v].node, lists[v].count * sizeof(int));
+        memcpy(*weights + (*offsets)[v], lists[v].weight, lists[v].count * sizeof(double));
+    }
+    return 0;
+}
+
+int contraction_hierarchy_build(ContractionHierarchy *hierarchy, const RoadGraph *graph,
+                                ContractionStats *stats) {
+    double start = solver_clock_seconds();
+    memset(hierarchy, 0, sizeof(ContractionHierarchy));
+    int n = graph->num_nodes;
+    Contraction work = {0};
+    MinHeap order = {0};
+    char *contracted = calloc(n > 0 ? n : 1, 1);
+    int status = -1;
+    int shortcuts = 0;
+    if (!contracted || contraction_init(&work, graph) != 0 || min_heap_init(&order, n) != 0) {
+        goto done;
+    }
+
+    for (int v = 0; v < n; v++) min_heap_push(&order, v, priority(&work, v));
+    while (!min_heap_empty(&order)) {
+        int v = min_heap_pop(&order, NULL);
+        // Lazy update: priorities only grow stale upwards between updates,
+        // so re-queue v if it is no longer the cheapest
+        double current = priority(&work, v);
+        if (!min_heap_empty(&order) && current > min_heap_top_key(&order)) {
+            min_heap_push(&order, v, current);
+            continue;
+        }
+
+        if (find_shortcuts(&work, v, 1) < 0) goto done;
+        for (int i = 0; i < work.shortcut_count; i++) {
+            int from = work.shortcut_from[i], to = work.shortcut_to[i];
+            double weight = work.shortcut_weight[i];
+            if (adjacency_set_min(&work.out[from], to, weight) != 0 ||
+                adjacency_set_min(&work.in[to], from, weight) != 0) {
+                goto done;
+            }
+        }
+        shortcuts += work.shortcut_count;
+
+        // Detach v; its own lists now hold its upward arcs for good
+        contracted[v] = 1;
+        for (int i = 0; i < work.in[v].count; i++) adjacency_remove(&work.out[work.in[v].node[i]], v);
+        for (int i = 0; i < work.out[v].count; i++) adjacency_remove(&work.in[work.out[v].node[i]], v);
+        for (int side = 0; side < 2; side++) {
+            const Adjacency *list = side ? &work.out[v] : &work.in[v];
+            for (int i = 0; i < list->count; i++) {
+                int x = list->node[i];
+                work.contracted_neighbours[x]++;
+                if (work.level[x] < work.level[v] + 1) work.level[x] = work.level[v] + 1;
+                min_heap_push(&order, x, priority(&work, x));
+            }
+        }
+    }
+
+    hierarchy->num_nodes = n;
+    hierarchy->graph_hash = road_graph_hash(graph);
+    if (extract_upward(work.out, n, &hierarchy->up_offsets, &hierarchy->up_targets,
+                       &hierarchy->up_weights) != 0 ||
+        extract_upward(work.in, n, &hierarchy->down_offsets, &hierarchy->down_targets,
+                       &hierarchy->down_weights) != 0) {
+        goto done;
+    }
+    status = 0;
+
+done:
+    if (status != 0) contraction_hierarchy_free(hierarchy);
+    if (stats) {
+        stats->shortcuts = shortcuts;
+        stats->elapsed = solver_clock_seconds() - start;
+    }
+    min_heap_free(&order);
+    contraction_free(&work);
+    free(contracted);
+    return status;
+}
+
+void contraction_hierarchy_free(ContractionHierarchy *hierarchy) {
+    free(hierarchy->up_offsets);
+    free(hierarchy->up_targets);
+    free(hierarchy->up_weights);
+    free(hierarchy->down_offsets);
+    free(hierarchy->down_targets);
+    free(hierarchy->down_weights);
+    memset(hierarchy, 0, sizeof(ContractionHierarchy));
+}
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    int32_t num_nodes;
+    int32_t num_up_arcs;
+    int32_t num_down_arcs;
+    int32_t reserved;
+    uint64_t graph_hash;
+} HierarchyHeader;
+
+#define HIERARCHY_VERSION 1
+#define HIERARCHY_BYTE_ORDER 0x01020304u
+
+int contraction_hierarchy_save(const ContractionHierarchy *hierarchy, const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror(path);
+        return -1;
+    }
+    int n = hierarchy->num_nodes;
+    HierarchyHeader header = {{0}, HIERARCHY_VERSION, HIERARCHY_BYTE_ORDER, n,
+                              hierarchy->up_offsets[n], hierarchy->down_offsets[n], 0,
+                              hierarchy->graph_hash};
+    memcpy(header.magic, CONTRACTION_HIERARCHY_MAGIC, sizeof(header.magic));
+    size_t up = header.num_up_arcs, down = header.num_down_arcs;
+    int ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+             fwrite(hierarchy->up_offsets, sizeof(int), n + 1, out) == (size_t)n + 1 &&
+             fwrite(hierarchy->up_targets, sizeof(int), up, out) == up &&
+             fwrite(hierarchy->up_weights, sizeof(double), up, out) == up &&
+             fwrite(hierarchy->down_offsets, sizeof(int), n + 1, out) == (size_t)n + 1 &&
+             fwrite(hierarchy->down_targets, sizeof(int), down, out) == down &&
+             fwrite(hierarchy->down_weights, sizeof(double), down, out) == down;
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// Bytes of a file with this header, so the counts can be checked against
+// the file before anything is allocated for them
+static uint64_t file_bytes(const HierarchyHeader *header) {
+    uint64_t offsets = 2 * ((uint64_t)header->num_nodes + 1) * sizeof(int);
+    uint64_t arcs = (uint64_t)header->num_up_arcs + (uint64_t)header->num_down_arcs;
+    return sizeof(HierarchyHeader) + offsets + arcs * (sizeof(int) + sizeof(double));
+}
+
+// Reads one side's CSR arrays and checks that they are well formed
+static int read_side(FILE *in, int n, int arcs, int **offsets, int **targets, double **weights) {
+    *offsets = malloc((n + 1) * sizeof(int));
+    *targets = malloc((arcs > 0 ? arcs : 1) * sizeof(int));
+    *weights = malloc((arcs > 0 ? arcs : 1) * sizeof(double));
+    if (!*offsets || !*targets || !*weights ||
+        fread(*offsets, sizeof(int), n + 1, in) != (size_t)n + 1 ||
+        fread(*targets, sizeof(int), arcs, in) != (size_t)arcs ||
+        fread(*weights, sizeof(double), arcs, in) != (size_t)arcs) {
+        return -1;
+    }
+    if ((*offsets)[0] != 0 || (*offsets)[n] != arcs) return -1;
+    for (int v = 0; v < n; v++) {
+        if ((*offsets)[v + 1] < (*offsets)[v]) return -1;
+    }
+    for (int i = 0; i < arcs; i++) {
+        if ((*targets)[i] < 0 || (*targets)[i] >= n || !((*weights)[i] >= 0)) return -1;
+    }
+    return 0;
+}
+
+int contraction_hierarchy_load(ContractionHierarchy *hierarchy, const char *path,
+                               const RoadGraph *graph) {
+    memset(hierarchy, 0, sizeof(ContractionHierarchy));
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+    HierarchyHeader header;
+    const char *error = NULL;
+    long size = -1;
+    if (fseek(in, 0, SEEK_END) == 0) size = ftell(in);
+    rewind(in);
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, CONTRACTION_HIERARCHY_MAGIC, sizeof(header.magic)) != 0) {
+        error = "not a contraction hierarchy file";
+    } else if (header.version != HIERARCHY_VERSION || header.byte_order != HIERARCHY_BYTE_ORDER) {
+        error = "unsupported version or byte order";
+    } else if (header.num_nodes < 0 || header.num_up_arcs < 0 || header.num_down_arcs < 0) {
+        error = "corrupt header";
+    } else if (size < 0 || file_bytes(&header) != (uint64_t)size) {
+        error = "truncated or corrupt file";
+    } else if (graph && (header.num_nodes != graph->num_nodes ||
+                         header.graph_hash != road_graph_hash(graph))) {
+        error = "built for a different road graph";
+    } else if (read_side(in, header.num_nodes, header.num_up_arcs, &hierarchy->up_offsets,
+                         &hierarchy->up_targets, &hierarchy->up_weights) != 0 ||
+               read_side(in, header.num_nodes, header.num_down_arcs, &hierarchy->down_offsets,
+                         &hierarchy->down_targets, &hierarchy->down_weights) != 0) {
+        error = "truncated or corrupt file";
+    }
+    fclose(in);
+    if (error) {
+        fprintf(stderr, "%s: %s\n", path, error);
+        contraction_hierarchy_free(hierarchy);
+        return -1;
+    }
+    hierarchy->num_nodes = header.num_nodes;
+    hierarchy->graph_hash = header.graph_hash;
+    return 0;
+}
+
+int hierarchy_search_init(HierarchySearch *search, int num_nodes) {
+    memset(search, 0, sizeof(HierarchySearch));
+    int count = num_nodes > 0 ? num_nodes : 1;
+    search->forward_dist = malloc(count * sizeof(double));
+    search->backward_dist = malloc(count * sizeof(double));
+    search->forward_reached = calloc(count, sizeof(unsigned int));
+    search->backward_reached = calloc(count, sizeof(unsigned int));
+    search->settled = malloc(count * sizeof(int));
+    search->num_nodes = num_nodes;
+    if (!search->forward_dist || !search->backward_dist || !search->forward_reached ||
+        !search->backward_reached || !search->settled ||
+        min_heap_init(&search->forward_heap, num_nodes) != 0 ||
+        min_heap_init(&search->backward_heap, num_nodes) != 0) {
+        hierarchy_search_free(search);
+        return -1;
+    }
+    return 0;
+}
+
+void hierarchy_search_free(HierarchySearch *search) {
+    min_heap_free(&search->forward_heap);
+    min_heap_free(&search->backward_heap);
+    free(search->forward_dist);
+    free(search->backward_dist);
+    free(search->forward_reached);
+    free(search->backward_reached);
+    free(search->settled);
+    memset(search, 0, sizeof(HierarchySearch));
+}
+
+static unsigned int next_query(HierarchySearch *search) {
+    if (++search->query == 0) {
+        memset(search->forward_reached, 0, search->num_nodes * sizeof(unsigned int));
+        memset(search->backward_reached, 0, search->num_nodes * sizeof(unsigned int));
+        search->query = 1;
+    }
+    return search->query;
+}
+
+double contraction_hierarchy_distance(const ContractionHierarchy *hierarchy, int src, int target,
+                                      HierarchySearch *search) {
+    int n = hierarchy->num_nodes;
+    if (src < 0 || src >= n || target < 0 || target >= n || search->num_nodes < n) return INFINITY;
+
+    unsigned int query = next_query(search);
+    MinHeap *heaps[2] = {&search->forward_heap, &search->backward_heap};
+    double *dist[2] = {search->forward_dist, search->backward_dist};
+    unsigned int *reached[2] = {search->forward_reached, search->backward_reached};
+    const int *offsets[2] = {hierarchy->up_offsets, hierarchy->down_offsets};
+    const int *targets[2] = {hierarchy->up_targets, hierarchy->down_targets};
+    const double *weights[2] = {hierarchy->up_weights, hierarchy->down_weights};
+    int start[2] = {src, target};
+    for (int side = 0; side < 2; side++) {
+        min_heap_clear(heaps[side]);
+        dist[side][start[side]] = 0;
+        reached[side][start[side]] = query;
+        min_heap_push(heaps[side], start[side], 0);
+    }
+
+    double best = src == target ? 0 : INFINITY;
+    for (;;) {
+        double keys[2];
+        for (int side = 0; side < 2; side++) {
+            keys[side] = min_heap_empty(heaps[side]) ? INFINITY : min_heap_top_key(heaps[side]);
+        }
+        // Neither side can still find a shorter meeting point
+        if (fmin(keys[0], keys[1]) >= best) break;
+
+        int side = keys[0] <= keys[1] ? 0 : 1;
+        int other = 1 - side;
+        double d;
+        int u = min_heap_pop(heaps[side], &d);
+        for (int arc = offsets[side][u]; arc < offsets[side][u + 1]; arc++) {
+            int v = targets[side][arc];
+            double candidate = d + weights[side][arc];
+            if (reached[side][v] != query || candidate < dist[side][v]) {
+                reached[side][v] = query;
+                dist[side][v] = candidate;
+                min_heap_push(heaps[side], v, candidate);
+                if (reached[other][v] == query && candidate + dist[other][v] < best) {
+                    best = candidate + dist[other][v];
+                }
+            }
+        }
+    }
+    min_heap_clear(heaps[0]);
+    min_heap_clear(heaps[1]);
+    return best;
+}
+
+// Full upward search from src on one side. Fills dist for the settled nodes
+// and lists them in search->settled; returns how many there are.
+static int upward_search(const int *offsets, const int *targets, const double *weights, int src,
+                         HierarchySearch *search) {
+    unsigned int query = next_query(search);
+    MinHeap *heap = &search->forward_heap;
+    double *dist = search->forward_dist;
+    unsigned int *reached = search->forward_reached;
+    min_heap_clear(heap);
+    dist[src] = 0;
+    reached[src] = query;
+    min_heap_push(heap, src, 0);
+    int count = 0;
+    while (!min_heap_empty(heap)) {
+        double d;
+        int u = min_heap_pop(heap, &d);
+        search->settled[count++] = u;
+        for (int arc = offsets[u]; arc < offsets[u + 1]; arc++) {
+            int v = targets[arc];
+            double candidate = d + weights[arc];
+            if (reached[v] != query || candidate < dist[v]) {
+                reached[v] = query;
+                dist[v] = candidate;
+                min_heap_push(heap, v, candidate);
+            }
+        }
+    }
+    return count;
+}
+
+typedef struct {
+    int target;
+    double dist;
+} BucketEntry;
+
+typedef struct {
+    const ContractionHierarchy *hierarchy;
+    const int *sources;
+    int num_targets;
+    const int *bucket_offsets;   // per node, into entries
+    const BucketEntry *entries;
+    float *out;
+    int stride;
+    HierarchySearch *searches;   // one per worker, set up on first use
+    double **rows;
+    atomic_int failed;
+} BucketJob;
+
+static void bucket_row(void *context, int index, int worker) {
+    BucketJob *job = context;
+    const ContractionHierarchy *hierarchy = job->hierarchy;
+    HierarchySearch *search = &job->searches[worker];
+    if (!search->settled) {
+        job->rows[worker] = malloc((job->num_targets > 0 ? job->num_targets : 1) * sizeof(double));
+        if (!job->rows[worker] || hierarchy_search_init(search, hierarchy->num_nodes) != 0) {
+            atomic_store(&job->failed, 1);
+            return;
+        }
+    }
+    double *row = job->rows[worker];
+    for (int j = 0; j < job->num_targets; j++) row[j] = INFINITY;
+    int settled = upward_search(hierarchy->up_offsets, hierarchy->up_targets,
+                                hierarchy->up_weights, job->sources[index], search);
+    for (int i = 0; i < settled; i++) {
+        int u = search->settled[i];
+        double d = search->forward_dist[u];
+        for (int e = job->bucket_offsets[u]; e < job->bucket_offsets[u + 1]; e++) {
+            const BucketEntry *entry = &job->entries[e];
+            if (d + entry->dist < row[entry->target]) row[entry->target] = d + entry->dist;
+        }
+    }
+    float *out = job->out + (size_t)index * job->stride;
+    for (int j = 0; j < job->num_targets; j++) out[j] = (float)row[j];
+}
+
+int contraction_hierarchy_many_to_many(const ContractionHierarchy *hierarchy, const int *sources,
+                                       int num_sources, const int *targets, int num_targets,
+                                       float *out, int stride, ThreadPool *pool) {
+    int n = hierarchy->num_nodes;
+    if (num_sources < 0 || num_targets < 0 || stride < num_targets) return -1;
+    for (int i = 0; i < num_sources; i++) {
+        if (sources[i] < 0 || sources[i] >= n) return -1;
+    }
+    for (int j = 0; j < num_targets; j++) {
+        if (targets[j] < 0 || targets[j] >= n) return -1;
+    }
+    if (num_sources == 0) return 0;
+
+    // Backward phase: (node, target, distance) triples, then bucketed by
+    // node with a counting sort
+    HierarchySearch search;
+    int *bucket_offsets = calloc(n + 1, sizeof(int));
+    int *entry_node = NULL;
+    BucketEntry *unsorted = NULL, *entries = NULL;
+    size_t count = 0, capacity = 0;
+    int status = -1;
+    if (!bucket_offsets || hierarchy_search_init(&search, n) != 0) {
+        free(bucket_offsets);
+        return -1;
+    }
+    for (int j = 0; j < num_targets; j++) {
+        int settled = upward_search(hierarchy->down_offsets, hierarchy->down_targets,
+                                    hierarchy->down_weights, targets[j], &search);
+        if (count + settled > capacity) {
+            size_t grown = capacity ? 2 * capacity : 1024;
+            while (grown < count + settled) grown *= 2;
+            int *nodes = realloc(entry_node, grown * sizeof(int));
+            if (!nodes) goto done;
+            entry_node = nodes;
+            BucketEntry *grown_entries = realloc(unsorted, grown * sizeof(BucketEntry));
+            if (!grown_entries) goto done;
+            unsorted = grown_entries;
+            capacity = grown;
+        }
+        for (int i = 0; i < settled; i++) {
+            int v = search.settled[i];
+            entry_node[count] = v;
+            unsorted[count++] = (BucketEntry){j, search.forward_dist[v]};
+            bucket_offsets[v + 1]++;
+        }
+    }
+    for (int v = 0; v < n; v++) bucket_offsets[v + 1] += bucket_offsets[v];
+    entries = malloc((count > 0 ? count : 1) * sizeof(BucketEntry));
+    int *fill = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!entries || !fill) {
+        free(fill);
+        goto done;
+    }
+    memcpy(fill, bucket_offsets, n * sizeof(int));
+    for (size_t e = 0; e < count; e++) entries[fill[entry_node[e]]++] = unsorted[e];
+    free(fill);
+    free(unsorted);
+    free(entry_node);
+    unsorted = NULL;
+    entry_node = NULL;
+
+    // Forward phase, one source per task
+    int workers = thread_pool_size(pool);
+    BucketJob job = {hierarchy, sources, num_targets, bucket_offsets, entries, out, stride,
+                     calloc(workers, sizeof(HierarchySearch)), calloc(workers, sizeof(double *)), 0};
+    if (job.searches && job.rows) {
+        thread_pool_parallel_for(pool, num_sources, bucket_row, &job);
+        status = atomic_load(&job.failed) ? -1 : 0;
+    }
+    for (int w = 0; job.searches && w < workers; w++) hierarchy_search_free(&job.searches[w]);
+    for (int w = 0; job.rows && w < workers; w++) free(job.rows[w]);
+    free(job.searches);
+    free(job.rows);
+
+done:
+    hierarchy_search_free(&search);
+    free(bucket_offsets);
+    free(entry_node);
+    free(unsorted);
+    free(entries);
+    return status;
+}
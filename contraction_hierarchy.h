@@ -0,0 +1,76 @@
+#ifndef DELIVERY_CONTRACTION_HIERARCHY_H
+#define DELIVERY_CONTRACTION_HIERARCHY_H
+
+#include <stdint.h>
+
+#include "min_heap.h"
+#include "road_graph.h"
+#include "thread_pool.h"
+
+#define CONTRACTION_HIERARCHY_MAGIC "DLVRYCH1"
+
+// Contraction hierarchy over a RoadGraph. Nodes are contracted one by one
+// (least important first) and shortcuts keep the distances between the
+// remaining ones. What is left are the arcs towards more important nodes,
+// in CSR form like RoadGraph: "up" arcs for the forward search from a
+// source and reversed "down" arcs for the backward search from a target.
+// Shortest paths meet at their most important node, so both searches only
+// climb and settle a few hundred nodes even on city-scale graphs.
+typedef struct {
+    int num_nodes;
+    uint64_t graph_hash;     // road_graph_hash() of the graph it was built from
+    int *up_offsets;
+    int *up_targets;
+    double *up_weights;
+    int *down_offsets;
+    int *down_targets;
+    double *down_weights;
+} ContractionHierarchy;
+
+typedef struct {
+    int shortcuts;
+    double elapsed;
+} ContractionStats;
+
+// Preprocessing. Ties and duplicate arcs are fine; self loops are dropped.
+// stats may be NULL. Returns 0 or -1 on allocation failure.
+int contraction_hierarchy_build(ContractionHierarchy *hierarchy, const RoadGraph *graph,
+                                ContractionStats *stats);
+void contraction_hierarchy_free(ContractionHierarchy *hierarchy);
+
+// Binary file in native byte order. Loading fails (-1, reported on stderr)
+// for a damaged file or one built for another graph (graph may be NULL to
+// skip that check).
+int contraction_hierarchy_save(const ContractionHierarchy *hierarchy, const char *path);
+int contraction_hierarchy_load(ContractionHierarchy *hierarchy, const char *path,
+                               const RoadGraph *graph);
+
+// Per-thread query scratch, labels versioned per query like
+// RoadSearchWorkspace.
+typedef struct {
+    MinHeap forward_heap, backward_heap;
+    double *forward_dist, *backward_dist;
+    unsigned int *forward_reached, *backward_reached;
+    int *settled;
+    unsigned int query;
+    int num_nodes;
+} HierarchySearch;
+
+int hierarchy_search_init(HierarchySearch *search, int num_nodes);
+void hierarchy_search_free(HierarchySearch *search);
+
+// Shortest distance from src to target by bidirectional upward search,
+// INFINITY when unreachable or out of range.
+double contraction_hierarchy_distance(const ContractionHierarchy *hierarchy, int src, int target,
+                                      HierarchySearch *search);
+
+// Distances from every source to every target with the bucket algorithm:
+// one backward search per target stores (target, distance) at each node it
+// reaches, then one forward search per source, spread over pool, scans the
+// buckets of the nodes it settles. Row i goes to out + i * stride as floats.
+// Returns 0 or -1 on bad input or allocation failure.
+int contraction_hierarchy_many_to_many(const ContractionHierarchy *hierarchy, const int *sources,
+                                       int num_sources, const int *targets, int num_targets,
+                                       float *out, int stride, ThreadPool *pool);
+
+#endif
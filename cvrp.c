@@ -0,0 +1,794 @@
+#include "cvrp.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "solver_clock.h"
+
+#define MOVE_EPSILON 1e-6
+
+// A delivery: some packages for one destination that fit one vehicle.
+typedef struct {
+    int point;
+    int load;
+    int first_package;  // into DepotTask.job_packages
+    int num_packages;
+} Job;
+
+typedef struct {
+    int *jobs;
+    int length;
+    int capacity;
+    int load;
+    int *points;              // depot and the jobs' points, with windows only
+    int point_capacity;
+    TourSchedule schedule;    // of points
+} JobRoute;
+
+typedef struct {
+    const DeliveryProblem *problem;
+    const DistanceMatrix *matrix;
+    const CvrpOptions *options;
+    const TimeWindows *windows;  // NULL when the problem has none
+    int depot;
+    int *packages;       // package indices served from this depot
+    int num_packages;
+
+    Job *jobs;
+    int num_jobs;
+    int *job_packages;
+    int *neighbours;     // num_jobs * k nearest jobs
+    int k;
+    JobRoute *routes;
+    int num_routes;
+    int *route_of;       // job -> route, -1 when dropped
+    int *pos;            // job -> index in its route
+    int *dropped;        // packages this depot could not serve
+    int num_dropped;
+
+    int merges;
+    int relocates;
+    int exchanges;
+    double savings_distance;
+    int status;
+} DepotTask;
+
+typedef struct {
+    int destination;
+    int weight;
+    int package;
+} PackageKey;
+
+typedef struct {
+    double saving;
+    int i, j;
+} Saving;
+
+// A savings chain driven from the depot, forward and reversed
+typedef struct {
+    double depart[2];   // leaving its last job
+    double latest[2];   // latest arrival at its first job that keeps the rest within limits
+} ChainTimes;
+
+static int compare_package_keys(const void *a, const void *b) {
+    const PackageKey *x = a, *y = b;
+    if (x->destination != y->destination) return x->destination < y->destination ? -1 : 1;
+    if (x->weight != y->weight) return x->weight > y->weight ? -1 : 1;
+    return x->package - y->package;
+}
+
+static int compare_savings(const void *a, const void *b) {
+    const Saving *x = a, *y = b;
+    if (x->saving != y->saving) return x->saving > y->saving ? -1 : 1;
+    if (x->i != y->i) return x->i - y->i;
+    return x->j - y->j;
+}
+
+static inline double point_cost(const DepotTask *task, int a, int b) {
+    return distance_matrix_get(task->matrix, a, b);
+}
+
+// Splits each destination's packages into vehicle-sized jobs with
+// first-fit decreasing.
+static int build_jobs(DepotTask *task) {
+    int n = task->num_packages;
+    int capacity = task->options->vehicle_capacity;
+    PackageKey *keys = malloc((n > 0 ? n : 1) * sizeof(PackageKey));
+    int *job_of = malloc((n > 0 ? n : 1) * sizeof(int));
+    task->jobs = malloc((n > 0 ? n : 1) * sizeof(Job));
+    task->job_packages = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!keys || !job_of || !task->jobs || !task->job_packages) {
+        free(keys);
+        free(job_of);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const PackageTable *packages = &task->problem->packages;
+        keys[i].destination = packages->destination_id[task->packages[i]];
+        keys[i].weight = packages->weight[task->packages[i]];
+        keys[i].package = task->packages[i];
+    }
+    qsort(keys, n, sizeof(PackageKey), compare_package_keys);
+
+    task->num_jobs = 0;
+    for (int start = 0; start < n;) {
+        int end = start;
+        while (end < n && keys[end].destination == keys[start].destination) end++;
+        int first_job = task->num_jobs;
+        for (int i = start; i < end; i++) {
+            int job = first_job;
+            while (job < task->num_jobs && task->jobs[job].load + keys[i].weight > capacity) job++;
+            if (job == task->num_jobs) {
+                task->jobs[job].point = keys[i].destination;
+                task->jobs[job].load = 0;
+                task->jobs[job].num_packages = 0;
+                task->num_jobs++;
+            }
+            task->jobs[job].load += keys[i].weight;
+            task->jobs[job].num_packages++;
+            job_of[i] = job;
+        }
+        start = end;
+    }
+
+    int offset = 0;
+    for (int j = 0; j < task->num_jobs; j++) {
+        task->jobs[j].first_package = offset;
+        offset += task->jobs[j].num_packages;
+        task->jobs[j].num_packages = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        Job *job = &task->jobs[job_of[i]];
+        task->job_packages[job->first_package + job->num_packages++] = keys[i].package;
+    }
+    free(keys);
+    free(job_of);
+    return 0;
+}
+
+static int build_neighbours(DepotTask *task) {
+    int m = task->num_jobs;
+    int k = task->options->neighbours > 0 ? task->options->neighbours : 1;
+    if (k > m - 1) k = m - 1;
+    task->k = k;
+    if (k <= 0) return 0;
+
+    task->neighbours = malloc((size_t)m * k * sizeof(int));
+    double *best = malloc(k * sizeof(double));
+    if (!task->neighbours || !best) {
+        free(best);
+        return -1;
+    }
+    for (int a = 0; a < m; a++) {
+        int *list = task->neighbours + (size_t)a * k;
+        int count = 0;
+        for (int b = 0; b < m; b++) {
+            if (b == a) continue;
+            double d = point_cost(task, task->jobs[a].point, task->jobs[b].point);
+            if (!isfinite(d) || (count == k && d >= best[k - 1])) continue;
+            int slot = count < k ? count++ : k - 1;
+            while (slot > 0 && best[slot - 1] > d) {
+                best[slot] = best[slot - 1];
+                list[slot] = list[slot - 1];
+                slot--;
+            }
+            best[slot] = d;
+            list[slot] = b;
+        }
+        for (int i = count; i < k; i++) list[i] = -1;
+    }
+    free(best);
+    return 0;
+}
+
+static void reverse_chain(int route, int *first, int *last, int *next, int *prev) {
+    for (int job = first[route]; job != -1;) {
+        int following = next[job];
+        next[job] = prev[job];
+        prev[job] = following;
+        job = following;
+    }
+    int old_first = first[route];
+    first[route] = last[route];
+    last[route] = old_first;
+}
+
+static int chain_times(DepotTask *task, int route, const int *first, const int *last,
+                       const int *next, const int *prev, int *points, TourSchedule *schedule,
+                       ChainTimes *times) {
+    for (int reversed = 0; reversed < 2; reversed++) {
+        int length = 0;
+        points[length++] = task->depot;
+        for (int job = reversed ? last[route] : first[route]; job != -1;
+             job = reversed ? prev[job] : next[job]) {
+            points[length++] = task->jobs[job].point;
+        }
+        if (tour_schedule_update(schedule, task->windows, task->matrix, points, length) != 0) return -1;
+        times[route].depart[reversed] =
+            schedule->start[length - 1] + task->windows->service[points[length - 1]];
+        times[route].latest[reversed] = schedule->latest[1];
+    }
+    return 0;
+}
+
+// Whether driving tail's chain straight after head's, flip (one of them or
+// -1) reversed, keeps every stop of tail within its limit; head's stops
+// are not delayed. O(1).
+static int merge_on_time(const DepotTask *task, const ChainTimes *times, int head, int tail,
+                         int flip, const int *first, const int *last) {
+    int h = head == flip, t = tail == flip;
+    int from = task->jobs[h ? first[head] : last[head]].point;
+    int to = task->jobs[t ? last[tail] : first[tail]].point;
+    double arrival = times[head].depart[h] + time_window_travel(task->windows, task->matrix, from, to);
+    return arrival <= times[tail].latest[t] + MOVE_EPSILON;
+}
+
+// Clarke-Wright parallel savings over the neighbour pairs. With windows a
+// merge may not make any stop later than its close, or than it already was.
+static int savings_construction(DepotTask *task) {
+    int m = task->num_jobs;
+    int capacity = task->options->vehicle_capacity;
+    int depot = task->depot;
+
+    int count = m > 0 ? m : 1;
+    Saving *savings = malloc(((size_t)m * task->k + 1) * sizeof(Saving));
+    int *next = malloc(count * sizeof(int));
+    int *prev = malloc(count * sizeof(int));
+    int *first = malloc(count * sizeof(int));
+    int *last = malloc(count * sizeof(int));
+    int *load = malloc(count * sizeof(int));
+    int *size = malloc(count * sizeof(int));
+    task->route_of = malloc(count * sizeof(int));
+    task->pos = malloc(count * sizeof(int));
+    ChainTimes *times = task->windows ? malloc(count * sizeof(ChainTimes)) : NULL;
+    int *points = task->windows ? malloc((count + 1) * sizeof(int)) : NULL;
+    TourSchedule schedule = {0};
+    int status = -1;
+    if (!savings || !next || !prev || !first || !last || !load || !size || !task->route_of ||
+        !task->pos || (task->windows && (!times || !points))) {
+        goto done;
+    }
+
+    int num_savings = 0;
+    for (int i = 0; i < m; i++) {
+        const int *list = task->neighbours + (size_t)i * task->k;
+        for (int n = 0; n < task->k && list[n] >= 0; n++) {
+            int j = list[n];
+            int a = task->jobs[i].point, b = task->jobs[j].point;
+            double saving = point_cost(task, depot, a) + point_cost(task, depot, b) - point_cost(task, a, b);
+            if (saving > 0) savings[num_savings++] = (Saving){saving, i < j ? i : j, i < j ? j : i};
+        }
+    }
+    qsort(savings, num_savings, sizeof(Saving), compare_savings);
+
+    for (int r = 0; r < m; r++) {
+        next[r] = prev[r] = -1;
+        first[r] = last[r] = r;
+        load[r] = task->jobs[r].load;
+        size[r] = 1;
+        task->route_of[r] = r;
+        if (task->windows &&
+            chain_times(task, r, first, last, next, prev, points, &schedule, times) != 0) {
+            goto done;
+        }
+    }
+
+    for (int s = 0; s < num_savings; s++) {
+        int i = savings[s].i, j = savings[s].j;
+        int ri = task->route_of[i], rj = task->route_of[j];
+        if (ri == rj || load[ri] + load[rj] > capacity) continue;
+        int i_first = first[ri] == i, i_last = last[ri] == i;
+        int j_first = first[rj] == j, j_last = last[rj] == j;
+        if (!(i_first || i_last) || !(j_first || j_last)) continue;
+
+        // Orient the chains so the result reads (... i)(j ...)
+        int in_order = i_last && j_first, swapped = !in_order && i_first && j_last;
+        int head = swapped ? rj : ri, tail = swapped ? ri : rj;
+        int flip = in_order || swapped ? -1 : i_last ? rj : ri;
+        if (task->windows && !merge_on_time(task, times, head, tail, flip, first, last)) continue;
+        if (flip >= 0) reverse_chain(flip, first, last, next, prev);
+
+        next[last[head]] = first[tail];
+        prev[first[tail]] = last[head];
+        int keep = size[head] >= size[tail] ? head : tail;
+        int drop = keep == head ? tail : head;
+        for (int job = first[drop]; job != -1; job = next[job]) {
+            if (task->route_of[job] != drop) break;
+            task->route_of[job] = keep;
+        }
+        int new_first = first[head], new_last = last[tail];
+        first[keep] = new_first;
+        last[keep] = new_last;
+        load[keep] = load[head] + load[tail];
+        size[keep] = size[head] + size[tail];
+        size[drop] = 0;
+        task->merges++;
+        if (task->windows &&
+            chain_times(task, keep, first, last, next, prev, points, &schedule, times) != 0) {
+            goto done;
+        }
+    }
+
+    task->routes = calloc(count, sizeof(JobRoute));
+    if (!task->routes) goto done;
+    task->num_routes = 0;
+    for (int r = 0; r < m; r++) {
+        if (size[r] == 0) continue;
+        JobRoute *route = &task->routes[task->num_routes];
+        route->jobs = malloc(size[r] * sizeof(int));
+        if (!route->jobs) goto done;
+        route->capacity = size[r];
+        route->load = load[r];
+        for (int job = first[r]; job != -1; job = next[job]) {
+            task->route_of[job] = task->num_routes;
+            task->pos[job] = route->length;
+            route->jobs[route->length++] = job;
+        }
+        task->num_routes++;
+    }
+    status = 0;
+
+done:
+    free(savings);
+    free(next);
+    free(prev);
+    free(first);
+    free(last);
+    free(load);
+    free(size);
+    free(times);
+    free(points);
+    tour_schedule_free(&schedule);
+    return status;
+}
+
+static int compare_route_load(const void *a, const void *b) {
+    const JobRoute *x = a, *y = b;
+    return y->load - x->load;
+}
+
+static void drop_job_packages(DepotTask *task, const Job *job) {
+    for (int p = 0; p < job->num_packages; p++) {
+        task->dropped[task->num_dropped++] = task->job_packages[job->first_package + p];
+    }
+}
+
+// Keeps the max_vehicles heaviest routes; the others' packages are dropped.
+static void enforce_vehicle_limit(DepotTask *task) {
+    int limit = task->options->max_vehicles;
+    if (limit <= 0 || task->num_routes <= limit) return;
+
+    qsort(task->routes, task->num_routes, sizeof(JobRoute), compare_route_load);
+    for (int r = limit; r < task->num_routes; r++) {
+        JobRoute *route = &task->routes[r];
+        for (int i = 0; i < route->length; i++) {
+            drop_job_packages(task, &task->jobs[route->jobs[i]]);
+            task->route_of[route->jobs[i]] = -1;
+        }
+        free(route->jobs);
+    }
+    task->num_routes = limit;
+    for (int r = 0; r < task->num_routes; r++) {
+        for (int i = 0; i < task->routes[r].length; i++) {
+            task->route_of[task->routes[r].jobs[i]] = r;
+            task->pos[task->routes[r].jobs[i]] = i;
+        }
+    }
+}
+
+static inline int point_at(const DepotTask *task, const JobRoute *route, int index) {
+    if (index < 0 || index >= route->length) return task->depot;
+    return task->jobs[route->jobs[index]].point;
+}
+
+static double routes_distance(const DepotTask *task) {
+    double total = 0;
+    for (int r = 0; r < task->num_routes; r++) {
+        const JobRoute *route = &task->routes[r];
+        if (route->length == 0) continue;
+        for (int i = 0; i <= route->length; i++) {
+            total += point_cost(task, point_at(task, route, i - 1), point_at(task, route, i));
+        }
+    }
+    return total;
+}
+
+static int route_insert(DepotTask *task, int r, int index, int job) {
+    JobRoute *route = &task->routes[r];
+    if (route->length == route->capacity) {
+        int capacity = route->capacity ? 2 * route->capacity : 4;
+        int *jobs = realloc(route->jobs, capacity * sizeof(int));
+        if (!jobs) return -1;
+        route->jobs = jobs;
+        route->capacity = capacity;
+    }
+    memmove(route->jobs + index + 1, route->jobs + index, (route->length - index) * sizeof(int));
+    route->jobs[index] = job;
+    route->length++;
+    route->load += task->jobs[job].load;
+    for (int i = index; i < route->length; i++) task->pos[route->jobs[i]] = i;
+    task->route_of[job] = r;
+    return 0;
+}
+
+// Refreshes the points and schedule of route r after a change
+static int route_schedule(DepotTask *task, int r) {
+    JobRoute *route = &task->routes[r];
+    if (route->point_capacity < route->length + 1) {
+        int *points = realloc(route->points, (route->capacity + 1) * sizeof(int));
+        if (!points) return -1;
+        route->points = points;
+        route->point_capacity = route->capacity + 1;
+    }
+    route->points[0] = task->depot;
+    for (int i = 0; i < route->length; i++) route->points[i + 1] = task->jobs[route->jobs[i]].point;
+    return tour_schedule_update(&route->schedule, task->windows, task->matrix, route->points,
+                                route->length + 1);
+}
+
+// Whether point can go in after the job at index - 1 (replace: instead of
+// the one at index) with no stop later than its limit and point itself no
+// later than late minutes. Always with no windows.
+static int visit_on_time(const DepotTask *task, const JobRoute *route, int index, int point,
+                         int replace, double late) {
+    if (!task->windows) return 1;
+    double lateness = replace
+        ? tour_schedule_replace_lateness(&route->schedule, task->windows, task->matrix, index + 1, point)
+        : tour_schedule_insert_lateness(&route->schedule, task->windows, task->matrix, index, point);
+    return lateness <= late + MOVE_EPSILON;
+}
+
+static double job_lateness(const DepotTask *task, const JobRoute *route, int index) {
+    if (!task->windows) return 0;
+    double late = route->schedule.start[index + 1] - task->windows->close[route->points[index + 1]];
+    return late > 0 ? late : 0;
+}
+
+static void route_erase(DepotTask *task, int r, int index) {
+    JobRoute *route = &task->routes[r];
+    route->load -= task->jobs[route->jobs[index]].load;
+    memmove(route->jobs + index, route->jobs + index + 1, (route->length - index - 1) * sizeof(int));
+    route->length--;
+    for (int i = index; i < route->length; i++) task->pos[route->jobs[i]] = i;
+}
+
+// Best relocate or exchange of job u with a job in another route. With
+// windows, u and the job it swaps with may end up no later than they are,
+// and no other stop past its limit; taking a job out of a route only makes
+// the rest of it earlier.
+static int improve_job(DepotTask *task, int u) {
+    int capacity = task->options->vehicle_capacity;
+    int ru = task->route_of[u];
+    if (ru < 0) return 0;
+    JobRoute *route_u = &task->routes[ru];
+    int pu = task->pos[u];
+    int point_u = task->jobs[u].point;
+    int load_u = task->jobs[u].load;
+    int u_prev = point_at(task, route_u, pu - 1), u_next = point_at(task, route_u, pu + 1);
+    double removal_gain = point_cost(task, u_prev, point_u) + point_cost(task, point_u, u_next) -
+                          point_cost(task, u_prev, u_next);
+    double late_u = job_lateness(task, route_u, pu);
+
+    double best_delta = -MOVE_EPSILON;
+    int best_v = -1, best_kind = 0;  // kind 1/2: relocate after/before v, 3: exchange
+    const int *list = task->neighbours + (size_t)u * task->k;
+    for (int n = 0; n < task->k && list[n] >= 0; n++) {
+        int v = list[n];
+        int rv = task->route_of[v];
+        if (rv < 0 || rv == ru) continue;
+        JobRoute *route_v = &task->routes[rv];
+        int pv = task->pos[v];
+        int point_v = task->jobs[v].point;
+        int v_prev = point_at(task, route_v, pv - 1), v_next = point_at(task, route_v, pv + 1);
+
+        if (route_v->load + load_u <= capacity) {
+            double after = point_cost(task, point_v, point_u) + point_cost(task, point_u, v_next) -
+                           point_cost(task, point_v, v_next) - removal_gain;
+            double before = point_cost(task, v_prev, point_u) + point_cost(task, point_u, point_v) -
+                            point_cost(task, v_prev, point_v) - removal_gain;
+            if (after < best_delta && visit_on_time(task, route_v, pv + 1, point_u, 0, late_u)) {
+                best_delta = after;
+                best_v = v;
+                best_kind = 1;
+            }
+            if (before < best_delta && visit_on_time(task, route_v, pv, point_u, 0, late_u)) {
+                best_delta = before;
+                best_v = v;
+                best_kind = 2;
+            }
+        }
+
+        int load_v = task->jobs[v].load;
+        if (route_u->load - load_u + load_v <= capacity && route_v->load - load_v + load_u <= capacity) {
+            double delta = point_cost(task, u_prev, point_v) + point_cost(task, point_v, u_next) -
+                           point_cost(task, u_prev, point_u) - point_cost(task, point_u, u_next) +
+                           point_cost(task, v_prev, point_u) + point_cost(task, point_u, v_next) -
+                           point_cost(task, v_prev, point_v) - point_cost(task, point_v, v_next);
+            if (delta < best_delta && visit_on_time(task, route_v, pv, point_u, 1, late_u) &&
+                visit_on_time(task, route_u, pu, point_v, 1, job_lateness(task, route_v, pv))) {
+                best_delta = delta;
+                best_v = v;
+                best_kind = 3;
+            }
+        }
+    }
+    if (best_v < 0) return 0;
+
+    int rv = task->route_of[best_v];
+    if (best_kind == 3) {
+        int pv = task->pos[best_v];
+        JobRoute *route_v = &task->routes[rv];
+        route_u->jobs[pu] = best_v;
+        route_v->jobs[pv] = u;
+        route_u->load += task->jobs[best_v].load - load_u;
+        route_v->load += load_u - task->jobs[best_v].load;
+        task->route_of[u] = rv;
+        task->pos[u] = pv;
+        task->route_of[best_v] = ru;
+        task->pos[best_v] = pu;
+        task->exchanges++;
+        if (task->windows && (route_schedule(task, ru) != 0 || route_schedule(task, rv) != 0)) {
+            task->status = -1;
+        }
+        return 1;
+    }
+
+    route_erase(task, ru, pu);
+    int index = task->pos[best_v] + (best_kind == 1 ? 1 : 0);
+    if (route_insert(task, rv, index, u) != 0) {
+        // Out of memory: put u back where it was
+        route_insert(task, ru, pu, u);
+        task->status = -1;
+        return 0;
+    }
+    task->relocates++;
+    if (task->windows && (route_schedule(task, ru) != 0 || route_schedule(task, rv) != 0)) {
+        task->status = -1;
+    }
+    return 1;
+}
+
+static void inter_route_search(DepotTask *task) {
+    double budget = task->options->time_budget;
+    double start = solver_clock_seconds();
+    int improved = 1;
+    while (improved && task->status == 0) {
+        improved = 0;
+        for (int u = 0; u < task->num_jobs; u++) {
+            if (improve_job(task, u)) improved = 1;
+            if (budget > 0 && (u & 255) == 255 && solver_clock_seconds() - start > budget) return;
+        }
+        if (budget > 0 && solver_clock_seconds() - start > budget) return;
+    }
+}
+
+static void solve_depot(void *context, int index, int worker) {
+    DepotTask *task = &((DepotTask *)context)[index];
+    (void)worker;  // scratch is per depot, not per worker
+    task->dropped = malloc((task->num_packages > 0 ? task->num_packages : 1) * sizeof(int));
+    if (!task->dropped || build_jobs(task) != 0 || build_neighbours(task) != 0 ||
+        savings_construction(task) != 0) {
+        task->status = -1;
+        return;
+    }
+    enforce_vehicle_limit(task);
+    task->savings_distance = routes_distance(task);
+    for (int r = 0; task->windows && r < task->num_routes; r++) {
+        if (route_schedule(task, r) != 0) {
+            task->status = -1;
+            return;
+        }
+    }
+    inter_route_search(task);
+}
+
+typedef struct {
+    const DistanceMatrix *matrix;
+    const TourImproveOptions *improve;
+    VehicleRoute *vehicles;
+    Arena *arenas;            // one per pool worker
+    atomic_int failed;
+} PolishJob;
+
+static void polish_route(void *context, int index, int worker) {
+    PolishJob *job = context;
+    VehicleRoute *vehicle = &job->vehicles[index];
+    TourImproveOptions improve = *job->improve;
+    improve.arena = &job->arenas[worker];
+    if (tour_improve(job->matrix, vehicle->stops, vehicle->num_stops, &improve, NULL) != 0) {
+        atomic_store(&job->failed, 1);
+    }
+
+    // Several loads for the same destination end up next to each other
+    int length = 1;
+    for (int i = 1; i < vehicle->num_stops; i++) {
+        if (vehicle->stops[i] != vehicle->stops[length - 1]) vehicle->stops[length++] = vehicle->stops[i];
+    }
+    while (length > 1 && vehicle->stops[length - 1] == vehicle->stops[0]) length--;
+    vehicle->num_stops = length;
+}
+
+static int emit_routes(DepotTask *task, DeliveryPlan *plan) {
+    for (int r = 0; r < task->num_routes; r++) {
+        const JobRoute *route = &task->routes[r];
+        if (route->length == 0) continue;
+
+        VehicleRoute *vehicle = delivery_plan_add_vehicle(plan, task->depot);
+        if (!vehicle) return -1;
+        int num_packages = 0;
+        for (int i = 0; i < route->length; i++) num_packages += task->jobs[route->jobs[i]].num_packages;
+        vehicle->stops = malloc((route->length + 1) * sizeof(int));
+        vehicle->packages = malloc((num_packages > 0 ? num_packages : 1) * sizeof(int));
+        if (!vehicle->stops || !vehicle->packages) return -1;
+
+        vehicle->stops[vehicle->num_stops++] = task->depot;
+        for (int i = 0; i < route->length; i++) {
+            const Job *job = &task->jobs[route->jobs[i]];
+            vehicle->stops[vehicle->num_stops++] = job->point;
+            memcpy(vehicle->packages + vehicle->num_packages, task->job_packages + job->first_package,
+                   job->num_packages * sizeof(int));
+            vehicle->num_packages += job->num_packages;
+        }
+        vehicle->load = route->load;
+    }
+    return 0;
+}
+
+static void free_task(DepotTask *task) {
+    free(task->packages);
+    free(task->jobs);
+    free(task->job_packages);
+    free(task->neighbours);
+    for (int r = 0; r < task->num_routes; r++) {
+        free(task->routes[r].jobs);
+        free(task->routes[r].points);
+        tour_schedule_free(&task->routes[r].schedule);
+    }
+    free(task->routes);
+    free(task->route_of);
+    free(task->pos);
+    free(task->dropped);
+}
+
+void cvrp_default_options(CvrpOptions *options) {
+    options->vehicle_capacity = 50;
+    options->max_vehicles = 0;
+    options->neighbours = 30;
+    options->time_budget = 2.0;
+    tour_improve_default_options(&options->improve);
+    options->improve.time_budget = 0.2;
+}
+
+int cvrp_solve(const DeliveryProblem *problem, const CvrpOptions *options, ThreadPool *pool,
+               DeliveryPlan *plan, CvrpStats *stats) {
+    CvrpOptions defaults;
+    CvrpStats local_stats;
+    if (!options) {
+        cvrp_default_options(&defaults);
+        options = &defaults;
+    }
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(CvrpStats));
+    delivery_plan_clear(plan);
+
+    int n = problem->points.count;
+    if (n == 0) return 0;
+    DistanceMatrix local_matrix;
+    const DistanceMatrix *matrix = delivery_problem_matrix(problem, &local_matrix);
+    if (!matrix) return -1;
+
+    MetricScope scope = metrics_begin(METRIC_TIMER_CVRP);
+    int num_depots = 0;
+    for (int i = 0; i < n; i++) num_depots += problem->points.is_depot[i] != 0;
+    DepotTask *tasks = calloc(num_depots > 0 ? num_depots : 1, sizeof(DepotTask));
+    const PackageTable *packages = &problem->packages;
+    int *depot_of = malloc((packages->count > 0 ? packages->count : 1) * sizeof(int));
+    TimeWindows windows = {0};
+    plan->unassigned = malloc((packages->count > 0 ? packages->count : 1) * sizeof(int));
+    int num_workers = pool ? thread_pool_size(pool) : 1;
+    Arena *arenas = malloc(num_workers * sizeof(Arena));
+    int status = -1;
+    if (arenas) {
+        for (int w = 0; w < num_workers; w++) arena_init(&arenas[w], 0);
+    }
+    if (!tasks || !depot_of || !plan->unassigned || !arenas) goto done;
+
+    if (num_depots == 0) {
+        tasks[0].depot = 0;
+        num_depots = 1;
+    } else {
+        for (int i = 0, d = 0; i < n; i++) {
+            if (problem->points.is_depot[i]) tasks[d++].depot = i;
+        }
+    }
+
+    // Nearest depot for every package that a vehicle can carry at all
+    for (int p = 0; p < packages->count; p++) {
+        int destination = packages->destination_id[p];
+        depot_of[p] = -1;
+        if (packages->weight[p] > options->vehicle_capacity) {
+            plan->unassigned[plan->num_unassigned++] = p;
+            continue;
+        }
+        double best = INFINITY;
+        for (int d = 0; d < num_depots; d++) {
+            int depot = tasks[d].depot;
+            double there_and_back = distance_matrix_get(matrix, depot, destination) +
+                                    distance_matrix_get(matrix, destination, depot);
+            if (there_and_back < best) {
+                best = there_and_back;
+                depot_of[p] = d;
+            }
+        }
+        if (depot_of[p] < 0) {
+            plan->unassigned[plan->num_unassigned++] = p;
+        } else {
+            tasks[depot_of[p]].num_packages++;
+        }
+    }
+    // Every stage keeps to the delivery windows, if any
+    TourImproveOptions improve = options->improve;
+    if (!improve.windows && delivery_problem_has_time_windows(problem)) {
+        if (delivery_problem_time_windows(problem, &windows) != 0) goto done;
+        improve.windows = &windows;
+    }
+    for (int d = 0; d < num_depots; d++) {
+        tasks[d].problem = problem;
+        tasks[d].matrix = matrix;
+        tasks[d].options = options;
+        tasks[d].windows = improve.windows;
+        tasks[d].packages = malloc((tasks[d].num_packages > 0 ? tasks[d].num_packages : 1) * sizeof(int));
+        if (!tasks[d].packages) goto done;
+        tasks[d].num_packages = 0;
+    }
+    for (int p = 0; p < packages->count; p++) {
+        if (depot_of[p] >= 0) {
+            DepotTask *task = &tasks[depot_of[p]];
+            task->packages[task->num_packages++] = p;
+        }
+    }
+
+    thread_pool_parallel_for(pool, num_depots, solve_depot, tasks);
+
+    for (int d = 0; d < num_depots; d++) {
+        DepotTask *task = &tasks[d];
+        if (task->status != 0) goto done;
+        if (emit_routes(task, plan) != 0) goto done;
+        for (int i = 0; i < task->num_dropped; i++) {
+            plan->unassigned[plan->num_unassigned++] = task->dropped[i];
+        }
+        stats->savings_merges += task->merges;
+        stats->relocate_moves += task->relocates;
+        stats->exchange_moves += task->exchanges;
+        stats->savings_distance += task->savings_distance;
+    }
+
+    PolishJob polish = {matrix, &improve, plan->vehicles, arenas, 0};
+    thread_pool_parallel_for(pool, plan->num_vehicles, polish_route, &polish);
+    if (atomic_load(&polish.failed)) goto done;
+
+    delivery_plan_update_totals(plan, matrix);
+    stats->routes = plan->num_vehicles;
+    stats->final_distance = plan->total_distance;
+    status = 0;
+
+done:
+    if (tasks) {
+        for (int d = 0; d < num_depots; d++) free_task(&tasks[d]);
+    }
+    free(tasks);
+    free(depot_of);
+    if (arenas) {
+        for (int w = 0; w < num_workers; w++) arena_free(&arenas[w]);
+    }
+    free(arenas);
+    time_windows_free(&windows);
+    distance_matrix_free(&local_matrix);
+    if (status != 0) delivery_plan_clear(plan);
+    metrics_end(&scope);
+    return status;
+}
@@ -0,0 +1,41 @@
+#ifndef DELIVERY_CVRP_H
+#define DELIVERY_CVRP_H
+
+#include "solver.h"
+#include "thread_pool.h"
+#include "tour_improve.h"
+
+typedef struct {
+    int vehicle_capacity;        // kg each vehicle can carry
+    int max_vehicles;            // per depot, 0 = as many as needed
+    int neighbours;              // candidate partners per delivery for savings and moves
+    double time_budget;          // seconds of inter-route moves per depot, <= 0 = no limit
+    TourImproveOptions improve;  // 2-opt/Or-opt applied to every finished route
+} CvrpOptions;
+
+typedef struct {
+    int routes;
+    int savings_merges;
+    int relocate_moves;
+    int exchange_moves;
+    double savings_distance;     // after Clarke-Wright, before any local search
+    double final_distance;
+} CvrpStats;
+
+void cvrp_default_options(CvrpOptions *options);
+
+// Multi-vehicle capacitated routing. Every package goes to its nearest
+// depot; packages for one destination are split into loads that fit a
+// vehicle. Each depot is solved with Clarke-Wright savings followed by
+// inter-route relocate/exchange moves, depots in parallel on pool, and then
+// every route is polished with tour_improve(). With time windows every
+// merge and move is checked against the route's TourSchedule first (O(1)
+// per candidate) and none makes a stop later than its close, or than it
+// already was. Packages heavier than a vehicle, unreachable ones
+// and those left over when max_vehicles is hit are listed in
+// plan->unassigned. stats may be NULL.
+// Returns 0 on success, -1 on allocation failure.
+int cvrp_solve(const DeliveryProblem *problem, const CvrpOptions *options, ThreadPool *pool,
+               DeliveryPlan *plan, CvrpStats *stats);
+
+#endif
@@ -0,0 +1,1087 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "distance_matrix.h"
+#include "instance_generator.h"
+#include "instance_io.h"
+#include "knapsack.h"
+#include "process_memory.h"
+#include "road_graph.h"
+#include "route_repair.h"
+#include "solver.h"
+#include "solver_clock.h"
+#include "spatial_index.h"
+#include "traffic_model.h"
+
+static unsigned int bench_random(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Road-like test network: side x side grid with 4-neighbour streets and
+// integer lengths so the int matrix versions see exactly the same costs.
+static RoadEdge *make_grid_edges(int side, unsigned int seed, int *num_edges) {
+    RoadEdge *edges = malloc(2 * (size_t)side * side * sizeof(RoadEdge));
+    unsigned int state = seed;
+    int count = 0;
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++) {
+            int u = r * side + c;
+            if (c + 1 < side) {
+                edges[count++] = (RoadEdge){u, u + 1, (double)(bench_random(&state) % 100 + 1)};
+            }
+            if (r + 1 < side) {
+                edges[count++] = (RoadEdge){u, u + side, (double)(bench_random(&state) % 100 + 1)};
+            }
+        }
+    }
+    *num_edges = count;
+    return edges;
+}
+
+// Same O(V^2) scan as dijkstra() in solver.c, with the visited buffer
+// supplied by the caller so large grids do not time the allocation.
+static void dense_dijkstra(const int *graph, int n, int src, int *dist, char *visited) {
+    for (int i = 0; i < n; i++) {
+        dist[i] = INF;
+        visited[i] = 0;
+    }
+    dist[src] = 0;
+    for (int count = 0; count < n - 1; count++) {
+        int min_dist = INF, u = -1;
+        for (int v = 0; v < n; v++) {
+            if (!visited[v] && dist[v] <= min_dist) {
+                min_dist = dist[v];
+                u = v;
+            }
+        }
+        if (u == -1) break;
+        visited[u] = 1;
+        const int *row = graph + (size_t)u * n;
+        for (int v = 0; v < n; v++) {
+            if (!visited[v] && row[v] && dist[u] != INF && dist[u] + row[v] < dist[v]) {
+                dist[v] = dist[u] + row[v];
+            }
+        }
+    }
+}
+
+static double time_csr(const RoadGraph *graph, int queries, double *dist) {
+    MinHeap heap;
+    min_heap_init(&heap, graph->num_nodes);
+    double start = solver_clock_seconds();
+    for (int q = 0; q < queries; q++) {
+        road_graph_dijkstra(graph, (int)((long long)q * 7919 % graph->num_nodes), -1, dist, NULL, &heap);
+    }
+    double elapsed = solver_clock_seconds() - start;
+    min_heap_free(&heap);
+    return elapsed / queries;
+}
+
+#define LEGACY_SIDE 7
+#define LEGACY_NODES (LEGACY_SIDE * LEGACY_SIDE)
+
+static int bench_legacy_matrix(void) {
+    static int graph[LEGACY_NODES * LEGACY_NODES];
+    int side = LEGACY_SIDE;
+    int n = LEGACY_NODES;
+    int num_edges;
+    RoadEdge *edges = make_grid_edges(side, 12345, &num_edges);
+    memset(graph, 0, sizeof(graph));
+    for (int i = 0; i < num_edges; i++) {
+        graph[edges[i].from * n + edges[i].to] = (int)edges[i].weight;
+        graph[edges[i].to * n + edges[i].from] = (int)edges[i].weight;
+    }
+    RoadGraph csr;
+    road_graph_build(&csr, n, edges, num_edges, 1);
+
+    int dist[LEGACY_NODES], parent[LEGACY_NODES];
+    double csr_dist[LEGACY_NODES];
+    int queries = 20000;
+    double start = solver_clock_seconds();
+    for (int q = 0; q < queries; q++) {
+        dijkstra(graph, n, q % n, dist, parent);
+    }
+    double matrix_time = (solver_clock_seconds() - start) / queries;
+    double csr_time = time_csr(&csr, queries, csr_dist);
+
+    int mismatches = 0;
+    for (int src = 0; src < n; src++) {
+        dijkstra(graph, n, src, dist, parent);
+        road_graph_dijkstra(&csr, src, -1, csr_dist, NULL, NULL);
+        for (int v = 0; v < n; v++) {
+            if (dist[v] != (int)csr_dist[v]) mismatches++;
+        }
+    }
+
+    printf("%-10s %9d %14.0f %14.0f %9.1fx %s\n", "legacy", n, matrix_time * 1e9,
+           csr_time * 1e9, matrix_time / csr_time, mismatches ? "MISMATCH" : "ok");
+    road_graph_free(&csr);
+    free(edges);
+    return mismatches == 0;
+}
+
+static int bench_grid(int side, int dense_queries, int csr_queries) {
+    int n = side * side;
+    int num_edges;
+    RoadEdge *edges = make_grid_edges(side, 777u + side, &num_edges);
+    RoadGraph csr;
+    if (road_graph_build(&csr, n, edges, num_edges, 1) != 0) {
+        fprintf(stderr, "failed to build %d-node graph\n", n);
+        free(edges);
+        return 0;
+    }
+    double *csr_dist = malloc(n * sizeof(double));
+    double csr_time = time_csr(&csr, csr_queries, csr_dist);
+    int ok = 1;
+
+    if (dense_queries > 0) {
+        int *matrix = calloc((size_t)n * n, sizeof(int));
+        int *dist = malloc(n * sizeof(int));
+        char *visited = malloc(n);
+        for (int i = 0; i < num_edges; i++) {
+            matrix[(size_t)edges[i].from * n + edges[i].to] = (int)edges[i].weight;
+            matrix[(size_t)edges[i].to * n + edges[i].from] = (int)edges[i].weight;
+        }
+        double start = solver_clock_seconds();
+        for (int q = 0; q < dense_queries; q++) {
+            dense_dijkstra(matrix, n, (int)((long long)q * 7919 % n), dist, visited);
+        }
+        double dense_time = (solver_clock_seconds() - start) / dense_queries;
+
+        road_graph_dijkstra(&csr, 0, -1, csr_dist, NULL, NULL);
+        dense_dijkstra(matrix, n, 0, dist, visited);
+        int mismatches = 0;
+        for (int v = 0; v < n; v++) {
+            if (dist[v] != (int)csr_dist[v]) mismatches++;
+        }
+        ok = mismatches == 0;
+        printf("%-10s %9d %14.0f %14.0f %9.1fx %s\n", "grid", n, dense_time * 1e9,
+               csr_time * 1e9, dense_time / csr_time, mismatches ? "MISMATCH" : "ok");
+        free(matrix);
+        free(dist);
+        free(visited);
+    } else {
+        printf("%-10s %9d %14s %14.0f %10s %s\n", "grid", n, "-", csr_time * 1e9, "-", "ok");
+    }
+
+    free(csr_dist);
+    road_graph_free(&csr);
+    free(edges);
+    return ok;
+}
+
+static void bench_matrix(int side, int num_stops, ThreadPool *pool) {
+    int n = side * side;
+    int num_edges;
+    RoadEdge *edges = make_grid_edges(side, 4242u, &num_edges);
+    RoadGraph graph;
+    road_graph_build(&graph, n, edges, num_edges, 1);
+    int *stops = malloc(num_stops * sizeof(int));
+    unsigned int state = 99;
+    for (int i = 0; i < num_stops; i++) stops[i] = bench_random(&state) % n;
+
+    DistanceMatrix matrix;
+    double start = solver_clock_seconds();
+    distance_matrix_compute(&matrix, &graph, stops, num_stops, NULL);
+    double serial = solver_clock_seconds() - start;
+    distance_matrix_free(&matrix);
+
+    start = solver_clock_seconds();
+    distance_matrix_compute(&matrix, &graph, stops, num_stops, pool);
+    double parallel = solver_clock_seconds() - start;
+    distance_matrix_free(&matrix);
+
+    printf("%9d %7d %12.1f %12.1f %8d\n", n, num_stops, serial * 1e3, parallel * 1e3,
+           thread_pool_size(pool));
+    free(stops);
+    road_graph_free(&graph);
+    free(edges);
+}
+
+// Value-only DP against every knapsack mode on random items. The DP columns
+// are skipped (-) when capacity * items is too large for it.
+static int bench_knapsack(int n, int capacity, int run_dp) {
+    int *weights = malloc(n * sizeof(int));
+    int *values = malloc(n * sizeof(int));
+    unsigned int state = 7;
+    int max_weight = capacity / 50 > 100 ? capacity / 50 : 100;
+    for (int i = 0; i < n; i++) {
+        weights[i] = 1 + bench_random(&state) % max_weight;
+        values[i] = 1 + bench_random(&state) % 1000;
+    }
+
+    double value_only = 0.0;
+    int best = -1;
+    if (run_dp) {
+        double start = solver_clock_seconds();
+        best = knapsack_best_value(weights, values, n, capacity);
+        value_only = solver_clock_seconds() - start;
+    }
+
+    static const KnapsackMode modes[] = {KNAPSACK_DP, KNAPSACK_BRANCH_BOUND, KNAPSACK_FRACTIONAL};
+    double elapsed[3] = {0.0, 0.0, 0.0};
+    int exact_value = -1;
+    double fractional = 0.0;
+    int ok = 1;
+    KnapsackSolver solver;
+    knapsack_solver_init(&solver);
+    for (int m = run_dp ? 0 : 1; m < 3; m++) {
+        solver.mode = modes[m];
+        if (knapsack_solve_items(&solver, weights, values, n, capacity) != 0) {
+            ok = 0;
+            continue;
+        }
+        elapsed[m] = solver.result.elapsed;
+        if (modes[m] == KNAPSACK_FRACTIONAL) {
+            fractional = solver.result.fractional_value;
+            continue;
+        }
+        if (solver.result.total_weight > capacity) ok = 0;
+        if (exact_value >= 0 && solver.result.value != exact_value) ok = 0;
+        exact_value = solver.result.value;
+    }
+    if (best >= 0 && best != exact_value) ok = 0;
+    // The fractional optimum bounds every 0/1 selection from above
+    if (fractional + 1e-6 < exact_value) ok = 0;
+
+    char dp_ms[32] = "-", select_ms[32] = "-";
+    if (run_dp) {
+        snprintf(dp_ms, sizeof(dp_ms), "%.1f", value_only * 1e3);
+        snprintf(select_ms, sizeof(select_ms), "%.1f", elapsed[0] * 1e3);
+    }
+    printf("%7d %10d %12s %12s %12.2f %12.3f %s\n", n, capacity, dp_ms, select_ms,
+           elapsed[1] * 1e3, elapsed[2] * 1e3, ok ? "ok" : "MISMATCH");
+    knapsack_solver_free(&solver);
+    free(weights);
+    free(values);
+    return ok;
+}
+
+// Writes a CSV manifest of num_packages rows, converts it to binary and
+// times loading both. The files are removed afterwards.
+static int bench_loader(int num_points, int num_packages) {
+    const char *csv_path = "delivery_bench_instance.csv";
+    const char *binary_path = "delivery_bench_instance.dlvb";
+    FILE *out = fopen(csv_path, "w");
+    if (!out) {
+        perror(csv_path);
+        return 0;
+    }
+    unsigned int state = 11;
+    fprintf(out, "type,id,a,b,c,d,e\n");
+    for (int i = 0; i < num_points; i++) {
+        fprintf(out, "point,%d,%.3f,%.3f,%d,1,\"Stop %d, zone %d\"\n", i,
+                (bench_random(&state) % 100000) / 100.0, (bench_random(&state) % 100000) / 100.0,
+                i == 0, i, i % 40);
+    }
+    for (int i = 0; i < num_packages; i++) {
+        fprintf(out, "package,%d,%u,%u,%u,%.1f,%u\n", i, 1 + bench_random(&state) % 30,
+                50 + bench_random(&state) % 100, 1 + bench_random(&state) % 3,
+                (10 + bench_random(&state) % 50) / 10.0, 1 + bench_random(&state) % (num_points - 1));
+    }
+    fclose(out);
+
+    DeliveryProblem *problem = delivery_problem_new();
+    double start = solver_clock_seconds();
+    int ok = load_instance_csv(csv_path, problem) == 0;
+    double csv_time = solver_clock_seconds() - start;
+    ok = ok && write_instance_binary(binary_path, problem) == 0;
+    long long weight = 0;
+    for (int i = 0; ok && i < problem->packages.count; i++) weight += problem->packages.weight[i];
+
+    start = solver_clock_seconds();
+    ok = ok && load_instance_binary(binary_path, problem) == 0;
+    double binary_time = solver_clock_seconds() - start;
+    for (int i = 0; ok && i < problem->packages.count; i++) weight -= problem->packages.weight[i];
+
+    printf("%9d %9d %12.1f %12.1f %s\n", num_points, num_packages, csv_time * 1e3,
+           binary_time * 1e3, ok && weight == 0 ? "ok" : "MISMATCH");
+    delivery_problem_free(problem);
+    remove(csv_path);
+    remove(binary_path);
+    return ok && weight == 0;
+}
+
+// Peak-hour point-to-point queries on a side x side street grid (100 units
+// apart, streets up to 50% longer than the straight line), every tenth
+// street an arterial with heavier peaks. Plain time-dependent Dijkstra
+// against A* with the straight-line bound.
+static int bench_traffic(int side, int queries) {
+    int n = side * side;
+    RoadEdge *edges = malloc(2 * (size_t)n * sizeof(RoadEdge));
+    double *x = malloc(n * sizeof(double));
+    double *y = malloc(n * sizeof(double));
+    unsigned int state = 99;
+    int count = 0;
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++) {
+            int u = r * side + c;
+            x[u] = c * 100.0;
+            y[u] = r * 100.0;
+            double length = 100.0 + bench_random(&state) % 50;
+            if (c + 1 < side) edges[count++] = (RoadEdge){u, u + 1, length};
+            length = 100.0 + bench_random(&state) % 50;
+            if (r + 1 < side) edges[count++] = (RoadEdge){u, u + side, length};
+        }
+    }
+    RoadGraph graph;
+    TrafficModel model;
+    TrafficSearch search;
+    if (road_graph_build(&graph, n, edges, count, 1) != 0 ||
+        traffic_model_init(&model, &graph, 5.0, 0.21) != 0 ||
+        traffic_search_init(&search, n) != 0) {
+        fprintf(stderr, "failed to build the %d-node traffic graph\n", n);
+        return 0;
+    }
+    double local[TRAFFIC_PROFILE_POINTS], arterial[TRAFFIC_PROFILE_POINTS];
+    for (int h = 0; h < TRAFFIC_PROFILE_POINTS; h++) {
+        double peak = exp(-(h - 9) * (h - 9) / 4.0) + exp(-(h - 18) * (h - 18) / 4.0);
+        local[h] = 1.0 + 0.8 * peak;
+        arterial[h] = 1.0 + 2.0 * peak;
+    }
+    int local_id = traffic_model_add_profile(&model, local);
+    int arterial_id = traffic_model_add_profile(&model, arterial);
+    model.idle_emissions = 0.5;
+    for (int u = 0; u < n; u++) {
+        for (int arc = graph.offsets[u]; arc < graph.offsets[u + 1]; arc++) {
+            int v = graph.targets[arc];
+            int main_road = (u / side == v / side && u / side % 10 == 0) ||
+                            (u % side == v % side && u % side % 10 == 0);
+            traffic_model_set_arc(&model, arc, main_road ? arterial_id : local_id,
+                                  0.18 + (bench_random(&state) % 10) / 100.0);
+        }
+    }
+
+    TrafficQuery query = {TRAFFIC_TIME, 10.0, 8 * 60 + 30};
+    double *arrivals = malloc(queries * sizeof(double));
+    int ok = 1;
+    double elapsed[2];
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) traffic_model_set_coordinates(&model, x, y);
+        unsigned int pairs = 5;
+        double start = solver_clock_seconds();
+        for (int q = 0; q < queries; q++) {
+            int src = bench_random(&pairs) % n, target = bench_random(&pairs) % n;
+            TrafficLeg leg;
+            if (traffic_route(&model, &query, src, target, &search, &leg) != 0) ok = 0;
+            if (pass == 0) arrivals[q] = leg.arrival;
+            if (pass == 1 && fabs(leg.arrival - arrivals[q]) > 1e-6) ok = 0;
+        }
+        elapsed[pass] = (solver_clock_seconds() - start) / queries;
+    }
+    size_t bytes = sizeof(uint16_t) + sizeof(float);
+    printf("%9d %9d %12.1f %12.1f %9.1fx %9zu %s\n", n, graph.num_arcs, elapsed[0] * 1e6,
+           elapsed[1] * 1e6, elapsed[0] / elapsed[1], bytes, ok ? "ok" : "MISMATCH");
+    free(arrivals);
+    traffic_search_free(&search);
+    traffic_model_free(&model);
+    road_graph_free(&graph);
+    free(edges);
+    free(x);
+    free(y);
+    return ok;
+}
+
+// Contraction hierarchy on a random-weight grid: preprocessing, point-to-point
+// queries against plain Dijkstra, and a stop matrix against one search per
+// stop. Both answers are compared.
+
+static int bench_hierarchy(int side, int queries, int num_stops, ThreadPool *pool) {
+    int n = side * side;
+    int num_edges;
+    RoadEdge *edges = make_grid_edges(side, 31337u + side, &num_edges);
+    RoadGraph graph;
+    ContractionHierarchy hierarchy;
+    ContractionStats stats;
+    HierarchySearch search;
+    if (road_graph_build(&graph, n, edges, num_edges, 1) != 0) {
+        fprintf(stderr, "failed to build the %d-node graph\n", n);
+        free(edges);
+        return 0;
+    }
+    if (contraction_hierarchy_build(&hierarchy, &graph, &stats) != 0 ||
+        hierarchy_search_init(&search, n) != 0) {
+        fprintf(stderr, "failed to contract the %d-node graph\n", n);
+        road_graph_free(&graph);
+        free(edges);
+        return 0;
+    }
+
+    double *dist = malloc(n * sizeof(double));
+    double *expected = malloc(queries * sizeof(double));
+    unsigned int state = 17;
+    int ok = 1;
+    double start = solver_clock_seconds();
+    for (int q = 0; q < queries; q++) {
+        int src = bench_random(&state) % n, target = bench_random(&state) % n;
+        road_graph_dijkstra(&graph, src, target, dist, NULL, NULL);
+        expected[q] = dist[target];
+    }
+    double dijkstra = (solver_clock_seconds() - start) / queries;
+    state = 17;
+    start = solver_clock_seconds();
+    for (int q = 0; q < queries; q++) {
+        int src = bench_random(&state) % n, target = bench_random(&state) % n;
+        double d = contraction_hierarchy_distance(&hierarchy, src, target, &search);
+        if (fabs(d - expected[q]) > 1e-6 * expected[q]) ok = 0;
+    }
+    double ch = (solver_clock_seconds() - start) / queries;
+
+    int *stops = malloc(num_stops * sizeof(int));
+    for (int i = 0; i < num_stops; i++) stops[i] = bench_random(&state) % n;
+    DistanceMatrix plain, fast;
+    start = solver_clock_seconds();
+    distance_matrix_compute(&plain, &graph, stops, num_stops, pool);
+    double plain_time = solver_clock_seconds() - start;
+    start = solver_clock_seconds();
+    distance_matrix_compute_hierarchy(&fast, &hierarchy, stops, num_stops, pool);
+    double fast_time = solver_clock_seconds() - start;
+    for (int i = 0; i < num_stops && ok; i++) {
+        for (int j = 0; j < num_stops; j++) {
+            double a = distance_matrix_get(&plain, i, j), b = distance_matrix_get(&fast, i, j);
+            if (fabs(a - b) > 1e-5 * a) ok = 0;
+        }
+    }
+
+    printf("%9d %10.0f %9d %10.1f %10.1f %9.1f %9.1f %s\n", n, stats.elapsed * 1e3,
+           stats.shortcuts, dijkstra * 1e6, ch * 1e6, plain_time * 1e3, fast_time * 1e3,
+           ok ? "ok" : "MISMATCH");
+    distance_matrix_free(&plain);
+    distance_matrix_free(&fast);
+    free(stops);
+    free(expected);
+    free(dist);
+    hierarchy_search_free(&search);
+    contraction_hierarchy_free(&hierarchy);
+    road_graph_free(&graph);
+    free(edges);
+    return ok;
+}
+
+// Orders arriving one at a time against a solved route: each new stop is
+// joined to its nearest points, the matrix is extended and the tour repaired
+// by cheapest insertion plus local 2-opt. Compared with solving everything
+// again; the knapsack columns time one appended package with the DP rows of
+// the earlier packages reused.
+
+#define BENCH_ROAD_DEGREE 4
+
+// Roads from point to its nearest points among the first count, as Routes
+// with to set; returns how many
+static int bench_roads(const DeliveryProblem *problem, SpatialIndex *index, int point,
+                       Route *roads) {
+    int near[BENCH_ROAD_DEGREE + 1];
+    int found = spatial_index_knn(index, problem->points.x[point], problem->points.y[point],
+                                  BENCH_ROAD_DEGREE + 1, near);
+    int count = 0;
+    for (int i = 0; i < found && count < BENCH_ROAD_DEGREE; i++) {
+        if (near[i] == point) continue;
+        roads[count++] = (Route){point, near[i], calculate_distance(problem, point, near[i]), 0.21};
+    }
+    return count;
+}
+
+static int bench_incremental(int num_stops, int num_orders, int num_packages) {
+    int total = num_stops + num_orders;
+    DeliveryProblem *problem = delivery_problem_new();
+    unsigned int state = 11;
+    for (int i = 0; i < total; i++) {
+        DeliveryPoint point = {i, "", bench_random(&state) % 10000, bench_random(&state) % 10000,
+                               i == 0, 1};
+        delivery_problem_add_point(problem, &point);
+    }
+    // Positions of the late orders are drawn now but the points only join
+    // the problem as they arrive
+    double *x = malloc(total * sizeof(double));
+    double *y = malloc(total * sizeof(double));
+    memcpy(x, problem->points.x, total * sizeof(double));
+    memcpy(y, problem->points.y, total * sizeof(double));
+    problem->points.count = num_stops;
+
+    SpatialIndex index;
+    Route roads[BENCH_ROAD_DEGREE];
+    spatial_index_build(&index, x, y, num_stops);
+    for (int i = 1; i < num_stops; i++) {
+        int count = bench_roads(problem, &index, i, roads);
+        for (int r = 0; r < count; r++) delivery_problem_add_route(problem, &roads[r]);
+    }
+    spatial_index_free(&index);
+    ThreadPool *pool = thread_pool_create(0);
+    DeliveryPlan plan = {0};
+    TourImproveOptions options;
+    tour_improve_default_options(&options);
+    options.time_budget = 0;
+    double start = solver_clock_seconds();
+    delivery_problem_build_graph(problem);
+    delivery_problem_build_matrix(problem, pool);
+    calculate_optimal_route(problem, &plan, &options, NULL);
+    double full = solver_clock_seconds() - start;
+
+    int ok = plan.num_vehicles == 1;
+    double update = 0;
+    for (int order = num_stops; order < total && ok; order++) {
+        // The index covers the points placed so far; orders join to those
+        spatial_index_build(&index, x, y, order);
+        DeliveryPoint point = {order, "", x[order], y[order], 0, 1};
+        problem->points.x[order] = x[order];
+        problem->points.y[order] = y[order];
+        problem->points.count = order + 1;
+        int count = bench_roads(problem, &index, order, roads);
+        problem->points.count = order;
+        spatial_index_free(&index);
+
+        // Orders the depot cannot reach stay off the tour (status 1)
+        start = solver_clock_seconds();
+        ok = delivery_problem_add_stop(problem, &point, roads, count) == order &&
+             route_insert_stop(&problem->distance_matrix, NULL, &plan.vehicles[0], order, NULL) >= 0;
+        update += solver_clock_seconds() - start;
+    }
+    delivery_plan_update_totals(&plan, &problem->distance_matrix);
+    double repaired = plan.total_distance;
+    int repaired_stops = plan.num_vehicles == 1 ? plan.vehicles[0].num_stops : -1;
+
+    start = solver_clock_seconds();
+    delivery_problem_build_graph(problem);
+    delivery_problem_build_matrix(problem, pool);
+    calculate_optimal_route(problem, &plan, &options, NULL);
+    double resolve = solver_clock_seconds() - start;
+    double gap = (repaired / plan.total_distance - 1) * 100;
+    if (plan.num_vehicles != 1 || plan.vehicles[0].num_stops != repaired_stops) ok = 0;
+
+    int *weights = malloc(num_packages * sizeof(int));
+    int *values = malloc(num_packages * sizeof(int));
+    for (int i = 0; i < num_packages; i++) {
+        weights[i] = 1 + bench_random(&state) % 20;
+        values[i] = 1 + bench_random(&state) % 1000;
+    }
+    KnapsackSolver solver;
+    knapsack_solver_init(&solver);
+    solver.mode = KNAPSACK_DP;
+    knapsack_solve_items(&solver, weights, values, num_packages - 1, 1000);
+    double knapsack_full = solver.result.elapsed;
+    knapsack_solve_items(&solver, weights, values, num_packages, 1000);
+    double knapsack_append = solver.result.elapsed;
+    if (solver.result.reused_rows == 0 ||
+        solver.result.value != knapsack_best_value(weights, values, num_packages, 1000)) {
+        ok = 0;
+    }
+
+    printf("%9d %12.1f %12.1f %11.3f %9.2f%% %12.2f %12.3f %s\n", num_stops, full * 1e3,
+           resolve * 1e3, update / num_orders * 1e3, gap, knapsack_full * 1e3,
+           knapsack_append * 1e3, ok ? "ok" : "FAILED");
+    knapsack_solver_free(&solver);
+    free(weights);
+    free(values);
+    delivery_plan_clear(&plan);
+    thread_pool_destroy(pool);
+    delivery_problem_free(problem);
+    free(x);
+    free(y);
+    return ok;
+}
+
+static void report_lateness(const DeliveryProblem *problem, const DeliveryPlan *plan,
+                            TimeWindowReport *report) {
+    TimeWindows windows;
+    memset(report, 0, sizeof(TimeWindowReport));
+    if (plan->num_vehicles != 1 || delivery_problem_time_windows(problem, &windows) != 0) return;
+    time_window_report(&windows, &problem->distance_matrix, plan->vehicles[0].stops,
+                       plan->vehicles[0].num_stops, report);
+    time_windows_free(&windows);
+}
+
+// Single-vehicle routing with every 50th stop on a delivery window a fifth
+// of the shift wide and a premium deadline at 0.6 of the shift on every
+// 20th, the shift being the untimed tour's driving time: routed as before,
+// then with windows honoured.
+static int bench_time_windows(int num_stops) {
+    DeliveryProblem *problem = delivery_problem_new();
+    unsigned int state = 13;
+    for (int i = 0; i < num_stops; i++) {
+        DeliveryPoint point = {i, "", bench_random(&state) % 10000, bench_random(&state) % 10000,
+                               i == 0, 1};
+        delivery_problem_add_point(problem, &point);
+        if (i > 0) {
+            Package package = {i, 1, 100, i % 20 == 0 ? PACKAGE_PRIORITY_PREMIUM : 1, 1.0, i};
+            delivery_problem_add_package(problem, &package);
+        }
+    }
+    SpatialIndex index;
+    Route roads[BENCH_ROAD_DEGREE];
+    spatial_index_build(&index, problem->points.x, problem->points.y, num_stops);
+    for (int i = 1; i < num_stops; i++) {
+        int count = bench_roads(problem, &index, i, roads);
+        for (int r = 0; r < count; r++) delivery_problem_add_route(problem, &roads[r]);
+    }
+    spatial_index_free(&index);
+    ThreadPool *pool = thread_pool_create(0);
+    delivery_problem_build_graph(problem);
+    delivery_problem_build_matrix(problem, pool);
+    thread_pool_destroy(pool);
+
+    DeliveryPlan plan = {0};
+    TourImproveOptions options;
+    tour_improve_default_options(&options);
+    options.time_budget = 0;
+    double start = solver_clock_seconds();
+    calculate_optimal_route(problem, &plan, &options, NULL);
+    double untimed = solver_clock_seconds() - start;
+    double untimed_distance = plan.total_distance;
+    double shift = untimed_distance / 5.0;   // minutes at free-flow speed
+
+    for (int i = 1; i < num_stops; i += 50) {
+        double open = bench_random(&state) % (int)(shift * 0.8 + 1);
+        delivery_problem_set_window(problem, i, open, open + shift * 0.2, 0);
+    }
+    delivery_problem_set_sla(problem, PACKAGE_PRIORITY_PREMIUM, shift * 0.6);
+    TimeWindowReport before, after;
+    report_lateness(problem, &plan, &before);
+
+    TourImproveStats stats;
+    start = solver_clock_seconds();
+    int status = calculate_optimal_route(problem, &plan, &options, &stats);
+    double timed = solver_clock_seconds() - start;
+    report_lateness(problem, &plan, &after);
+
+    int ok = status == 0 && plan.num_vehicles == 1 && plan.vehicles[0].stops[0] == 0;
+    char *seen = calloc(num_stops, 1);
+    for (int i = 0; ok && i < plan.vehicles[0].num_stops; i++) ok = !seen[plan.vehicles[0].stops[i]]++;
+    free(seen);
+    printf("%9d %10.1f %7d %7d %10.1f %7d %7d %9llu %9.1f%% %s\n", num_stops, untimed * 1e3,
+           before.late_stops, before.late_premium, timed * 1e3, after.late_stops,
+           after.late_premium, (unsigned long long)stats.window_rejections,
+           (plan.total_distance / untimed_distance - 1) * 100, ok ? "ok" : "FAILED");
+    delivery_plan_clear(&plan);
+    delivery_problem_free(problem);
+    return ok;
+}
+
+static double open_tour_length(const double *x, const double *y, const int *tour, int n) {
+    double length = 0.0;
+    for (int i = 1; i < n; i++) {
+        length += hypot(x[tour[i]] - x[tour[i - 1]], y[tour[i]] - y[tour[i - 1]]);
+    }
+    return length;
+}
+
+// Greedy nearest-neighbour construction over num_stops random points: the
+// O(n^2) scan against nearest-unvisited queries on the spatial index.
+static int bench_construction(int num_stops, int run_scan) {
+    double *x = malloc(num_stops * sizeof(double));
+    double *y = malloc(num_stops * sizeof(double));
+    int *tour = malloc(num_stops * sizeof(int));
+    unsigned int state = 5;
+    for (int i = 0; i < num_stops; i++) {
+        x[i] = bench_random(&state) / 4294967296.0 * 1000.0;
+        y[i] = bench_random(&state) / 4294967296.0 * 1000.0;
+    }
+
+    double scan_time = 0.0, scan_length = -1.0;
+    if (run_scan) {
+        char *visited = calloc(num_stops, 1);
+        double start = solver_clock_seconds();
+        int current = 0;
+        visited[0] = 1;
+        tour[0] = 0;
+        for (int step = 1; step < num_stops; step++) {
+            double best = INFINITY;
+            int next = -1;
+            for (int i = 0; i < num_stops; i++) {
+                if (visited[i]) continue;
+                double dx = x[i] - x[current], dy = y[i] - y[current];
+                double d = dx * dx + dy * dy;
+                if (d < best) {
+                    best = d;
+                    next = i;
+                }
+            }
+            visited[next] = 1;
+            tour[step] = current = next;
+        }
+        scan_time = solver_clock_seconds() - start;
+        scan_length = open_tour_length(x, y, tour, num_stops);
+        free(visited);
+    }
+
+    double start = solver_clock_seconds();
+    SpatialIndex index;
+    int ok = spatial_index_build(&index, x, y, num_stops) == 0;
+    if (ok) {
+        int current = 0;
+        tour[0] = 0;
+        spatial_index_remove(&index, 0);
+        for (int step = 1; step < num_stops; step++) {
+            current = spatial_index_nearest(&index, x[current], y[current], INFINITY);
+            tour[step] = current;
+            spatial_index_remove(&index, current);
+        }
+        spatial_index_free(&index);
+    }
+    double index_time = solver_clock_seconds() - start;
+    if (ok && run_scan) ok = fabs(open_tour_length(x, y, tour, num_stops) - scan_length) < 1e-6;
+
+    char scan_ms[32] = "-";
+    if (run_scan) snprintf(scan_ms, sizeof(scan_ms), "%.1f", scan_time * 1e3);
+    printf("%9d %12s %12.1f %s\n", num_stops, scan_ms, index_time * 1e3, ok ? "ok" : "MISMATCH");
+    free(x);
+    free(y);
+    free(tour);
+    return ok;
+}
+
+// Regression suite (--json): every solver stage on generated instances,
+// one JSON object per layout and size so runs can be diffed or plotted.
+// Times are ns per operation. Gaps compare with a bound on the optimum:
+// the fractional knapsack value, and for tours the minimum spanning tree of
+// the stops, which no closed tour can undercut. Tours need the full stop
+// matrix, so they are skipped above max_matrix stops. Peak RSS is reset
+// per case where the system allows; --layout and --stops run a single case
+// for a clean process peak anywhere.
+
+#define SUITE_DIJKSTRA_WORK 2000000 // node visits per size for the Dijkstra sample
+
+typedef struct {
+    unsigned int seed;
+    int max_stops;
+    int max_matrix;
+    int layout;         // InstanceLayout, -1 = all
+    int stops;          // one size only, 0 = all
+} SuiteOptions;
+
+// JSON has no inf or nan
+static void json_number(const char *name, double value, const char *after) {
+    if (isfinite(value)) {
+        printf("\"%s\": %.10g%s", name, value, after);
+    } else {
+        printf("\"%s\": null%s", name, after);
+    }
+}
+
+// Minimum spanning tree of the matrix stops, Prim in O(n^2)
+static double matrix_spanning_tree(const DistanceMatrix *matrix) {
+    int n = matrix->size;
+    double *best = malloc(n * sizeof(double));
+    char *in_tree = calloc(n, 1);
+    double total = INFINITY;
+    if (best && in_tree) {
+        total = 0.0;
+        for (int i = 0; i < n; i++) best[i] = INFINITY;
+        best[0] = 0.0;
+        for (int step = 0; step < n; step++) {
+            int next = -1;
+            for (int i = 0; i < n; i++) {
+                if (!in_tree[i] && (next < 0 || best[i] < best[next])) next = i;
+            }
+            in_tree[next] = 1;
+            total += best[next];
+            const float *row = distance_matrix_row(matrix, next);
+            for (int i = 0; i < n; i++) {
+                if (!in_tree[i] && row[i] < best[i]) best[i] = row[i];
+            }
+        }
+    }
+    free(best);
+    free(in_tree);
+    return total;
+}
+
+static int suite_dijkstra(const DeliveryProblem *problem) {
+    const RoadGraph *graph = &problem->road_graph;
+    int n = graph->num_nodes;
+    int queries = SUITE_DIJKSTRA_WORK / n;
+    queries = queries < 3 ? 3 : queries > 1000 ? 1000 : queries;
+    double *dist = malloc(n * sizeof(double));
+    if (!dist) return 0;
+    double per_query = time_csr(graph, queries, dist);
+    int reached = 0;
+    for (int i = 0; i < n; i++) reached += dist[i] < INFINITY;
+    printf("    \"dijkstra\": {\"queries\": %d, ", queries);
+    json_number("ns_per_query", per_query * 1e9, ", ");
+    json_number("ns_per_node", per_query * 1e9 / n, ", ");
+    printf("\"reached\": %d},\n", reached);
+    free(dist);
+    return reached == n;
+}
+
+static int suite_knapsack(const DeliveryProblem *problem) {
+    long long total_weight = 0;
+    for (int i = 0; i < problem->packages.count; i++) total_weight += problem->packages.weight[i];
+    int capacity = (int)(total_weight / 4);
+    KnapsackSolver solver;
+    knapsack_solver_init(&solver);
+    double start = solver_clock_seconds();
+    const KnapsackResult *result = knapsack_solve(&solver, problem, capacity);
+    double elapsed = solver_clock_seconds() - start;
+    int ok = result && result->total_weight <= capacity;
+    int value = result ? result->value : 0, exact = result && result->exact;
+    KnapsackMode mode = result ? result->mode : KNAPSACK_AUTO;
+    solver.mode = KNAPSACK_FRACTIONAL;
+    result = knapsack_solve(&solver, problem, capacity);
+    double bound = result ? result->fractional_value : NAN;
+    ok = ok && result && value <= bound + 1e-6;
+
+    int items = problem->packages.count > 0 ? problem->packages.count : 1;
+    printf("    \"knapsack\": {\"items\": %d, \"capacity\": %d, \"mode\": \"%s\", "
+           "\"exact\": %s, ", problem->packages.count, capacity, knapsack_mode_name(mode),
+           exact ? "true" : "false");
+    json_number("ns_per_item", elapsed * 1e9 / items, ", ");
+    printf("\"value\": %d, ", value);
+    json_number("upper_bound", bound, ", ");
+    json_number("gap", bound > 0 ? (bound - value) / bound : 0.0, "},\n");
+    knapsack_solver_free(&solver);
+    return ok;
+}
+
+// Nearest-neighbour tour over the coordinates, as calculate_optimal_route()
+// builds it before it has road distances to improve on
+static int suite_construction(const DeliveryProblem *problem) {
+    int n = problem->points.count;
+    const double *x = problem->points.x, *y = problem->points.y;
+    int *tour = malloc(n * sizeof(int));
+    SpatialIndex index;
+    if (!tour) return 0;
+    double start = solver_clock_seconds();
+    int ok = spatial_index_build(&index, x, y, n) == 0;
+    if (ok) {
+        int current = 0;
+        tour[0] = 0;
+        spatial_index_remove(&index, 0);
+        for (int step = 1; step < n; step++) {
+            current = spatial_index_nearest(&index, x[current], y[current], INFINITY);
+            tour[step] = current;
+            spatial_index_remove(&index, current);
+        }
+        spatial_index_free(&index);
+    }
+    double elapsed = solver_clock_seconds() - start;
+    double length = ok ? open_tour_length(x, y, tour, n) +
+                             hypot(x[tour[n - 1]] - x[0], y[tour[n - 1]] - y[0])
+                       : NAN;
+    printf("    \"construction\": {");
+    json_number("ns_per_stop", elapsed * 1e9 / n, ", ");
+    json_number("straight_length", length, "},\n");
+    free(tour);
+    return ok;
+}
+
+static int suite_route(DeliveryProblem *problem, ThreadPool *pool, int max_matrix) {
+    int n = problem->points.count;
+    if (n > max_matrix) {
+        printf("    \"route\": null,\n");
+        return 1;
+    }
+    double start = solver_clock_seconds();
+    int ok = delivery_problem_build_matrix(problem, pool) == 0;
+    double matrix_time = solver_clock_seconds() - start;
+    DeliveryPlan plan = {0};
+    TourImproveOptions options;
+    tour_improve_default_options(&options);
+    options.time_budget = 0;
+    TourImproveStats stats = {0};
+    start = solver_clock_seconds();
+    ok = ok && calculate_optimal_route(problem, &plan, &options, &stats) == 0 &&
+         plan.num_vehicles == 1 && plan.vehicles[0].num_stops == n;
+    double elapsed = solver_clock_seconds() - start;
+    double bound = ok ? matrix_spanning_tree(&problem->distance_matrix) : NAN;
+
+    printf("    \"route\": {");
+    json_number("matrix_ns_per_pair", matrix_time * 1e9 / ((double)n * n), ", ");
+    json_number("ns_per_stop", elapsed * 1e9 / n, ", ");
+    printf("\"two_opt_moves\": %llu, \"or_opt_moves\": %llu, ",
+           (unsigned long long)stats.two_opt_moves, (unsigned long long)stats.or_opt_moves);
+    json_number("greedy_length", stats.initial_length, ", ");
+    json_number("length", stats.final_length, ", ");
+    json_number("lower_bound", bound, ", ");
+    json_number("greedy_gap", stats.initial_length / bound - 1, ", ");
+    json_number("gap", stats.final_length / bound - 1, "},\n");
+    delivery_plan_clear(&plan);
+    return ok && stats.final_length <= stats.initial_length + 1e-6;
+}
+
+static int suite_case(InstanceLayout layout, int num_stops, const SuiteOptions *options,
+                      ThreadPool *pool, int first) {
+    int reset = process_memory_reset_peak() == 0;
+    DeliveryProblem *problem = delivery_problem_new();
+    InstanceSpec spec = {layout, num_stops, options->seed, 0};
+    double start = solver_clock_seconds();
+    int ok = problem && generate_instance(problem, &spec) == 0;
+    double elapsed = solver_clock_seconds() - start;
+
+    printf("%s  {\n    \"layout\": \"%s\", \"stops\": %d, \"roads\": %d, ", first ? "" : ",\n",
+           instance_layout_name(layout), num_stops, ok ? problem->routes.count : 0);
+    json_number("generate_ns_per_stop", elapsed * 1e9 / num_stops, ",\n");
+    if (ok) {
+        ok = suite_dijkstra(problem) & ok;
+        ok = suite_knapsack(problem) & ok;
+        ok = suite_construction(problem) & ok;
+        ok = suite_route(problem, pool, options->max_matrix) & ok;
+    }
+    // Without a reset the peak covers every case so far
+    printf("    \"peak_rss_bytes\": %zu, \"peak_rss_reset\": %s, \"ok\": %s\n  }",
+           process_memory_peak(), reset ? "true" : "false", ok ? "true" : "false");
+    fflush(stdout);
+    delivery_problem_free(problem);
+    return ok;
+}
+
+// Returns 1 when every case passed its checks
+static int run_suite(const SuiteOptions *options) {
+    static const int sizes[] = {20, 100, 1000, 5000, 10000, 100000, 1000000};
+    static const InstanceLayout layouts[] = {INSTANCE_RANDOM, INSTANCE_CLUSTERED, INSTANCE_GRID};
+    ThreadPool *pool = thread_pool_create(0);
+    printf("{\n\"suite\": \"delivery_bench\", \"seed\": %u, \"threads\": %d, \"cases\": [\n",
+           options->seed, pool ? thread_pool_size(pool) : 1);
+    int first = 1, ok = 1;
+    // Small sizes first, so the process peak stays meaningful without resets
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int stops = options->stops > 0 ? options->stops : sizes[s];
+        if (stops > options->max_stops || (options->stops > 0 && s > 0)) break;
+        for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+            if (options->layout >= 0 && (int)layouts[l] != options->layout) continue;
+            ok = suite_case(layouts[l], stops, options, pool, first) & ok;
+            first = 0;
+        }
+    }
+    printf("\n]}\n");
+    thread_pool_destroy(pool);
+    return ok;
+}
+
+// The comparison tables, or with quick only their smallest row each.
+// Returns 1 when every row passed its check.
+static int run_tables(int quick) {
+    int ok = 1;
+    printf("One-to-all shortest paths, ns per query\n");
+    printf("%-10s %9s %14s %14s %10s %s\n", "graph", "nodes", "matrix O(V^2)", "csr+heap",
+           "speedup", "check");
+    ok = bench_legacy_matrix() & ok;
+    ok = bench_grid(32, 200, 2000) & ok;
+    if (!quick) {
+        ok = bench_grid(64, 20, 500) & ok;
+        ok = bench_grid(100, 0, 100) & ok;
+        ok = bench_grid(316, 0, 20) & ok;
+        ok = bench_grid(1000, 0, 3) & ok;
+    }
+
+    ThreadPool *pool = thread_pool_create(0);
+    printf("\nStop-to-stop distance matrix, ms\n");
+    printf("%9s %7s %12s %12s %8s\n", "nodes", "stops", "serial", "pool", "threads");
+    bench_matrix(100, 100, pool);
+    if (!quick) {
+        bench_matrix(316, 300, pool);
+        bench_matrix(1000, 32, pool);
+    }
+
+    printf("\nContraction hierarchy: build ms, query us, stop matrix ms\n");
+    printf("%9s %10s %9s %10s %10s %9s %9s %s\n", "nodes", "build", "shortcuts", "dijkstra",
+           "ch query", "matrix", "ch matrix", "check");
+    ok = bench_hierarchy(100, 500, 300, pool) & ok;
+    if (!quick) ok = bench_hierarchy(316, 100, 300, pool) & ok;
+    thread_pool_destroy(pool);
+
+    printf("\nKnapsack, ms\n");
+    printf("%7s %10s %12s %12s %12s %12s %s\n", "items", "capacity", "dp value", "dp select",
+           "branch+bound", "fractional", "check");
+    ok = bench_knapsack(100, 1000, 1) & ok;
+    if (!quick) {
+        ok = bench_knapsack(1000, 10000, 1) & ok;
+        ok = bench_knapsack(10000, 100000, 1) & ok;
+        ok = bench_knapsack(10000, 10000000, 0) & ok;
+        ok = bench_knapsack(1000000, 1000000000, 0) & ok;
+    }
+
+    printf("\nInstance loading (includes the road graph), ms\n");
+    printf("%9s %9s %12s %12s %s\n", "points", "packages", "csv", "binary", "check");
+    ok = bench_loader(100, 100000) & ok;
+    if (!quick) {
+        ok = bench_loader(200, 1000000) & ok;
+        ok = bench_loader(200, 5000000) & ok;
+    }
+
+    printf("\nNearest-neighbour tour construction, ms\n");
+    printf("%9s %12s %12s %s\n", "stops", "scan O(n^2)", "k-d tree", "check");
+    ok = bench_construction(1000, 1) & ok;
+    if (!quick) {
+        ok = bench_construction(10000, 1) & ok;
+        ok = bench_construction(50000, 1) & ok;
+        ok = bench_construction(1000000, 0) & ok;
+    }
+
+    printf("\nIncremental orders, ms\n");
+    printf("%9s %12s %12s %11s %10s %12s %12s %s\n", "stops", "full solve", "re-solve",
+           "per order", "gap", "knapsack", "+1 package", "check");
+    ok = bench_incremental(1000, 100, 1000) & ok;
+    if (!quick) ok = bench_incremental(5000, 100, 5000) & ok;
+
+    printf("\nTime windows: untimed tour, then routed to the windows; ms and late stops\n");
+    printf("%9s %10s %7s %7s %10s %7s %7s %9s %10s %s\n", "stops", "untimed", "late", "premium",
+           "timed", "late", "premium", "refused", "distance", "check");
+    ok = bench_time_windows(1000) & ok;
+    if (!quick) ok = bench_time_windows(5000) & ok;
+
+    printf("\nTime-dependent routing at 08:30, us per query\n");
+    printf("%9s %9s %12s %12s %10s %9s %s\n", "nodes", "arcs", "dijkstra", "a*", "speedup",
+           "bytes/arc", "check");
+    ok = bench_traffic(100, 200) & ok;
+    if (!quick) {
+        ok = bench_traffic(316, 50) & ok;
+        ok = bench_traffic(1000, 10) & ok;
+    }
+    return ok;
+
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--quick | --json [options]]\n"
+            "Without --json prints the comparison tables, with --quick only the\n"
+            "smallest row of each. --json runs the regression suite on generated\n"
+            "instances and prints JSON:\n"
+            "  --seed N         instance seed (default 1)\n"
+            "  --layout L       random, clustered or grid only (default all)\n"
+            "  --stops N        this many stops only (default 20 up to 1000000)\n"
+            "  --max-stops N    skip sizes above N\n"
+            "  --max-matrix N   route and gap stages up to N stops (default 5000)\n"
+            "Exits with 1 when any check fails.\n",
+            program);
+}
+
+int main(int argc, char *argv[]) {
+    SuiteOptions suite = {1, 1000000, 5000, -1, 0};
+    int json = 0, quick = 0;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--json") == 0) {
+            json = 1;
+        } else if (strcmp(arg, "--quick") == 0) {
+            quick = 1;
+        } else if (strcmp(arg, "--seed") == 0 && i + 1 < argc) {
+            suite.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--layout") == 0 && i + 1 < argc) {
+            InstanceLayout layout;
+            if (instance_layout_parse(argv[++i], &layout) != 0) {
+                fprintf(stderr, "unknown layout '%s'\n", argv[i]);
+                return 2;
+            }
+            suite.layout = layout;
+        } else if (strcmp(arg, "--stops") == 0 && i + 1 < argc) {
+            suite.stops = atoi(argv[++i]);
+        } else if (strcmp(arg, "--max-stops") == 0 && i + 1 < argc) {
+            suite.max_stops = atoi(argv[++i]);
+        } else if (strcmp(arg, "--max-matrix") == 0 && i + 1 < argc) {
+            suite.max_matrix = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0 ? 0 : 2;
+        }
+    }
+    if (json) return run_suite(&suite) ? 0 : 1;
+    return run_tables(quick) ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cvrp.h"
+#include "fleet_sim.h"
+#include "instance_generator.h"
+#include "instance_io.h"
+#include "knapsack.h"
+#include "metrics.h"
+#include "plan_file.h"
+#include "portfolio.h"
+#include "solver.h"
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] [instance]\n"
+            "  -c, --capacity N   bag capacity in kg (default 50)\n"
+            "  -k, --knapsack M   package selection: auto, dp, fractional or bb (default auto)\n"
+            "      --cvrp         plan a fleet: one route per vehicle, each carrying up to -c kg\n"
+            "      --vehicles N   vehicles available per depot with --cvrp (default: as many as needed)\n"
+            "      --portfolio    restart the route search from randomized tours on every\n"
+            "                     thread for the -t budget and keep the best tour found\n"
+            "      --starts N     stop --portfolio after N starts (default: when -t runs out)\n"
+            "  -s, --seed N       seed for the sample or generated instance (default 1)\n"
+            "      --generate L:N solve a generated instance of N stops laid out as random,\n"
+            "                     clustered or grid (see also --dump-sample, --convert)\n"
+            "  -o, --output FILE  write the plan to FILE instead of stdout\n"
+            "      --save-plan FILE  also write the plan in binary form, with arrival times,\n"
+            "                     loads and emissions per stop, for replay in the GUI\n"
+            "      --simulate M   drive every vehicle of the plan through the day in steps\n"
+            "                     of M sim minutes, as fast as possible, and report the speed\n"
+            "  -j, --threads N    worker threads for the distance matrix and --portfolio\n"
+            "                     (default: all CPUs)\n"
+            "  -t, --time-limit S seconds of 2-opt/Or-opt improvement (default 1, 0 = no limit)\n"
+            "      --no-improve   keep the plain nearest-neighbour tour\n"
+            "      --depart HH:MM drive the plan through peak-hour traffic leaving at HH:MM\n"
+            "      --objective O  legs minimise time, co2 or blend with --depart (default time)\n"
+            "      --co2-weight M minutes one kg of CO2 is worth for --objective blend (default 10)\n"
+            "      --sla P=MIN    deliver packages of priority P (3 = premium) within MIN minutes\n"
+            "                     of the shift start; routes then honour the delivery windows\n"
+            "      --metrics FILE write solver counters and stage timings to FILE when done,\n"
+            "                     as JSON for *.json and Prometheus text otherwise\n"
+            "      --dump-sample  print the sample instance and exit\n"
+            "      --convert FILE write the instance in binary form to FILE and exit\n"
+            "      --hierarchy FILE  compute distances with the contraction hierarchy in FILE,\n"
+            "                     building and saving it first if FILE is missing or stale\n"
+            "The instance may be a text, CSV (.csv) or binary file. Without one the\n"
+            "Bengaluru sample instance is solved.\n",
+            program);
+}
+
+int main(int argc, char *argv[]) {
+    const char *instance_path = NULL;
+    const char *output_path = NULL;
+    const char *convert_path = NULL;
+    const char *hierarchy_path = NULL;
+    const char *metrics_path = NULL;
+    const char *plan_path = NULL;
+    int capacity = 50;
+    unsigned int seed = 1;
+    int dump_sample = 0;
+    InstanceSpec generate = {INSTANCE_RANDOM, 0, 0, 0};
+    int threads = 0;
+    int fleet = 0;
+    int max_vehicles = 0;
+    int portfolio = 0;
+    int portfolio_starts = 0;
+    double simulate_step = 0;
+    KnapsackMode knapsack_mode = KNAPSACK_AUTO;
+    int schedule = 0;
+    TrafficQuery traffic = {TRAFFIC_TIME, 10.0, 0.0};
+    TourImproveOptions improve;
+    tour_improve_default_options(&improve);
+    double sla[PACKAGE_PRIORITY_PREMIUM + 1] = {0};
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if ((strcmp(arg, "-c") == 0 || strcmp(arg, "--capacity") == 0) && i + 1 < argc) {
+            capacity = atoi(argv[++i]);
+        } else if ((strcmp(arg, "-s") == 0 || strcmp(arg, "--seed") == 0) && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if ((strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(arg, "--save-plan") == 0 && i + 1 < argc) {
+            plan_path = argv[++i];
+        } else if (strcmp(arg, "--simulate") == 0 && i + 1 < argc) {
+            simulate_step = atof(argv[++i]);
+            if (!(simulate_step > 0)) {
+                fprintf(stderr, "simulation step must be positive\n");
+                return 2;
+            }
+        } else if ((strcmp(arg, "-k") == 0 || strcmp(arg, "--knapsack") == 0) && i + 1 < argc) {
+            if (knapsack_mode_parse(argv[++i], &knapsack_mode) != 0) {
+                fprintf(stderr, "unknown knapsack mode '%s'\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--cvrp") == 0) {
+            fleet = 1;
+        } else if (strcmp(arg, "--vehicles") == 0 && i + 1 < argc) {
+            max_vehicles = atoi(argv[++i]);
+        } else if (strcmp(arg, "--portfolio") == 0) {
+            portfolio = 1;
+        } else if (strcmp(arg, "--starts") == 0 && i + 1 < argc) {
+            portfolio_starts = atoi(argv[++i]);
+        } else if ((strcmp(arg, "-j") == 0 || strcmp(arg, "--threads") == 0) && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if ((strcmp(arg, "-t") == 0 || strcmp(arg, "--time-limit") == 0) && i + 1 < argc) {
+            improve.time_budget = atof(argv[++i]);
+        } else if (strcmp(arg, "--no-improve") == 0) {
+            improve.two_opt = 0;
+            improve.or_opt_segment = 0;
+        } else if (strcmp(arg, "--depart") == 0 && i + 1 < argc) {
+            int hours, minutes;
+            if (sscanf(argv[++i], "%d:%d", &hours, &minutes) != 2 || hours < 0 || hours > 23 ||
+                minutes < 0 || minutes > 59) {
+                fprintf(stderr, "bad departure time '%s', expected HH:MM\n", argv[i]);
+                return 2;
+            }
+            traffic.depart = hours * 60 + minutes;
+            schedule = 1;
+        } else if (strcmp(arg, "--objective") == 0 && i + 1 < argc) {
+            if (traffic_objective_parse(argv[++i], &traffic.objective) != 0) {
+                fprintf(stderr, "unknown objective '%s'\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--co2-weight") == 0 && i + 1 < argc) {
+            traffic.co2_weight = atof(argv[++i]);
+            if (!(traffic.co2_weight >= 0)) {
+                fprintf(stderr, "co2 weight must not be negative\n");
+                return 2;
+            }
+        } else if (strcmp(arg, "--sla") == 0 && i + 1 < argc) {
+            int priority;
+            double minutes;
+            if (sscanf(argv[++i], "%d=%lf", &priority, &minutes) != 2 || priority < 1 ||
+                priority > PACKAGE_PRIORITY_PREMIUM || !(minutes > 0)) {
+                fprintf(stderr, "bad SLA '%s', expected PRIORITY=MINUTES\n", argv[i]);
+                return 2;
+            }
+            sla[priority] = minutes;
+        } else if (strcmp(arg, "--generate") == 0 && i + 1 < argc) {
+            char layout[16];
+            if (sscanf(argv[++i], "%15[a-z]:%d", layout, &generate.num_stops) != 2 ||
+                instance_layout_parse(layout, &generate.layout) != 0 || generate.num_stops < 1) {
+                fprintf(stderr, "bad instance '%s', expected LAYOUT:STOPS\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--hierarchy") == 0 && i + 1 < argc) {
+            hierarchy_path = argv[++i];
+        } else if (strcmp(arg, "--metrics") == 0 && i + 1 < argc) {
+            metrics_path = argv[++i];
+        } else if (strcmp(arg, "--convert") == 0 && i + 1 < argc) {
+            convert_path = argv[++i];
+        } else if (strcmp(arg, "--dump-sample") == 0) {
+            dump_sample = 1;
+        } else if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg[0] != '-' && !instance_path) {
+            instance_path = arg;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (capacity < 0) {
+        fprintf(stderr, "capacity must not be negative\n");
+        return 2;
+    }
+
+    DeliveryProblem *problem = delivery_problem_new();
+    if (!problem) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    generate.seed = seed;
+    if (instance_path) {
+        if (load_instance(instance_path, problem) != 0) {
+            delivery_problem_free(problem);
+            return 1;
+        }
+    } else if (generate.num_stops > 0) {
+        if (generate_instance(problem, &generate) != 0) {
+            fprintf(stderr, "out of memory\n");
+            delivery_problem_free(problem);
+            return 1;
+        }
+    } else if (initialize_data(problem, seed) != 0) {
+        fprintf(stderr, "out of memory\n");
+        delivery_problem_free(problem);
+        return 1;
+    }
+
+    // Command line deadlines override the instance's
+    for (int priority = 1; priority <= PACKAGE_PRIORITY_PREMIUM; priority++) {
+        if (sla[priority] > 0) delivery_problem_set_sla(problem, priority, sla[priority]);
+    }
+
+    if (convert_path) {
+        int status = write_instance_binary(convert_path, problem);
+        delivery_problem_free(problem);
+        return status == 0 ? 0 : 1;
+    }
+    if (dump_sample) {
+        int status = write_instance_text(stdout, problem);
+        delivery_problem_free(problem);
+        return status == 0 ? 0 : 1;
+    }
+
+    FILE *out = stdout;
+    if (output_path) {
+        out = fopen(output_path, "w");
+        if (!out) {
+            perror(output_path);
+            delivery_problem_free(problem);
+            return 1;
+        }
+    }
+
+    if (hierarchy_path && delivery_problem_use_hierarchy(problem, hierarchy_path, NULL) != 0) {
+        fprintf(stderr, "failed to prepare the contraction hierarchy\n");
+        if (out != stdout) fclose(out);
+        delivery_problem_free(problem);
+        return 1;
+    }
+
+    ThreadPool *pool = thread_pool_create(threads);
+    if (delivery_problem_build_matrix(problem, pool) != 0) {
+        fprintf(stderr, "failed to compute the distance matrix\n");
+        thread_pool_destroy(pool);
+        if (out != stdout) fclose(out);
+        delivery_problem_free(problem);
+        return 1;
+    }
+
+    DeliveryPlan plan = {0};
+    int solved;
+    if (fleet) {
+        CvrpOptions options;
+        cvrp_default_options(&options);
+        options.vehicle_capacity = capacity;
+        options.max_vehicles = max_vehicles;
+        options.improve.two_opt = improve.two_opt;
+        options.improve.or_opt_segment = improve.or_opt_segment;
+        solved = cvrp_solve(problem, &options, pool, &plan, NULL);
+    } else if (portfolio) {
+        PortfolioOptions options;
+        PortfolioStats stats;
+        portfolio_default_options(&options);
+        options.starts = portfolio_starts;
+        options.time_budget = improve.time_budget;
+        options.seed = seed;
+        options.improve = improve;
+        solved = portfolio_solve(problem, &options, pool, &plan, &stats);
+        if (solved == 0) {
+            fprintf(stderr, "portfolio: %d starts on %d threads, best from start %d (%s)\n",
+                    stats.starts_run, stats.workers, stats.best_start,
+                    portfolio_heuristic_name(stats.best_heuristic));
+        }
+    } else {
+        solved = calculate_optimal_route(problem, &plan, &improve, NULL);
+    }
+    // A single vehicle carries the knapsack's selection, so its plan lists
+    // the packages and per-stop loads like a CVRP plan does
+    KnapsackSolver knapsack;
+    knapsack_solver_init(&knapsack);
+    knapsack.mode = knapsack_mode;
+    const KnapsackResult *selection = NULL;
+    if (solved != 0) {
+        fprintf(stderr, "solver ran out of memory\n");
+    } else if (!fleet && (!(selection = knapsack_solve(&knapsack, problem, capacity)) ||
+                          knapsack_load_plan(&plan, problem, selection) != 0)) {
+        fprintf(stderr, "knapsack ran out of memory\n");
+        solved = -1;
+    } else {
+        write_plan_text(out, problem, &plan);
+        if (plan_path && write_plan_binary(plan_path, problem, &plan) != 0) solved = -1;
+        if (simulate_step > 0) {
+            PlanSchedule day;
+            FleetSim sim;
+            FleetSimStats stats;
+            if (plan_schedule_build(&day, problem, &plan) != 0) {
+                fprintf(stderr, "simulation ran out of memory\n");
+                solved = -1;
+            } else if (fleet_sim_init(&sim, day.vehicles, day.num_vehicles, day.stops,
+                                      problem->points.x, problem->points.y) != 0) {
+                fprintf(stderr, "simulation ran out of memory\n");
+                plan_schedule_free(&day);
+                solved = -1;
+            } else {
+                fleet_sim_run(&sim, simulate_step, &stats);
+                fprintf(stderr,
+                        "simulation: %d vehicles, %llu stops, %llu events in %llu steps of %g min; "
+                        "%.0f sim minutes in %.2f ms (%.0fx real time)\n",
+                        stats.vehicles, (unsigned long long)stats.stops,
+                        (unsigned long long)stats.events, (unsigned long long)stats.steps,
+                        simulate_step, stats.sim_minutes, stats.elapsed * 1e3,
+                        stats.elapsed > 0 ? stats.sim_minutes * 60 / stats.elapsed : 0.0);
+                fleet_sim_free(&sim);
+                plan_schedule_free(&day);
+            }
+        }
+        if (delivery_problem_has_time_windows(problem) &&
+            write_lateness_text(out, problem, &plan) != 0) {
+            fprintf(stderr, "time windows ran out of memory\n");
+            solved = -1;
+        }
+        if (schedule) {
+            TrafficModel model = {0};
+            if (delivery_problem_build_traffic(problem, &model) != 0 ||
+                write_schedule_text(out, &plan, &model, &traffic) < 0) {
+                fprintf(stderr, "traffic model ran out of memory\n");
+                solved = -1;
+            }
+            traffic_model_free(&model);
+        }
+        if (selection) write_knapsack_text(out, problem, selection);
+    }
+    knapsack_solver_free(&knapsack);
+
+    int status = solved != 0 || ferror(out) ? 1 : 0;
+    if (out != stdout) fclose(out);
+    if (metrics_path && metrics_save(metrics_path) != 0) {
+        perror(metrics_path);
+        status = 1;
+    }
+    delivery_plan_clear(&plan);
+    thread_pool_destroy(pool);
+    delivery_problem_free(problem);
+    return status;
+}
@@ -5,38 +5,61 @@
 #include <string.h>
 #include <stdio.h>
 #include <limits.h>
+
+#include "fleet_sim.h"
+#include "instance_io.h"
+#include "knapsack.h"
+#include "metrics.h"
+#include "plan_file.h"
+#include "route_repair.h"
+#include "solver.h"
+#include "spatial_index.h"
+
 #define M_PI 3.14159265358979323846
-#define MAX_NODES 50
-#define MAX_PACKAGES 100
-#define INF 999999
 #define CANVAS_WIDTH 1000
 #define CANVAS_HEIGHT 1000
 #define VEHICLE_SIZE 20
 #define ANIMATION_INTERVAL 50
+// Room kept right of a node for its name and value labels when culling
+#define NODE_LABEL_WIDTH 180
+#define CLICK_RADIUS 15
+#define PACKAGE_CAPACITY 50
+#define ROUTE_TIME_BUDGET 30.0  // seconds of 2-opt/Or-opt per route solve
+// A right-click on empty map adds an order: a stop joined to its nearest
+// points by this many roads, with one package
+#define ORDER_ROADS 4
+#define ORDER_WEIGHT 5
+#define ORDER_VALUE 100
+#define STATS_REFRESH_SECONDS 1
+#define REPLAY_MINUTES_PER_SECOND 10  // plan minutes a replay covers per second at speed 1
+#define FLEET_MINUTES_PER_SECOND 60   // sim minutes the whole fleet covers per second at speed 1
+#define FLEET_VEHICLE_RADIUS 4
 
-typedef struct {
-    int id;
-    char name[100];
-    double lat, lon;
-    double x, y;
-    int is_depot;
-    int package_count;
-} DeliveryPoint;
+typedef enum {
+    SOLVE_ROUTE,
+    SOLVE_PACKAGES
+} SolveKind;
 
+// A solve running on the worker thread. The worker only reads the problem,
+// which the UI leaves alone while a job runs, and hands everything back to
+// the main loop through g_idle_add.
 typedef struct {
-    int id;
-    int weight;
-    int value;
-    int priority;
-    double carbon_footprint;
-    int destination_id;
-} Package;
+    SolveKind kind;
+    guint generation;
+    gint cancel;                // set by the Cancel button, read by the worker
+    gint64 started;             // g_get_monotonic_time() at dispatch
+    DeliveryPlan plan;
+    TourImproveStats stats;
+    int status;
+} SolveJob;
 
+// Improved tour published by the worker while the search is still running
 typedef struct {
-    int from, to;
+    guint generation;
+    int *stops;
+    int num_stops;
     double distance;
-    double carbon_emission_factor;
-} Route;
+} RouteUpdate;
 
 typedef struct {
     GtkWidget *window;
@@ -45,18 +68,18 @@ typedef struct {
     GtkWidget *route_button;
     GtkWidget *optimize_button;
     GtkWidget *start_button;
+    GtkWidget *cancel_button;
     GtkWidget *speed_scale;
     GtkWidget *table_label;
-    DeliveryPoint points[MAX_NODES];
-    Package packages[MAX_PACKAGES];
-    Route routes[MAX_NODES * MAX_NODES];
-    int num_points;
-    int num_packages;
-    int num_routes;
-    int *optimal_route;
-    int route_length;
-    double total_distance;
-    double total_emissions;
+    GtkWidget *stats_expander;
+    GtkWidget *stats_label;
+    GtkWidget *open_plan_button;
+    GtkWidget *fleet_check;
+    DeliveryProblem *problem;
+    DeliveryPlan plan;
+    ThreadPool *pool;
+    KnapsackSolver knapsack;
+    Arena solve_arena;              // route solve scratch, kept between solves
     int selected_point;
     gboolean show_route;
     gboolean animation_running;
@@ -64,202 +87,173 @@ typedef struct {
     double vehicle_progress;
     guint animation_timeout_id;
     double animation_speed;
+    // Static map (roads, labels, routes, nodes) rendered once and reused
+    // by every frame until map_dirty is set or the canvas is resized
+    cairo_surface_t *map_layer;
+    int map_width, map_height;
+    gboolean map_dirty;
+    int *node_values;               // net package value per point
+    int node_values_count;
+    unsigned int node_values_version;
+    GdkRectangle vehicle_area;      // where the sprite was last drawn
+    SpatialIndex point_index;       // hit-testing, built on the first click
+    int point_index_count;          // points indexed, -1 before the first build
+    SolveJob *job;                  // running solve, NULL when idle
+    GThread *solver_thread;
+    guint solve_generation;
+    gboolean packages_shown;        // knapsack table is on screen
+    // Plan file shown instead of plan, read in place (replay.mapping.data is
+    // NULL when none). The animation follows one vehicle at a time by its
+    // recorded times, validating each vehicle's stops as it gets there.
+    PlanFile replay;
+    int replay_vehicle;
+    const PlanStop *replay_stops;   // of replay_vehicle, NULL before the first
+    int replay_stop;                // last stop reached
+    double replay_clock;            // minutes after the shift starts
+    // Whole-fleet mode: every vehicle of the shown plan (or plan file) is
+    // simulated at once, a fixed step of sim time per frame
+    gboolean simulating;
+    FleetSim fleet;
+    PlanSchedule fleet_day;         // schedule of app->plan, empty for a plan file
 } DeliveryApp;
 
 DeliveryApp *app;
 
-void dijkstra(int graph[MAX_NODES][MAX_NODES], int src, int dist[], int parent[]) {
-    gboolean visited[MAX_NODES] = {FALSE};
-    
-    for (int i = 0; i < app->num_points; i++) {
-        dist[i] = INF;
-        parent[i] = -1;
-    }
-    
-    dist[src] = 0;
-    
-    for (int count = 0; count < app->num_points - 1; count++) {
-        int min_dist = INF, u = -1;
-        
-        for (int v = 0; v < app->num_points; v++) {
-            if (!visited[v] && dist[v] <= min_dist) {
-                min_dist = dist[v];
-                u = v;
-            }
-        }
-        
-        if (u == -1) break;
-        visited[u] = TRUE;
-        
-        for (int v = 0; v < app->num_points; v++) {
-            if (!visited[v] && graph[u][v] && dist[u] != INF &&
-                dist[u] + graph[u][v] < dist[v]) {
-                dist[v] = dist[u] + graph[u][v];
-                parent[v] = u;
-            }
-        }
-    }
+// The animation follows the first vehicle of the plan
+static const VehicleRoute *animated_vehicle(void) {
+    return app->plan.num_vehicles > 0 ? &app->plan.vehicles[0] : NULL;
 }
 
-int knapsack(int capacity) {
-    int dp[capacity + 1];
-    memset(dp, 0, sizeof(dp));
-    for (int i = 0; i < app->num_packages; i++) {
-        for (int w = capacity; w >= app->packages[i].weight; w--) {
-            int value_with_priority = app->packages[i].value; // No priority
-            int carbon_penalty = (int)(app->packages[i].carbon_footprint * 10);
-            int net_value = value_with_priority - carbon_penalty;
-            if (dp[w - app->packages[i].weight] + net_value > dp[w]) {
-                dp[w] = dp[w - app->packages[i].weight] + net_value;
-            }
-        }
-    }
-    return dp[capacity];
+static gboolean replaying(void) {
+    return app->replay.mapping.data != NULL;
 }
 
-double calculate_distance(DeliveryPoint *p1, DeliveryPoint *p2) {
-    double dx = p1->x - p2->x;
-    double dy = p1->y - p2->y;
-    return sqrt(dx * dx + dy * dy);
+static void close_replay(void) {
+    plan_file_close(&app->replay);
+    app->replay_stops = NULL;
 }
 
-void initialize_data() {
-    char *locations[] = {
-        "Depot - Koramangala", "Electronic City", "Whitefield", "Banashankari",
-        "Jayanagar", "Indiranagar", "HSR Layout", "BTM Layout",
-        "Malleshwaram", "Rajajinagar", "Hebbal", "Marathahalli",
-        "Yeshwanthpur", "Kengeri", "Vijayanagar", "Ulsoor",
-        "Shivajinagar", "KR Puram", "Basavanagudi", "RT Nagar"
-    };
-    
-    app->num_points = 18;
-    
-    for (int i = 0; i < app->num_points; i++) {
-        app->points[i].id = i;
-        strcpy(app->points[i].name, locations[i]);
-        app->points[i].is_depot = (i == 0);
-        app->points[i].x = 100 + (i % 6) * 160 + (rand() % 20);
-        app->points[i].y = 100 + (i / 6) * 160 + (rand() % 20);
-        app->points[i].package_count = rand() % 5 + 1;
+// Net package value delivered to each point, recomputed only when the
+// packages change instead of rescanning them per node on every frame
+static void update_node_values(void) {
+    const DeliveryProblem *problem = app->problem;
+    int n = problem->points.count;
+    if (app->node_values && app->node_values_count == n &&
+        app->node_values_version == problem->packages_version) {
+        return;
     }
-    
-    app->num_packages = 20;
-    for (int i = 0; i < app->num_packages; i++) {
-        app->packages[i].id = i;
-        app->packages[i].weight = rand() % 10 + 1;
-        app->packages[i].value = rand() % 100 + 50;
-        app->packages[i].priority = rand() % 3 + 1;
-        app->packages[i].carbon_footprint = (rand() % 50 + 10) / 10.0;
-        app->packages[i].destination_id = rand() % (app->num_points - 1) + 1;
-    }
-    
-    app->num_routes = 0;
-    for (int i = 0; i < app->num_points; i++) {
-        for (int j = i + 1; j < app->num_points; j++) {
-            app->routes[app->num_routes].from = i;
-            app->routes[app->num_routes].to = j;
-            app->routes[app->num_routes].distance = calculate_distance(&app->points[i], &app->points[j]);
-            app->routes[app->num_routes].carbon_emission_factor = 0.21 + (rand() % 10) / 100.0;
-            app->num_routes++;
-        }
+    int *values = realloc(app->node_values, (n > 0 ? n : 1) * sizeof(int));
+    if (!values) return;
+    app->node_values = values;
+    app->node_values_count = n;
+    app->node_values_version = problem->packages_version;
+    memset(values, 0, (n > 0 ? n : 1) * sizeof(int));
+    for (int j = 0; j < problem->packages.count; j++) {
+        values[problem->packages.destination_id[j]] += package_net_value(problem, j);
     }
 }
 
-void calculate_optimal_route() {
-    if (app->optimal_route) free(app->optimal_route);
-    
-    app->optimal_route = malloc(app->num_points * sizeof(int));
-    app->route_length = 0;
-    app->total_distance = 0;
-    app->total_emissions = 0;
-    
-    gboolean visited[MAX_NODES] = {FALSE};
-    int current = 0;
-    app->optimal_route[app->route_length++] = current;
-    visited[current] = TRUE;
-    
-    while (app->route_length < app->num_points) {
-        double min_distance = INF;
-        int next_point = -1;
-        
-        for (int i = 0; i < app->num_points; i++) {
-            if (!visited[i]) {
-                double dist = calculate_distance(&app->points[current], &app->points[i]);
-                if (dist < min_distance) {
-                    min_distance = dist;
-                    next_point = i;
-                }
-            }
-        }
-        
-        if (next_point != -1) {
-            app->optimal_route[app->route_length++] = next_point;
-            visited[next_point] = TRUE;
-            app->total_distance += min_distance;
-            app->total_emissions += min_distance * 0.21;
-            current = next_point;
-        } else {
-            break;
-        }
-    }
-    
-    if (app->route_length > 1) {
-        app->total_distance += calculate_distance(&app->points[current], &app->points[0]);
-        app->total_emissions += calculate_distance(&app->points[current], &app->points[0]) * 0.21;
+// Rebuilds the point index when points were added. Returns 0 or -1.
+static int update_point_index(void) {
+    int n = app->problem->points.count;
+    if (app->point_index_count == n) return 0;
+    if (app->point_index_count >= 0) spatial_index_free(&app->point_index);
+    app->point_index_count = -1;
+    if (spatial_index_build(&app->point_index, app->problem->points.x, app->problem->points.y,
+                            n) != 0) {
+        return -1;
     }
-    
-    app->show_route = TRUE;
+    app->point_index_count = n;
+    return 0;
 }
 
-gboolean on_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
+// Point under the given canvas position (nearest within CLICK_RADIUS), or -1
+static int point_at(double x, double y) {
+    if (update_point_index() != 0) return -1;
+    return spatial_index_nearest(&app->point_index, x, y, CLICK_RADIUS);
+}
+
+// Whether the box spanned by two points, grown by margin, meets the canvas
+static gboolean box_visible(double x1, double y1, double x2, double y2, double margin,
+                            int width, int height) {
+    return fmax(x1, x2) + margin >= 0 && fmin(x1, x2) - margin <= width &&
+           fmax(y1, y2) + margin >= 0 && fmin(y1, y2) - margin <= height;
+}
+
+// Roads, distance labels, planned routes and nodes. Only redrawn into the
+// cached map layer when the data, the plan or the canvas size changes.
+static void draw_map(cairo_t *cr, int width, int height) {
+    const DeliveryProblem *problem = app->problem;
+    const double *px = problem->points.x;
+    const double *py = problem->points.y;
+
     cairo_set_source_rgb(cr, 0.95, 0.95, 0.95);
     cairo_paint(cr);
     // Draw all routes and distances (gray)
-    cairo_set_source_rgb(cr, 0.7, 0.7, 0.7);
     cairo_set_line_width(cr, 1.0);
-    for (int i = 0; i < app->num_routes; i++) {
-        int from = app->routes[i].from;
-        int to = app->routes[i].to;
-        double x1 = app->points[from].x;
-        double y1 = app->points[from].y;
-        double x2 = app->points[to].x;
-        double y2 = app->points[to].y;
+    for (int i = 0; i < problem->routes.count; i++) {
+        int from = problem->routes.from[i];
+        int to = problem->routes.to[i];
+        double x1 = px[from], y1 = py[from];
+        double x2 = px[to], y2 = py[to];
+        if (!box_visible(x1, y1, x2, y2, 0, width, height)) continue;
+        cairo_set_source_rgb(cr, 0.7, 0.7, 0.7);
         cairo_move_to(cr, x1, y1);
         cairo_line_to(cr, x2, y2);
         cairo_stroke(cr);
         // Draw distance at midpoint
         double mx = (x1 + x2) / 2;
         double my = (y1 + y2) / 2;
+        if (!box_visible(mx, my, mx, my, 40, width, height)) continue;
         char dist_str[16];
-        snprintf(dist_str, sizeof(dist_str), "%.1f", app->routes[i].distance / 10.0); // scale for km
+        snprintf(dist_str, sizeof(dist_str), "%.1f", problem->routes.distance[i] / 10.0); // scale for km
         cairo_set_source_rgb(cr, 0.2, 0.2, 0.2);
         cairo_move_to(cr, mx + 5, my - 5);
         cairo_show_text(cr, dist_str);
-        cairo_set_source_rgb(cr, 0.7, 0.7, 0.7); // reset for next line
     }
-    // Highlight the optimal route (blue, thick)
-    if (app->show_route && app->optimal_route && app->route_length > 1) {
+    // Highlight each vehicle's route (blue, thick)
+    if (app->show_route && replaying()) {
         cairo_set_source_rgb(cr, 0.2, 0.6, 1.0);
         cairo_set_line_width(cr, 3.0);
-        for (int i = 0; i < app->route_length - 1; i++) {
-            int from = app->optimal_route[i];
-            int to = app->optimal_route[i + 1];
-            cairo_move_to(cr, app->points[from].x, app->points[from].y);
-            cairo_line_to(cr, app->points[to].x, app->points[to].y);
+        for (int v = 0; v < app->replay.num_vehicles; v++) {
+            const PlanStop *stops = plan_file_vehicle_stops(&app->replay, v);
+            int num_stops = app->replay.vehicles[v].num_stops;
+            if (!stops || num_stops < 2) continue;
+            for (int i = 0; i < num_stops; i++) {
+                int from = stops[i].point;
+                int to = stops[i + 1 < num_stops ? i + 1 : 0].point;
+                if (!box_visible(px[from], py[from], px[to], py[to], 2, width, height)) continue;
+                cairo_move_to(cr, px[from], py[from]);
+                cairo_line_to(cr, px[to], py[to]);
+            }
+            cairo_stroke(cr);
+        }
+    } else if (app->show_route) {
+        cairo_set_source_rgb(cr, 0.2, 0.6, 1.0);
+        cairo_set_line_width(cr, 3.0);
+        for (int v = 0; v < app->plan.num_vehicles; v++) {
+            const VehicleRoute *vehicle = &app->plan.vehicles[v];
+            if (vehicle->num_stops < 2) continue;
+            for (int i = 0; i < vehicle->num_stops; i++) {
+                // The last leg closes the loop back to the depot
+                int from = vehicle->stops[i];
+                int to = i + 1 < vehicle->num_stops ? vehicle->stops[i + 1] : vehicle->depot;
+                if (!box_visible(px[from], py[from], px[to], py[to], 2, width, height)) continue;
+                cairo_move_to(cr, px[from], py[from]);
+                cairo_line_to(cr, px[to], py[to]);
+            }
             cairo_stroke(cr);
         }
-        // Close the loop to depot if needed
-        int last = app->optimal_route[app->route_length - 1];
-        cairo_move_to(cr, app->points[last].x, app->points[last].y);
-        cairo_line_to(cr, app->points[0].x, app->points[0].y);
-        cairo_stroke(cr);
     }
-    
-    for (int i = 0; i < app->num_points; i++) {
-        double x = app->points[i].x;
-        double y = app->points[i].y;
-        
-        if (app->points[i].is_depot) {
+
+    update_node_values();
+    for (int i = 0; i < problem->points.count; i++) {
+        double x = px[i];
+        double y = py[i];
+        // Labels reach about NODE_LABEL_WIDTH to the right of the node
+        if (x + NODE_LABEL_WIDTH < 0 || x - 15 > width || y + 30 < 0 || y - 15 > height) continue;
+
+        if (problem->points.is_depot[i]) {
             cairo_set_source_rgb(cr, 1.0, 0.0, 0.0);
             cairo_arc(cr, x, y, 12, 0, 2 * M_PI);
         } else {
@@ -267,29 +261,17 @@ gboolean on_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
             cairo_arc(cr, x, y, 10, 0, 2 * M_PI);
         }
         cairo_fill(cr);
-        
-        if (i == app->selected_point) {
-            cairo_set_source_rgb(cr, 1.0, 1.0, 0.0);
-            cairo_set_line_width(cr, 2.0);
-            cairo_arc(cr, x, y, 15, 0, 2 * M_PI);
-            cairo_stroke(cr);
-        }
-        
+
         cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
         cairo_move_to(cr, x + 15, y - 5);
-        cairo_show_text(cr, app->points[i].name);
-        
+        cairo_show_text(cr, delivery_point_name(problem, i));
+
         char package_info[50];
-        snprintf(package_info, sizeof(package_info), "Packages: %d", app->points[i].package_count);
+        snprintf(package_info, sizeof(package_info), "Packages: %d", problem->points.package_count[i]);
         cairo_move_to(cr, x + 15, y + 10);
         cairo_show_text(cr, package_info);
         // Show total value of packages for this node
-        int total_value = 0;
-        for (int j = 0; j < app->num_packages; j++) {
-            if (app->packages[j].destination_id == app->points[i].id) {
-                total_value += app->packages[j].value - (int)(app->packages[j].carbon_footprint * 10);
-            }
-        }
+        int total_value = app->node_values && i < app->node_values_count ? app->node_values[i] : 0;
         if (total_value > 0) {
             char value_info[50];
             snprintf(value_info, sizeof(value_info), "Value: %d", total_value);
@@ -297,43 +279,221 @@ gboolean on_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
             cairo_show_text(cr, value_info);
         }
     }
-    
-    if (app->animation_running && app->optimal_route) {
-        if (app->current_route_segment < app->route_length) {
-            int from = app->optimal_route[app->current_route_segment];
-            int to = app->optimal_route[(app->current_route_segment + 1) % app->route_length];
-            
-            double start_x = app->points[from].x;
-            double start_y = app->points[from].y;
-            double end_x = app->points[to].x;
-            double end_y = app->points[to].y;
-            
-            double vehicle_x = start_x + (end_x - start_x) * app->vehicle_progress;
-            double vehicle_y = start_y + (end_y - start_y) * app->vehicle_progress;
-            
-            cairo_set_source_rgb(cr, 0.8, 0.2, 0.2);
-            cairo_arc(cr, vehicle_x, vehicle_y, VEHICLE_SIZE/2, 0, 2 * M_PI);
-            cairo_fill(cr);
-            
-            cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
-            cairo_arc(cr, 
-                vehicle_x + VEHICLE_SIZE/3 * cos(atan2(end_y - start_y, end_x - start_x)),
-                vehicle_y + VEHICLE_SIZE/3 * sin(atan2(end_y - start_y, end_x - start_x)),
-                VEHICLE_SIZE/4, 0, 2 * M_PI);
-            cairo_fill(cr);
-        }
+}
+
+static void end_fleet_simulation(void) {
+    if (!app->simulating) return;
+    if (app->animation_timeout_id) {
+        g_source_remove(app->animation_timeout_id);
+        app->animation_timeout_id = 0;
     }
-    
+    fleet_sim_free(&app->fleet);
+    plan_schedule_free(&app->fleet_day);
+    app->simulating = FALSE;
+    app->animation_running = FALSE;
+    gtk_button_set_label(GTK_BUTTON(app->start_button), "Start Delivery");
+    gtk_widget_queue_draw(app->drawing_area);
+}
+
+// Marks the cached map layer stale, e.g. after a new plan or new data. A
+// fleet simulation of the old data ends here, as it points into it.
+static void invalidate_map(void) {
+    end_fleet_simulation();
+    app->map_dirty = TRUE;
+    gtk_widget_queue_draw(app->drawing_area);
+}
+
+// Replayed vehicle: waits at a stop until its recorded departure, then
+// covers the leg by the next arrival
+static gboolean replay_position(double *x, double *y, double *heading) {
+    if (!app->replay_stops) return FALSE;
+    const PlanVehicle *vehicle = &app->replay.vehicles[app->replay_vehicle];
+    const PlanStop *from = &app->replay_stops[app->replay_stop];
+    int last = app->replay_stop + 1 == vehicle->num_stops;
+    int to = app->replay_stops[last ? 0 : app->replay_stop + 1].point;
+    double arrival = last ? vehicle->finish : app->replay_stops[app->replay_stop + 1].arrival;
+    double progress = 0.0;
+    if (app->replay_clock > from->departure && arrival > from->departure) {
+        progress = fmin(1.0, (app->replay_clock - from->departure) / (arrival - from->departure));
+    }
+    const double *px = app->problem->points.x, *py = app->problem->points.y;
+    *x = px[from->point] + (px[to] - px[from->point]) * progress;
+    *y = py[from->point] + (py[to] - py[from->point]) * progress;
+    *heading = atan2(py[to] - py[from->point], px[to] - px[from->point]);
+    return TRUE;
+}
+
+// Sprite position and heading on the current leg of the animated vehicle
+static gboolean vehicle_position(double *x, double *y, double *heading) {
+    if (app->simulating) return FALSE;
+    if (app->animation_running && replaying()) return replay_position(x, y, heading);
+    const VehicleRoute *vehicle = animated_vehicle();
+    if (!app->animation_running || !vehicle || app->current_route_segment >= vehicle->num_stops) {
+        return FALSE;
+    }
+    int from = vehicle->stops[app->current_route_segment];
+    int to = vehicle->stops[(app->current_route_segment + 1) % vehicle->num_stops];
+    double start_x = app->problem->points.x[from];
+    double start_y = app->problem->points.y[from];
+    double end_x = app->problem->points.x[to];
+    double end_y = app->problem->points.y[to];
+    *x = start_x + (end_x - start_x) * app->vehicle_progress;
+    *y = start_y + (end_y - start_y) * app->vehicle_progress;
+    *heading = atan2(end_y - start_y, end_x - start_x);
+    return TRUE;
+}
+
+// Widget area covered by the sprite at its current position
+static GdkRectangle current_vehicle_area(void) {
+    GdkRectangle area = {0, 0, 0, 0};
+    double x, y, heading;
+    if (vehicle_position(&x, &y, &heading)) {
+        area.x = (int)floor(x) - VEHICLE_SIZE;
+        area.y = (int)floor(y) - VEHICLE_SIZE;
+        area.width = area.height = 2 * VEHICLE_SIZE + 1;
+    }
+    return area;
+}
+
+// Every vehicle of the fleet simulation as one path, filled once
+static void draw_fleet(cairo_t *cr) {
+    const FleetSim *sim = &app->fleet;
+    double left, top, right, bottom;
+    cairo_clip_extents(cr, &left, &top, &right, &bottom);
+    left -= FLEET_VEHICLE_RADIUS;
+    top -= FLEET_VEHICLE_RADIUS;
+    right += FLEET_VEHICLE_RADIUS;
+    bottom += FLEET_VEHICLE_RADIUS;
+    cairo_new_path(cr);
+    for (int v = 0; v < sim->count; v++) {
+        double x = sim->x[v], y = sim->y[v];
+        if (x < left || x > right || y < top || y > bottom) continue;
+        cairo_new_sub_path(cr);
+        cairo_arc(cr, x, y, FLEET_VEHICLE_RADIUS, 0, 2 * M_PI);
+    }
+    cairo_set_source_rgb(cr, 0.8, 0.2, 0.2);
+    cairo_fill(cr);
+}
+
+gboolean on_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    int width = gtk_widget_get_allocated_width(widget);
+    int height = gtk_widget_get_allocated_height(widget);
+    if (!app->map_layer || app->map_dirty || app->map_width != width || app->map_height != height) {
+        if (app->map_layer) cairo_surface_destroy(app->map_layer);
+        app->map_layer = gdk_window_create_similar_surface(gtk_widget_get_window(widget),
+                                                           CAIRO_CONTENT_COLOR, width, height);
+        cairo_t *map = cairo_create(app->map_layer);
+        draw_map(map, width, height);
+        cairo_destroy(map);
+        app->map_width = width;
+        app->map_height = height;
+        app->map_dirty = FALSE;
+    }
+    // GTK clips cr to the invalidated area, so animation frames only copy
+    // the few pixels around the vehicle
+    cairo_set_source_surface(cr, app->map_layer, 0, 0);
+    cairo_paint(cr);
+
+    if (app->selected_point >= 0 && app->selected_point < app->problem->points.count) {
+        cairo_set_source_rgb(cr, 1.0, 1.0, 0.0);
+        cairo_set_line_width(cr, 2.0);
+        cairo_arc(cr, app->problem->points.x[app->selected_point],
+                  app->problem->points.y[app->selected_point], 15, 0, 2 * M_PI);
+        cairo_stroke(cr);
+    }
+
+    if (app->simulating) draw_fleet(cr);
+
+    double vehicle_x, vehicle_y, heading;
+    if (vehicle_position(&vehicle_x, &vehicle_y, &heading)) {
+        cairo_set_source_rgb(cr, 0.8, 0.2, 0.2);
+        cairo_arc(cr, vehicle_x, vehicle_y, VEHICLE_SIZE/2, 0, 2 * M_PI);
+        cairo_fill(cr);
+
+        cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+        cairo_arc(cr,
+            vehicle_x + VEHICLE_SIZE/3 * cos(heading),
+            vehicle_y + VEHICLE_SIZE/3 * sin(heading),
+            VEHICLE_SIZE/4, 0, 2 * M_PI);
+        cairo_fill(cr);
+    }
+
     return FALSE;
 }
 
-gboolean animation_step(gpointer data) {
-    DeliveryApp *app = (DeliveryApp *)data;
+// Next replayed vehicle with stops from first on, wrapping around. Returns
+// FALSE when there is none or its records are corrupt.
+static gboolean replay_select_vehicle(int first) {
+    app->replay_stops = NULL;
+    for (int i = 0; i < app->replay.num_vehicles; i++) {
+        int v = (first + i) % app->replay.num_vehicles;
+        if (app->replay.vehicles[v].num_stops == 0) continue;
+        app->replay_stops = plan_file_vehicle_stops(&app->replay, v);
+        if (!app->replay_stops) return FALSE;
+        app->replay_vehicle = v;
+        app->replay_stop = 0;
+        app->replay_clock = app->replay_stops[0].arrival;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void describe_replay(void) {
+    const PlanVehicle *vehicle = &app->replay.vehicles[app->replay_vehicle];
+    const PlanStop *stop = &app->replay_stops[app->replay_stop];
+    int minutes = (int)app->replay_clock;
+    char info[300];
+    snprintf(info, sizeof(info),
+             "Replay: vehicle %d/%d | %d:%02d | Stop %d/%d: %s | Load: %.1f kg | Emissions: %.2f kg CO2",
+             app->replay_vehicle + 1, app->replay.num_vehicles, minutes / 60, minutes % 60,
+             app->replay_stop + 1, vehicle->num_stops, delivery_point_name(app->problem, stop->point),
+             stop->load, stop->emissions / 10);
+    gtk_label_set_text(GTK_LABEL(app->info_label), info);
+}
+
+static void advance_replay(void) {
+    if (!app->replay_stops) return;
+    app->replay_clock += ANIMATION_INTERVAL / 1000.0 * REPLAY_MINUTES_PER_SECOND * app->animation_speed;
+    const PlanVehicle *vehicle = &app->replay.vehicles[app->replay_vehicle];
+    int reached = app->replay_stop;
+    while (app->replay_stop + 1 < vehicle->num_stops &&
+           app->replay_clock >= app->replay_stops[app->replay_stop + 1].arrival) {
+        app->replay_stop++;
+    }
+    if (app->replay_stop + 1 == vehicle->num_stops && app->replay_clock >= vehicle->finish) {
+        replay_select_vehicle(app->replay_vehicle + 1);
+        reached = -1;
+    }
+    if (app->replay_stops && app->replay_stop != reached) describe_replay();
+}
+
+static void describe_fleet(void) {
+    const FleetSim *sim = &app->fleet;
+    int minutes = (int)sim->clock;
+    char info[300];
+    snprintf(info, sizeof(info),
+             "Fleet: %d vehicles | %d:%02d | Driving: %d | At stops: %d | Back: %d | Events: %llu",
+             sim->count, minutes / 60, minutes % 60, sim->driving,
+             sim->count - sim->driving - sim->finished, sim->finished,
+             (unsigned long long)sim->events_run);
+    gtk_label_set_text(GTK_LABEL(app->info_label), info);
+}
+
+// Fixed sim step per frame, however long the frame took to draw
+static void advance_fleet(void) {
+    double step = ANIMATION_INTERVAL / 1000.0 * FLEET_MINUTES_PER_SECOND * app->animation_speed;
+    int active = fleet_sim_advance(&app->fleet, step);
+    describe_fleet();
+    if (active == 0) end_fleet_simulation();
+}
+
+static void advance_route(void) {
+    int route_length = app->plan.num_vehicles > 0 ? app->plan.vehicles[0].num_stops : 0;
     
-    if (app->current_route_segment >= app->route_length) {
+    if (app->current_route_segment >= route_length) {
         app->current_route_segment = 0;
         app->vehicle_progress = 0.0;
-        return G_SOURCE_CONTINUE;
+        return;
     }
 
     app->vehicle_progress += 0.02 * app->animation_speed;
@@ -342,17 +502,87 @@ gboolean animation_step(gpointer data) {
         app->current_route_segment++;
         app->vehicle_progress = 0.0;
         
-        if (app->current_route_segment >= app->route_length) {
+        if (app->current_route_segment >= route_length) {
             app->current_route_segment = 0;
         }
     }
+}
+
+gboolean animation_step(gpointer data) {
+    DeliveryApp *app = (DeliveryApp *)data;
+    if (app->simulating) {
+        advance_fleet();
+        // Vehicles are everywhere, so the whole map is repainted from the
+        // cached layer
+        gtk_widget_queue_draw(app->drawing_area);
+        return G_SOURCE_CONTINUE;
+    }
+    if (replaying()) {
+        advance_replay();
+    } else {
+        advance_route();
+    }
     
-    gtk_widget_queue_draw(app->drawing_area);
+    // Repaint only where the sprite was and where it is now
+    GdkRectangle area = current_vehicle_area();
+    gtk_widget_queue_draw_area(app->drawing_area, app->vehicle_area.x, app->vehicle_area.y,
+                               app->vehicle_area.width, app->vehicle_area.height);
+    gtk_widget_queue_draw_area(app->drawing_area, area.x, area.y, area.width, area.height);
+    app->vehicle_area = area;
     return G_SOURCE_CONTINUE;
 }
 
+// Simulates every vehicle of the plan file, or of the shown plan
+static void start_fleet_simulation(void) {
+    const PlanVehicle *vehicles;
+    const PlanStop *stops;
+    int count;
+    if (replaying()) {
+        for (int v = 0; v < app->replay.num_vehicles; v++) {
+            if (!plan_file_vehicle_stops(&app->replay, v)) {
+                gtk_label_set_text(GTK_LABEL(app->info_label), "The plan file is corrupt");
+                return;
+            }
+        }
+        vehicles = app->replay.vehicles;
+        stops = app->replay.stops;
+        count = app->replay.num_vehicles;
+    } else {
+        if (app->plan.num_vehicles == 0) return;
+        if (plan_schedule_build(&app->fleet_day, app->problem, &app->plan) != 0) {
+            gtk_label_set_text(GTK_LABEL(app->info_label), "Simulation ran out of memory");
+            return;
+        }
+        vehicles = app->fleet_day.vehicles;
+        stops = app->fleet_day.stops;
+        count = app->fleet_day.num_vehicles;
+    }
+    if (fleet_sim_init(&app->fleet, vehicles, count, stops, app->problem->points.x,
+                       app->problem->points.y) != 0) {
+        plan_schedule_free(&app->fleet_day);
+        gtk_label_set_text(GTK_LABEL(app->info_label), "Simulation ran out of memory");
+        return;
+    }
+    describe_fleet();
+    app->simulating = TRUE;
+    app->animation_running = TRUE;
+    app->animation_timeout_id = g_timeout_add(ANIMATION_INTERVAL, animation_step, app);
+    gtk_widget_queue_draw(app->drawing_area);
+}
+
 void start_delivery_animation(DeliveryApp *app) {
-    if (!app->animation_running && app->optimal_route) {
+    if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(app->fleet_check)) &&
+        !app->animation_running) {
+        start_fleet_simulation();
+    } else if (replaying() && !app->animation_running) {
+        if (!replay_select_vehicle(0)) {
+            gtk_label_set_text(GTK_LABEL(app->info_label), "The plan has no stops to replay");
+            return;
+        }
+        describe_replay();
+        app->animation_running = TRUE;
+        app->animation_timeout_id = g_timeout_add(ANIMATION_INTERVAL, animation_step, app);
+    } else if (!app->animation_running && app->plan.num_vehicles > 0) {
         app->animation_running = TRUE;
         app->current_route_segment = 0;
         app->vehicle_progress = 0.0;
@@ -361,12 +591,18 @@ void start_delivery_animation(DeliveryApp *app) {
 }
 
 void stop_delivery_animation(DeliveryApp *app) {
-    if (app->animation_running) {
+    if (app->simulating) {
+        end_fleet_simulation();
+    } else if (app->animation_running) {
         app->animation_running = FALSE;
         if (app->animation_timeout_id) {
             g_source_remove(app->animation_timeout_id);
             app->animation_timeout_id = 0;
         }
+        // Erase the parked sprite
+        gtk_widget_queue_draw_area(app->drawing_area, app->vehicle_area.x, app->vehicle_area.y,
+                                   app->vehicle_area.width, app->vehicle_area.height);
+        app->vehicle_area.width = app->vehicle_area.height = 0;
     }
 }
 
@@ -375,7 +611,7 @@ void on_start_delivery(GtkWidget *widget, gpointer data) {
     
     if (!app->animation_running) {
         start_delivery_animation(app);
-        gtk_button_set_label(GTK_BUTTON(widget), "Stop Delivery");
+        if (app->animation_running) gtk_button_set_label(GTK_BUTTON(widget), "Stop Delivery");
     } else {
         stop_delivery_animation(app);
         gtk_button_set_label(GTK_BUTTON(widget), "Start Delivery");
@@ -387,91 +623,47 @@ void on_speed_changed(GtkRange *range, gpointer data) {
     app->animation_speed = gtk_range_get_value(range);
 }
 
-gboolean on_button_press(GtkWidget *widget, GdkEventButton *event, gpointer data) {
-    double x = event->x;
-    double y = event->y;
-    
-    app->selected_point = -1;
-    for (int i = 0; i < app->num_points; i++) {
-        double dx = x - app->points[i].x;
-        double dy = y - app->points[i].y;
-        double distance = sqrt(dx * dx + dy * dy);
-        
-        if (distance <= 15) {
-            app->selected_point = i;
-            break;
-        }
-    }
-    
-    if (app->selected_point >= 0) {
-        char info[500];
-        DeliveryPoint *point = &app->points[app->selected_point];
-        snprintf(info, sizeof(info), 
-                "Selected: %s | Packages: %d | Type: %s",
-                point->name, point->package_count,
-                point->is_depot ? "Depot" : "Delivery Point");
-        gtk_label_set_text(GTK_LABEL(app->info_label), info);
-    } else {
-        gtk_label_set_text(GTK_LABEL(app->info_label), "Click on a delivery point for details");
-    }
-    
-    gtk_widget_queue_draw(widget);
-    return TRUE;
-}
-
-void on_calculate_route(GtkWidget *widget, gpointer data) {
-    calculate_optimal_route();
-    
-    char info[300];
-    int optimal_value = knapsack(50);
-    snprintf(info, sizeof(info),
-            "Route calculated! Distance: %.1f km | Emissions: %.2f kg CO2 | Package Value: %d",
-            app->total_distance / 10, app->total_emissions / 10, optimal_value);
-    gtk_label_set_text(GTK_LABEL(app->info_label), info);
-    
-    gtk_widget_queue_draw(app->drawing_area);
-}
-
 // Helper to show selected packages for knapsack
 void show_knapsack_details(int capacity) {
-    int dp[capacity + 1];
-    int keep[MAX_PACKAGES][capacity + 1];
-    memset(dp, 0, sizeof(dp));
-    memset(keep, 0, sizeof(keep));
-    for (int i = 0; i < app->num_packages; i++) {
-        for (int w = capacity; w >= app->packages[i].weight; w--) {
-            int value_with_priority = app->packages[i].value; // No priority
-            int carbon_penalty = (int)(app->packages[i].carbon_footprint * 10);
-            int net_value = value_with_priority - carbon_penalty;
-            if (dp[w - app->packages[i].weight] + net_value > dp[w]) {
-                dp[w] = dp[w - app->packages[i].weight] + net_value;
-                keep[i][w] = 1;
-            }
-        }
-    }
-    // Backtrack to find selected packages
-    int w = capacity;
+    const KnapsackResult *selection = knapsack_solve(&app->knapsack, app->problem, capacity);
+    if (!selection) return;
     int total_weight = 0;
     int total_value = 0;
     char details[4096] = "";
-    strcat(details, "ID   Wt   Val   C.Foot  Location                Value\n");
-    for (int i = app->num_packages - 1; i >= 0; i--) {
-        if (w >= app->packages[i].weight && keep[i][w]) {
-            int net_value = app->packages[i].value - (int)(app->packages[i].carbon_footprint * 10);
-            char pkg[256];
-            snprintf(pkg, sizeof(pkg), "%2d  %3d  %4d   %5.1f  %-22s %5d\n",
-                app->packages[i].id, app->packages[i].weight, app->packages[i].value, app->packages[i].carbon_footprint,
-                app->points[app->packages[i].destination_id].name, net_value);
-            strcat(details, pkg);
-            total_weight += app->packages[i].weight;
+    size_t length = 0;
+    int hidden = 0;
+    const PackageTable *packages = &app->problem->packages;
+    length += snprintf(details, sizeof(details), "ID   Wt   Val  Pri  C.Foot  Location                Value\n");
+    for (int i = packages->count - 1; i >= 0; i--) {
+        if (selection->selected[i]) {
+            int net_value = package_net_value(app->problem, i);
+            total_weight += packages->weight[i];
             total_value += net_value;
-            w -= app->packages[i].weight;
+            // Leave room for the "more" line once the table is full
+            if (length + 160 > sizeof(details)) {
+                hidden++;
+                continue;
+            }
+            length += snprintf(details + length, sizeof(details) - length,
+                "%2d  %3d  %4d  %3d   %5.1f  %-22s %5d\n",
+                packages->id[i], packages->weight[i], packages->value[i],
+                package_priority_level(app->problem, i), packages->carbon_footprint[i],
+                delivery_point_name(app->problem, packages->destination_id[i]), net_value);
+            if (length >= sizeof(details)) length = sizeof(details) - 1;
         }
     }
+    if (hidden > 0) {
+        snprintf(details + length, sizeof(details) - length, "... and %d more\n", hidden);
+    }
+    char reused[48] = "";
+    if (selection->reused_rows > 0) {
+        snprintf(reused, sizeof(reused), ", %d rows reused", selection->reused_rows);
+    }
     char info[5000];
     snprintf(info, sizeof(info),
-        "Knapsack: MaxCap=%dkg | TotalValue=%d | TotalWeight=%dkg\n-----------------------------------------------\n%s",
-        capacity, total_value, total_weight, details);
+        "Knapsack (%s, %.2f ms%s): MaxCap=%dkg | TotalValue=%d | TotalWeight=%dkg\n-----------------------------------------------\n%s",
+        knapsack_mode_name(selection->mode), selection->elapsed * 1e3, reused, capacity,
+        total_value, total_weight, details);
     // Set monospace font for the table label
     PangoAttrList *attrs = pango_attr_list_new();
     pango_attr_list_insert(attrs, pango_attr_family_new("monospace"));
@@ -480,10 +672,433 @@ void show_knapsack_details(int capacity) {
     gtk_label_set_text(GTK_LABEL(app->table_label), info);
 }
 
+// Replaces the shown plan with a single tour; takes ownership of stops
+static void show_tour(int *stops, int num_stops, double distance) {
+    close_replay();
+    delivery_plan_clear(&app->plan);
+    VehicleRoute *vehicle = delivery_plan_add_vehicle(&app->plan, 0);
+    if (!vehicle) {
+        free(stops);
+        return;
+    }
+    vehicle->stops = stops;
+    vehicle->num_stops = num_stops;
+    vehicle->distance = app->plan.total_distance = distance;
+    vehicle->emissions = app->plan.total_emissions = route_emissions(distance);
+    app->show_route = TRUE;
+    invalidate_map();
+}
+
+// Windows of the problem for routing, or NULL when it has none (or on
+// allocation failure, which then just routes untimed)
+static const TimeWindows *route_windows(TimeWindows *windows) {
+    memset(windows, 0, sizeof(TimeWindows));
+    if (!delivery_problem_has_time_windows(app->problem) ||
+        delivery_problem_time_windows(app->problem, windows) != 0) {
+        return NULL;
+    }
+    return windows;
+}
+
+// " | Late: ..." for the shown route when the problem has time windows
+static void describe_lateness(char *text, size_t size) {
+    text[0] = '\0';
+    TimeWindows storage;
+    const TimeWindows *windows = route_windows(&storage);
+    const VehicleRoute *vehicle = animated_vehicle();
+    if (windows && vehicle && app->problem->distance_matrix.size == app->problem->points.count) {
+        TimeWindowReport report;
+        time_window_report(windows, &app->problem->distance_matrix, vehicle->stops,
+                           vehicle->num_stops, &report);
+        snprintf(text, size, " | Late: %d stops (%d premium), %.0f min", report.late_stops,
+                 report.late_premium, report.late_minutes);
+    }
+    time_windows_free(&storage);
+}
+
+static double job_seconds(const SolveJob *job) {
+    return (g_get_monotonic_time() - job->started) / 1e6;
+}
+
+// Main loop: shows a tour published by route_progress()
+static gboolean publish_route(gpointer data) {
+    RouteUpdate *update = data;
+    if (app->job && app->job->generation == update->generation) {
+        char info[300];
+        snprintf(info, sizeof(info), "Optimizing route... %.1f s | Distance: %.1f km",
+                 job_seconds(app->job), update->distance / 10);
+        gtk_label_set_text(GTK_LABEL(app->info_label), info);
+        show_tour(update->stops, update->num_stops, update->distance);
+    } else {
+        free(update->stops);
+    }
+    g_free(update);
+    return G_SOURCE_REMOVE;
+}
+
+// Worker: tour_improve() progress hook, queues a copy of the current tour
+static int route_progress(const int *tour, int length, double tour_length, void *user) {
+    SolveJob *job = user;
+    if (g_atomic_int_get(&job->cancel)) return 1;
+    RouteUpdate *update = g_malloc0(sizeof(RouteUpdate));
+    update->stops = malloc(length * sizeof(int));
+    if (!update->stops) {
+        g_free(update);
+        return 0;
+    }
+    memcpy(update->stops, tour, length * sizeof(int));
+    update->generation = job->generation;
+    update->num_stops = length;
+    update->distance = tour_length;
+    g_idle_add(publish_route, update);
+    return 0;
+}
+
+static void set_solving(gboolean solving) {
+    gtk_widget_set_sensitive(app->route_button, !solving);
+    gtk_widget_set_sensitive(app->optimize_button, !solving);
+    gtk_widget_set_sensitive(app->cancel_button, solving);
+    gtk_widget_set_sensitive(app->open_plan_button, !solving);
+}
+
+// Main loop: takes over the finished job's results
+static gboolean finish_solve(gpointer data) {
+    SolveJob *job = data;
+    g_thread_join(app->solver_thread);
+    app->solver_thread = NULL;
+    app->job = NULL;
+    gboolean cancelled = g_atomic_int_get(&job->cancel);
+
+    if (job->kind == SOLVE_ROUTE) {
+        char info[300];
+        if (job->status == 0 && job->plan.num_vehicles > 0) {
+            // Cancelling keeps the best tour found so far
+            close_replay();
+            delivery_plan_clear(&app->plan);
+            app->plan = job->plan;
+            memset(&job->plan, 0, sizeof(DeliveryPlan));
+            app->show_route = TRUE;
+            // The worker ran the knapsack too, so this is a cache hit
+            const KnapsackResult *selection =
+                cancelled ? NULL : knapsack_solve(&app->knapsack, app->problem, PACKAGE_CAPACITY);
+            int optimal_value = selection ? selection->value : 0;
+            char late[80];
+            describe_lateness(late, sizeof(late));
+            snprintf(info, sizeof(info),
+                    "Route %s! Distance: %.1f km | Emissions: %.2f kg CO2 | Package Value: %d%s",
+                    cancelled ? "stopped early" : "calculated",
+                    app->plan.total_distance / 10, app->plan.total_emissions / 10, optimal_value,
+                    late);
+        } else {
+            snprintf(info, sizeof(info), "Route calculation failed (out of memory)");
+        }
+        gtk_label_set_text(GTK_LABEL(app->info_label), info);
+        invalidate_map();
+    } else if (cancelled) {
+        gtk_label_set_text(GTK_LABEL(app->info_label), "Package optimization cancelled");
+    } else {
+        show_knapsack_details(PACKAGE_CAPACITY);
+        app->packages_shown = TRUE;
+        gtk_widget_queue_draw(app->drawing_area);
+    }
+
+    delivery_plan_clear(&job->plan);
+    g_free(job);
+    set_solving(FALSE);
+    return G_SOURCE_REMOVE;
+}
+
+static gpointer solve_thread(gpointer data) {
+    SolveJob *job = data;
+    if (job->kind == SOLVE_ROUTE) {
+        TourImproveOptions options;
+        tour_improve_default_options(&options);
+        options.time_budget = ROUTE_TIME_BUDGET;
+        options.progress = route_progress;
+        options.progress_user = job;
+        options.arena = &app->solve_arena;
+        job->status = calculate_optimal_route(app->problem, &job->plan, &options, &job->stats);
+    }
+    if (!g_atomic_int_get(&job->cancel)) {
+        knapsack_solve(&app->knapsack, app->problem, PACKAGE_CAPACITY);
+    }
+    g_idle_add(finish_solve, job);
+    return NULL;
+}
+
+// Runs a solve on the worker thread; the window stays responsive meanwhile
+static void start_solve(SolveKind kind) {
+    if (app->job) return;
+    SolveJob *job = g_malloc0(sizeof(SolveJob));
+    job->kind = kind;
+    job->generation = ++app->solve_generation;
+    job->started = g_get_monotonic_time();
+    app->job = job;
+    set_solving(TRUE);
+    gtk_label_set_text(GTK_LABEL(app->info_label),
+                       kind == SOLVE_ROUTE ? "Optimizing route..." : "Optimizing packages...");
+    app->solver_thread = g_thread_new("solver", solve_thread, job);
+}
+
+void on_calculate_route(GtkWidget *widget, gpointer data) {
+    start_solve(SOLVE_ROUTE);
+}
+
+void on_cancel_solve(GtkWidget *widget, gpointer data) {
+    if (!app->job) return;
+    g_atomic_int_set(&app->job->cancel, 1);
+    gtk_label_set_text(GTK_LABEL(app->info_label), "Cancelling...");
+}
+
 void on_optimize_packages(GtkWidget *widget, gpointer data) {
-    int max_capacity = 50;
-    show_knapsack_details(max_capacity);
-    gtk_widget_queue_draw(app->drawing_area);
+    start_solve(SOLVE_PACKAGES);
+}
+
+// Stats panel: where solve time went, from the solver's own counters. Only
+// redrawn while expanded, so a collapsed panel costs nothing.
+static gboolean refresh_stats(gpointer data) {
+    if (!gtk_expander_get_expanded(GTK_EXPANDER(app->stats_expander))) return G_SOURCE_CONTINUE;
+    MetricsSnapshot snapshot;
+    metrics_snapshot(&snapshot);
+    char text[2048];
+    size_t length = 0;
+    for (int i = 0; i < METRIC_TIMER_COUNT; i++) {
+        const MetricTimerValue *timer = &snapshot.timers[i];
+        length += snprintf(text + length, sizeof(text) - length,
+                           "%-9s %6llu runs %10.3f s   longest %8.3f s\n", metric_timer_name(i),
+                           (unsigned long long)timer->count, timer->seconds, timer->max_seconds);
+    }
+    for (int i = 0; i < METRIC_COUNTER_COUNT && length < sizeof(text); i++) {
+        length += snprintf(text + length, sizeof(text) - length, "%-20s %15llu\n",
+                           metric_counter_name(i), (unsigned long long)snapshot.counters[i]);
+    }
+    gtk_label_set_text(GTK_LABEL(app->stats_label), text);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean refresh_stats_once(gpointer data) {
+    refresh_stats(data);
+    return G_SOURCE_REMOVE;
+}
+
+void on_stats_expanded(GtkWidget *widget, gpointer data) {
+    // The expander opens after this signal; fill it in right after
+    g_idle_add(refresh_stats_once, NULL);
+}
+
+void on_save_metrics(GtkWidget *widget, gpointer data) {
+    GtkWidget *dialog = gtk_file_chooser_dialog_new("Save Metrics", GTK_WINDOW(app->window),
+                                                    GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                    "_Cancel", GTK_RESPONSE_CANCEL,
+                                                    "_Save", GTK_RESPONSE_ACCEPT, NULL);
+    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+    gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(dialog), "delivery_metrics.prom");
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+        char *path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+        char info[300];
+        snprintf(info, sizeof(info), metrics_save(path) == 0 ? "Metrics saved to %s"
+                                                             : "Could not save metrics to %s",
+                 path);
+        gtk_label_set_text(GTK_LABEL(app->info_label), info);
+        g_free(path);
+    }
+    gtk_widget_destroy(dialog);
+}
+
+// Shows a plan file solved elsewhere; Start Delivery then replays it
+static void open_plan(const char *path) {
+    char info[300];
+    PlanFile plan;
+    if (plan_file_open(&plan, path) != 0) {
+        snprintf(info, sizeof(info), "Could not open plan %s", path);
+    } else if (!plan_file_matches(&plan, app->problem)) {
+        plan_file_close(&plan);
+        snprintf(info, sizeof(info), "%s was planned for a different instance", path);
+    } else {
+        stop_delivery_animation(app);
+        gtk_button_set_label(GTK_BUTTON(app->start_button), "Start Delivery");
+        close_replay();
+        delivery_plan_clear(&app->plan);
+        app->replay = plan;
+        app->show_route = TRUE;
+        snprintf(info, sizeof(info),
+                 "Plan loaded: %d vehicles, %llu stops | Distance: %.1f km | Emissions: %.2f kg CO2",
+                 plan.num_vehicles, (unsigned long long)plan.num_stops, plan.total_distance / 10,
+                 plan.total_emissions / 10);
+        invalidate_map();
+    }
+    gtk_label_set_text(GTK_LABEL(app->info_label), info);
+}
+
+void on_open_plan(GtkWidget *widget, gpointer data) {
+    if (app->job) return;
+    GtkWidget *dialog = gtk_file_chooser_dialog_new("Open Plan", GTK_WINDOW(app->window),
+                                                    GTK_FILE_CHOOSER_ACTION_OPEN,
+                                                    "_Cancel", GTK_RESPONSE_CANCEL,
+                                                    "_Open", GTK_RESPONSE_ACCEPT, NULL);
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+        char *path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+        open_plan(path);
+        g_free(path);
+    }
+    gtk_widget_destroy(dialog);
+}
+
+void on_save_plan(GtkWidget *widget, gpointer data) {
+    if (app->plan.num_vehicles == 0) {
+        gtk_label_set_text(GTK_LABEL(app->info_label), "Calculate a route first");
+        return;
+    }
+    GtkWidget *dialog = gtk_file_chooser_dialog_new("Save Plan", GTK_WINDOW(app->window),
+                                                    GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                    "_Cancel", GTK_RESPONSE_CANCEL,
+                                                    "_Save", GTK_RESPONSE_ACCEPT, NULL);
+    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+    gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(dialog), "plan.dlvp");
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+        char *path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+        char info[300];
+        snprintf(info, sizeof(info),
+                 write_plan_binary(path, app->problem, &app->plan) == 0 ? "Plan saved to %s"
+                                                                       : "Could not save the plan to %s",
+                 path);
+        gtk_label_set_text(GTK_LABEL(app->info_label), info);
+        g_free(path);
+    }
+    gtk_widget_destroy(dialog);
+}
+
+// Orders arriving while a route is shown are worked into it in place:
+// the matrix gains the new stop's distances, the tour takes it by cheapest
+// insertion plus local 2-opt, and the knapsack reuses the DP rows of the
+// packages that did not change.
+
+static VehicleRoute *editable_route(void) {
+    if (!app->show_route || app->plan.num_vehicles != 1) return NULL;
+    // A stale matrix (e.g. after a failed extension) means a full solve first
+    if (app->problem->distance_matrix.size != app->problem->points.count) return NULL;
+    return &app->plan.vehicles[0];
+}
+
+static void orders_changed(void) {
+    delivery_plan_update_totals(&app->plan, &app->problem->distance_matrix);
+    if (app->packages_shown) show_knapsack_details(PACKAGE_CAPACITY);
+    invalidate_map();
+}
+
+static void add_order(double x, double y) {
+    DeliveryProblem *problem = app->problem;
+    if (app->job || update_point_index() != 0) return;
+    int near[ORDER_ROADS];
+    Route roads[ORDER_ROADS];
+    int count = spatial_index_knn(&app->point_index, x, y, ORDER_ROADS, near);
+    int s = problem->points.count;
+    for (int i = 0; i < count; i++) {
+        double dx = problem->points.x[near[i]] - x, dy = problem->points.y[near[i]] - y;
+        roads[i] = (Route){s, near[i], sqrt(dx * dx + dy * dy), route_emissions(1.0)};
+    }
+    int package_id = 0;
+    for (int i = 0; i < problem->packages.count; i++) {
+        if (problem->packages.id[i] >= package_id) package_id = problem->packages.id[i] + 1;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "Order %d", package_id);
+    DeliveryPoint point = {s, name, x, y, 0, 1};
+    Package package = {package_id, ORDER_WEIGHT, ORDER_VALUE, 2, 2.0, s};
+    if (count == 0 || delivery_problem_add_stop(problem, &point, roads, count) != s ||
+        delivery_problem_add_package(problem, &package) < 0) {
+        gtk_label_set_text(GTK_LABEL(app->info_label), "Could not add the order");
+        return;
+    }
+    delivery_problem_packages_changed(problem);
+
+    char info[300];
+    VehicleRoute *vehicle = editable_route();
+    RouteRepairStats stats;
+    TimeWindows windows = {0};
+    if (vehicle && route_insert_stop(&problem->distance_matrix, route_windows(&windows), vehicle, s,
+                                     &stats) == 0) {
+        orders_changed();
+        snprintf(info, sizeof(info),
+                 "Added %s: route +%.1f km, repaired in %.2f ms (%d 2-opt moves) | Distance: %.1f km%s",
+                 name, stats.change / 10, stats.elapsed * 1e3, stats.two_opt_moves,
+                 app->plan.total_distance / 10, stats.late ? " | misses its window" : "");
+    } else {
+        orders_changed();
+        snprintf(info, sizeof(info), "Added %s; calculate a route to include it", name);
+    }
+    time_windows_free(&windows);
+    gtk_label_set_text(GTK_LABEL(app->info_label), info);
+}
+
+// Takes a stop off the route, cancelling its packages, or puts it back
+static void toggle_stop(int point) {
+    DeliveryProblem *problem = app->problem;
+    VehicleRoute *vehicle = editable_route();
+    if (app->job || !vehicle || problem->points.is_depot[point]) return;
+    char info[300];
+    RouteRepairStats stats;
+    TimeWindows storage;
+    const TimeWindows *windows = route_windows(&storage);
+    if (route_remove_stop(&problem->distance_matrix, windows, vehicle, point, &stats) == 0) {
+        int cancelled = 0;
+        for (int i = problem->packages.count - 1; i >= 0; i--) {
+            if (problem->packages.destination_id[i] == point &&
+                delivery_problem_remove_package(problem, i) == 0) {
+                cancelled++;
+            }
+        }
+        orders_changed();
+        snprintf(info, sizeof(info),
+                 "Removed %s: route %.1f km, %d packages cancelled, repaired in %.2f ms",
+                 delivery_point_name(problem, point), stats.change / 10, cancelled,
+                 stats.elapsed * 1e3);
+    } else if (route_insert_stop(&problem->distance_matrix, windows, vehicle, point, &stats) == 0) {
+        orders_changed();
+        snprintf(info, sizeof(info), "Added %s back: route +%.1f km, repaired in %.2f ms",
+                 delivery_point_name(problem, point), stats.change / 10, stats.elapsed * 1e3);
+    } else {
+        snprintf(info, sizeof(info), "%s cannot be reached", delivery_point_name(problem, point));
+    }
+    time_windows_free(&storage);
+    gtk_label_set_text(GTK_LABEL(app->info_label), info);
+}
+
+gboolean on_button_press(GtkWidget *widget, GdkEventButton *event, gpointer data) {
+    double x = event->x;
+    double y = event->y;
+    
+    app->selected_point = point_at(x, y);
+    if (event->button == 3) {
+        if (app->selected_point >= 0) {
+            toggle_stop(app->selected_point);
+        } else {
+            add_order(x, y);
+        }
+        gtk_widget_queue_draw(widget);
+        return TRUE;
+    }
+    
+    if (app->selected_point >= 0) {
+        char info[500];
+        int point = app->selected_point;
+        const PointTable *points = &app->problem->points;
+        char window[64] = "";
+        if (isfinite(points->window_close[point])) {
+            snprintf(window, sizeof(window), " | Window: %.0f-%.0f min", points->window_open[point],
+                     points->window_close[point]);
+        }
+        snprintf(info, sizeof(info), 
+                "Selected: %s | Packages: %d | Type: %s%s",
+                delivery_point_name(app->problem, point), app->problem->points.package_count[point],
+                app->problem->points.is_depot[point] ? "Depot" : "Delivery Point", window);
+        gtk_label_set_text(GTK_LABEL(app->info_label), info);
+    } else {
+        gtk_label_set_text(GTK_LABEL(app->info_label), "Click on a delivery point for details");
+    }
+    
+    gtk_widget_queue_draw(widget);
+    return TRUE;
 }
 
 void init_gui() {
@@ -498,14 +1113,23 @@ void init_gui() {
     app->route_button = gtk_button_new_with_label("Calculate Optimal Route");
     app->optimize_button = gtk_button_new_with_label("Optimize Packages");
     app->start_button = gtk_button_new_with_label("Start Delivery");
+    app->cancel_button = gtk_button_new_with_label("Cancel");
+    gtk_widget_set_sensitive(app->cancel_button, FALSE);
     GtkWidget *speed_label = gtk_label_new("Speed:");
     app->speed_scale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0.5, 3.0, 0.5);
     gtk_range_set_value(GTK_RANGE(app->speed_scale), 1.0);
     gtk_box_pack_start(GTK_BOX(hbox), app->route_button, FALSE, FALSE, 5);
     gtk_box_pack_start(GTK_BOX(hbox), app->optimize_button, FALSE, FALSE, 5);
+    gtk_box_pack_start(GTK_BOX(hbox), app->cancel_button, FALSE, FALSE, 5);
     gtk_box_pack_start(GTK_BOX(hbox), app->start_button, FALSE, FALSE, 5);
     gtk_box_pack_start(GTK_BOX(hbox), speed_label, FALSE, FALSE, 5);
     gtk_box_pack_start(GTK_BOX(hbox), app->speed_scale, FALSE, FALSE, 5);
+    app->fleet_check = gtk_check_button_new_with_label("Whole Fleet");
+    gtk_box_pack_start(GTK_BOX(hbox), app->fleet_check, FALSE, FALSE, 5);
+    app->open_plan_button = gtk_button_new_with_label("Open Plan...");
+    GtkWidget *save_plan_button = gtk_button_new_with_label("Save Plan...");
+    gtk_box_pack_start(GTK_BOX(hbox), app->open_plan_button, FALSE, FALSE, 5);
+    gtk_box_pack_start(GTK_BOX(hbox), save_plan_button, FALSE, FALSE, 5);
     // --- Main horizontal box for graph and table ---
     GtkWidget *hbox_main = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
     app->drawing_area = gtk_drawing_area_new();
@@ -520,13 +1144,34 @@ void init_gui() {
     gtk_box_pack_start(GTK_BOX(vbox), hbox_main, TRUE, TRUE, 0);
     app->info_label = gtk_label_new("Bengaluru Smart Delivery System - Click on delivery points for details");
     gtk_box_pack_start(GTK_BOX(vbox), app->info_label, FALSE, FALSE, 5);
+    // --- Collapsible solver stats ---
+    app->stats_expander = gtk_expander_new("Solver Stats");
+    GtkWidget *stats_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    app->stats_label = gtk_label_new("");
+    gtk_label_set_xalign(GTK_LABEL(app->stats_label), 0.0);
+    PangoAttrList *attrs = pango_attr_list_new();
+    pango_attr_list_insert(attrs, pango_attr_family_new("monospace"));
+    gtk_label_set_attributes(GTK_LABEL(app->stats_label), attrs);
+    pango_attr_list_unref(attrs);
+    GtkWidget *save_metrics_button = gtk_button_new_with_label("Save Metrics...");
+    gtk_widget_set_valign(save_metrics_button, GTK_ALIGN_START);
+    gtk_box_pack_start(GTK_BOX(stats_box), app->stats_label, FALSE, FALSE, 5);
+    gtk_box_pack_start(GTK_BOX(stats_box), save_metrics_button, FALSE, FALSE, 5);
+    gtk_container_add(GTK_CONTAINER(app->stats_expander), stats_box);
+    gtk_box_pack_start(GTK_BOX(vbox), app->stats_expander, FALSE, FALSE, 5);
     g_signal_connect(app->window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
     g_signal_connect(app->drawing_area, "draw", G_CALLBACK(on_draw), NULL);
     g_signal_connect(app->drawing_area, "button-press-event", G_CALLBACK(on_button_press), NULL);
     g_signal_connect(app->route_button, "clicked", G_CALLBACK(on_calculate_route), NULL);
     g_signal_connect(app->optimize_button, "clicked", G_CALLBACK(on_optimize_packages), NULL);
+    g_signal_connect(app->cancel_button, "clicked", G_CALLBACK(on_cancel_solve), NULL);
     g_signal_connect(app->start_button, "clicked", G_CALLBACK(on_start_delivery), app);
     g_signal_connect(app->speed_scale, "value-changed", G_CALLBACK(on_speed_changed), app);
+    g_signal_connect(app->stats_expander, "activate", G_CALLBACK(on_stats_expanded), NULL);
+    g_signal_connect(save_metrics_button, "clicked", G_CALLBACK(on_save_metrics), NULL);
+    g_signal_connect(app->open_plan_button, "clicked", G_CALLBACK(on_open_plan), NULL);
+    g_signal_connect(save_plan_button, "clicked", G_CALLBACK(on_save_plan), NULL);
+    g_timeout_add_seconds(STATS_REFRESH_SECONDS, refresh_stats, NULL);
     gtk_widget_add_events(app->drawing_area, GDK_BUTTON_PRESS_MASK);
     app->animation_running = FALSE;
     app->current_route_segment = 0;
@@ -541,19 +1186,53 @@ int main(int argc, char *argv[]) {
     app = malloc(sizeof(DeliveryApp));
     memset(app, 0, sizeof(DeliveryApp));
     app->selected_point = -1;
+    app->point_index_count = -1;
     app->show_route = FALSE;
+    app->problem = delivery_problem_new();
+    
+    app->pool = thread_pool_create(0);
+    knapsack_solver_init(&app->knapsack);
+    arena_init(&app->solve_arena, 0);
     
-    initialize_data();
+    // An instance file (text, CSV or binary) may be given on the command line
+    if (argc > 1 ? load_instance(argv[1], app->problem) != 0
+                 : initialize_data(app->problem, 1) != 0) {
+        fprintf(stderr, "Could not load the delivery instance\n");
+        return 1;
+    }
+    delivery_problem_build_matrix(app->problem, app->pool);
     init_gui();
+    // ...and a plan file solved for it after that, to replay
+    if (argc > 2) open_plan(argv[2]);
     
     printf("Bengaluru Smart Delivery System Started!\n");
     printf("- Click on delivery points for details\n");
     printf("- Use 'Calculate Optimal Route' to find best path\n");
     printf("- Use 'Start Delivery' to begin vehicle animation\n");
+    printf("- Right-click the map to add an order, or a point to take it off the route\n");
+    printf("- Use 'Open Plan...' to replay a plan saved by delivery_solver --save-plan\n");
+    printf("- Tick 'Whole Fleet' before 'Start Delivery' to simulate every vehicle at once\n");
     
     gtk_main();
     
-    if (app->optimal_route) free(app->optimal_route);
+    // Closing the window mid-solve: stop the worker before freeing its data
+    if (app->job) {
+        g_atomic_int_set(&app->job->cancel, 1);
+        g_thread_join(app->solver_thread);
+        delivery_plan_clear(&app->job->plan);
+        g_free(app->job);
+    }
+    fleet_sim_free(&app->fleet);
+    plan_schedule_free(&app->fleet_day);
+    delivery_plan_clear(&app->plan);
+    close_replay();
+    if (app->map_layer) cairo_surface_destroy(app->map_layer);
+    free(app->node_values);
+    if (app->point_index_count >= 0) spatial_index_free(&app->point_index);
+    knapsack_solver_free(&app->knapsack);
+    arena_free(&app->solve_arena);
+    delivery_problem_free(app->problem);
+    thread_pool_destroy(app->pool);
     free(app);
     
     return 0;
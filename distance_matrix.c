@@ -0,0 +1,135 @@
+#include "distance_matrix.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+
+#define CACHE_LINE 64
+#define FLOATS_PER_LINE (CACHE_LINE / (int)sizeof(float))
+
+typedef struct {
+    DistanceMatrix *matrix;
+    const RoadGraph *graph;
+    RoadSearchWorkspace *workspaces;
+    atomic_int failed;
+} MatrixJob;
+
+static void *aligned_block(size_t size) {
+    size = (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+#ifdef _WIN32
+    return _aligned_malloc(size, CACHE_LINE);
+#else
+    return aligned_alloc(CACHE_LINE, size ? size : CACHE_LINE);
+#endif
+}
+
+static void aligned_block_free(void *block) {
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+static void compute_row(void *context, int index, int worker) {
+    MatrixJob *job = context;
+    DistanceMatrix *matrix = job->matrix;
+    float *row = matrix->values + (size_t)index * matrix->stride;
+    RoadSearchWorkspace *workspace = &job->workspaces[worker];
+    // Workspaces are O(V), so only threads that actually pick up a row get one
+    if (!workspace->dist && road_search_workspace_init(workspace, job->graph->num_nodes) != 0) {
+        atomic_store(&job->failed, 1);
+        return;
+    }
+    if (road_graph_one_to_many(job->graph, matrix->stops[index], matrix->stops, matrix->size, row,
+                               workspace) != 0) {
+        atomic_store(&job->failed, 1);
+    }
+}
+
+static int allocate_matrix(DistanceMatrix *matrix, const int *stops, int num_stops) {
+    memset(matrix, 0, sizeof(DistanceMatrix));
+    if (num_stops < 0) return -1;
+
+    matrix->size = num_stops;
+    matrix->stride = (num_stops + FLOATS_PER_LINE - 1) / FLOATS_PER_LINE * FLOATS_PER_LINE;
+    matrix->capacity = num_stops;
+    matrix->stops = malloc((num_stops > 0 ? num_stops : 1) * sizeof(int));
+    matrix->values = aligned_block((size_t)num_stops * matrix->stride * sizeof(float));
+    if (!matrix->stops || !matrix->values) {
+        distance_matrix_free(matrix);
+        return -1;
+    }
+    memcpy(matrix->stops, stops, num_stops * sizeof(int));
+    return 0;
+}
+
+int distance_matrix_compute(DistanceMatrix *matrix, const RoadGraph *graph, const int *stops,
+                            int num_stops, ThreadPool *pool) {
+    if (allocate_matrix(matrix, stops, num_stops) != 0) return -1;
+    if (num_stops == 0) return 0;
+
+    MetricScope scope = metrics_begin(METRIC_TIMER_MATRIX);
+    MatrixJob job = {matrix, graph, calloc(thread_pool_size(pool), sizeof(RoadSearchWorkspace)), 0};
+    int status = -1;
+    if (job.workspaces) {
+        thread_pool_parallel_for(pool, num_stops, compute_row, &job);
+        status = atomic_load(&job.failed) ? -1 : 0;
+        for (int i = 0; i < thread_pool_size(pool); i++) {
+            road_search_workspace_free(&job.workspaces[i]);
+        }
+        free(job.workspaces);
+    }
+    if (status != 0) distance_matrix_free(matrix);
+    metrics_end(&scope);
+    return status;
+}
+
+int distance_matrix_compute_hierarchy(DistanceMatrix *matrix,
+                                      const ContractionHierarchy *hierarchy, const int *stops,
+                                      int num_stops, ThreadPool *pool) {
+    if (allocate_matrix(matrix, stops, num_stops) != 0) return -1;
+    MetricScope scope = metrics_begin(METRIC_TIMER_MATRIX);
+    int status = contraction_hierarchy_many_to_many(hierarchy, stops, num_stops, stops, num_stops,
+                                                    matrix->values, matrix->stride, pool) == 0 ? 0 : -1;
+    if (status != 0) distance_matrix_free(matrix);
+    metrics_end(&scope);
+    return status;
+}
+
+void distance_matrix_free(DistanceMatrix *matrix) {
+    free(matrix->stops);
+    aligned_block_free(matrix->values);
+    memset(matrix, 0, sizeof(DistanceMatrix));
+}
+
+int distance_matrix_reserve(DistanceMatrix *matrix, int size) {
+    if (size <= matrix->capacity && size <= matrix->stride) return 0;
+    int capacity = matrix->capacity * 2 > size ? matrix->capacity * 2 : size;
+    int stride = (capacity + FLOATS_PER_LINE - 1) / FLOATS_PER_LINE * FLOATS_PER_LINE;
+    int *stops = realloc(matrix->stops, capacity * sizeof(int));
+    if (!stops) return -1;
+    matrix->stops = stops;
+    float *values = aligned_block((size_t)capacity * stride * sizeof(float));
+    if (!values) return -1;
+    for (int i = 0; i < matrix->size; i++) {
+        memcpy(values + (size_t)i * stride, distance_matrix_row(matrix, i),
+               matrix->size * sizeof(float));
+    }
+    aligned_block_free(matrix->values);
+    matrix->values = values;
+    matrix->stride = stride;
+    matrix->capacity = capacity;
+    return 0;
+}
+
+double distance_matrix_tour_length(const DistanceMatrix *matrix, const int *tour, int length) {
+    if (length < 2) return 0;
+    double total = 0;
+    for (int i = 0; i + 1 < length; i++) {
+        total += distance_matrix_get(matrix, tour[i], tour[i + 1]);
+    }
+    return total + distance_matrix_get(matrix, tour[length - 1], tour[0]);
+}
@@ -0,0 +1,47 @@
+#ifndef DELIVERY_DISTANCE_MATRIX_H
+#define DELIVERY_DISTANCE_MATRIX_H
+
+#include <stddef.h>
+
+#include "contraction_hierarchy.h"
+#include "road_graph.h"
+#include "thread_pool.h"
+
+// Shortest road distance between every pair of stops, row-major floats.
+// Rows are padded to whole 64-byte cache lines and the block is 64-byte
+// aligned, so a row never shares a line with its neighbour.
+typedef struct {
+    int size;       // number of stops
+    int stride;     // floats per row
+    int capacity;   // rows allocated; stops can be appended up to min(capacity, stride)
+    int *stops;     // road graph node of each stop
+    float *values;
+} DistanceMatrix;
+
+// Runs one one-to-many search per stop, spread over pool (NULL = serial).
+// Returns 0 on success, -1 on failure.
+int distance_matrix_compute(DistanceMatrix *matrix, const RoadGraph *graph, const int *stops,
+                            int num_stops, ThreadPool *pool);
+// Same distances from a contraction hierarchy of the road graph with the
+// bucket many-to-many algorithm; much faster on large graphs.
+int distance_matrix_compute_hierarchy(DistanceMatrix *matrix,
+                                      const ContractionHierarchy *hierarchy, const int *stops,
+                                      int num_stops, ThreadPool *pool);
+void distance_matrix_free(DistanceMatrix *matrix);
+// Makes room for at least size stops, keeping the current values, so stops
+// can be appended one at a time. Grows geometrically. Returns 0, or -1 with
+// the matrix unchanged.
+int distance_matrix_reserve(DistanceMatrix *matrix, int size);
+
+static inline float distance_matrix_get(const DistanceMatrix *matrix, int from, int to) {
+    return matrix->values[(size_t)from * matrix->stride + to];
+}
+
+static inline const float *distance_matrix_row(const DistanceMatrix *matrix, int from) {
+    return matrix->values + (size_t)from * matrix->stride;
+}
+
+// Length of the closed tour stops[0] -> ... -> stops[length - 1] -> stops[0].
+double distance_matrix_tour_length(const DistanceMatrix *matrix, const int *tour, int length);
+
+#endif
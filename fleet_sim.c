@@ -0,0 +1,162 @@
+#include "fleet_sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "solver_clock.h"
+
+static const PlanStop *vehicle_stops(const FleetSim *sim, int v) {
+    return sim->stops + sim->vehicles[v].first_stop;
+}
+
+static void park(FleetSim *sim, int v, int point) {
+    sim->from_x[v] = (float)sim->px[point];
+    sim->from_y[v] = (float)sim->py[point];
+    sim->dx[v] = sim->dy[v] = 0.0f;
+    sim->leg_rate[v] = 0.0f;
+    sim->on_road[v] = 0;
+}
+
+// Leaves stop[v] for the next stop, or for the depot after the last one
+static void depart(FleetSim *sim, int v) {
+    const PlanVehicle *vehicle = &sim->vehicles[v];
+    const PlanStop *stops = vehicle_stops(sim, v);
+    int i = sim->stop[v];
+    int last = i + 1 == vehicle->num_stops;
+    int from = stops[i].point;
+    int to = stops[last ? 0 : i + 1].point;
+    double arrival = last ? vehicle->finish : stops[i + 1].arrival;
+    sim->dx[v] = (float)(sim->px[to] - sim->px[from]);
+    sim->dy[v] = (float)(sim->py[to] - sim->py[from]);
+    sim->leg_start[v] = stops[i].departure;
+    sim->leg_rate[v] = arrival > stops[i].departure ? (float)(1.0 / (arrival - stops[i].departure)) : 0.0f;
+    sim->on_road[v] = 1;
+    sim->driving++;
+    min_heap_push(&sim->events, v, arrival);
+}
+
+static void arrive(FleetSim *sim, int v) {
+    const PlanVehicle *vehicle = &sim->vehicles[v];
+    const PlanStop *stops = vehicle_stops(sim, v);
+    sim->driving--;
+    sim->stop[v]++;
+    if (sim->stop[v] == vehicle->num_stops) {
+        park(sim, v, stops[0].point);
+        sim->finished++;
+        return;
+    }
+    park(sim, v, stops[sim->stop[v]].point);
+    min_heap_push(&sim->events, v, stops[sim->stop[v]].departure);
+}
+
+// One pass over the leg arrays for the whole fleet: no branches or calls,
+// and restrict parameters (block-scope restrict is not used for alias
+// analysis), so it vectorizes
+static void interpolate_legs(int count, float clock, const float *restrict from_x,
+                             const float *restrict from_y, const float *restrict dx,
+                             const float *restrict dy, const float *restrict leg_start,
+                             const float *restrict leg_rate, float *restrict x, float *restrict y) {
+    for (int v = 0; v < count; v++) {
+        float f = (clock - leg_start[v]) * leg_rate[v];
+        f = f < 0.0f ? 0.0f : f;
+        f = f > 1.0f ? 1.0f : f;
+        x[v] = from_x[v] + dx[v] * f;
+        y[v] = from_y[v] + dy[v] * f;
+    }
+}
+
+static void update_positions(FleetSim *sim) {
+    interpolate_legs(sim->count, (float)sim->clock, sim->from_x, sim->from_y, sim->dx, sim->dy,
+                     sim->leg_start, sim->leg_rate, sim->x, sim->y);
+}
+
+int fleet_sim_init(FleetSim *sim, const PlanVehicle *vehicles, int num_vehicles,
+                   const PlanStop *stops, const double *px, const double *py) {
+    memset(sim, 0, sizeof(FleetSim));
+    size_t n = num_vehicles > 0 ? num_vehicles : 1;
+    float **columns[] = {&sim->x, &sim->y, &sim->from_x, &sim->from_y,
+                         &sim->dx, &sim->dy, &sim->leg_start, &sim->leg_rate};
+    int failed = 0;
+    for (size_t c = 0; c < sizeof(columns) / sizeof(columns[0]); c++) {
+        *columns[c] = calloc(n, sizeof(float));
+        failed |= !*columns[c];
+    }
+    sim->stop = calloc(n, sizeof(int));
+    sim->on_road = calloc(n, 1);
+    if (failed || !sim->stop || !sim->on_road || min_heap_init(&sim->events, num_vehicles) != 0) {
+        fleet_sim_free(sim);
+        return -1;
+    }
+    sim->count = num_vehicles;
+    sim->vehicles = vehicles;
+    sim->stops = stops;
+    sim->px = px;
+    sim->py = py;
+
+    int started = 0;
+    for (int v = 0; v < num_vehicles; v++) {
+        const PlanStop *first = vehicle_stops(sim, v);
+        if (vehicles[v].num_stops == 0) {
+            park(sim, v, vehicles[v].depot);
+            sim->finished++;
+            continue;
+        }
+        park(sim, v, first->point);
+        min_heap_push(&sim->events, v, first->departure);
+        if (!started || first->arrival < sim->clock) sim->clock = first->arrival;
+        if (!started || vehicles[v].finish > sim->end) sim->end = vehicles[v].finish;
+        started = 1;
+    }
+    update_positions(sim);
+    return 0;
+}
+
+void fleet_sim_free(FleetSim *sim) {
+    free(sim->x);
+    free(sim->y);
+    free(sim->from_x);
+    free(sim->from_y);
+    free(sim->dx);
+    free(sim->dy);
+    free(sim->leg_start);
+    free(sim->leg_rate);
+    free(sim->stop);
+    free(sim->on_road);
+    min_heap_free(&sim->events);
+    memset(sim, 0, sizeof(FleetSim));
+}
+
+int fleet_sim_advance(FleetSim *sim, double minutes) {
+    double target = sim->clock + minutes;
+    while (!min_heap_empty(&sim->events) && min_heap_top_key(&sim->events) <= target) {
+        double time;
+        int v = min_heap_pop(&sim->events, &time);
+        if (sim->on_road[v]) {
+            arrive(sim, v);
+        } else {
+            depart(sim, v);
+        }
+        sim->events_run++;
+    }
+    sim->clock = target;
+    update_positions(sim);
+    return sim->count - sim->finished;
+}
+
+void fleet_sim_run(FleetSim *sim, double step, FleetSimStats *stats) {
+    double started = solver_clock_seconds();
+    double first = sim->clock;
+    uint64_t events = sim->events_run;
+    uint64_t steps = 0;
+    while (sim->finished < sim->count) {
+        fleet_sim_advance(sim, step);
+        steps++;
+    }
+    memset(stats, 0, sizeof(FleetSimStats));
+    stats->vehicles = sim->count;
+    for (int v = 0; v < sim->count; v++) stats->stops += sim->vehicles[v].num_stops;
+    stats->events = sim->events_run - events;
+    stats->steps = steps;
+    stats->sim_minutes = sim->end > first ? sim->end - first : 0.0;
+    stats->elapsed = solver_clock_seconds() - started;
+}
@@ -0,0 +1,63 @@
+#ifndef DELIVERY_FLEET_SIM_H
+#define DELIVERY_FLEET_SIM_H
+
+#include <stdint.h>
+
+#include "min_heap.h"
+#include "plan_file.h"
+
+// Discrete-event simulation of a fleet driving the schedule of a plan (a
+// PlanSchedule or a mapped PlanFile) on a sim clock in minutes after the
+// shift starts. Each vehicle has one pending event, leaving its stop or
+// arriving at the next, queued by time, so advancing the clock costs
+// O(log vehicles) per event passed whatever the step. A vehicle waits at
+// a stop until its recorded departure and drives each leg in a straight
+// line at constant speed. After it returns to the depot it stays there.
+//
+// Positions are kept as a struct of arrays and recomputed for the whole
+// fleet after every advance in one branch-free loop over the leg arrays,
+// which the compiler vectorizes.
+typedef struct {
+    int count;
+    float *x, *y;               // positions at clock
+    float *from_x, *from_y;     // start of the current leg, or the stop
+    float *dx, *dy;             // leg vector, 0 while parked
+    float *leg_start;           // minutes
+    float *leg_rate;            // 1 / leg minutes, 0 while parked
+    int *stop;                  // index among the vehicle's stops of the last one reached
+    unsigned char *on_road;     // driving away from stop, else waiting there
+    const PlanVehicle *vehicles;
+    const PlanStop *stops;
+    const double *px, *py;      // point coordinates
+    MinHeap events;             // next event per vehicle, keyed by its time
+    double clock;
+    double end;                 // the last vehicle is back
+    int driving;
+    int finished;               // vehicles back at the depot for good
+    uint64_t events_run;
+} FleetSim;
+
+typedef struct {
+    int vehicles;
+    uint64_t stops;
+    uint64_t events;
+    uint64_t steps;
+    double sim_minutes;         // first departure to the last return
+    double elapsed;             // wall-clock seconds
+} FleetSimStats;
+
+// Puts every vehicle at its first stop at the earliest arrival among them.
+// The stops and depots must name points below the length of px and py (see
+// plan_file_vehicle_stops()); vehicles, stops and the coordinates must
+// outlive the simulation. Returns 0 or -1 on allocation failure.
+int fleet_sim_init(FleetSim *sim, const PlanVehicle *vehicles, int num_vehicles,
+                   const PlanStop *stops, const double *px, const double *py);
+void fleet_sim_free(FleetSim *sim);
+// Moves the clock on by minutes, runs the events up to it and updates the
+// positions. Returns the number of vehicles not yet back for good.
+int fleet_sim_advance(FleetSim *sim, double minutes);
+// Runs the rest of the day at a fixed step of minutes (> 0), as fast as it
+// goes.
+void fleet_sim_run(FleetSim *sim, double step, FleetSimStats *stats);
+
+#endif
@@ -0,0 +1,230 @@
+#include "instance_io.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define BINARY_VERSION 2   // 2 added the delivery windows and SLA deadlines
+#define BINARY_BYTE_ORDER 0x01020304u
+#define BINARY_ALIGNMENT 64
+
+// Columns in file order
+enum {
+    COLUMN_POINT_ID,
+    COLUMN_POINT_NAME,
+    COLUMN_POINT_X,
+    COLUMN_POINT_Y,
+    COLUMN_POINT_IS_DEPOT,
+    COLUMN_POINT_PACKAGE_COUNT,
+    COLUMN_POINT_WINDOW_OPEN,
+    COLUMN_POINT_WINDOW_CLOSE,
+    COLUMN_POINT_SERVICE_MINUTES,
+    COLUMN_PACKAGE_ID,
+    COLUMN_PACKAGE_WEIGHT,
+    COLUMN_PACKAGE_VALUE,
+    COLUMN_PACKAGE_PRIORITY,
+    COLUMN_PACKAGE_CARBON_FOOTPRINT,
+    COLUMN_PACKAGE_DESTINATION,
+    COLUMN_ROUTE_FROM,
+    COLUMN_ROUTE_TO,
+    COLUMN_ROUTE_DISTANCE,
+    COLUMN_ROUTE_EMISSION_FACTOR,
+    COLUMN_NAMES,
+    COLUMN_SLA,
+    NUM_COLUMNS
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;     // BINARY_BYTE_ORDER as written by the producer
+    int32_t num_points;
+    int32_t num_packages;
+    int32_t num_routes;
+    int32_t reserved;
+    uint64_t names_size;
+    uint64_t offsets[NUM_COLUMNS];
+} BinaryHeader;
+
+// The columns are stored exactly as they sit in memory
+_Static_assert(sizeof(int) == 4 && sizeof(double) == 8, "binary format assumes 32-bit int");
+
+typedef struct {
+    const void *data;
+    size_t bytes;
+} BinaryColumn;
+
+static void describe_columns(const DeliveryProblem *problem, BinaryColumn *columns) {
+    const PointTable *points = &problem->points;
+    const PackageTable *packages = &problem->packages;
+    const RouteTable *routes = &problem->routes;
+    size_t n = (size_t)points->count;
+    size_t p = (size_t)packages->count;
+    size_t r = (size_t)routes->count;
+    columns[COLUMN_POINT_ID] = (BinaryColumn){points->id, n * sizeof(int)};
+    columns[COLUMN_POINT_NAME] = (BinaryColumn){points->name, n * sizeof(int)};
+    columns[COLUMN_POINT_X] = (BinaryColumn){points->x, n * sizeof(double)};
+    columns[COLUMN_POINT_Y] = (BinaryColumn){points->y, n * sizeof(double)};
+    columns[COLUMN_POINT_IS_DEPOT] = (BinaryColumn){points->is_depot, n};
+    columns[COLUMN_POINT_PACKAGE_COUNT] = (BinaryColumn){points->package_count, n * sizeof(int)};
+    columns[COLUMN_POINT_WINDOW_OPEN] = (BinaryColumn){points->window_open, n * sizeof(double)};
+    columns[COLUMN_POINT_WINDOW_CLOSE] = (BinaryColumn){points->window_close, n * sizeof(double)};
+    columns[COLUMN_POINT_SERVICE_MINUTES] =
+        (BinaryColumn){points->service_minutes, n * sizeof(double)};
+    columns[COLUMN_PACKAGE_ID] = (BinaryColumn){packages->id, p * sizeof(int)};
+    columns[COLUMN_PACKAGE_WEIGHT] = (BinaryColumn){packages->weight, p * sizeof(int)};
+    columns[COLUMN_PACKAGE_VALUE] = (BinaryColumn){packages->value, p * sizeof(int)};
+    columns[COLUMN_PACKAGE_PRIORITY] = (BinaryColumn){packages->priority, p * sizeof(int)};
+    columns[COLUMN_PACKAGE_CARBON_FOOTPRINT] =
+        (BinaryColumn){packages->carbon_footprint, p * sizeof(double)};
+    columns[COLUMN_PACKAGE_DESTINATION] = (BinaryColumn){packages->destination_id, p * sizeof(int)};
+    columns[COLUMN_ROUTE_FROM] = (BinaryColumn){routes->from, r * sizeof(int)};
+    columns[COLUMN_ROUTE_TO] = (BinaryColumn){routes->to, r * sizeof(int)};
+    columns[COLUMN_ROUTE_DISTANCE] = (BinaryColumn){routes->distance, r * sizeof(double)};
+    columns[COLUMN_ROUTE_EMISSION_FACTOR] =
+        (BinaryColumn){routes->carbon_emission_factor, r * sizeof(double)};
+    columns[COLUMN_NAMES] = (BinaryColumn){problem->names.data, problem->names.size};
+    columns[COLUMN_SLA] = (BinaryColumn){problem->sla_minutes, sizeof(problem->sla_minutes)};
+}
+
+static uint64_t align_offset(uint64_t offset) {
+    return (offset + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+}
+
+int write_instance_binary(const char *path, const DeliveryProblem *problem) {
+    BinaryColumn columns[NUM_COLUMNS];
+    describe_columns(problem, columns);
+
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INSTANCE_BINARY_MAGIC, sizeof(header.magic));
+    header.version = BINARY_VERSION;
+    header.byte_order = BINARY_BYTE_ORDER;
+    header.num_points = problem->points.count;
+    header.num_packages = problem->packages.count;
+    header.num_routes = problem->routes.count;
+    header.names_size = problem->names.size;
+    uint64_t offset = align_offset(sizeof(header));
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        header.offsets[c] = offset;
+        offset = align_offset(offset + columns[c].bytes);
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror(path);
+        return -1;
+    }
+    static const char padding[BINARY_ALIGNMENT];
+    uint64_t written = sizeof(header);
+    fwrite(&header, sizeof(header), 1, out);
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        fwrite(padding, 1, header.offsets[c] - written, out);
+        if (columns[c].bytes > 0) fwrite(columns[c].data, 1, columns[c].bytes, out);
+        written = header.offsets[c] + columns[c].bytes;
+    }
+    int status = ferror(out) ? -1 : 0;
+    if (fclose(out) != 0) status = -1;
+    if (status != 0) fprintf(stderr, "%s: write failed\n", path);
+    return status;
+}
+
+int load_instance_binary(const char *path, DeliveryProblem *problem) {
+    // The tables are about to point into the mapping, so nothing may stay owned
+    delivery_problem_release(problem);
+    MappedFile mapped;
+    if (mapped_file_open(&mapped, path) != 0) {
+        perror(path);
+        return -1;
+    }
+
+    BinaryHeader header;
+    const char *error = NULL;
+    if (mapped.size < sizeof(header)) {
+        error = "not a binary instance";
+    } else {
+        memcpy(&header, mapped.data, sizeof(header));
+        if (memcmp(header.magic, INSTANCE_BINARY_MAGIC, sizeof(header.magic)) != 0) {
+            error = "not a binary instance";
+        } else if (header.byte_order != BINARY_BYTE_ORDER) {
+            error = "written on a machine with a different byte order";
+        } else if (header.version != BINARY_VERSION) {
+            error = "unsupported binary instance version";
+        } else if (header.num_points < 0 || header.num_packages < 0 || header.num_routes < 0 ||
+                   header.names_size >= (uint64_t)2147483647) {
+            error = "corrupt header";
+        }
+    }
+    if (error) {
+        fprintf(stderr, "%s: %s\n", path, error);
+        mapped_file_close(&mapped);
+        return -1;
+    }
+
+    // Every column must lie inside the file and be aligned for its type
+    DeliveryProblem sizes;
+    memset(&sizes, 0, sizeof(sizes));
+    sizes.points.count = header.num_points;
+    sizes.packages.count = header.num_packages;
+    sizes.routes.count = header.num_routes;
+    sizes.names.size = header.names_size;
+    BinaryColumn columns[NUM_COLUMNS];
+    describe_columns(&sizes, columns);
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        uint64_t offset = header.offsets[c];
+        if (offset % 8 != 0 || offset > mapped.size || columns[c].bytes > mapped.size - offset) {
+            fprintf(stderr, "%s: truncated or corrupt file\n", path);
+            mapped_file_close(&mapped);
+            return -1;
+        }
+    }
+
+    char *base = mapped.data;
+#define COLUMN(index) (columns[index].bytes > 0 ? (void *)(base + header.offsets[index]) : NULL)
+    problem->mapping = mapped;
+    PointTable *points = &problem->points;
+    points->id = COLUMN(COLUMN_POINT_ID);
+    points->name = COLUMN(COLUMN_POINT_NAME);
+    points->x = COLUMN(COLUMN_POINT_X);
+    points->y = COLUMN(COLUMN_POINT_Y);
+    points->is_depot = COLUMN(COLUMN_POINT_IS_DEPOT);
+    points->package_count = COLUMN(COLUMN_POINT_PACKAGE_COUNT);
+    points->window_open = COLUMN(COLUMN_POINT_WINDOW_OPEN);
+    points->window_close = COLUMN(COLUMN_POINT_WINDOW_CLOSE);
+    points->service_minutes = COLUMN(COLUMN_POINT_SERVICE_MINUTES);
+    points->count = header.num_points;
+    PackageTable *packages = &problem->packages;
+    packages->id = COLUMN(COLUMN_PACKAGE_ID);
+    packages->weight = COLUMN(COLUMN_PACKAGE_WEIGHT);
+    packages->value = COLUMN(COLUMN_PACKAGE_VALUE);
+    packages->priority = COLUMN(COLUMN_PACKAGE_PRIORITY);
+    packages->carbon_footprint = COLUMN(COLUMN_PACKAGE_CARBON_FOOTPRINT);
+    packages->destination_id = COLUMN(COLUMN_PACKAGE_DESTINATION);
+    packages->count = header.num_packages;
+    RouteTable *routes = &problem->routes;
+    routes->from = COLUMN(COLUMN_ROUTE_FROM);
+    routes->to = COLUMN(COLUMN_ROUTE_TO);
+    routes->distance = COLUMN(COLUMN_ROUTE_DISTANCE);
+    routes->carbon_emission_factor = COLUMN(COLUMN_ROUTE_EMISSION_FACTOR);
+    routes->count = header.num_routes;
+    string_pool_attach(&problem->names, COLUMN(COLUMN_NAMES), header.names_size);
+    // Small enough to copy, and the problem holds it by value
+    memcpy(problem->sla_minutes, base + header.offsets[COLUMN_SLA], sizeof(problem->sla_minutes));
+#undef COLUMN
+
+    // Names must be terminated and referenced in range before anyone reads them
+    const char *names = problem->names.data;
+    int valid = header.names_size == 0 || names[header.names_size - 1] == '\0';
+    for (int i = 0; valid && i < points->count; i++) {
+        valid = points->name[i] >= 0 && (uint64_t)points->name[i] < header.names_size;
+    }
+    if (!valid) {
+        fprintf(stderr, "%s: corrupt name table\n", path);
+        delivery_problem_clear(problem);
+        return -1;
+    }
+    if (instance_finish_load(path, problem) != 0) {
+        delivery_problem_clear(problem);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "instance_io.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes read per fread(); a buffer only grows past this for a longer row
+#define CSV_CHUNK_SIZE ((size_t)1 << 20)
+#define CSV_MAX_FIELDS 8
+
+// Splits row into fields in place, unquoting quoted ones. Returns the field
+// count or -1 for malformed quoting / too many fields.
+static int split_row(char *row, char **fields) {
+    int count = 0;
+    char *p = row;
+    for (;;) {
+        if (count == CSV_MAX_FIELDS) return -1;
+        if (*p == '"') {
+            char *out = p;
+            fields[count++] = out;
+            p++;
+            for (;;) {
+                if (*p == '\0') return -1;
+                if (*p == '"') {
+                    if (p[1] != '"') break;
+                    p++;
+                }
+                *out++ = *p++;
+            }
+            p++;
+            char separator = *p;
+            if (separator != ',' && separator != '\0') return -1;
+            *out = '\0';
+            if (separator == '\0') return count;
+            p++;
+        } else {
+            fields[count++] = p;
+            char *comma = strchr(p, ',');
+            if (!comma) return count;
+            *comma = '\0';
+            p = comma + 1;
+        }
+    }
+}
+
+static int parse_int_field(const char *text, int *value) {
+    char *end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    end += strspn(end, " \t");
+    if (end == text || *end != '\0' || errno != 0 || parsed < -2147483647L - 1 ||
+        parsed > 2147483647L) {
+        return -1;
+    }
+    *value = (int)parsed;
+    return 0;
+}
+
+static int parse_double_field(const char *text, double *value) {
+    char *end;
+    *value = strtod(text, &end);
+    end += strspn(end, " \t");
+    return end == text || *end != '\0' ? -1 : 0;
+}
+
+static int parse_row(char *row, DeliveryProblem *problem) {
+    size_t length = strlen(row);
+    if (length > 0 && row[length - 1] == '\r') row[--length] = '\0';
+    row += strspn(row, " \t");
+    if (*row == '\0' || *row == '#') return 0;
+
+    char *fields[CSV_MAX_FIELDS];
+    int count = split_row(row, fields);
+    if (count < 1) return -1;
+    const char *type = fields[0];
+
+    if (strcmp(type, "point") == 0 && count == 7) {
+        DeliveryPoint point;
+        if (parse_int_field(fields[1], &point.id) || parse_double_field(fields[2], &point.x) ||
+            parse_double_field(fields[3], &point.y) || parse_int_field(fields[4], &point.is_depot) ||
+            parse_int_field(fields[5], &point.package_count)) {
+            return -1;
+        }
+        point.name = fields[6];
+        if (point.id != problem->points.count) return -1;
+        return delivery_problem_add_point(problem, &point) < 0 ? -1 : 0;
+    }
+    if (strcmp(type, "package") == 0 && count == 7) {
+        Package package;
+        if (parse_int_field(fields[1], &package.id) || parse_int_field(fields[2], &package.weight) ||
+            parse_int_field(fields[3], &package.value) ||
+            parse_int_field(fields[4], &package.priority) ||
+            parse_double_field(fields[5], &package.carbon_footprint) ||
+            parse_int_field(fields[6], &package.destination_id) || package.weight < 0) {
+            return -1;
+        }
+        return delivery_problem_add_package(problem, &package) < 0 ? -1 : 0;
+    }
+    if (strcmp(type, "route") == 0 && count == 5) {
+        Route route;
+        if (parse_int_field(fields[1], &route.from) || parse_int_field(fields[2], &route.to) ||
+            parse_double_field(fields[3], &route.distance) ||
+            parse_double_field(fields[4], &route.carbon_emission_factor)) {
+            return -1;
+        }
+        return delivery_problem_add_route(problem, &route) < 0 ? -1 : 0;
+    }
+    if (strcmp(type, "window") == 0 && count == 5) {
+        int point;
+        double open, close, service;
+        if (parse_int_field(fields[1], &point) || parse_double_field(fields[2], &open) ||
+            parse_double_field(fields[3], &close) || parse_double_field(fields[4], &service)) {
+            return -1;
+        }
+        return delivery_problem_set_window(problem, point, open, close, service);
+    }
+    if (strcmp(type, "sla") == 0 && count == 3) {
+        int priority;
+        double minutes;
+        if (parse_int_field(fields[1], &priority) || parse_double_field(fields[2], &minutes)) {
+            return -1;
+        }
+        return delivery_problem_set_sla(problem, priority, minutes);
+    }
+    return strcmp(type, "type") == 0 ? 0 : -1;
+}
+
+int load_instance_csv(const char *path, DeliveryProblem *problem) {
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+    delivery_problem_clear(problem);
+
+    size_t capacity = CSV_CHUNK_SIZE;
+    char *buffer = malloc(capacity + 1);
+    size_t filled = 0;
+    int line_number = 0;
+    int status = 0;
+    if (!buffer) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        status = -1;
+    }
+    while (status == 0) {
+        size_t got = fread(buffer + filled, 1, capacity - filled, in);
+        filled += got;
+        int at_end = got == 0;
+        if (at_end && ferror(in)) {
+            perror(path);
+            status = -1;
+            break;
+        }
+
+        // Parse every complete row; the partial tail moves to the front
+        size_t start = 0;
+        char *newline;
+        while (status == 0 && (newline = memchr(buffer + start, '\n', filled - start))) {
+            *newline = '\0';
+            line_number++;
+            status = parse_row(buffer + start, problem);
+            start = (size_t)(newline - buffer) + 1;
+        }
+        if (status == 0 && at_end && start < filled) {
+            buffer[filled] = '\0';
+            line_number++;
+            status = parse_row(buffer + start, problem);
+            start = filled;
+        }
+        if (status != 0) {
+            fprintf(stderr, "%s:%d: invalid record\n", path, line_number);
+            break;
+        }
+        if (at_end) break;
+
+        memmove(buffer, buffer + start, filled - start);
+        filled -= start;
+        if (filled == capacity) {
+            char *grown = realloc(buffer, capacity * 2 + 1);
+            if (!grown) {
+                fprintf(stderr, "%s: out of memory\n", path);
+                status = -1;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+    }
+    free(buffer);
+    fclose(in);
+    if (status != 0) return -1;
+
+    return instance_finish_load(path, problem);
+}
@@ -0,0 +1,193 @@
+#include "instance_generator.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spatial_index.h"
+
+#define BLOCK_SIZE 160.0          // spacing of the sample's grid points
+#define CLUSTER_STOPS 200         // average points per clustered neighbourhood
+#define ROAD_EMISSION_FACTOR 0.21 // kg CO2 per distance unit, as route_emissions()
+#define DEFAULT_ROAD_DEGREE 4
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static unsigned int next_random(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Uniform in (0, 1)
+static double next_uniform(unsigned int *state) {
+    return (next_random(state) + 0.5) / 4294967296.0;
+}
+
+const char *instance_layout_name(InstanceLayout layout) {
+    switch (layout) {
+    case INSTANCE_RANDOM: return "random";
+    case INSTANCE_CLUSTERED: return "clustered";
+    case INSTANCE_GRID: return "grid";
+    }
+    return "?";
+}
+
+int instance_layout_parse(const char *name, InstanceLayout *layout) {
+    static const InstanceLayout layouts[] = {INSTANCE_RANDOM, INSTANCE_CLUSTERED, INSTANCE_GRID};
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        if (strcmp(name, instance_layout_name(layouts[i])) == 0) {
+            *layout = layouts[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int find_root(int *parent, int point) {
+    while (parent[point] != point) {
+        parent[point] = parent[parent[point]];
+        point = parent[point];
+    }
+    return point;
+}
+
+static int add_road(DeliveryProblem *problem, int *parent, int from, int to) {
+    Route road = {from, to, calculate_distance(problem, from, to), ROAD_EMISSION_FACTOR};
+    if (delivery_problem_add_route(problem, &road) < 0) return -1;
+    parent[find_root(parent, from)] = find_root(parent, to);
+    return 0;
+}
+
+static int place_points(DeliveryProblem *problem, const InstanceSpec *spec, unsigned int *state) {
+    int n = spec->num_stops;
+    int side = (int)ceil(sqrt((double)n));
+    double extent = BLOCK_SIZE * sqrt((double)n);
+    int num_clusters = (n + CLUSTER_STOPS - 1) / CLUSTER_STOPS;
+    double spread = extent / (4.0 * sqrt((double)num_clusters));
+    double *centres = NULL;
+    if (spec->layout == INSTANCE_CLUSTERED) {
+        centres = malloc(2 * num_clusters * sizeof(double));
+        if (!centres) return -1;
+        for (int c = 0; c < 2 * num_clusters; c++) centres[c] = next_uniform(state) * extent;
+    }
+
+    int status = 0;
+    for (int i = 0; i < n && status == 0; i++) {
+        DeliveryPoint point = {i, i == 0 ? "Depot" : "", 0, 0, i == 0, i == 0 ? 0 : 1};
+        if (spec->layout == INSTANCE_GRID) {
+            point.x = 100 + (i % side) * BLOCK_SIZE + next_random(state) % 20;
+            point.y = 100 + (i / side) * BLOCK_SIZE + next_random(state) % 20;
+        } else if (i == 0) {
+            point.x = point.y = extent / 2;
+        } else if (spec->layout == INSTANCE_CLUSTERED) {
+            // Box-Muller around a random centre
+            const double *centre = centres + 2 * (next_random(state) % num_clusters);
+            double radius = spread * sqrt(-2.0 * log(next_uniform(state)));
+            double angle = 2.0 * M_PI * next_uniform(state);
+            point.x = centre[0] + radius * cos(angle);
+            point.y = centre[1] + radius * sin(angle);
+        } else {
+            point.x = next_uniform(state) * extent;
+            point.y = next_uniform(state) * extent;
+        }
+        if (delivery_problem_add_point(problem, &point) < 0) status = -1;
+    }
+    free(centres);
+    return status;
+}
+
+static int add_grid_streets(DeliveryProblem *problem, int *parent) {
+    int n = problem->points.count;
+    int side = (int)ceil(sqrt((double)n));
+    for (int i = 0; i < n; i++) {
+        if ((i + 1) % side != 0 && i + 1 < n && add_road(problem, parent, i, i + 1) != 0) return -1;
+        if (i + side < n && add_road(problem, parent, i, i + side) != 0) return -1;
+    }
+    return 0;
+}
+
+// Each point to its degree nearest, every pair once
+static int add_nearest_roads(DeliveryProblem *problem, int *parent, int degree) {
+    int n = problem->points.count;
+    int stride = degree + 1;
+    int *near = malloc((size_t)n * stride * sizeof(int));
+    SpatialIndex index;
+    if (!near || spatial_index_build(&index, problem->points.x, problem->points.y, n) != 0) {
+        free(near);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        int *list = near + (size_t)i * stride;
+        int found = spatial_index_knn(&index, problem->points.x[i], problem->points.y[i], stride,
+                                      list);
+        // Drop the point itself, wherever ties put it
+        int kept = 0;
+        for (int j = 0; j < found; j++) {
+            if (list[j] != i && kept < degree) list[kept++] = list[j];
+        }
+        for (; kept < stride; kept++) list[kept] = -1;
+    }
+    spatial_index_free(&index);
+
+    int status = 0;
+    for (int i = 0; i < n && status == 0; i++) {
+        for (int j = 0; j < degree && status == 0; j++) {
+            int other = near[(size_t)i * stride + j];
+            if (other < 0) continue;
+            // The lower point adds a mutual pair; otherwise only i has it
+            int mutual = 0;
+            for (int k = 0; k < degree; k++) mutual |= near[(size_t)other * stride + k] == i;
+            if (i < other || !mutual) status = add_road(problem, parent, i, other);
+        }
+    }
+    free(near);
+    return status;
+}
+
+int generate_instance(DeliveryProblem *problem, const InstanceSpec *spec) {
+    int n = spec->num_stops;
+    if (n < 1) return -1;
+    int degree = spec->layout == INSTANCE_GRID ? 2
+                 : spec->road_degree > 0 ? spec->road_degree : DEFAULT_ROAD_DEGREE;
+    unsigned int state = spec->seed ? spec->seed : 1;
+
+    delivery_problem_clear(problem);
+    int *parent = malloc(n * sizeof(int));
+    if (!parent || delivery_problem_reserve_points(problem, n) != 0 ||
+        delivery_problem_reserve_packages(problem, n - 1) != 0 ||
+        delivery_problem_reserve_routes(problem, n * degree) != 0 ||
+        place_points(problem, spec, &state) != 0) {
+        free(parent);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) parent[i] = i;
+    int status = spec->layout == INSTANCE_GRID ? add_grid_streets(problem, parent)
+                                               : add_nearest_roads(problem, parent, degree);
+    // Straight roads between pieces the nearest-point roads left apart
+    for (int i = 1, previous = 0; i < n && status == 0; i++) {
+        if (find_root(parent, i) == find_root(parent, 0)) continue;
+        status = add_road(problem, parent, previous, i);
+        previous = i;
+    }
+
+    for (int i = 1; i < n && status == 0; i++) {
+        Package package;
+        package.id = i - 1;
+        package.weight = next_random(&state) % 10 + 1;
+        package.value = next_random(&state) % 100 + 50;
+        package.priority = next_random(&state) % 3 + 1;
+        package.carbon_footprint = (next_random(&state) % 50 + 10) / 10.0;
+        package.destination_id = i;
+        if (delivery_problem_add_package(problem, &package) < 0) status = -1;
+    }
+    free(parent);
+    if (status != 0) return -1;
+    delivery_problem_packages_changed(problem);
+    return delivery_problem_build_graph(problem);
+}
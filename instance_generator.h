@@ -0,0 +1,33 @@
+#ifndef DELIVERY_INSTANCE_GENERATOR_H
+#define DELIVERY_INSTANCE_GENERATOR_H
+
+#include "solver.h"
+
+typedef enum {
+    INSTANCE_RANDOM,      // uniform over a square
+    INSTANCE_CLUSTERED,   // gaussian neighbourhoods around random centres
+    INSTANCE_GRID         // city blocks like the sample: 160 apart with a little jitter
+} InstanceLayout;
+
+typedef struct {
+    InstanceLayout layout;
+    int num_stops;        // points including the depot (point 0)
+    unsigned int seed;    // same seed, same instance
+    int road_degree;      // random/clustered: roads to this many nearest points, 0 = 4
+} InstanceSpec;
+
+const char *instance_layout_name(InstanceLayout layout);
+// Parses "random", "clustered" or "grid". Returns 0 or -1.
+int instance_layout_parse(const char *name, InstanceLayout *layout);
+
+// Fills the problem with a synthetic instance for benchmarks: point 0 is
+// the depot and every other point receives one package with sample-like
+// weight, value, priority and carbon. Points cover about the sample's
+// density (one per 160 x 160 block) whatever the size. The grid layout has
+// a street to each of the four neighbours; the others join each point to
+// its road_degree nearest, then link any pieces left apart, so every point
+// can reach the depot. O(n log n) for the spatial queries. road_graph is
+// built. Returns 0 or -1.
+int generate_instance(DeliveryProblem *problem, const InstanceSpec *spec);
+
+#endif
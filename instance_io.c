@@ -0,0 +1,286 @@
+#include "instance_io.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int parse_point(char *line, DeliveryProblem *problem) {
+    DeliveryPoint point;
+    int name_start = 0;
+    if (sscanf(line, "point %d %lf %lf %d %d %n", &point.id, &point.x, &point.y,
+               &point.is_depot, &point.package_count, &name_start) < 5 || name_start == 0) {
+        return -1;
+    }
+    point.name = line + name_start;
+    line[name_start + strcspn(line + name_start, "\r\n")] = '\0';
+    if (point.id != problem->points.count) return -1;
+    return delivery_problem_add_point(problem, &point) < 0 ? -1 : 0;
+}
+
+static int parse_package(const char *line, DeliveryProblem *problem) {
+    Package package;
+    if (sscanf(line, "package %d %d %d %d %lf %d", &package.id, &package.weight,
+               &package.value, &package.priority, &package.carbon_footprint,
+               &package.destination_id) != 6) {
+        return -1;
+    }
+    if (package.weight < 0) return -1;
+    return delivery_problem_add_package(problem, &package) < 0 ? -1 : 0;
+}
+
+static int parse_window(const char *line, DeliveryProblem *problem) {
+    int point;
+    double open, close, service;
+    if (sscanf(line, "window %d %lf %lf %lf", &point, &open, &close, &service) != 4) return -1;
+    return delivery_problem_set_window(problem, point, open, close, service);
+}
+
+static int parse_sla(const char *line, DeliveryProblem *problem) {
+    int priority;
+    double minutes;
+    if (sscanf(line, "sla %d %lf", &priority, &minutes) != 2) return -1;
+    return delivery_problem_set_sla(problem, priority, minutes);
+}
+
+static int parse_route(const char *line, DeliveryProblem *problem) {
+    Route route;
+    if (sscanf(line, "route %d %d %lf %lf", &route.from, &route.to, &route.distance,
+               &route.carbon_emission_factor) != 4) {
+        return -1;
+    }
+    return delivery_problem_add_route(problem, &route) < 0 ? -1 : 0;
+}
+
+int load_instance_text(const char *path, DeliveryProblem *problem) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+
+    char line[512];
+    int line_number = 0;
+    int status = 0;
+    delivery_problem_clear(problem);
+
+    while (fgets(line, sizeof(line), in)) {
+        line_number++;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+
+        if (strncmp(p, "point ", 6) == 0) {
+            status = parse_point(p, problem);
+        } else if (strncmp(p, "package ", 8) == 0) {
+            status = parse_package(p, problem);
+        } else if (strncmp(p, "route ", 6) == 0) {
+            status = parse_route(p, problem);
+        } else if (strncmp(p, "window ", 7) == 0) {
+            status = parse_window(p, problem);
+        } else if (strncmp(p, "sla ", 4) == 0) {
+            status = parse_sla(p, problem);
+        } else {
+            status = -1;
+        }
+        if (status != 0) {
+            fprintf(stderr, "%s:%d: invalid record\n", path, line_number);
+            break;
+        }
+    }
+    fclose(in);
+    if (status != 0) return -1;
+
+    return instance_finish_load(path, problem);
+}
+
+int load_instance(const char *path, DeliveryProblem *problem) {
+    char magic[8] = {0};
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+    size_t got = fread(magic, 1, sizeof(magic), in);
+    fclose(in);
+    if (got == sizeof(magic) && memcmp(magic, INSTANCE_BINARY_MAGIC, sizeof(magic)) == 0) {
+        return load_instance_binary(path, problem);
+    }
+    size_t length = strlen(path);
+    if (length >= 4 && strcmp(path + length - 4, ".csv") == 0) {
+        return load_instance_csv(path, problem);
+    }
+    return load_instance_text(path, problem);
+}
+
+int instance_finish_load(const char *path, DeliveryProblem *problem) {
+    const PackageTable *packages = &problem->packages;
+    for (int i = 0; i < packages->count; i++) {
+        int destination = packages->destination_id[i];
+        if (destination < 0 || destination >= problem->points.count) {
+            fprintf(stderr, "%s: package %d has unknown destination %d\n",
+                    path, packages->id[i], destination);
+            return -1;
+        }
+    }
+    const RouteTable *routes = &problem->routes;
+    for (int i = 0; i < routes->count; i++) {
+        if (routes->from[i] < 0 || routes->from[i] >= problem->points.count ||
+            routes->to[i] < 0 || routes->to[i] >= problem->points.count) {
+            fprintf(stderr, "%s: route %d references an unknown point\n", path, i);
+            return -1;
+        }
+    }
+    delivery_problem_packages_changed(problem);
+    if (routes->count == 0 && build_complete_routes(problem) != 0) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        return -1;
+    }
+    if (delivery_problem_build_graph(problem) != 0) {
+        fprintf(stderr, "%s: invalid road network\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int write_instance_text(FILE *out, const DeliveryProblem *problem) {
+    const PointTable *points = &problem->points;
+    for (int i = 0; i < points->count; i++) {
+        fprintf(out, "point %d %.3f %.3f %d %d %s\n", points->id[i], points->x[i], points->y[i],
+                points->is_depot[i], points->package_count[i], delivery_point_name(problem, i));
+    }
+    for (int i = 0; i < points->count; i++) {
+        if (points->window_open[i] > 0 || isfinite(points->window_close[i]) ||
+            points->service_minutes[i] > 0) {
+            fprintf(out, "window %d %.3f %.3f %.3f\n", points->id[i], points->window_open[i],
+                    points->window_close[i], points->service_minutes[i]);
+        }
+    }
+    for (int priority = 1; priority <= PACKAGE_PRIORITY_PREMIUM; priority++) {
+        if (problem->sla_minutes[priority] > 0) {
+            fprintf(out, "sla %d %.3f\n", priority, problem->sla_minutes[priority]);
+        }
+    }
+    const PackageTable *packages = &problem->packages;
+    for (int i = 0; i < packages->count; i++) {
+        fprintf(out, "package %d %d %d %d %.2f %d\n", packages->id[i], packages->weight[i],
+                packages->value[i], packages->priority[i], packages->carbon_footprint[i],
+                packages->destination_id[i]);
+    }
+    const RouteTable *routes = &problem->routes;
+    for (int i = 0; i < routes->count; i++) {
+        fprintf(out, "route %d %d %.3f %.3f\n", routes->from[i], routes->to[i],
+                routes->distance[i], routes->carbon_emission_factor[i]);
+    }
+    return ferror(out) ? -1 : 0;
+}
+
+void write_plan_text(FILE *out, const DeliveryProblem *problem, const DeliveryPlan *plan) {
+    fprintf(out, "distance %.3f\n", plan->total_distance / 10);
+    fprintf(out, "emissions %.3f\n", plan->total_emissions / 10);
+    fprintf(out, "vehicles %d\n", plan->num_vehicles);
+    for (int v = 0; v < plan->num_vehicles; v++) {
+        const VehicleRoute *vehicle = &plan->vehicles[v];
+        fprintf(out, "vehicle %d depot %d load %d distance %.3f stops", v, vehicle->depot,
+                vehicle->load, vehicle->distance / 10);
+        for (int i = 0; i < vehicle->num_stops; i++) {
+            fprintf(out, " %d", vehicle->stops[i]);
+        }
+        fprintf(out, " packages");
+        for (int i = 0; i < vehicle->num_packages; i++) {
+            fprintf(out, " %d", problem->packages.id[vehicle->packages[i]]);
+        }
+        fprintf(out, "\n");
+    }
+    if (plan->num_unassigned > 0) {
+        fprintf(out, "unassigned");
+        for (int i = 0; i < plan->num_unassigned; i++) {
+            fprintf(out, " %d", problem->packages.id[plan->unassigned[i]]);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+// Minutes since midnight as HH:MM, with "+<days>" once past midnight
+static void format_clock(char *text, size_t size, double minutes) {
+    long total = lround(minutes);
+    long days = total / 1440;
+    snprintf(text, size, days > 0 ? "%02ld:%02ld+%ld" : "%02ld:%02ld", total % 1440 / 60,
+             total % 60, days);
+}
+
+int write_schedule_text(FILE *out, const DeliveryPlan *plan, const TrafficModel *model,
+                        const TrafficQuery *query) {
+    TrafficSearch search;
+    if (traffic_search_init(&search, model->graph->num_nodes) != 0) return -1;
+    char clock[32];
+    format_clock(clock, sizeof(clock), query->depart);
+    fprintf(out, "traffic_objective %s\n", traffic_objective_name(query->objective));
+    fprintf(out, "depart %s\n", clock);
+    double minutes = 0, emissions = 0;
+    int status = 0;
+    for (int v = 0; v < plan->num_vehicles && status == 0; v++) {
+        const VehicleRoute *vehicle = &plan->vehicles[v];
+        TrafficLeg total;
+        status = traffic_tour(model, query, vehicle->stops, vehicle->num_stops, &search, &total);
+        if (status != 0) break;
+        format_clock(clock, sizeof(clock), total.arrival);
+        fprintf(out, "vehicle %d return %s minutes %.1f distance %.3f emissions %.3f\n", v, clock,
+                total.minutes, total.distance / 10, total.emissions / 10);
+        minutes += total.minutes;
+        emissions += total.emissions;
+    }
+    if (status == 0) {
+        fprintf(out, "traffic_minutes %.1f\n", minutes);
+        fprintf(out, "traffic_emissions %.3f\n", emissions / 10);
+    }
+    traffic_search_free(&search);
+    return status;
+}
+
+int write_lateness_text(FILE *out, const DeliveryProblem *problem, const DeliveryPlan *plan) {
+    DistanceMatrix scratch;
+    const DistanceMatrix *matrix = delivery_problem_matrix(problem, &scratch);
+    TimeWindows windows;
+    if (!matrix) return -1;
+    if (delivery_problem_time_windows(problem, &windows) != 0) {
+        distance_matrix_free(&scratch);
+        return -1;
+    }
+    TimeWindowReport total = {0};
+    for (int v = 0; v < plan->num_vehicles; v++) {
+        const VehicleRoute *vehicle = &plan->vehicles[v];
+        TimeWindowReport report;
+        time_window_report(&windows, matrix, vehicle->stops, vehicle->num_stops, &report);
+        fprintf(out, "vehicle %d finish %.1f late %d premium %d late_minutes %.1f\n", v,
+                report.finish, report.late_stops, report.late_premium, report.late_minutes);
+        total.late_stops += report.late_stops;
+        total.late_premium += report.late_premium;
+        total.late_minutes += report.late_minutes;
+        total.penalty += report.penalty;
+    }
+    fprintf(out, "late_stops %d\n", total.late_stops);
+    fprintf(out, "late_premium %d\n", total.late_premium);
+    fprintf(out, "late_minutes %.1f\n", total.late_minutes);
+    fprintf(out, "late_penalty %.1f\n", total.penalty);
+    time_windows_free(&windows);
+    distance_matrix_free(&scratch);
+    return 0;
+}
+
+void write_knapsack_text(FILE *out, const DeliveryProblem *problem, const KnapsackResult *result) {
+    fprintf(out, "capacity %d\n", result->capacity);
+    fprintf(out, "knapsack_mode %s%s\n", knapsack_mode_name(result->mode),
+            result->exact ? "" : " node_limit");
+    fprintf(out, "knapsack_time_ms %.3f\n", result->elapsed * 1e3);
+    fprintf(out, "package_value %d\n", result->value);
+    fprintf(out, "package_weight %d\n", result->total_weight);
+    fprintf(out, "packages");
+    for (int i = 0; i < result->num_items; i++) {
+        if (result->selected[i]) fprintf(out, " %d", problem->packages.id[i]);
+    }
+    fprintf(out, "\n");
+    if (result->split_item >= 0) {
+        fprintf(out, "split_package %d %.4f\n", problem->packages.id[result->split_item],
+                result->split_fraction);
+        fprintf(out, "fractional_value %.2f\n", result->fractional_value);
+    }
+}
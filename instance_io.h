@@ -0,0 +1,69 @@
+#ifndef DELIVERY_INSTANCE_IO_H
+#define DELIVERY_INSTANCE_IO_H
+
+#include <stdio.h>
+
+#include "knapsack.h"
+#include "solver.h"
+
+// Text instance format, one record per line ('#' starts a comment):
+//   point   <id> <x> <y> <is_depot> <package_count> <name...>
+//   package <id> <weight> <value> <priority> <carbon_footprint> <destination_id>
+//   route   <from> <to> <distance> <carbon_emission_factor>
+//   window  <point_id> <open> <close> <service>
+//   sla     <priority> <minutes>
+// Times are minutes after the shift starts; a window's close may be "inf"
+// and its line must follow the point's. sla sets the delivery deadline of
+// every package with that priority.
+// If no route lines are given every pair of points is connected directly.
+// Returns 0 on success, -1 on error (reported on stderr).
+int load_instance_text(const char *path, DeliveryProblem *problem);
+int write_instance_text(FILE *out, const DeliveryProblem *problem);
+
+// CSV instance with the same records, the record type in the first column:
+//   point,<id>,<x>,<y>,<is_depot>,<package_count>,<name>
+//   package,<id>,<weight>,<value>,<priority>,<carbon_footprint>,<destination_id>
+//   route,<from>,<to>,<distance>,<carbon_emission_factor>
+//   window,<point_id>,<open>,<close>,<service>
+//   sla,<priority>,<minutes>
+// Fields may be quoted ("" is a literal quote) but a row may not span lines.
+// A header row whose first field is "type" and '#' rows are skipped. The file
+// is parsed in fixed-size chunks, so memory use does not grow with its size.
+int load_instance_csv(const char *path, DeliveryProblem *problem);
+
+// Binary instance: a fixed header followed by every column of the problem
+// tables and the name pool, 64-byte aligned, in native byte order. Loading
+// maps the file and points the tables into it without copying or parsing.
+#define INSTANCE_BINARY_MAGIC "DLVRYBIN"
+int load_instance_binary(const char *path, DeliveryProblem *problem);
+int write_instance_binary(const char *path, const DeliveryProblem *problem);
+
+// Loads any of the formats: binary when the file starts with the binary
+// magic, CSV for a ".csv" name, text otherwise.
+int load_instance(const char *path, DeliveryProblem *problem);
+
+// Shared last step of the loaders: checks package destinations and route
+// ends, adds straight-line routes if none were given and builds the road
+// graph. Errors are reported on stderr against path.
+int instance_finish_load(const char *path, DeliveryProblem *problem);
+
+// Writes one line per vehicle plus the totals in a line-oriented format:
+//   vehicle <i> depot <d> load <kg> distance <km> stops <s...> packages <p...>
+void write_plan_text(FILE *out, const DeliveryProblem *problem, const DeliveryPlan *plan);
+// Drives every vehicle's tour through the traffic model, leaving at
+// query->depart, and writes its return time, driving minutes and CO2:
+//   vehicle <i> return <HH:MM> minutes <m> distance <km> emissions <kg>
+// Returns 0, 1 when a leg is unreachable or -1 on allocation failure.
+int write_schedule_text(FILE *out, const DeliveryPlan *plan, const TrafficModel *model,
+                        const TrafficQuery *query);
+// Drives every vehicle's tour at free-flow speed against the problem's
+// delivery windows (see delivery_problem_time_windows()) and writes when it
+// is back and how late it ran, minutes after the shift starts:
+//   vehicle <i> finish <min> late <stops> premium <stops> late_minutes <min>
+// followed by the totals. Returns 0 or -1 on allocation failure.
+int write_lateness_text(FILE *out, const DeliveryProblem *problem, const DeliveryPlan *plan);
+// Writes the knapsack selection for a single bag, the mode that produced it
+// and, for fractional loads, the package taken in part.
+void write_knapsack_text(FILE *out, const DeliveryProblem *problem, const KnapsackResult *result);
+
+#endif
@@ -0,0 +1,566 @@
+#include "knapsack.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "solver_clock.h"
+
+// Largest keep table (in bytes) before reconstruction switches to divide and conquer
+#define KNAPSACK_BITSET_LIMIT ((size_t)128 << 20)
+// KNAPSACK_AUTO uses the DP up to this many cells (items * (capacity + 1))
+#define KNAPSACK_AUTO_DP_CELLS ((int64_t)1 << 28)
+#define KNAPSACK_DEFAULT_MAX_NODES 50000000L
+// Largest full DP table (in bytes) a solver keeps for reuse by the next solve
+#define KNAPSACK_ROW_CACHE_LIMIT ((size_t)32 << 20)
+
+typedef struct {
+    int weight;
+    int value;
+    int index;
+} Item;
+
+typedef struct {
+    const Item *items;
+    unsigned char *selected;
+    int32_t *row_a;      // DP rows, capacity + 1 each
+    int32_t *row_b;
+    int32_t *row_c;
+    uint64_t *keep;      // bit rows for the current leaf
+} KnapsackWork;
+
+// One item step: next[w] = max(prev[w], prev[w - weight] + value).
+// Separate input and output rows keep the loop free of carried dependencies
+// so the compiler can vectorise it.
+static void dp_row(const int32_t *restrict prev, int32_t *restrict next, int capacity, int weight,
+                   int value) {
+    int split = weight <= capacity ? weight : capacity + 1;
+    memcpy(next, prev, split * sizeof(int32_t));
+    for (int w = split; w <= capacity; w++) {
+        int32_t take = prev[w - weight] + value;
+        int32_t skip = prev[w];
+        next[w] = take > skip ? take : skip;
+    }
+}
+
+// Runs items[lo..hi) over a zeroed row; returns the row holding the answer
+// (one of a/b).
+static int32_t *dp_range(const Item *items, int lo, int hi, int capacity, int32_t *a, int32_t *b) {
+    metrics_add(METRIC_DP_CELLS, (uint64_t)(hi - lo) * (capacity + 1));
+    memset(a, 0, (capacity + 1) * sizeof(int32_t));
+    for (int i = lo; i < hi; i++) {
+        dp_row(a, b, capacity, items[i].weight, items[i].value);
+        int32_t *swap = a;
+        a = b;
+        b = swap;
+    }
+    return a;
+}
+
+// Packs next[w] > prev[w] into bits. Compares go to a byte buffer first (a
+// plain vectorisable loop), then eight flags at a time become one byte via a
+// multiply that gathers bit 0 of each byte into the top byte.
+static void pack_keep_bits(const int32_t *prev, const int32_t *next, uint64_t *bits, int capacity) {
+    int words = capacity / 64 + 1;
+    for (int word = 0; word < words; word++) {
+        int base = word * 64;
+        int end = base + 64 <= capacity + 1 ? 64 : capacity + 1 - base;
+        unsigned char flags[64] = {0};
+        for (int b = 0; b < end; b++) flags[b] = next[base + b] > prev[base + b];
+        uint64_t mask = 0;
+        for (int byte = 0; byte < 8; byte++) {
+            uint64_t chunk;
+            memcpy(&chunk, flags + byte * 8, sizeof(chunk));
+            mask |= ((chunk * 0x0102040810204080ULL) >> 56) << (byte * 8);
+        }
+        bits[word] = mask;
+    }
+}
+
+// Exact selection for items[lo..hi) within capacity using keep bit rows.
+static void solve_leaf(KnapsackWork *work, int lo, int hi, int capacity) {
+    int words = capacity / 64 + 1;
+    int32_t *prev = work->row_a, *next = work->row_b;
+    metrics_add(METRIC_DP_CELLS, (uint64_t)(hi - lo) * (capacity + 1));
+    memset(prev, 0, (capacity + 1) * sizeof(int32_t));
+    for (int i = lo; i < hi; i++) {
+        dp_row(prev, next, capacity, work->items[i].weight, work->items[i].value);
+        pack_keep_bits(prev, next, work->keep + (size_t)(i - lo) * words, capacity);
+        int32_t *swap = prev;
+        prev = next;
+        next = swap;
+    }
+    int w = capacity;
+    for (int i = hi - 1; i >= lo; i--) {
+        const uint64_t *bits = work->keep + (size_t)(i - lo) * words;
+        if (bits[w / 64] >> (w % 64) & 1) {
+            work->selected[work->items[i].index] = 1;
+            w -= work->items[i].weight;
+        }
+    }
+}
+
+static size_t keep_bytes(int num_items, int capacity) {
+    return (size_t)num_items * (capacity / 64 + 1) * sizeof(uint64_t);
+}
+
+// Hirschberg-style split: the best capacity share between the two halves
+// comes from a forward DP over the left half and one over the right half.
+static void solve_range(KnapsackWork *work, int lo, int hi, int capacity) {
+    if (hi <= lo) return;
+    if (hi - lo == 1 || keep_bytes(hi - lo, capacity) <= KNAPSACK_BITSET_LIMIT) {
+        solve_leaf(work, lo, hi, capacity);
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    int32_t *left = dp_range(work->items, lo, mid, capacity, work->row_a, work->row_b);
+    int32_t *spare = left == work->row_a ? work->row_b : work->row_a;
+    // Keep the left row in row_c while the right half reuses the others
+    memcpy(work->row_c, left, (capacity + 1) * sizeof(int32_t));
+    int32_t *right = dp_range(work->items, mid, hi, capacity, spare, left);
+
+    int best_split = 0;
+    int64_t best = -1;
+    for (int c = 0; c <= capacity; c++) {
+        int64_t total = (int64_t)work->row_c[c] + right[capacity - c];
+        if (total > best) {
+            best = total;
+            best_split = c;
+        }
+    }
+    solve_range(work, lo, mid, best_split);
+    solve_range(work, mid, hi, capacity - best_split);
+}
+
+// Negative when a packs more value per kg than b. Cross-multiplied so ties
+// are exact.
+static int ratio_compare(const Item *a, const Item *b) {
+    int64_t left = (int64_t)a->value * b->weight;
+    int64_t right = (int64_t)b->value * a->weight;
+    return (left < right) - (left > right);
+}
+
+static int ratio_compare_qsort(const void *a, const void *b) {
+    int order = ratio_compare(a, b);
+    return order != 0 ? order : ((const Item *)a)->index - ((const Item *)b)->index;
+}
+
+static void swap_items(Item *items, int a, int b) {
+    Item swap = items[a];
+    items[a] = items[b];
+    items[b] = swap;
+}
+
+// Fractional knapsack without sorting: quickselect for the critical item
+// (the first one, by falling value/weight, that no longer fits whole).
+// Everything denser is packed and the critical item is split. Expected O(n).
+static void fractional_select(Item *items, int count, int capacity, unsigned char *selected,
+                              KnapsackResult *result) {
+    unsigned int state = 2463534242u;
+    int lo = 0, hi = count;
+    int64_t room = capacity;
+    while (lo < hi) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        Item pivot = items[lo + (int)(state % (unsigned int)(hi - lo))];
+        // Three-way partition: [lo, gt) denser, [gt, lt) as dense, [lt, hi) sparser
+        int gt = lo, i = lo, lt = hi;
+        while (i < lt) {
+            int order = ratio_compare(&items[i], &pivot);
+            if (order < 0) {
+                swap_items(items, i++, gt++);
+            } else if (order > 0) {
+                swap_items(items, i, --lt);
+            } else {
+                i++;
+            }
+        }
+        int64_t denser = 0;
+        for (int k = lo; k < gt; k++) denser += items[k].weight;
+        if (denser > room) {
+            hi = gt;
+            continue;
+        }
+        room -= denser;
+        for (int k = lo; k < gt; k++) selected[items[k].index] = 1;
+        for (int k = gt; k < lt; k++) {
+            if (items[k].weight > room) {
+                result->split_item = items[k].index;
+                result->split_fraction = (double)room / items[k].weight;
+                return;
+            }
+            room -= items[k].weight;
+            selected[items[k].index] = 1;
+        }
+        lo = lt;
+    }
+}
+
+// Fractional (LP) bound for items[from..] with room left, rounded down since
+// values are integers.
+static int64_t lp_bound(const Item *items, int count, int from, int64_t room) {
+    int64_t bound = 0;
+    for (int i = from; i < count; i++) {
+        if (items[i].weight > room) {
+            return bound + (int64_t)items[i].value * room / items[i].weight;
+        }
+        room -= items[i].weight;
+        bound += items[i].value;
+    }
+    return bound;
+}
+
+// Depth-first branch and bound (Horowitz-Sahni order): items sorted by
+// falling density, take greedily, skip the first item that does not fit and
+// backtrack to the last taken item once the LP bound cannot beat the best
+// selection. Returns 1 when the search finished, 0 when max_nodes ran out.
+static int branch_and_bound(Arena *arena, Item *items, int count, int capacity, long max_nodes,
+                            unsigned char *selected) {
+    qsort(items, count, sizeof(Item), ratio_compare_qsort);
+    unsigned char *taken = arena_calloc(arena, count, 1);
+    unsigned char *best_taken = arena_calloc(arena, count, 1);
+    if (!taken || !best_taken) return -1;
+
+    int64_t best = -1, value = 0, room = capacity;
+    long nodes = 0;
+    int finished = 1;
+    int next = 0;
+    for (;;) {
+        if (max_nodes > 0 && ++nodes > max_nodes) {
+            finished = 0;
+            break;
+        }
+        if (value + lp_bound(items, count, next, room) > best) {
+            while (next < count && items[next].weight <= room) {
+                room -= items[next].weight;
+                value += items[next].value;
+                taken[next++] = 1;
+            }
+            if (next < count) {
+                taken[next++] = 0;
+                continue;
+            }
+            if (value > best) {
+                best = value;
+                memcpy(best_taken, taken, count);
+            }
+        }
+        // Undo the deepest item still taken and branch on leaving it out
+        int last = next - 1;
+        while (last >= 0 && !taken[last]) last--;
+        if (last < 0) break;
+        taken[last] = 0;
+        room += items[last].weight;
+        value -= items[last].value;
+        next = last + 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (best_taken[i]) selected[items[i].index] = 1;
+    }
+    metrics_add(METRIC_BRANCH_NODES, nodes);
+    return finished;
+}
+
+static int solve_dp(Arena *arena, Item *items, int count, int capacity, unsigned char *selected) {
+    KnapsackWork work = {items, selected, NULL, NULL, NULL, NULL};
+    size_t row = (size_t)(capacity + 1) * sizeof(int32_t);
+    size_t leaf = keep_bytes(count, capacity);
+    if (leaf > KNAPSACK_BITSET_LIMIT) leaf = KNAPSACK_BITSET_LIMIT;
+    work.row_a = arena_alloc(arena, row);
+    work.row_b = arena_alloc(arena, row);
+    work.row_c = arena_alloc(arena, row);
+    work.keep = arena_alloc(arena, leaf > keep_bytes(1, capacity) ? leaf : keep_bytes(1, capacity));
+    if (!work.row_a || !work.row_b || !work.row_c || !work.keep) return -1;
+    solve_range(&work, 0, count, capacity);
+    return 0;
+}
+
+static int reserve_rows(KnapsackSolver *solver, int count, size_t cells) {
+    if (cells > solver->row_cells) {
+        size_t grown = solver->row_cells + solver->row_cells / 2;
+        if (grown < cells) grown = cells;
+        int32_t *rows = realloc(solver->rows, grown * sizeof(int32_t));
+        if (!rows) return -1;
+        solver->rows = rows;
+        solver->row_cells = grown;
+    }
+    if (count > solver->row_items_capacity) {
+        int grown = count > 2 * solver->row_items_capacity ? count : 2 * solver->row_items_capacity;
+        int *weights = realloc(solver->row_weight, grown * sizeof(int));
+        if (!weights) return -1;
+        solver->row_weight = weights;
+        int *values = realloc(solver->row_value, grown * sizeof(int));
+        if (!values) return -1;
+        solver->row_value = values;
+        solver->row_items_capacity = grown;
+    }
+    return 0;
+}
+
+// Exact DP over the solver's kept table: rows up to the first changed item
+// stay, the rest are recomputed, and the selection is read off the table.
+static int solve_dp_rows(KnapsackSolver *solver, const Item *items, int count, int capacity,
+                         unsigned char *selected) {
+    size_t width = (size_t)capacity + 1;
+    int keep = 0;
+    if (solver->row_capacity == capacity) {
+        while (keep < count && keep < solver->row_count &&
+               solver->row_weight[keep] == items[keep].weight &&
+               solver->row_value[keep] == items[keep].value) {
+            keep++;
+        }
+    }
+    if (reserve_rows(solver, count, (count + 1) * width) != 0) {
+        solver->row_count = 0;
+        solver->row_capacity = -1;
+        return -1;
+    }
+    int32_t *rows = solver->rows;
+    if (solver->row_capacity != capacity) memset(rows, 0, width * sizeof(int32_t));
+    for (int i = keep; i < count; i++) {
+        dp_row(rows + i * width, rows + (i + 1) * width, capacity, items[i].weight, items[i].value);
+        solver->row_weight[i] = items[i].weight;
+        solver->row_value[i] = items[i].value;
+    }
+    solver->row_count = count;
+    solver->row_capacity = capacity;
+    solver->result.reused_rows = keep;
+    metrics_add(METRIC_DP_CELLS, (uint64_t)(count - keep) * width);
+    metrics_add(METRIC_DP_ROWS_REUSED, keep);
+
+    int w = capacity;
+    for (int i = count - 1; i >= 0; i--) {
+        if (rows[(i + 1) * width + w] != rows[i * width + w]) {
+            selected[items[i].index] = 1;
+            w -= items[i].weight;
+        }
+    }
+    return 0;
+}
+
+static int ensure_selected(KnapsackSolver *solver, int n) {
+    if (n > solver->selected_capacity) {
+        unsigned char *selected = realloc(solver->result.selected, n);
+        if (!selected) return -1;
+        solver->result.selected = selected;
+        solver->selected_capacity = n;
+    }
+    if (n > 0) memset(solver->result.selected, 0, n);
+    return 0;
+}
+
+void knapsack_solver_init(KnapsackSolver *solver) {
+    memset(solver, 0, sizeof(KnapsackSolver));
+    solver->mode = KNAPSACK_AUTO;
+    solver->max_nodes = KNAPSACK_DEFAULT_MAX_NODES;
+    solver->row_capacity = -1;
+    arena_init(&solver->scratch, 0);
+}
+
+void knapsack_solver_free(KnapsackSolver *solver) {
+    free(solver->result.selected);
+    free(solver->rows);
+    free(solver->row_weight);
+    free(solver->row_value);
+    arena_free(&solver->scratch);
+    knapsack_solver_init(solver);
+}
+
+void knapsack_solver_invalidate(KnapsackSolver *solver) {
+    solver->valid = 0;
+}
+
+const char *knapsack_mode_name(KnapsackMode mode) {
+    switch (mode) {
+    case KNAPSACK_DP: return "dp";
+    case KNAPSACK_FRACTIONAL: return "fractional";
+    case KNAPSACK_BRANCH_BOUND: return "bb";
+    default: return "auto";
+    }
+}
+
+int knapsack_mode_parse(const char *name, KnapsackMode *mode) {
+    static const KnapsackMode modes[] = {KNAPSACK_AUTO, KNAPSACK_DP, KNAPSACK_FRACTIONAL,
+                                         KNAPSACK_BRANCH_BOUND};
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcmp(name, knapsack_mode_name(modes[i])) == 0) {
+            *mode = modes[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int knapsack_solve_items(KnapsackSolver *solver, const int *weights, const int *values, int n,
+                         int capacity) {
+    double start = solver_clock_seconds();
+    solver->valid = 0;
+    if (capacity < 0) capacity = 0;
+    if (ensure_selected(solver, n) != 0) return -1;
+
+    KnapsackResult *result = &solver->result;
+    result->capacity = capacity;
+    result->num_items = n;
+    result->value = 0;
+    result->total_weight = 0;
+    result->num_selected = 0;
+    result->exact = 1;
+    result->reused_rows = 0;
+    result->split_item = -1;
+    result->split_fraction = 0.0;
+
+    // Only items that can fit and add value take part; weightless ones are
+    // always packed
+    ArenaMark mark = arena_mark(&solver->scratch);
+    Item *items = arena_alloc(&solver->scratch, n * sizeof(Item));
+    if (!items) return -1;
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (values[i] <= 0 || weights[i] < 0) continue;
+        if (weights[i] > capacity && solver->mode != KNAPSACK_FRACTIONAL) continue;
+        if (weights[i] == 0) {
+            result->selected[i] = 1;
+            continue;
+        }
+        items[count++] = (Item){weights[i], values[i], i};
+    }
+
+    KnapsackMode mode = solver->mode;
+    if (mode == KNAPSACK_AUTO) {
+        mode = (int64_t)count * (capacity + 1) <= KNAPSACK_AUTO_DP_CELLS ? KNAPSACK_DP
+                                                                          : KNAPSACK_BRANCH_BOUND;
+    }
+    int status = 0;
+    if (count > 0) {
+        switch (mode) {
+        case KNAPSACK_FRACTIONAL:
+            fractional_select(items, count, capacity, result->selected, result);
+            break;
+        case KNAPSACK_BRANCH_BOUND: {
+            int finished = branch_and_bound(&solver->scratch, items, count, capacity,
+                                            solver->max_nodes, result->selected);
+            if (finished < 0) status = -1;
+            result->exact = finished == 1;
+            break;
+        }
+        default:
+            // The kept table is the faster path while it fits; a failed
+            // allocation there still leaves the memory-lean DP
+            if ((size_t)(count + 1) * (capacity + 1) * sizeof(int32_t) > KNAPSACK_ROW_CACHE_LIMIT ||
+                solve_dp_rows(solver, items, count, capacity, result->selected) != 0) {
+                status = solve_dp(&solver->scratch, items, count, capacity, result->selected);
+            }
+            break;
+        }
+    }
+    arena_release(&solver->scratch, mark);
+    if (status != 0) return -1;
+
+    for (int i = 0; i < n; i++) {
+        if (result->selected[i]) {
+            result->value += values[i];
+            result->total_weight += weights[i];
+            result->num_selected++;
+        }
+    }
+    result->fractional_value = result->value;
+    if (result->split_item >= 0) {
+        result->fractional_value += result->split_fraction * values[result->split_item];
+    }
+    result->mode = mode;
+    result->elapsed = solver_clock_seconds() - start;
+    metrics_record_time(METRIC_TIMER_KNAPSACK, result->elapsed);
+    return 0;
+}
+
+int knapsack_best_value(const int *weights, const int *values, int n, int capacity) {
+    if (capacity < 0) return 0;
+    int32_t *a = calloc(capacity + 1, sizeof(int32_t));
+    int32_t *b = malloc((capacity + 1) * sizeof(int32_t));
+    int best = 0;
+    if (a && b) {
+        uint64_t rows = 0;
+        for (int i = 0; i < n; i++) {
+            if (values[i] <= 0 || weights[i] > capacity || weights[i] < 0) continue;
+            rows++;
+            dp_row(a, b, capacity, weights[i], values[i]);
+            int32_t *swap = a;
+            a = b;
+            b = swap;
+        }
+        best = a[capacity];
+        metrics_add(METRIC_DP_CELLS, rows * (capacity + 1));
+    }
+    free(a);
+    free(b);
+    return best;
+}
+
+const KnapsackResult *knapsack_solve(KnapsackSolver *solver, const DeliveryProblem *problem,
+                                     int capacity) {
+    if (solver->valid && solver->problem == problem &&
+        solver->packages_version == problem->packages_version &&
+        solver->result.capacity == capacity && solver->requested_mode == solver->mode) {
+        metrics_add(METRIC_KNAPSACK_CACHE_HITS, 1);
+        return &solver->result;
+    }
+
+    // Weights are used in place; only the net values need computing
+    int n = problem->packages.count;
+    ArenaMark mark = arena_mark(&solver->scratch);
+    int *values = arena_alloc(&solver->scratch, n * sizeof(int));
+    int status = -1;
+    if (values) {
+        for (int i = 0; i < n; i++) values[i] = package_net_value(problem, i);
+        status = knapsack_solve_items(solver, problem->packages.weight, values, n, capacity);
+    }
+    arena_release(&solver->scratch, mark);
+    if (status != 0) return NULL;
+
+    solver->valid = 1;
+    solver->problem = problem;
+    solver->packages_version = problem->packages_version;
+    solver->requested_mode = solver->mode;
+    return &solver->result;
+}
+
+int knapsack_load_plan(DeliveryPlan *plan, const DeliveryProblem *problem,
+                       const KnapsackResult *selection) {
+    if (plan->num_vehicles != 1) return plan->num_vehicles == 0 ? 0 : -1;
+    VehicleRoute *vehicle = &plan->vehicles[0];
+    const PackageTable *packages = &problem->packages;
+    int n = packages->count;
+    unsigned char *visited = calloc(problem->points.count > 0 ? problem->points.count : 1, 1);
+    int *carried = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *unassigned = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!visited || !carried || !unassigned) {
+        free(visited);
+        free(carried);
+        free(unassigned);
+        return -1;
+    }
+    for (int i = 0; i < vehicle->num_stops; i++) visited[vehicle->stops[i]] = 1;
+    int num_carried = 0, num_unassigned = 0, load = 0;
+    for (int p = 0; p < n; p++) {
+        if (p < selection->num_items && selection->selected[p] &&
+            visited[packages->destination_id[p]]) {
+            carried[num_carried++] = p;
+            load += packages->weight[p];
+        } else {
+            unassigned[num_unassigned++] = p;
+        }
+    }
+    free(visited);
+    free(vehicle->packages);
+    free(plan->unassigned);
+    vehicle->packages = carried;
+    vehicle->num_packages = num_carried;
+    vehicle->load = load;
+    plan->unassigned = unassigned;
+    plan->num_unassigned = num_unassigned;
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef DELIVERY_KNAPSACK_H
+#define DELIVERY_KNAPSACK_H
+
+#include <stdint.h>
+
+#include "arena.h"
+#include "solver.h"
+
+typedef enum {
+    KNAPSACK_AUTO,          // DP when capacity * items is small, else branch and bound
+    KNAPSACK_DP,            // exact 0/1, O(items * capacity)
+    KNAPSACK_FRACTIONAL,    // divisible loads, greedy on value/weight in O(items)
+    KNAPSACK_BRANCH_BOUND   // exact 0/1 by depth-first search with the fractional bound
+} KnapsackMode;
+
+typedef struct {
+    int capacity;
+    int value;                // packed whole items
+    int total_weight;
+    int num_items;
+    unsigned char *selected;  // one flag per item (package), 1 when packed whole
+    int num_selected;
+    KnapsackMode mode;        // mode that actually ran (never KNAPSACK_AUTO)
+    double elapsed;           // seconds spent in the solve
+    int exact;                // 0 when branch and bound hit its node limit
+    int reused_rows;          // DP rows kept from the previous solve
+    // Fractional mode only: the item packed in part (-1 for none), the share
+    // of it taken and the value including that share
+    int split_item;
+    double split_fraction;
+    double fractional_value;
+} KnapsackResult;
+
+// Knapsack engine. Keeps its last answer and scratch buffers, so asking
+// again for the same problem, capacity and mode is free until the packages
+// change, and after a change the DP reuses the rows of the unchanged items.
+// Per-solve scratch (item lists, search flags, the memory-lean DP rows)
+// comes from an arena that is kept between solves until
+// knapsack_solver_free().
+typedef struct {
+    KnapsackMode mode;        // requested mode, KNAPSACK_AUTO after init
+    long max_nodes;           // branch and bound search limit, <= 0 = no limit
+    KnapsackResult result;
+    int selected_capacity;
+    // Memo key of result
+    int valid;
+    const DeliveryProblem *problem;
+    unsigned int packages_version;
+    KnapsackMode requested_mode;
+    // Full DP table of the last DP solve, kept while it fits the row cache
+    // limit. Row i + 1 follows row i by one item; the next solve keeps every
+    // row up to the first item whose weight or value differs, so appending
+    // a package costs one row and removing one recomputes the rows after it.
+    int32_t *rows;
+    size_t row_cells;         // allocated
+    int *row_weight;          // item behind each row after the zero row
+    int *row_value;
+    int row_count;
+    int row_items_capacity;
+    int row_capacity;         // knapsack capacity of the rows, -1 for none
+    Arena scratch;
+} KnapsackSolver;
+
+void knapsack_solver_init(KnapsackSolver *solver);
+void knapsack_solver_free(KnapsackSolver *solver);
+void knapsack_solver_invalidate(KnapsackSolver *solver);
+
+const char *knapsack_mode_name(KnapsackMode mode);
+// Parses "auto", "dp", "fractional" or "bb". Returns 0 or -1.
+int knapsack_mode_parse(const char *name, KnapsackMode *mode);
+
+// Best selection of problem packages by package_net_value() within capacity,
+// using solver->mode. Returns the cached result when neither the problem's
+// packages, the capacity nor the mode changed. Returns NULL on allocation
+// failure.
+const KnapsackResult *knapsack_solve(KnapsackSolver *solver, const DeliveryProblem *problem,
+                                     int capacity);
+
+// Loads a single-vehicle plan from a knapsack_solve() result: the selected
+// packages whose destination the vehicle stops at go on vehicles[0], their
+// weight is its load, and every other package goes to plan->unassigned.
+// Returns 0 or -1 on allocation failure (the plan is left unchanged).
+int knapsack_load_plan(DeliveryPlan *plan, const DeliveryProblem *problem,
+                       const KnapsackResult *selection);
+
+// Same over plain arrays (items with value <= 0 are never packed). The DP
+// rebuilds its selection from 1-bit-per-cell keep rows, or by divide and
+// conquer over the items in O(capacity) memory when those rows would not fit
+// the memory limit. Result goes to solver->result. Returns 0 or -1.
+int knapsack_solve_items(KnapsackSolver *solver, const int *weights, const int *values, int n,
+                         int capacity);
+
+// Value of the best selection only, O(capacity) memory, no reconstruction.
+int knapsack_best_value(const int *weights, const int *values, int n, int capacity);
+
+#endif
@@ -0,0 +1,74 @@
+#include "mapped_file.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+int mapped_file_open(MappedFile *mapped, const char *path) {
+    memset(mapped, 0, sizeof(MappedFile));
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return -1;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return -1;
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE view = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    void *data = view ? MapViewOfFile(view, FILE_MAP_COPY, 0, 0, 0) : NULL;
+    if (!data) {
+        if (view) CloseHandle(view);
+        CloseHandle(file);
+        return -1;
+    }
+    mapped->file = file;
+    mapped->view = view;
+    mapped->data = data;
+    mapped->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (info.st_size > 0) {
+        void *data = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        mapped->data = data;
+        mapped->size = (size_t)info.st_size;
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+#endif
+    return 0;
+}
+
+void mapped_file_close(MappedFile *mapped) {
+    if (mapped->data) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapped->data);
+        CloseHandle(mapped->view);
+        CloseHandle(mapped->file);
+#else
+        munmap(mapped->data, mapped->size);
+#endif
+    }
+    memset(mapped, 0, sizeof(MappedFile));
+}
@@ -0,0 +1,22 @@
+#ifndef DELIVERY_MAPPED_FILE_H
+#define DELIVERY_MAPPED_FILE_H
+
+#include <stddef.h>
+
+// Private copy-on-write view of a whole file: writes through data change the
+// process's copy only, never the file.
+typedef struct {
+    void *data;
+    size_t size;
+#ifdef _WIN32
+    void *file;
+    void *view;
+#endif
+} MappedFile;
+
+// Returns 0 on success, -1 on error (errno is left set). An empty file maps to
+// data == NULL, size == 0.
+int mapped_file_open(MappedFile *mapped, const char *path);
+void mapped_file_close(MappedFile *mapped);
+
+#endif
@@ -0,0 +1,148 @@
+#include "metrics.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+atomic_int metrics_enabled = 1;
+_Atomic uint64_t metrics_counters[METRIC_COUNTER_COUNT];
+MetricTimerCell metrics_timers[METRIC_TIMER_COUNT];
+
+static const char *const counter_names[METRIC_COUNTER_COUNT] = {
+    "searches", "heap_pushes", "nodes_settled", "dp_cells", "dp_rows_reused",
+    "branch_nodes", "knapsack_cache_hits", "two_opt_tried", "two_opt_applied",
+    "or_opt_tried", "or_opt_applied", "window_rejections"
+};
+
+static const char *const counter_help[METRIC_COUNTER_COUNT] = {
+    "Shortest-path searches run.",
+    "Heap inserts and decrease-keys in shortest-path searches.",
+    "Nodes settled by shortest-path searches.",
+    "Knapsack DP cells evaluated.",
+    "Knapsack DP rows reused from the previous solve.",
+    "Knapsack branch-and-bound nodes explored.",
+    "Knapsack solves answered from the cache.",
+    "2-opt moves evaluated.",
+    "2-opt moves applied.",
+    "Or-opt moves evaluated.",
+    "Or-opt moves applied.",
+    "Improving moves refused by delivery time windows."
+};
+
+static const char *const timer_names[METRIC_TIMER_COUNT] = {
+    "matrix", "knapsack", "route", "improve", "cvrp", "repair", "portfolio"
+};
+
+void metrics_record_time(MetricTimer timer, double seconds) {
+    if (!atomic_load_explicit(&metrics_enabled, memory_order_relaxed)) return;
+    MetricTimerCell *cell = &metrics_timers[timer];
+    uint64_t nanoseconds = seconds > 0 ? (uint64_t)(seconds * 1e9) : 0;
+    atomic_fetch_add_explicit(&cell->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&cell->nanoseconds, nanoseconds, memory_order_relaxed);
+    uint64_t longest = atomic_load_explicit(&cell->max_nanoseconds, memory_order_relaxed);
+    while (nanoseconds > longest &&
+           !atomic_compare_exchange_weak_explicit(&cell->max_nanoseconds, &longest, nanoseconds,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void metrics_set_enabled(int enabled) {
+    atomic_store(&metrics_enabled, enabled != 0);
+}
+
+void metrics_reset(void) {
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) atomic_store(&metrics_counters[i], 0);
+    for (int i = 0; i < METRIC_TIMER_COUNT; i++) {
+        atomic_store(&metrics_timers[i].count, 0);
+        atomic_store(&metrics_timers[i].nanoseconds, 0);
+        atomic_store(&metrics_timers[i].max_nanoseconds, 0);
+    }
+}
+
+void metrics_snapshot(MetricsSnapshot *snapshot) {
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        snapshot->counters[i] = atomic_load_explicit(&metrics_counters[i], memory_order_relaxed);
+    }
+    for (int i = 0; i < METRIC_TIMER_COUNT; i++) {
+        MetricTimerCell *cell = &metrics_timers[i];
+        snapshot->timers[i].count = atomic_load_explicit(&cell->count, memory_order_relaxed);
+        snapshot->timers[i].seconds =
+            atomic_load_explicit(&cell->nanoseconds, memory_order_relaxed) * 1e-9;
+        snapshot->timers[i].max_seconds =
+            atomic_load_explicit(&cell->max_nanoseconds, memory_order_relaxed) * 1e-9;
+    }
+}
+
+const char *metric_counter_name(MetricCounter counter) {
+    return counter >= 0 && counter < METRIC_COUNTER_COUNT ? counter_names[counter] : "?";
+}
+
+const char *metric_timer_name(MetricTimer timer) {
+    return timer >= 0 && timer < METRIC_TIMER_COUNT ? timer_names[timer] : "?";
+}
+
+int metrics_write_prometheus(FILE *out, const MetricsSnapshot *snapshot) {
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        fprintf(out, "# HELP delivery_%s_total %s\n", counter_names[i], counter_help[i]);
+        fprintf(out, "# TYPE delivery_%s_total counter\n", counter_names[i]);
+        fprintf(out, "delivery_%s_total %llu\n", counter_names[i],
+                (unsigned long long)snapshot->counters[i]);
+    }
+    fprintf(out, "# HELP delivery_stage_seconds Wall time spent in solver stages.\n"
+                 "# TYPE delivery_stage_seconds summary\n");
+    for (int i = 0; i < METRIC_TIMER_COUNT; i++) {
+        fprintf(out, "delivery_stage_seconds_sum{stage=\"%s\"} %.9f\n", timer_names[i],
+                snapshot->timers[i].seconds);
+        fprintf(out, "delivery_stage_seconds_count{stage=\"%s\"} %llu\n", timer_names[i],
+                (unsigned long long)snapshot->timers[i].count);
+    }
+    fprintf(out, "# HELP delivery_stage_max_seconds Longest single run of each solver stage.\n"
+                 "# TYPE delivery_stage_max_seconds gauge\n");
+    for (int i = 0; i < METRIC_TIMER_COUNT; i++) {
+        fprintf(out, "delivery_stage_max_seconds{stage=\"%s\"} %.9f\n", timer_names[i],
+                snapshot->timers[i].max_seconds);
+    }
+    return ferror(out) ? -1 : 0;
+}
+
+int metrics_write_json(FILE *out, const MetricsSnapshot *snapshot) {
+    fprintf(out, "{\"counters\": {");
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        fprintf(out, "%s\"%s\": %llu", i ? ", " : "", counter_names[i],
+                (unsigned long long)snapshot->counters[i]);
+    }
+    fprintf(out, "},\n \"timers\": {");
+    for (int i = 0; i < METRIC_TIMER_COUNT; i++) {
+        fprintf(out, "%s\"%s\": {\"count\": %llu, \"seconds\": %.9f, \"max_seconds\": %.9f}",
+                i ? ",\n            " : "", timer_names[i],
+                (unsigned long long)snapshot->timers[i].count, snapshot->timers[i].seconds,
+                snapshot->timers[i].max_seconds);
+    }
+    fprintf(out, "}}\n");
+    return ferror(out) ? -1 : 0;
+}
+
+int metrics_save(const char *path) {
+    MetricsSnapshot snapshot;
+    metrics_snapshot(&snapshot);
+    size_t length = strlen(path);
+    int json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+    char *temporary = malloc(length + 5);
+    if (!temporary) return -1;
+    memcpy(temporary, path, length);
+    memcpy(temporary + length, ".tmp", 5);
+
+    FILE *out = fopen(temporary, "w");
+    int status = -1;
+    if (out) {
+        status = json ? metrics_write_json(out, &snapshot) : metrics_write_prometheus(out, &snapshot);
+        if (fclose(out) != 0) status = -1;
+#ifdef _WIN32
+        // rename() does not replace an existing file here
+        if (status == 0) remove(path);
+#endif
+        if (status == 0 && rename(temporary, path) != 0) status = -1;
+        if (status != 0) remove(temporary);
+    }
+    free(temporary);
+    return status;
+}
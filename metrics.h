@@ -0,0 +1,112 @@
+#ifndef DELIVERY_METRICS_H
+#define DELIVERY_METRICS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "solver_clock.h"
+
+// Process-wide solver counters and stage timers. Hot loops count into
+// locals and add once per call, so instrumentation costs a relaxed atomic
+// add or two per solver call, cheap enough to leave on. All functions are
+// safe to call from any thread.
+typedef enum {
+    METRIC_SEARCHES,            // shortest-path searches
+    METRIC_HEAP_PUSHES,         // heap inserts and decrease-keys in those searches
+    METRIC_NODES_SETTLED,
+    METRIC_DP_CELLS,            // knapsack DP cells evaluated
+    METRIC_DP_ROWS_REUSED,      // knapsack DP rows kept from the previous solve
+    METRIC_BRANCH_NODES,        // knapsack branch-and-bound nodes
+    METRIC_KNAPSACK_CACHE_HITS,
+    METRIC_TWO_OPT_TRIED,
+    METRIC_TWO_OPT_APPLIED,
+    METRIC_OR_OPT_TRIED,
+    METRIC_OR_OPT_APPLIED,
+    METRIC_WINDOW_REJECTIONS,   // improving moves refused by time windows
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    METRIC_TIMER_MATRIX,        // distance matrix builds
+    METRIC_TIMER_KNAPSACK,      // knapsack solves (cache hits excluded)
+    METRIC_TIMER_ROUTE,         // calculate_optimal_route()
+    METRIC_TIMER_IMPROVE,       // tour_improve() runs, also inside other stages
+    METRIC_TIMER_CVRP,          // cvrp_solve()
+    METRIC_TIMER_REPAIR,        // route_insert_stop() / route_remove_stop()
+    METRIC_TIMER_PORTFOLIO,     // portfolio_solve()
+    METRIC_TIMER_COUNT
+} MetricTimer;
+
+typedef struct {
+    uint64_t count;
+    double seconds;             // total
+    double max_seconds;         // longest single run
+} MetricTimerValue;
+
+typedef struct {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    MetricTimerValue timers[METRIC_TIMER_COUNT];
+} MetricsSnapshot;
+
+// Live values; use the functions below rather than these
+typedef struct {
+    _Atomic uint64_t count;
+    _Atomic uint64_t nanoseconds;
+    _Atomic uint64_t max_nanoseconds;
+} MetricTimerCell;
+
+extern atomic_int metrics_enabled;
+extern _Atomic uint64_t metrics_counters[METRIC_COUNTER_COUNT];
+extern MetricTimerCell metrics_timers[METRIC_TIMER_COUNT];
+
+static inline void metrics_add(MetricCounter counter, uint64_t amount) {
+    if (atomic_load_explicit(&metrics_enabled, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&metrics_counters[counter], amount, memory_order_relaxed);
+    }
+}
+
+// Adds one run of a stage that the caller timed itself.
+void metrics_record_time(MetricTimer timer, double seconds);
+
+// Scoped timer: MetricScope scope = metrics_begin(T); ... metrics_end(&scope);
+typedef struct {
+    MetricTimer timer;
+    double start;               // < 0 while metrics are off
+} MetricScope;
+
+static inline MetricScope metrics_begin(MetricTimer timer) {
+    MetricScope scope = {timer, -1.0};
+    if (atomic_load_explicit(&metrics_enabled, memory_order_relaxed)) {
+        scope.start = solver_clock_seconds();
+    }
+    return scope;
+}
+
+static inline void metrics_end(const MetricScope *scope) {
+    if (scope->start >= 0) metrics_record_time(scope->timer, solver_clock_seconds() - scope->start);
+}
+
+// On by default.
+void metrics_set_enabled(int enabled);
+void metrics_reset(void);
+void metrics_snapshot(MetricsSnapshot *snapshot);
+
+// Short snake_case names, as used in the exports
+const char *metric_counter_name(MetricCounter counter);
+const char *metric_timer_name(MetricTimer timer);
+
+// Prometheus text exposition format: a delivery_<name>_total counter per
+// counter and a delivery_stage_seconds summary labelled by stage, plus the
+// longest run per stage as a gauge. Returns 0 or -1.
+int metrics_write_prometheus(FILE *out, const MetricsSnapshot *snapshot);
+// {"counters": {name: n, ...}, "timers": {name: {"count", "seconds",
+// "max_seconds"}, ...}}. Returns 0 or -1.
+int metrics_write_json(FILE *out, const MetricsSnapshot *snapshot);
+// Snapshots now and writes it to path, as JSON when path ends in ".json"
+// and as Prometheus text otherwise. The file is replaced whole through a
+// temporary next to it, so a scraper never reads half a snapshot.
+// Returns 0 or -1.
+int metrics_save(const char *path);
+
+#endif
@@ -0,0 +1,89 @@
+#include "min_heap.h"
+
+#include <stdlib.h>
+
+int min_heap_init(MinHeap *heap, int capacity) {
+    heap->entries = malloc((capacity > 0 ? capacity : 1) * sizeof(HeapEntry));
+    heap->position = malloc((capacity > 0 ? capacity : 1) * sizeof(int));
+    heap->size = 0;
+    heap->capacity = capacity;
+    if (!heap->entries || !heap->position) {
+        min_heap_free(heap);
+        return -1;
+    }
+    for (int i = 0; i < capacity; i++) heap->position[i] = -1;
+    return 0;
+}
+
+void min_heap_free(MinHeap *heap) {
+    free(heap->entries);
+    free(heap->position);
+    heap->entries = NULL;
+    heap->position = NULL;
+    heap->size = 0;
+    heap->capacity = 0;
+}
+
+void min_heap_clear(MinHeap *heap) {
+    for (int i = 0; i < heap->size; i++) {
+        heap->position[heap->entries[i].node] = -1;
+    }
+    heap->size = 0;
+}
+
+static void sift_up(MinHeap *heap, int slot) {
+    HeapEntry entry = heap->entries[slot];
+    while (slot > 0) {
+        int parent = (slot - 1) / 2;
+        if (heap->entries[parent].key <= entry.key) break;
+        heap->entries[slot] = heap->entries[parent];
+        heap->position[heap->entries[slot].node] = slot;
+        slot = parent;
+    }
+    heap->entries[slot] = entry;
+    heap->position[entry.node] = slot;
+}
+
+static void sift_down(MinHeap *heap, int slot) {
+    HeapEntry entry = heap->entries[slot];
+    int half = heap->size / 2;
+    while (slot < half) {
+        int child = 2 * slot + 1;
+        if (child + 1 < heap->size && heap->entries[child + 1].key < heap->entries[child].key) {
+            child++;
+        }
+        if (entry.key <= heap->entries[child].key) break;
+        heap->entries[slot] = heap->entries[child];
+        heap->position[heap->entries[slot].node] = slot;
+        slot = child;
+    }
+    heap->entries[slot] = entry;
+    heap->position[entry.node] = slot;
+}
+
+void min_heap_push(MinHeap *heap, int node, double key) {
+    int slot = heap->position[node];
+    if (slot >= 0) {
+        if (key < heap->entries[slot].key) {
+            heap->entries[slot].key = key;
+            sift_up(heap, slot);
+        }
+        return;
+    }
+    slot = heap->size++;
+    heap->entries[slot].key = key;
+    heap->entries[slot].node = node;
+    sift_up(heap, slot);
+}
+
+int min_heap_pop(MinHeap *heap, double *key) {
+    HeapEntry top = heap->entries[0];
+    heap->position[top.node] = -1;
+    heap->size--;
+    if (heap->size > 0) {
+        heap->entries[0] = heap->entries[heap->size];
+        sift_down(heap, 0);
+    }
+    if (key) *key = top.key;
+    return top.node;
+}
@@ -0,0 +1,34 @@
+#ifndef DELIVERY_MIN_HEAP_H
+#define DELIVERY_MIN_HEAP_H
+
+// Indexed binary min-heap over node ids 0..capacity-1 with decrease-key.
+typedef struct {
+    double key;
+    int node;
+} HeapEntry;
+
+typedef struct {
+    HeapEntry *entries;
+    int *position;  // node -> slot in entries, -1 when not queued
+    int size;
+    int capacity;
+} MinHeap;
+
+int min_heap_init(MinHeap *heap, int capacity);
+void min_heap_free(MinHeap *heap);
+// Empties the heap in O(size) so it can be reused for the next search.
+void min_heap_clear(MinHeap *heap);
+// Inserts node, or lowers its key if it is already queued with a larger one.
+void min_heap_push(MinHeap *heap, int node, double key);
+int min_heap_pop(MinHeap *heap, double *key);
+
+static inline int min_heap_empty(const MinHeap *heap) {
+    return heap->size == 0;
+}
+
+// Smallest key; the heap must not be empty.
+static inline double min_heap_top_key(const MinHeap *heap) {
+    return heap->entries[0].key;
+}
+
+#endif
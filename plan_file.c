@@ -0,0 +1,242 @@
+#include "plan_file.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLAN_VERSION 1
+#define PLAN_BYTE_ORDER 0x01020304u
+#define PLAN_ALIGNMENT 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;      // PLAN_BYTE_ORDER as written by the producer
+    int32_t num_vehicles;
+    int32_t num_points;
+    uint64_t num_stops;
+    uint64_t points_hash;
+    double total_distance;
+    double total_emissions;
+    uint64_t stops_offset;
+    uint64_t vehicles_offset;
+} PlanHeader;
+
+static uint64_t align_offset(uint64_t offset) {
+    return (offset + PLAN_ALIGNMENT - 1) / PLAN_ALIGNMENT * PLAN_ALIGNMENT;
+}
+
+// FNV-1a over the point count and coordinates
+static uint64_t points_hash(const DeliveryProblem *problem) {
+    const PointTable *points = &problem->points;
+    uint64_t hash = 14695981039346656037ull;
+    const unsigned char *count = (const unsigned char *)&points->count;
+    for (size_t i = 0; i < sizeof(points->count); i++) hash = (hash ^ count[i]) * 1099511628211ull;
+    for (int p = 0; p < points->count; p++) {
+        double xy[2] = {points->x[p], points->y[p]};
+        const unsigned char *bytes = (const unsigned char *)xy;
+        for (size_t i = 0; i < sizeof(xy); i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Drives one tour and fills its records. drop holds 0 for every point on
+// entry and is left that way.
+static void describe_vehicle(const DeliveryProblem *problem, const DistanceMatrix *matrix,
+                             const TimeWindows *windows, const VehicleRoute *vehicle,
+                             double *drop, PlanStop *stops, PlanVehicle *record) {
+    const PackageTable *packages = &problem->packages;
+    double load = 0;
+    for (int i = 0; i < vehicle->num_packages; i++) {
+        int p = vehicle->packages[i];
+        load += packages->weight[p];
+        drop[packages->destination_id[p]] += packages->weight[p];
+    }
+    record->depot = vehicle->depot;
+    record->num_stops = vehicle->num_stops;
+    record->distance = vehicle->distance;
+    record->emissions = vehicle->emissions;
+    record->load = (float)load;
+
+    double time = vehicle->num_stops > 0 ? windows->open[vehicle->stops[0]] : 0;
+    double distance = 0;
+    for (int i = 0; i < vehicle->num_stops; i++) {
+        int point = vehicle->stops[i];
+        if (i > 0) {
+            int from = vehicle->stops[i - 1];
+            distance += distance_matrix_get(matrix, from, point);
+            time = fmax(time + time_window_travel(windows, matrix, from, point), windows->open[point]);
+        }
+        load -= drop[point];
+        drop[point] = 0;
+        stops[i] = (PlanStop){point, (float)time, (float)(time + windows->service[point]),
+                              (float)load, (float)route_emissions(distance)};
+        time += windows->service[point];
+    }
+    if (vehicle->num_stops > 0) {
+        time += time_window_travel(windows, matrix, vehicle->stops[vehicle->num_stops - 1],
+                                   vehicle->stops[0]);
+    }
+    record->finish = (float)time;
+    // Packages for points off the tour
+    for (int i = 0; i < vehicle->num_packages; i++) drop[packages->destination_id[vehicle->packages[i]]] = 0;
+}
+
+int plan_schedule_build(PlanSchedule *schedule, const DeliveryProblem *problem,
+                        const DeliveryPlan *plan) {
+    memset(schedule, 0, sizeof(PlanSchedule));
+    DistanceMatrix scratch;
+    const DistanceMatrix *matrix = delivery_problem_matrix(problem, &scratch);
+    if (!matrix) return -1;
+    int n = problem->points.count;
+    uint64_t num_stops = 0;
+    for (int v = 0; v < plan->num_vehicles; v++) num_stops += plan->vehicles[v].num_stops;
+    TimeWindows windows = {0};
+    double *drop = calloc(n > 0 ? n : 1, sizeof(double));
+    schedule->vehicles = calloc(plan->num_vehicles > 0 ? plan->num_vehicles : 1, sizeof(PlanVehicle));
+    schedule->stops = malloc((num_stops > 0 ? num_stops : 1) * sizeof(PlanStop));
+    int status = -1;
+    if (drop && schedule->vehicles && schedule->stops &&
+        delivery_problem_time_windows(problem, &windows) == 0) {
+        uint64_t first_stop = 0;
+        for (int v = 0; v < plan->num_vehicles; v++) {
+            describe_vehicle(problem, matrix, &windows, &plan->vehicles[v], drop,
+                             schedule->stops + first_stop, &schedule->vehicles[v]);
+            schedule->vehicles[v].first_stop = first_stop;
+            first_stop += plan->vehicles[v].num_stops;
+        }
+        schedule->num_vehicles = plan->num_vehicles;
+        schedule->num_stops = num_stops;
+        status = 0;
+    }
+    free(drop);
+    time_windows_free(&windows);
+    distance_matrix_free(&scratch);
+    if (status != 0) plan_schedule_free(schedule);
+    return status;
+}
+
+void plan_schedule_free(PlanSchedule *schedule) {
+    free(schedule->vehicles);
+    free(schedule->stops);
+    memset(schedule, 0, sizeof(PlanSchedule));
+}
+
+int write_plan_binary(const char *path, const DeliveryProblem *problem, const DeliveryPlan *plan) {
+    PlanSchedule schedule;
+    if (plan_schedule_build(&schedule, problem, plan) != 0) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        return -1;
+    }
+
+    PlanHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PLAN_FILE_MAGIC, sizeof(header.magic));
+    header.version = PLAN_VERSION;
+    header.byte_order = PLAN_BYTE_ORDER;
+    header.num_vehicles = schedule.num_vehicles;
+    header.num_points = problem->points.count;
+    header.num_stops = schedule.num_stops;
+    header.points_hash = points_hash(problem);
+    header.total_distance = plan->total_distance;
+    header.total_emissions = plan->total_emissions;
+    header.stops_offset = align_offset(sizeof(header));
+    header.vehicles_offset = align_offset(header.stops_offset + schedule.num_stops * sizeof(PlanStop));
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror(path);
+        plan_schedule_free(&schedule);
+        return -1;
+    }
+    static const char padding[PLAN_ALIGNMENT];
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(padding, 1, header.stops_offset - sizeof(header), out);
+    fwrite(schedule.stops, sizeof(PlanStop), schedule.num_stops, out);
+    uint64_t written = header.stops_offset + schedule.num_stops * sizeof(PlanStop);
+    fwrite(padding, 1, header.vehicles_offset - written, out);
+    fwrite(schedule.vehicles, sizeof(PlanVehicle), schedule.num_vehicles, out);
+    int status = ferror(out) ? -1 : 0;
+    if (fclose(out) != 0) status = -1;
+    if (status != 0) fprintf(stderr, "%s: write failed\n", path);
+    plan_schedule_free(&schedule);
+    return status;
+}
+
+int plan_file_open(PlanFile *plan, const char *path) {
+    memset(plan, 0, sizeof(PlanFile));
+    MappedFile mapped;
+    if (mapped_file_open(&mapped, path) != 0) {
+        perror(path);
+        return -1;
+    }
+
+    PlanHeader header;
+    const char *error = NULL;
+    if (mapped.size < sizeof(header)) {
+        error = "not a plan file";
+    } else {
+        memcpy(&header, mapped.data, sizeof(header));
+        if (memcmp(header.magic, PLAN_FILE_MAGIC, sizeof(header.magic)) != 0) {
+            error = "not a plan file";
+        } else if (header.byte_order != PLAN_BYTE_ORDER) {
+            error = "written on a machine with a different byte order";
+        } else if (header.version != PLAN_VERSION) {
+            error = "unsupported plan file version";
+        } else if (header.num_vehicles < 0 || header.num_points < 0 ||
+                   header.num_stops > mapped.size / sizeof(PlanStop) ||
+                   header.stops_offset % 8 != 0 || header.vehicles_offset % 8 != 0 ||
+                   header.stops_offset > mapped.size ||
+                   header.num_stops * sizeof(PlanStop) > mapped.size - header.stops_offset ||
+                   header.vehicles_offset > mapped.size ||
+                   (uint64_t)header.num_vehicles * sizeof(PlanVehicle) >
+                       mapped.size - header.vehicles_offset) {
+            error = "truncated or corrupt file";
+        }
+    }
+
+    const char *base = mapped.data;
+    const PlanVehicle *vehicles = error ? NULL : (const void *)(base + header.vehicles_offset);
+    for (int v = 0; !error && v < header.num_vehicles; v++) {
+        if (vehicles[v].num_stops < 0 || vehicles[v].first_stop > header.num_stops ||
+            (uint64_t)vehicles[v].num_stops > header.num_stops - vehicles[v].first_stop) {
+            error = "corrupt vehicle table";
+        }
+    }
+    if (error) {
+        fprintf(stderr, "%s: %s\n", path, error);
+        mapped_file_close(&mapped);
+        return -1;
+    }
+
+    plan->mapping = mapped;
+    plan->num_vehicles = header.num_vehicles;
+    plan->num_points = header.num_points;
+    plan->num_stops = header.num_stops;
+    plan->points_hash = header.points_hash;
+    plan->total_distance = header.total_distance;
+    plan->total_emissions = header.total_emissions;
+    plan->vehicles = vehicles;
+    plan->stops = (const void *)(base + header.stops_offset);
+    return 0;
+}
+
+void plan_file_close(PlanFile *plan) {
+    if (plan->mapping.data) mapped_file_close(&plan->mapping);
+    memset(plan, 0, sizeof(PlanFile));
+}
+
+int plan_file_matches(const PlanFile *plan, const DeliveryProblem *problem) {
+    return plan->num_points == problem->points.count && plan->points_hash == points_hash(problem);
+}
+
+const PlanStop *plan_file_vehicle_stops(const PlanFile *plan, int vehicle) {
+    const PlanVehicle *record = &plan->vehicles[vehicle];
+    const PlanStop *stops = plan->stops + record->first_stop;
+    if (record->depot < 0 || record->depot >= plan->num_points) return NULL;
+    for (int i = 0; i < record->num_stops; i++) {
+        if (stops[i].point < 0 || stops[i].point >= plan->num_points) return NULL;
+    }
+    return stops;
+}
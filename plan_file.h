@@ -0,0 +1,81 @@
+#ifndef DELIVERY_PLAN_FILE_H
+#define DELIVERY_PLAN_FILE_H
+
+#include <stdint.h>
+
+#include "mapped_file.h"
+#include "solver.h"
+
+// Binary plan: a fixed header, then one PlanStop per stop of every vehicle
+// in vehicle order and one PlanVehicle per vehicle, 64-byte aligned, in
+// native byte order. Times are minutes after the shift starts, driving the
+// plan at free-flow speed through the problem's delivery windows as
+// write_lateness_text() does; loads are kg of VehicleRoute::packages (see
+// knapsack_load_plan() for single-vehicle plans) and emissions are in the
+// units of VehicleRoute::emissions. Points are matrix indices into the instance
+// the plan was solved on, which the header identifies by a hash of the
+// point coordinates.
+#define PLAN_FILE_MAGIC "DLVRYPLN"
+
+typedef struct {
+    int32_t point;
+    float arrival;            // service starts (after any wait for the window)
+    float departure;
+    float load;               // kg still on board when leaving
+    float emissions;          // since leaving the depot
+} PlanStop;
+
+typedef struct {
+    int32_t depot;
+    int32_t num_stops;        // stops[0] is the depot
+    uint64_t first_stop;      // index of stops[0] among all stops
+    double distance;
+    double emissions;
+    float load;               // kg on board leaving the depot
+    float finish;             // back at the depot
+} PlanVehicle;
+
+_Static_assert(sizeof(PlanStop) == 20 && sizeof(PlanVehicle) == 40, "plan records are fixed size");
+
+// Records of a plan built in memory, as write_plan_binary() writes them
+typedef struct {
+    int num_vehicles;
+    uint64_t num_stops;
+    PlanVehicle *vehicles;
+    PlanStop *stops;
+} PlanSchedule;
+
+// Returns 0 or -1 on allocation failure.
+int plan_schedule_build(PlanSchedule *schedule, const DeliveryProblem *problem,
+                        const DeliveryPlan *plan);
+void plan_schedule_free(PlanSchedule *schedule);
+
+// Returns 0 or -1 (reported on stderr).
+int write_plan_binary(const char *path, const DeliveryProblem *problem, const DeliveryPlan *plan);
+
+// Plan file opened for replay. The file is mapped and the records are read
+// in place, so opening costs O(vehicles) whatever the number of stops and
+// pages are only read as the stops are used.
+typedef struct {
+    MappedFile mapping;
+    int num_vehicles;
+    int num_points;           // of the instance it was solved on
+    uint64_t num_stops;
+    uint64_t points_hash;
+    double total_distance;
+    double total_emissions;
+    const PlanVehicle *vehicles;
+    const PlanStop *stops;
+} PlanFile;
+
+// Checks the header and the vehicle table. Returns 0 or -1 (reported on
+// stderr).
+int plan_file_open(PlanFile *plan, const char *path);
+void plan_file_close(PlanFile *plan);
+// Whether the plan was written for the points of problem.
+int plan_file_matches(const PlanFile *plan, const DeliveryProblem *problem);
+// Stops of one vehicle, or NULL when a record or the vehicle's depot names
+// a point outside the instance. O(stops of the vehicle).
+const PlanStop *plan_file_vehicle_stops(const PlanFile *plan, int vehicle);
+
+#endif
@@ -0,0 +1,369 @@
+#include "portfolio.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "metrics.h"
+#include "solver_clock.h"
+#include "spatial_index.h"
+
+#define PORTFOLIO_OPEN_STARTS 1000000 // start count when only the time budget limits the run
+#define RANDOM_CHOICES 3              // nearest points a randomized step picks from
+#define KICK_SPAN 30                  // longest segment a kick moves
+#define KICK_STOPS 500                // one more kick per this many stops
+#define SCORE_EPSILON 1e-6
+
+// A finished start. Published ones stay allocated until the run ends, so a
+// tour read from the shared best is never freed under its reader.
+typedef struct Candidate Candidate;
+struct Candidate {
+    double penalty;
+    double length;
+    int start;
+    PortfolioHeuristic heuristic;
+    int *tour;
+    Candidate *next;          // the worker's published candidates
+};
+
+typedef struct {
+    SpatialIndex index;       // all points, built on first use
+    int indexed;
+    Arena arena;
+    Candidate *spare;         // losing candidate, reused by the next start
+    Candidate *published;
+} PortfolioWorker;
+
+typedef struct {
+    const DeliveryProblem *problem;
+    const DistanceMatrix *matrix;
+    const PortfolioOptions *options;
+    const TimeWindows *windows;   // NULL without time windows
+    const int *unreachable;       // points the depot cannot reach
+    int unreachable_count;
+    int length;                   // stops in every tour, depot included
+    const int *candidates;        // from delivery_route_candidates(), or NULL
+    int workers;
+    PortfolioWorker *worker;
+    double deadline;
+    _Atomic(Candidate *) best;
+    atomic_int starts_run;
+    atomic_int improvements;
+    atomic_int runs[PORTFOLIO_HEURISTIC_COUNT];
+    atomic_int timed_out;
+    atomic_int failed;
+} PortfolioJob;
+
+static unsigned int next_random(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+void portfolio_default_options(PortfolioOptions *options) {
+    options->starts = 0;
+    options->time_budget = 2.0;
+    options->seed = 1;
+    tour_improve_default_options(&options->improve);
+}
+
+const char *portfolio_heuristic_name(PortfolioHeuristic heuristic) {
+    switch (heuristic) {
+    case PORTFOLIO_GREEDY: return "greedy";
+    case PORTFOLIO_RANDOM_GREEDY: return "random_greedy";
+    case PORTFOLIO_KICK: return "kick";
+    default: return "?";
+    }
+}
+
+// Every worker's first start builds a fresh tour; after that two in three
+// starts perturb the best tour, which pays off more than starting over
+static PortfolioHeuristic heuristic_for(int start, int workers) {
+    if (start == 0) return PORTFOLIO_GREEDY;
+    if (start < workers || start % 3 == 0) return PORTFOLIO_RANDOM_GREEDY;
+    return PORTFOLIO_KICK;
+}
+
+static int better(const Candidate *a, const Candidate *b) {
+    if (a->penalty < b->penalty - SCORE_EPSILON) return 1;
+    if (a->penalty > b->penalty + SCORE_EPSILON) return 0;
+    if (a->length < b->length - SCORE_EPSILON) return 1;
+    if (a->length > b->length + SCORE_EPSILON) return 0;
+    return a->start < b->start;
+}
+
+// Swaps candidate in as the shared best unless a better one is there.
+// Returns 1 when it was.
+static int publish(PortfolioJob *job, Candidate *candidate) {
+    Candidate *current = atomic_load_explicit(&job->best, memory_order_acquire);
+    do {
+        if (current && !better(candidate, current)) return 0;
+    } while (!atomic_compare_exchange_weak_explicit(&job->best, &current, candidate,
+                                                    memory_order_acq_rel, memory_order_acquire));
+    atomic_fetch_add_explicit(&job->improvements, 1, memory_order_relaxed);
+    return 1;
+}
+
+// Nearest-neighbour tour from the depot over the reachable points; with
+// random set each step takes the nearest point half of the time and one of
+// the next RANDOM_CHOICES - 1 otherwise
+static int construct(PortfolioJob *job, PortfolioWorker *worker, int random, unsigned int *rng,
+                     int *tour) {
+    const double *x = job->problem->points.x, *y = job->problem->points.y;
+    SpatialIndex *index = &worker->index;
+    if (!worker->indexed) {
+        if (spatial_index_build(index, x, y, job->problem->points.count) != 0) return -1;
+        worker->indexed = 1;
+    } else {
+        spatial_index_restore_all(index);
+    }
+    for (int i = 0; i < job->unreachable_count; i++) spatial_index_remove(index, job->unreachable[i]);
+
+    int current = 0, length = 0;
+    tour[length++] = current;
+    spatial_index_remove(index, current);
+    while (length < job->length) {
+        int next;
+        if (random) {
+            int nearest[RANDOM_CHOICES];
+            int found = spatial_index_knn(index, x[current], y[current], RANDOM_CHOICES, nearest);
+            if (found == 0) break;
+            int pick = next_random(rng) % 2 ? 0 : 1 + (int)(next_random(rng) % (RANDOM_CHOICES - 1));
+            next = nearest[pick < found ? pick : found - 1];
+        } else {
+            next = spatial_index_nearest(index, x[current], y[current], INFINITY);
+            if (next < 0) break;
+        }
+        tour[length++] = next;
+        spatial_index_remove(index, next);
+        current = next;
+    }
+    return 0;
+}
+
+// Double bridges: swap two adjacent short segments, a move 2-opt and
+// Or-opt cannot undo in one step
+static void kick(int *tour, int length, unsigned int *rng) {
+    int span = (length - 1) / 2 < KICK_SPAN ? (length - 1) / 2 : KICK_SPAN;
+    if (span < 1) return;
+    int buffer[KICK_SPAN];
+    int kicks = 1 + length / KICK_STOPS;
+    for (int k = 0; k < kicks; k++) {
+        int a = 1 + (int)(next_random(rng) % span);
+        int b = 1 + (int)(next_random(rng) % span);
+        int first = 1 + (int)(next_random(rng) % (length - a - b));
+        memcpy(buffer, tour + first, a * sizeof(int));
+        memmove(tour + first, tour + first + a, b * sizeof(int));
+        memcpy(tour + first + b, buffer, a * sizeof(int));
+    }
+}
+
+// Constructed tours go through delivery_route_improve() as in
+// calculate_optimal_route(); a kicked tour is already repaired, so it is
+// only improved within the windows
+static int improve(PortfolioJob *job, PortfolioWorker *worker, int *tour, int start,
+                   PortfolioHeuristic heuristic, double now) {
+    TourImproveOptions options = job->options->improve;
+    options.windows = heuristic == PORTFOLIO_KICK ? job->windows : NULL;
+    options.progress = NULL;
+    options.arena = &worker->arena;
+    // Start 0 keeps the whole budget, so it ends on calculate_optimal_route()'s
+    // tour and the best is never worse than that
+    double remaining = job->deadline - now;
+    if (start > 0 && (options.time_budget <= 0 || options.time_budget > remaining)) {
+        options.time_budget = remaining > 0 ? remaining : 1e-3;
+    }
+    return delivery_route_improve(job->problem, job->matrix,
+                                  heuristic == PORTFOLIO_KICK ? NULL : job->windows, tour,
+                                  job->length, job->candidates, &options, NULL);
+}
+
+static void run_start(void *context, int index, int worker_index) {
+    PortfolioJob *job = context;
+    if (atomic_load_explicit(&job->failed, memory_order_relaxed)) return;
+    // Start 0 always runs, so there is a tour however short the budget
+    double now = solver_clock_seconds();
+    if (index > 0 && now >= job->deadline) {
+        atomic_store_explicit(&job->timed_out, 1, memory_order_relaxed);
+        return;
+    }
+
+    PortfolioWorker *worker = &job->worker[worker_index];
+    Candidate *candidate = worker->spare;
+    if (!candidate) {
+        candidate = calloc(1, sizeof(Candidate));
+        if (candidate) candidate->tour = malloc(job->length * sizeof(int));
+        if (!candidate || !candidate->tour) {
+            free(candidate);
+            atomic_store(&job->failed, 1);
+            return;
+        }
+    }
+    worker->spare = NULL;
+
+    unsigned int rng = (job->options->seed + 1) * 2654435761u ^ (unsigned int)(index + 1) * 2246822519u;
+    if (rng == 0) rng = 1;
+    PortfolioHeuristic heuristic = heuristic_for(index, job->workers);
+    Candidate *best = atomic_load_explicit(&job->best, memory_order_acquire);
+    if (heuristic == PORTFOLIO_KICK && !best) heuristic = PORTFOLIO_RANDOM_GREEDY;
+
+    ArenaMark mark = arena_mark(&worker->arena);
+    int status = 0;
+    if (heuristic == PORTFOLIO_KICK) {
+        memcpy(candidate->tour, best->tour, job->length * sizeof(int));
+        kick(candidate->tour, job->length, &rng);
+    } else {
+        status = construct(job, worker, heuristic == PORTFOLIO_RANDOM_GREEDY, &rng,
+                           candidate->tour);
+    }
+    if (status == 0) status = improve(job, worker, candidate->tour, index, heuristic, now);
+    arena_release(&worker->arena, mark);
+    if (status != 0) {
+        worker->spare = candidate;
+        atomic_store(&job->failed, 1);
+        return;
+    }
+
+    candidate->start = index;
+    candidate->heuristic = heuristic;
+    candidate->length = distance_matrix_tour_length(job->matrix, candidate->tour, job->length);
+    candidate->penalty = 0;
+    if (job->windows) {
+        TimeWindowReport report;
+        time_window_report(job->windows, job->matrix, candidate->tour, job->length, &report);
+        candidate->penalty = report.penalty;
+    }
+    atomic_fetch_add_explicit(&job->starts_run, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&job->runs[heuristic], 1, memory_order_relaxed);
+    if (publish(job, candidate)) {
+        candidate->next = worker->published;
+        worker->published = candidate;
+    } else {
+        worker->spare = candidate;
+    }
+}
+
+static void free_candidate(Candidate *candidate) {
+    if (!candidate) return;
+    free(candidate->tour);
+    free(candidate);
+}
+
+int portfolio_solve(const DeliveryProblem *problem, const PortfolioOptions *options,
+                    ThreadPool *pool, DeliveryPlan *plan, PortfolioStats *stats) {
+    PortfolioOptions defaults;
+    PortfolioStats local_stats;
+    if (!options) {
+        portfolio_default_options(&defaults);
+        options = &defaults;
+    }
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(PortfolioStats));
+    delivery_plan_clear(plan);
+
+    int n = problem->points.count;
+    if (n == 0) return 0;
+    double start = solver_clock_seconds();
+    DistanceMatrix local_matrix;
+    const DistanceMatrix *matrix = delivery_problem_matrix(problem, &local_matrix);
+    if (!matrix) return -1;
+
+    MetricScope scope = metrics_begin(METRIC_TIMER_PORTFOLIO);
+    PortfolioJob job = {0};
+    job.problem = problem;
+    job.matrix = matrix;
+    job.options = options;
+    job.workers = thread_pool_size(pool);
+    job.deadline = options->time_budget > 0 ? start + options->time_budget : INFINITY;
+    TimeWindows windows = {0};
+    int *unreachable = malloc(n * sizeof(int));
+    int *reachable = malloc(n * sizeof(int));
+    PortfolioWorker *worker = calloc(job.workers, sizeof(PortfolioWorker));
+    int *candidates = NULL;
+    int status = -1;
+    if (!unreachable || !reachable || !worker) goto done;
+    for (int w = 0; w < job.workers; w++) arena_init(&worker[w].arena, 0);
+    job.unreachable = unreachable;
+    job.worker = worker;
+
+    // As in calculate_optimal_route(), points the depot cannot reach are
+    // left out of every tour
+    const float *depot_row = distance_matrix_row(matrix, 0);
+    for (int i = 0; i < n; i++) {
+        if (!isfinite(depot_row[i])) {
+            unreachable[job.unreachable_count++] = i;
+        } else {
+            reachable[job.length++] = i;
+        }
+    }
+    if (delivery_problem_has_time_windows(problem)) {
+        if (delivery_problem_time_windows(problem, &windows) != 0) goto done;
+        job.windows = &windows;
+    }
+    // One candidate table for every start, whatever order its tour has
+    int count = delivery_route_candidate_count(&options->improve, job.length);
+    if (count > 0) {
+        candidates = malloc((size_t)n * count * sizeof(int));
+        if (!candidates ||
+            delivery_route_candidates(problem, reachable, job.length, count, candidates) != 0) {
+            goto done;
+        }
+        job.candidates = candidates;
+    }
+
+    int starts = options->starts > 0 ? options->starts
+               : options->time_budget > 0 ? PORTFOLIO_OPEN_STARTS : job.workers;
+    thread_pool_parallel_for(pool, starts, run_start, &job);
+    Candidate *best = atomic_load(&job.best);
+    if (atomic_load(&job.failed) || !best) goto done;
+
+    VehicleRoute *vehicle = delivery_plan_add_vehicle(plan, 0);
+    int *tour = vehicle ? malloc(job.length * sizeof(int)) : NULL;
+    if (!tour) {
+        delivery_plan_clear(plan);
+        goto done;
+    }
+    memcpy(tour, best->tour, job.length * sizeof(int));
+    vehicle->stops = tour;
+    vehicle->num_stops = job.length;
+    delivery_plan_update_totals(plan, matrix);
+
+    stats->workers = job.workers;
+    stats->starts_run = atomic_load(&job.starts_run);
+    stats->improvements = atomic_load(&job.improvements);
+    stats->best_start = best->start;
+    stats->best_heuristic = best->heuristic;
+    for (int h = 0; h < PORTFOLIO_HEURISTIC_COUNT; h++) stats->runs[h] = atomic_load(&job.runs[h]);
+    stats->best_length = best->length;
+    stats->best_penalty = best->penalty;
+    stats->timed_out = atomic_load(&job.timed_out);
+    status = 0;
+
+done:
+    if (worker) {
+        for (int w = 0; w < job.workers; w++) {
+            free_candidate(worker[w].spare);
+            while (worker[w].published) {
+                Candidate *next = worker[w].published->next;
+                free_candidate(worker[w].published);
+                worker[w].published = next;
+            }
+            if (worker[w].indexed) spatial_index_free(&worker[w].index);
+            arena_free(&worker[w].arena);
+        }
+    }
+    free(worker);
+    free(unreachable);
+    free(reachable);
+    free(candidates);
+    time_windows_free(&windows);
+    distance_matrix_free(&local_matrix);
+    stats->elapsed = solver_clock_seconds() - start;
+    metrics_end(&scope);
+    return status;
+}
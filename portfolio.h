@@ -0,0 +1,57 @@
+#ifndef DELIVERY_PORTFOLIO_H
+#define DELIVERY_PORTFOLIO_H
+
+#include "solver.h"
+#include "thread_pool.h"
+#include "tour_improve.h"
+
+typedef enum {
+    PORTFOLIO_GREEDY,         // nearest neighbour from the depot, as calculate_optimal_route()
+    PORTFOLIO_RANDOM_GREEDY,  // nearest neighbour, sometimes taking the second or third nearest
+    PORTFOLIO_KICK,           // best tour so far with a few segment swaps (double bridges)
+    PORTFOLIO_HEURISTIC_COUNT
+} PortfolioHeuristic;
+
+typedef struct {
+    int starts;               // constructions to run, <= 0 = as many as the time budget allows
+    double time_budget;       // wall-clock seconds for the whole run, <= 0 = no limit
+    unsigned int seed;
+    TourImproveOptions improve; // local search after every construction; its time
+                                // budget is cut to what is left of the run's,
+                                // except for start 0
+} PortfolioOptions;
+
+typedef struct {
+    int workers;
+    int starts_run;
+    int improvements;         // times a start replaced the shared best tour
+    int best_start;
+    PortfolioHeuristic best_heuristic;
+    int runs[PORTFOLIO_HEURISTIC_COUNT];  // starts run per heuristic
+    double best_length;
+    double best_penalty;      // weighted late minutes, 0 without time windows
+    double elapsed;
+    int timed_out;            // the budget ended the run before all starts ran
+} PortfolioStats;
+
+void portfolio_default_options(PortfolioOptions *options);
+const char *portfolio_heuristic_name(PortfolioHeuristic heuristic);
+
+// Single-vehicle plan like calculate_optimal_route(), from many starts at
+// once: every start builds a tour with its heuristic (start 0 is the plain
+// greedy tour, the others use a per-start random stream from seed), improves
+// it with delivery_route_improve() and offers it as the shared best. Start
+// 0 runs with the whole of options->improve's budget, so it reproduces
+// calculate_optimal_route() and the result is never worse than that. The
+// best is a pointer swapped in with compare-and-swap, so starts never wait
+// on each other; kick starts read it to perturb. Starts are handed to idle pool
+// workers one at a time until they or the time budget run out; start 0
+// always runs. Tours compare by lateness penalty under the problem's time
+// windows, then length, then start number. Which tour a kick perturbs
+// depends on thread timing, so runs with kicks are not reproducible.
+// options->improve.progress is not called. stats may be NULL.
+// Returns 0 on success, -1 on allocation failure.
+int portfolio_solve(const DeliveryProblem *problem, const PortfolioOptions *options,
+                    ThreadPool *pool, DeliveryPlan *plan, PortfolioStats *stats);
+
+#endif
@@ -0,0 +1,51 @@
+#include "process_memory.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+size_t process_memory_peak(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+#ifdef __linux__
+    // VmHWM follows resets through clear_refs, ru_maxrss does not
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status) {
+        char line[128];
+        unsigned long kilobytes = 0;
+        while (fgets(line, sizeof(line), status)) {
+            if (sscanf(line, "VmHWM: %lu kB", &kilobytes) == 1) break;
+        }
+        fclose(status);
+        if (kilobytes > 0) return (size_t)kilobytes * 1024;
+    }
+#endif
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+int process_memory_reset_peak(void) {
+#ifdef __linux__
+    FILE *refs = fopen("/proc/self/clear_refs", "w");
+    if (!refs) return -1;
+    int written = fputs("5", refs) >= 0;
+    return fclose(refs) == 0 && written ? 0 : -1;
+#else
+    return -1;
+#endif
+}
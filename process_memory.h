@@ -0,0 +1,15 @@
+#ifndef DELIVERY_PROCESS_MEMORY_H
+#define DELIVERY_PROCESS_MEMORY_H
+
+#include <stddef.h>
+
+// Peak resident set size of this process in bytes since it started or since
+// the last successful process_memory_reset_peak(); 0 when unknown.
+size_t process_memory_peak(void);
+
+// Starts a new peak from the current resident size, so one process can
+// measure stages one after another. Linux only; elsewhere the peak keeps
+// covering the whole run. Returns 0 or -1.
+int process_memory_reset_peak(void);
+
+#endif
@@ -0,0 +1,227 @@
+#include "road_graph.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+
+int road_graph_build(RoadGraph *graph, int num_nodes, const RoadEdge *edges, int num_edges,
+                     int bidirectional) {
+    memset(graph, 0, sizeof(RoadGraph));
+    if (num_nodes < 0 || num_edges < 0) return -1;
+
+    int num_arcs = bidirectional ? 2 * num_edges : num_edges;
+    graph->num_nodes = num_nodes;
+    graph->num_arcs = num_arcs;
+    graph->offsets = calloc(num_nodes + 1, sizeof(int));
+    graph->targets = malloc((num_arcs > 0 ? num_arcs : 1) * sizeof(int));
+    graph->weights = malloc((num_arcs > 0 ? num_arcs : 1) * sizeof(double));
+    graph->edges = malloc((num_arcs > 0 ? num_arcs : 1) * sizeof(int));
+    if (!graph->offsets || !graph->targets || !graph->weights || !graph->edges) {
+        road_graph_free(graph);
+        return -1;
+    }
+
+    // Counting sort of the arcs by source node
+    for (int i = 0; i < num_edges; i++) {
+        const RoadEdge *edge = &edges[i];
+        if (edge->from < 0 || edge->from >= num_nodes || edge->to < 0 || edge->to >= num_nodes ||
+            !(edge->weight >= 0)) {
+            road_graph_free(graph);
+            return -1;
+        }
+        graph->offsets[edge->from + 1]++;
+        if (bidirectional) graph->offsets[edge->to + 1]++;
+    }
+    for (int u = 0; u < num_nodes; u++) {
+        graph->offsets[u + 1] += graph->offsets[u];
+    }
+
+    int *fill = malloc((num_nodes > 0 ? num_nodes : 1) * sizeof(int));
+    if (!fill) {
+        road_graph_free(graph);
+        return -1;
+    }
+    memcpy(fill, graph->offsets, num_nodes * sizeof(int));
+    for (int i = 0; i < num_edges; i++) {
+        const RoadEdge *edge = &edges[i];
+        int slot = fill[edge->from]++;
+        graph->targets[slot] = edge->to;
+        graph->weights[slot] = edge->weight;
+        graph->edges[slot] = i;
+        if (bidirectional) {
+            slot = fill[edge->to]++;
+            graph->targets[slot] = edge->from;
+            graph->weights[slot] = edge->weight;
+            graph->edges[slot] = i;
+        }
+    }
+    free(fill);
+    return 0;
+}
+
+void road_graph_free(RoadGraph *graph) {
+    free(graph->offsets);
+    free(graph->targets);
+    free(graph->weights);
+    free(graph->edges);
+    memset(graph, 0, sizeof(RoadGraph));
+}
+
+// FNV-1a over raw bytes
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t road_graph_hash(const RoadGraph *graph) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = hash_bytes(hash, &graph->num_nodes, sizeof(int));
+    hash = hash_bytes(hash, &graph->num_arcs, sizeof(int));
+    hash = hash_bytes(hash, graph->offsets, (graph->num_nodes + 1) * sizeof(int));
+    hash = hash_bytes(hash, graph->targets, graph->num_arcs * sizeof(int));
+    return hash_bytes(hash, graph->weights, graph->num_arcs * sizeof(double));
+}
+
+int road_graph_dijkstra(const RoadGraph *graph, int src, int target, double *dist, int *parent,
+                        MinHeap *heap) {
+    if (src < 0 || src >= graph->num_nodes || target < -1 || target >= graph->num_nodes) return -1;
+    MinHeap local_heap;
+    if (!heap) {
+        if (min_heap_init(&local_heap, graph->num_nodes) != 0) return -1;
+        heap = &local_heap;
+    } else {
+        min_heap_clear(heap);
+    }
+
+    for (int i = 0; i < graph->num_nodes; i++) {
+        dist[i] = INFINITY;
+    }
+    if (parent) {
+        for (int i = 0; i < graph->num_nodes; i++) parent[i] = -1;
+    }
+
+    dist[src] = 0;
+    min_heap_push(heap, src, 0);
+    uint64_t pushes = 1, settled = 0;
+
+    while (!min_heap_empty(heap)) {
+        double d;
+        int u = min_heap_pop(heap, &d);
+        settled++;
+        if (u == target) break;
+
+        for (int arc = graph->offsets[u]; arc < graph->offsets[u + 1]; arc++) {
+            int v = graph->targets[arc];
+            double candidate = d + graph->weights[arc];
+            if (candidate < dist[v]) {
+                dist[v] = candidate;
+                if (parent) parent[v] = u;
+                min_heap_push(heap, v, candidate);
+                pushes++;
+            }
+        }
+    }
+    metrics_add(METRIC_SEARCHES, 1);
+    metrics_add(METRIC_HEAP_PUSHES, pushes);
+    metrics_add(METRIC_NODES_SETTLED, settled);
+
+    if (heap == &local_heap) {
+        min_heap_free(&local_heap);
+    } else {
+        min_heap_clear(heap);
+    }
+    return 0;
+}
+
+int road_search_workspace_init(RoadSearchWorkspace *workspace, int num_nodes) {
+    memset(workspace, 0, sizeof(RoadSearchWorkspace));
+    int count = num_nodes > 0 ? num_nodes : 1;
+    workspace->dist = malloc(count * sizeof(double));
+    workspace->reached = calloc(count, sizeof(unsigned int));
+    workspace->target = calloc(count, sizeof(unsigned int));
+    workspace->num_nodes = num_nodes;
+    if (!workspace->dist || !workspace->reached || !workspace->target ||
+        min_heap_init(&workspace->heap, num_nodes) != 0) {
+        road_search_workspace_free(workspace);
+        return -1;
+    }
+    return 0;
+}
+
+void road_search_workspace_free(RoadSearchWorkspace *workspace) {
+    min_heap_free(&workspace->heap);
+    free(workspace->dist);
+    free(workspace->reached);
+    free(workspace->target);
+    memset(workspace, 0, sizeof(RoadSearchWorkspace));
+}
+
+static unsigned int next_query(RoadSearchWorkspace *workspace) {
+    if (++workspace->query == 0) {
+        // Stamp wrapped around: old labels could look current again
+        memset(workspace->reached, 0, workspace->num_nodes * sizeof(unsigned int));
+        memset(workspace->target, 0, workspace->num_nodes * sizeof(unsigned int));
+        workspace->query = 1;
+    }
+    return workspace->query;
+}
+
+int road_graph_one_to_many(const RoadGraph *graph, int src, const int *targets, int num_targets,
+                           float *out, RoadSearchWorkspace *workspace) {
+    if (src < 0 || src >= graph->num_nodes || workspace->num_nodes < graph->num_nodes) return -1;
+
+    unsigned int query = next_query(workspace);
+    double *dist = workspace->dist;
+    unsigned int *reached = workspace->reached;
+    MinHeap *heap = &workspace->heap;
+
+    int pending = 0;
+    for (int i = 0; i < num_targets; i++) {
+        int t = targets[i];
+        if (t < 0 || t >= graph->num_nodes) return -1;
+        if (workspace->target[t] != query) {
+            workspace->target[t] = query;
+            pending++;
+        }
+    }
+
+    min_heap_clear(heap);
+    dist[src] = 0;
+    reached[src] = query;
+    min_heap_push(heap, src, 0);
+    uint64_t pushes = 1, settled = 0;
+
+    while (pending > 0 && !min_heap_empty(heap)) {
+        double d;
+        int u = min_heap_pop(heap, &d);
+        settled++;
+        if (workspace->target[u] == query) pending--;
+
+        for (int arc = graph->offsets[u]; arc < graph->offsets[u + 1]; arc++) {
+            int v = graph->targets[arc];
+            double candidate = d + graph->weights[arc];
+            if (reached[v] != query || candidate < dist[v]) {
+                reached[v] = query;
+                dist[v] = candidate;
+                min_heap_push(heap, v, candidate);
+                pushes++;
+            }
+        }
+    }
+    min_heap_clear(heap);
+    metrics_add(METRIC_SEARCHES, 1);
+    metrics_add(METRIC_HEAP_PUSHES, pushes);
+    metrics_add(METRIC_NODES_SETTLED, settled);
+
+    for (int i = 0; i < num_targets; i++) {
+        int t = targets[i];
+        out[i] = reached[t] == query ? (float)dist[t] : INFINITY;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef DELIVERY_ROAD_GRAPH_H
+#define DELIVERY_ROAD_GRAPH_H
+
+#include <stdint.h>
+
+#include "min_heap.h"
+
+typedef struct {
+    int from, to;
+    double weight;
+} RoadEdge;
+
+// Road network in compressed sparse row form. The arcs leaving node u are
+// targets/weights[offsets[u] .. offsets[u + 1] - 1].
+typedef struct {
+    int num_nodes;
+    int num_arcs;
+    int *offsets;
+    int *targets;
+    double *weights;
+    int *edges;      // input edge each arc was built from
+} RoadGraph;
+
+// Builds the graph from an edge list. With bidirectional set every edge is
+// also added in the reverse direction. Returns 0 on success, -1 on bad input
+// or allocation failure.
+int road_graph_build(RoadGraph *graph, int num_nodes, const RoadEdge *edges, int num_edges,
+                     int bidirectional);
+void road_graph_free(RoadGraph *graph);
+// Fingerprint of the nodes, arcs and weights, e.g. to tell whether data
+// preprocessed from a graph still belongs to it.
+uint64_t road_graph_hash(const RoadGraph *graph);
+
+// Single-source shortest paths with a binary heap, O(E log V). Unreachable
+// nodes get dist = INFINITY and parent = -1; parent may be NULL. If target is
+// not -1 the search stops once target is settled. heap must have capacity for
+// num_nodes; pass NULL to let the function allocate a temporary one.
+// Returns 0 on success, -1 when src or target is outside [0, num_nodes) or
+// on allocation failure.
+int road_graph_dijkstra(const RoadGraph *graph, int src, int target, double *dist, int *parent,
+                        MinHeap *heap);
+
+// Per-thread scratch for repeated searches. Labels are versioned with a
+// query stamp, so a search only touches the nodes it reaches instead of
+// clearing O(V) arrays first.
+typedef struct {
+    MinHeap heap;
+    double *dist;
+    unsigned int *reached;  // dist[v] is valid when reached[v] == query
+    unsigned int *target;   // v is a pending target when target[v] == query
+    unsigned int query;
+    int num_nodes;
+} RoadSearchWorkspace;
+
+int road_search_workspace_init(RoadSearchWorkspace *workspace, int num_nodes);
+void road_search_workspace_free(RoadSearchWorkspace *workspace);
+
+// Shortest distances from src to each node in targets, written to out as
+// floats (INFINITY when unreachable). The search stops as soon as every
+// target is settled. Returns 0 on success, -1 on bad input.
+int road_graph_one_to_many(const RoadGraph *graph, int src, const int *targets, int num_targets,
+                           float *out, RoadSearchWorkspace *workspace);
+
+#endif
@@ -0,0 +1,167 @@
+#include "route_repair.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "solver_clock.h"
+
+#define GAIN_EPSILON 1e-6
+// 2-opt moves per repair; each one costs a scan of the whole tour
+#define REPAIR_MAX_MOVES 32
+
+static void reverse_stops(int *tour, int from, int to) {
+    while (from < to) {
+        int swap = tour[from];
+        tour[from++] = tour[to];
+        tour[to--] = swap;
+    }
+}
+
+// 2-opt seeded with the edges at the given positions (edge p joins tour[p]
+// and the stop after it). The best exchange with any other edge is made and
+// the two edges it creates are tried next. tour[0] never moves. With
+// windows, schedule describes tour and exchanges must pass its check.
+static void repair_two_opt(const DistanceMatrix *matrix, const TimeWindows *windows,
+                           TourSchedule *schedule, int *tour, int n, int *pending, int count,
+                           RouteRepairStats *stats) {
+    int moves = 0;
+    uint64_t tried = 0;
+    while (count > 0 && moves < REPAIR_MAX_MOVES) {
+        int i = pending[--count];
+        int a = tour[i], b = tour[(i + 1) % n];
+        double ab = distance_matrix_get(matrix, a, b);
+        int best = -1;
+        double best_gain = GAIN_EPSILON;
+        for (int j = 0; j < n; j++) {
+            // Edges sharing a stop with edge i cannot be exchanged with it
+            if (j == i || j == (i + 1) % n || (j + 1) % n == i) continue;
+            int c = tour[j], d = tour[(j + 1) % n];
+            double gain = ab + distance_matrix_get(matrix, c, d) - distance_matrix_get(matrix, a, c) -
+                          distance_matrix_get(matrix, b, d);
+            tried++;
+            if (gain <= best_gain) continue;
+            if (windows && !tour_schedule_reverse_ok(schedule, windows, matrix,
+                                                     (i < j ? i : j) + 1, i < j ? j : i)) {
+                continue;
+            }
+            best_gain = gain;
+            best = j;
+        }
+        if (best < 0) continue;
+        int lo = i < best ? i : best, hi = i < best ? best : i;
+        reverse_stops(tour, lo + 1, hi);
+        if (windows) tour_schedule_update(schedule, windows, matrix, tour, n);
+        pending[count++] = lo;
+        pending[count++] = hi;
+        moves++;
+    }
+    stats->two_opt_moves = moves;
+    metrics_add(METRIC_TWO_OPT_TRIED, tried);
+    metrics_add(METRIC_TWO_OPT_APPLIED, moves);
+}
+
+static void finish_repair(const DistanceMatrix *matrix, VehicleRoute *vehicle,
+                          RouteRepairStats *stats, double start) {
+    vehicle->distance = distance_matrix_tour_length(matrix, vehicle->stops, vehicle->num_stops);
+    vehicle->emissions = route_emissions(vehicle->distance);
+    stats->elapsed = solver_clock_seconds() - start;
+    metrics_record_time(METRIC_TIMER_REPAIR, stats->elapsed);
+}
+
+int route_insert_stop(const DistanceMatrix *matrix, const TimeWindows *windows,
+                      VehicleRoute *vehicle, int stop, RouteRepairStats *stats) {
+    double start = solver_clock_seconds();
+    RouteRepairStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(RouteRepairStats));
+    stats->position = -1;
+    int n = vehicle->num_stops;
+    if (n == 0 || stop < 0 || stop >= matrix->size) return 1;
+    for (int i = 0; i < n; i++) {
+        if (vehicle->stops[i] == stop) return 1;
+    }
+
+    // Sized for the tour after insertion, so no later update can fail
+    TourSchedule schedule = {0};
+    if (windows && tour_schedule_reserve(&schedule, n + 1) != 0) return -1;
+    if (windows) tour_schedule_update(&schedule, windows, matrix, vehicle->stops, n);
+
+    int best = -1;
+    double best_added = INFINITY, best_late = INFINITY;
+    for (int p = 0; p < n; p++) {
+        int a = vehicle->stops[p], b = vehicle->stops[(p + 1) % n];
+        double added = distance_matrix_get(matrix, a, stop) + distance_matrix_get(matrix, stop, b) -
+                       distance_matrix_get(matrix, a, b);
+        // On time first, then least late, then shortest
+        double late = windows ? tour_schedule_insert_lateness(&schedule, windows, matrix, p, stop) : 0;
+        if (late < best_late || (late == best_late && added < best_added)) {
+            best_late = late;
+            best_added = added;
+            best = p;
+        }
+    }
+    if (windows && !isfinite(best_late)) {
+        // Every position makes someone else late; go last
+        best = n - 1;
+        int a = vehicle->stops[n - 1], b = vehicle->stops[0];
+        best_added = distance_matrix_get(matrix, a, stop) + distance_matrix_get(matrix, stop, b) -
+                     distance_matrix_get(matrix, a, b);
+    }
+    if (best < 0 || !isfinite(best_added)) {
+        tour_schedule_free(&schedule);
+        return 1;
+    }
+    int *stops = realloc(vehicle->stops, (n + 1) * sizeof(int));
+    if (!stops) {
+        tour_schedule_free(&schedule);
+        return -1;
+    }
+    memmove(stops + best + 2, stops + best + 1, (n - best - 1) * sizeof(int));
+    stops[best + 1] = stop;
+    vehicle->stops = stops;
+    vehicle->num_stops = n + 1;
+    stats->position = best + 1;
+    stats->change = best_added;
+    stats->late = windows && best_late > 0;
+
+    int pending[REPAIR_MAX_MOVES + 2] = {best, best + 1};
+    if (windows) tour_schedule_update(&schedule, windows, matrix, stops, n + 1);
+    repair_two_opt(matrix, windows, &schedule, stops, n + 1, pending, 2, stats);
+    tour_schedule_free(&schedule);
+    finish_repair(matrix, vehicle, stats, start);
+    return 0;
+}
+
+int route_remove_stop(const DistanceMatrix *matrix, const TimeWindows *windows,
+                      VehicleRoute *vehicle, int stop, RouteRepairStats *stats) {
+    double start = solver_clock_seconds();
+    RouteRepairStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(RouteRepairStats));
+    stats->position = -1;
+    int n = vehicle->num_stops;
+    int p = 1;
+    while (p < n && vehicle->stops[p] != stop) p++;
+    if (p >= n) return 1;
+
+    TourSchedule schedule = {0};
+    if (windows && tour_schedule_reserve(&schedule, n - 1) != 0) return -1;
+
+    int *stops = vehicle->stops;
+    int before = stops[p - 1], after = stops[(p + 1) % n];
+    stats->position = p;
+    stats->change = distance_matrix_get(matrix, before, after) -
+                    distance_matrix_get(matrix, before, stop) - distance_matrix_get(matrix, stop, after);
+    memmove(stops + p, stops + p + 1, (n - p - 1) * sizeof(int));
+    vehicle->num_stops = n - 1;
+
+    // Taking a stop out only lets the later ones arrive earlier
+    if (windows) tour_schedule_update(&schedule, windows, matrix, stops, n - 1);
+    int pending[REPAIR_MAX_MOVES + 2] = {p - 1};
+    repair_two_opt(matrix, windows, &schedule, stops, n - 1, pending, 1, stats);
+    tour_schedule_free(&schedule);
+    finish_repair(matrix, vehicle, stats, start);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef DELIVERY_ROUTE_REPAIR_H
+#define DELIVERY_ROUTE_REPAIR_H
+
+#include "solver.h"
+
+typedef struct {
+    int position;        // where the stop went in or came out
+    double change;       // tour length change of the insertion or removal alone
+    int two_opt_moves;
+    int late;            // inserted where it, or with no choice someone else, misses a window
+    double elapsed;
+} RouteRepairStats;
+
+// Puts stop into the vehicle's closed tour between the two consecutive
+// stops where it adds the least distance, then runs 2-opt on the new
+// edges: each is tried against every other edge of the tour and improving
+// moves queue their own new edges, up to a fixed number of moves. About
+// O(num_stops) per edge tried, so a single order is repaired in well under
+// a full tour_improve(). Distances are assumed symmetric.
+//
+// With windows (NULL = untimed) the tour is driven from stops[0] and the
+// insertion goes where it keeps every stop on time, judged in O(1) per
+// position from a TourSchedule, then where only the new stop is late, else
+// last; 2-opt moves must not make any stop later than its window.
+//
+// Updates vehicle->distance and emissions (not the plan totals). stats may
+// be NULL. Returns 0, 1 when the stop is already on the tour or cannot be
+// reached, or -1 on allocation failure.
+int route_insert_stop(const DistanceMatrix *matrix, const TimeWindows *windows,
+                      VehicleRoute *vehicle, int stop, RouteRepairStats *stats);
+
+// Takes stop off the tour, joins its neighbours and repairs the new edge
+// the same way. Returns 0, 1 when stop is the depot or not on the tour, or
+// -1 on allocation failure (tour unchanged).
+int route_remove_stop(const DistanceMatrix *matrix, const TimeWindows *windows,
+                      VehicleRoute *vehicle, int stop, RouteRepairStats *stats);
+
+#endif
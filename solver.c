@@ -0,0 +1,892 @@
+#include "solver.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "spatial_index.h"
+
+// Small xorshift generator so sample data does not depend on the global rand() state
+static unsigned int next_random(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+DeliveryProblem *delivery_problem_new(void) {
+    return calloc(1, sizeof(DeliveryProblem));
+}
+
+void delivery_problem_packages_changed(DeliveryProblem *problem) {
+    // Versions come from one global counter so that a new problem reusing a
+    // freed one's address can never look unchanged to a cache
+    static atomic_uint next_version = 1;
+    problem->packages_version = atomic_fetch_add(&next_version, 1);
+}
+
+static int in_mapping(const DeliveryProblem *problem, const void *column) {
+    const char *start = problem->mapping.data;
+    return start && (const char *)column >= start && (const char *)column < start + problem->mapping.size;
+}
+
+// Frees an owned column, or forgets one that lives in the mapping
+#define RELEASE_COLUMN(problem, column)                        \
+    do {                                                       \
+        if (!in_mapping((problem), (column))) free(column);    \
+        (column) = NULL;                                       \
+    } while (0)
+
+static void release_columns(DeliveryProblem *problem) {
+    PointTable *points = &problem->points;
+    RELEASE_COLUMN(problem, points->id);
+    RELEASE_COLUMN(problem, points->name);
+    RELEASE_COLUMN(problem, points->x);
+    RELEASE_COLUMN(problem, points->y);
+    RELEASE_COLUMN(problem, points->is_depot);
+    RELEASE_COLUMN(problem, points->package_count);
+    RELEASE_COLUMN(problem, points->window_open);
+    RELEASE_COLUMN(problem, points->window_close);
+    RELEASE_COLUMN(problem, points->service_minutes);
+    PackageTable *packages = &problem->packages;
+    RELEASE_COLUMN(problem, packages->id);
+    RELEASE_COLUMN(problem, packages->weight);
+    RELEASE_COLUMN(problem, packages->value);
+    RELEASE_COLUMN(problem, packages->priority);
+    RELEASE_COLUMN(problem, packages->carbon_footprint);
+    RELEASE_COLUMN(problem, packages->destination_id);
+    RouteTable *routes = &problem->routes;
+    RELEASE_COLUMN(problem, routes->from);
+    RELEASE_COLUMN(problem, routes->to);
+    RELEASE_COLUMN(problem, routes->distance);
+    RELEASE_COLUMN(problem, routes->carbon_emission_factor);
+    points->capacity = packages->capacity = routes->capacity = 0;
+    points->count = packages->count = routes->count = 0;
+}
+
+void delivery_problem_free(DeliveryProblem *problem) {
+    if (!problem) return;
+    release_columns(problem);
+    string_pool_free(&problem->names);
+    mapped_file_close(&problem->mapping);
+    road_graph_free(&problem->road_graph);
+    contraction_hierarchy_free(&problem->hierarchy);
+    distance_matrix_free(&problem->distance_matrix);
+    free(problem);
+}
+
+void delivery_problem_clear(DeliveryProblem *problem) {
+    if (problem->mapping.data) {
+        // Mapped columns go away with the mapping; owned ones are freed too
+        // since the tables are typically refilled from another file
+        release_columns(problem);
+        string_pool_free(&problem->names);
+        mapped_file_close(&problem->mapping);
+    }
+    problem->points.count = 0;
+    problem->packages.count = 0;
+    problem->routes.count = 0;
+    memset(problem->sla_minutes, 0, sizeof(problem->sla_minutes));
+    string_pool_clear(&problem->names);
+    road_graph_free(&problem->road_graph);
+    contraction_hierarchy_free(&problem->hierarchy);
+    distance_matrix_free(&problem->distance_matrix);
+    delivery_problem_packages_changed(problem);
+}
+
+void delivery_problem_release(DeliveryProblem *problem) {
+    delivery_problem_clear(problem);
+    release_columns(problem);
+    string_pool_free(&problem->names);
+}
+
+// Resizes an owned column, or copies a mapped one into a new owned buffer
+static void *grow_column(const DeliveryProblem *problem, void *column, size_t element, int count,
+                         int capacity) {
+    if (!in_mapping(problem, column)) return realloc(column, element * capacity);
+    void *copy = malloc(element * capacity);
+    if (copy) memcpy(copy, column, element * count);
+    return copy;
+}
+
+// On failure the column keeps its old buffer
+#define GROW_COLUMN(problem, column, count, capacity, status)                          \
+    do {                                                                               \
+        void *grown = grow_column((problem), (column), sizeof(*(column)), (count), (capacity)); \
+        if (grown) (column) = grown; else (status) = -1;                               \
+    } while (0)
+
+static int next_capacity(int capacity, int count, int needed) {
+    int grown = capacity > 0 ? capacity * 2 : 16;
+    if (grown < count) grown = count;
+    return grown > needed ? grown : needed;
+}
+
+int delivery_problem_reserve_points(DeliveryProblem *problem, int count) {
+    PointTable *points = &problem->points;
+    if (count <= points->capacity) return 0;
+    int n = points->count;
+    int capacity = next_capacity(points->capacity, n, count);
+    int status = 0;
+    GROW_COLUMN(problem, points->id, n, capacity, status);
+    GROW_COLUMN(problem, points->name, n, capacity, status);
+    GROW_COLUMN(problem, points->x, n, capacity, status);
+    GROW_COLUMN(problem, points->y, n, capacity, status);
+    GROW_COLUMN(problem, points->is_depot, n, capacity, status);
+    GROW_COLUMN(problem, points->package_count, n, capacity, status);
+    GROW_COLUMN(problem, points->window_open, n, capacity, status);
+    GROW_COLUMN(problem, points->window_close, n, capacity, status);
+    GROW_COLUMN(problem, points->service_minutes, n, capacity, status);
+    if (status == 0) points->capacity = capacity;
+    return status;
+}
+
+int delivery_problem_reserve_packages(DeliveryProblem *problem, int count) {
+    PackageTable *packages = &problem->packages;
+    if (count <= packages->capacity) return 0;
+    int n = packages->count;
+    int capacity = next_capacity(packages->capacity, n, count);
+    int status = 0;
+    GROW_COLUMN(problem, packages->id, n, capacity, status);
+    GROW_COLUMN(problem, packages->weight, n, capacity, status);
+    GROW_COLUMN(problem, packages->value, n, capacity, status);
+    GROW_COLUMN(problem, packages->priority, n, capacity, status);
+    GROW_COLUMN(problem, packages->carbon_footprint, n, capacity, status);
+    GROW_COLUMN(problem, packages->destination_id, n, capacity, status);
+    if (status == 0) packages->capacity = capacity;
+    return status;
+}
+
+int delivery_problem_reserve_routes(DeliveryProblem *problem, int count) {
+    RouteTable *routes = &problem->routes;
+    if (count <= routes->capacity) return 0;
+    int n = routes->count;
+    int capacity = next_capacity(routes->capacity, n, count);
+    int status = 0;
+    GROW_COLUMN(problem, routes->from, n, capacity, status);
+    GROW_COLUMN(problem, routes->to, n, capacity, status);
+    GROW_COLUMN(problem, routes->distance, n, capacity, status);
+    GROW_COLUMN(problem, routes->carbon_emission_factor, n, capacity, status);
+    if (status == 0) routes->capacity = capacity;
+    return status;
+}
+
+int delivery_problem_add_point(DeliveryProblem *problem, const DeliveryPoint *point) {
+    PointTable *points = &problem->points;
+    if (delivery_problem_reserve_points(problem, points->count + 1) != 0) return -1;
+    const char *name = point->name ? point->name : "";
+    int name_offset = string_pool_intern(&problem->names, name, strlen(name));
+    if (name_offset < 0) return -1;
+    int i = points->count++;
+    points->id[i] = point->id;
+    points->name[i] = name_offset;
+    points->x[i] = point->x;
+    points->y[i] = point->y;
+    points->is_depot[i] = point->is_depot != 0;
+    points->package_count[i] = point->package_count;
+    points->window_open[i] = 0;
+    points->window_close[i] = INFINITY;
+    points->service_minutes[i] = 0;
+    return i;
+}
+
+int delivery_problem_set_window(DeliveryProblem *problem, int point, double open, double close,
+                                double service) {
+    PointTable *points = &problem->points;
+    if (point < 0 || point >= points->count || !(open <= close) || !(service >= 0)) return -1;
+    // Mapped columns are read-only; growing copies them out
+    if (points->capacity == 0 && delivery_problem_reserve_points(problem, points->count) != 0) {
+        return -1;
+    }
+    points->window_open[point] = open;
+    points->window_close[point] = close;
+    points->service_minutes[point] = service;
+    return 0;
+}
+
+int delivery_problem_set_sla(DeliveryProblem *problem, int priority, double minutes) {
+    if (priority < 1 || priority > PACKAGE_PRIORITY_PREMIUM || !(minutes > 0)) return -1;
+    problem->sla_minutes[priority] = minutes;
+    return 0;
+}
+
+int delivery_problem_add_package(DeliveryProblem *problem, const Package *package) {
+    PackageTable *packages = &problem->packages;
+    if (delivery_problem_reserve_packages(problem, packages->count + 1) != 0) return -1;
+    int i = packages->count++;
+    packages->id[i] = package->id;
+    packages->weight[i] = package->weight;
+    packages->value[i] = package->value;
+    packages->priority[i] = package->priority;
+    packages->carbon_footprint[i] = package->carbon_footprint;
+    packages->destination_id[i] = package->destination_id;
+    return i;
+}
+
+int delivery_problem_add_route(DeliveryProblem *problem, const Route *route) {
+    RouteTable *routes = &problem->routes;
+    if (delivery_problem_reserve_routes(problem, routes->count + 1) != 0) return -1;
+    int i = routes->count++;
+    routes->from[i] = route->from;
+    routes->to[i] = route->to;
+    routes->distance[i] = route->distance;
+    routes->carbon_emission_factor[i] = route->carbon_emission_factor;
+    return i;
+}
+
+void delivery_plan_clear(DeliveryPlan *plan) {
+    for (int i = 0; i < plan->num_vehicles; i++) {
+        free(plan->vehicles[i].stops);
+        free(plan->vehicles[i].packages);
+    }
+    free(plan->vehicles);
+    free(plan->unassigned);
+    memset(plan, 0, sizeof(DeliveryPlan));
+}
+
+VehicleRoute *delivery_plan_add_vehicle(DeliveryPlan *plan, int depot) {
+    VehicleRoute *vehicles = realloc(plan->vehicles, (plan->num_vehicles + 1) * sizeof(VehicleRoute));
+    if (!vehicles) return NULL;
+    plan->vehicles = vehicles;
+    VehicleRoute *vehicle = &vehicles[plan->num_vehicles++];
+    memset(vehicle, 0, sizeof(VehicleRoute));
+    vehicle->depot = depot;
+    return vehicle;
+}
+
+double route_emissions(double distance) {
+    return distance * 0.21;
+}
+
+void delivery_plan_update_totals(DeliveryPlan *plan, const DistanceMatrix *matrix) {
+    plan->total_distance = 0;
+    plan->total_emissions = 0;
+    for (int i = 0; i < plan->num_vehicles; i++) {
+        VehicleRoute *vehicle = &plan->vehicles[i];
+        vehicle->distance = distance_matrix_tour_length(matrix, vehicle->stops, vehicle->num_stops);
+        vehicle->emissions = route_emissions(vehicle->distance);
+        plan->total_distance += vehicle->distance;
+        plan->total_emissions += vehicle->emissions;
+    }
+}
+
+double calculate_distance(const DeliveryProblem *problem, int from, int to) {
+    double dx = problem->points.x[from] - problem->points.x[to];
+    double dy = problem->points.y[from] - problem->points.y[to];
+    return sqrt(dx * dx + dy * dy);
+}
+
+int build_complete_routes(DeliveryProblem *problem) {
+    unsigned int state = 0x9e3779b9u;
+    int n = problem->points.count;
+
+    problem->routes.count = 0;
+    if (delivery_problem_reserve_routes(problem, n * (n - 1) / 2) != 0) return -1;
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            Route route = {i, j, calculate_distance(problem, i, j),
+                           0.21 + (next_random(&state) % 10) / 100.0};
+            delivery_problem_add_route(problem, &route);
+        }
+    }
+    return 0;
+}
+
+static int rebuild_road_graph(DeliveryProblem *problem) {
+    const RouteTable *routes = &problem->routes;
+    RoadEdge *edges = malloc((routes->count > 0 ? routes->count : 1) * sizeof(RoadEdge));
+    if (!edges) return -1;
+    for (int i = 0; i < routes->count; i++) {
+        edges[i].from = routes->from[i];
+        edges[i].to = routes->to[i];
+        edges[i].weight = routes->distance[i];
+    }
+    // The old graph stays in place if the new one cannot be built
+    RoadGraph graph;
+    int status = road_graph_build(&graph, problem->points.count, edges, routes->count, 1);
+    free(edges);
+    if (status != 0) return -1;
+    road_graph_free(&problem->road_graph);
+    problem->road_graph = graph;
+    return 0;
+}
+
+int delivery_problem_build_graph(DeliveryProblem *problem) {
+    int status = rebuild_road_graph(problem);
+    // Any hierarchy or matrix from the previous graph is now stale
+    contraction_hierarchy_free(&problem->hierarchy);
+    distance_matrix_free(&problem->distance_matrix);
+    return status;
+}
+
+// Appends the row and column of the newest point s from its roads: a
+// shortest path to s ends with one of them, so d(s, j) = min over roads
+// (length + d(end, j)), and roads are two-way, so d(j, s) = d(s, j).
+// A path between older points i and j can only get shorter through s by
+// entering on i's best road a and leaving on j's best road b with
+// length(a) + length(b) < d(a, b). Points are bucketed by best road and
+// only rows that s brings closer to such a road's end are relaxed, against
+// that road's bucket.
+static int extend_point_matrix(DeliveryProblem *problem, const Route *roads, int num_roads) {
+    DistanceMatrix *matrix = &problem->distance_matrix;
+    int s = matrix->size;
+    int *entry = malloc((s > 0 ? s : 1) * sizeof(int));
+    int *offsets = calloc(num_roads + 2, sizeof(int));
+    int *order = malloc((s > 0 ? s : 1) * sizeof(int));
+    unsigned char *shortcut = malloc((size_t)num_roads * num_roads + 1);
+    unsigned char *exits = malloc(num_roads + 1);
+    if (!entry || !offsets || !order || !shortcut || !exits ||
+        distance_matrix_reserve(matrix, s + 1) != 0) {
+        free(entry);
+        free(offsets);
+        free(order);
+        free(shortcut);
+        free(exits);
+        return -1;
+    }
+    matrix->stops[s] = s;
+    matrix->size = s + 1;
+    float *row = matrix->values + (size_t)s * matrix->stride;
+    for (int j = 0; j < s; j++) {
+        row[j] = INFINITY;
+        entry[j] = -1;
+    }
+    row[s] = 0;
+    for (int r = 0; r < num_roads; r++) {
+        const float *end = distance_matrix_row(matrix, roads[r].to);
+        float length = (float)roads[r].distance;
+        for (int j = 0; j < s; j++) {
+            if (length + end[j] < row[j]) {
+                row[j] = length + end[j];
+                entry[j] = r;
+            }
+        }
+    }
+    for (int j = 0; j < s; j++) matrix->values[(size_t)j * matrix->stride + s] = row[j];
+
+    // Counting sort of the reachable points by best road
+    for (int j = 0; j < s; j++) {
+        if (entry[j] >= 0) offsets[entry[j] + 2]++;
+    }
+    for (int r = 0; r < num_roads; r++) offsets[r + 2] += offsets[r + 1];
+    for (int j = 0; j < s; j++) {
+        if (entry[j] >= 0) order[offsets[entry[j] + 1]++] = j;
+    }
+    // offsets[r] .. offsets[r + 1] now holds road r's points. Shortcuts are
+    // all found before relaxing changes the distances they compare against.
+    for (int a = 0; a < num_roads; a++) {
+        for (int b = 0; b < num_roads; b++) {
+            shortcut[a * num_roads + b] = roads[a].distance + roads[b].distance <
+                                          distance_matrix_get(matrix, roads[a].to, roads[b].to);
+        }
+    }
+    for (int a = 0; a < num_roads; a++) {
+        for (int x = offsets[a]; x < offsets[a + 1]; x++) {
+            int i = order[x];
+            float *values = matrix->values + (size_t)i * matrix->stride;
+            // If s does not bring i closer to the end of road b, it brings i
+            // no closer to anything behind b either. Tested on the row as it
+            // was, before any of it is lowered.
+            for (int b = 0; b < num_roads; b++) {
+                exits[b] = shortcut[a * num_roads + b] &&
+                           row[i] + (float)roads[b].distance < values[roads[b].to];
+            }
+            for (int b = 0; b < num_roads; b++) {
+                if (!exits[b]) continue;
+                for (int y = offsets[b]; y < offsets[b + 1]; y++) {
+                    int j = order[y];
+                    float via = row[i] + row[j];
+                    if (via < values[j]) values[j] = via;
+                }
+            }
+        }
+    }
+    free(entry);
+    free(offsets);
+    free(order);
+    free(shortcut);
+    free(exits);
+    return 0;
+}
+
+int delivery_problem_add_stop(DeliveryProblem *problem, const DeliveryPoint *point,
+                              const Route *roads, int num_roads) {
+    int s = problem->points.count;
+    int matrix_current = problem->distance_matrix.size == s;
+    for (int r = 0; r < num_roads; r++) {
+        if (roads[r].to < 0 || roads[r].to >= s) return -1;
+    }
+    if (delivery_problem_reserve_routes(problem, problem->routes.count + num_roads) != 0 ||
+        delivery_problem_add_point(problem, point) != s) {
+        return -1;
+    }
+    for (int r = 0; r < num_roads; r++) {
+        Route road = roads[r];
+        road.from = s;
+        delivery_problem_add_route(problem, &road);
+    }
+    if (rebuild_road_graph(problem) != 0) {
+        // Back to the problem as it was: graph and matrix still match it
+        problem->routes.count -= num_roads;
+        problem->points.count = s;
+        return -1;
+    }
+    // The hierarchy would need the new node contracted; drop it and let
+    // the next delivery_problem_use_hierarchy() rebuild it
+    contraction_hierarchy_free(&problem->hierarchy);
+    if (matrix_current && extend_point_matrix(problem, roads, num_roads) != 0) {
+        distance_matrix_free(&problem->distance_matrix);
+    }
+    return s;
+}
+
+int delivery_problem_remove_package(DeliveryProblem *problem, int package) {
+    PackageTable *packages = &problem->packages;
+    if (package < 0 || package >= packages->count) return -1;
+    // Mapped columns are copied out before they are edited
+    if (delivery_problem_reserve_packages(problem, packages->count) != 0) return -1;
+    PointTable *points = &problem->points;
+    int destination = packages->destination_id[package];
+    if (destination >= 0 && destination < points->count && points->package_count[destination] > 0) {
+        if (points->capacity == 0 && delivery_problem_reserve_points(problem, points->count) != 0) {
+            return -1;
+        }
+        points->package_count[destination]--;
+    }
+    int tail = packages->count - package - 1;
+    memmove(packages->id + package, packages->id + package + 1, tail * sizeof(int));
+    memmove(packages->weight + package, packages->weight + package + 1, tail * sizeof(int));
+    memmove(packages->value + package, packages->value + package + 1, tail * sizeof(int));
+    memmove(packages->priority + package, packages->priority + package + 1, tail * sizeof(int));
+    memmove(packages->carbon_footprint + package, packages->carbon_footprint + package + 1,
+            tail * sizeof(double));
+    memmove(packages->destination_id + package, packages->destination_id + package + 1,
+            tail * sizeof(int));
+    packages->count--;
+    delivery_problem_packages_changed(problem);
+    return 0;
+}
+
+#define TRAFFIC_FREE_FLOW_SPEED 5.0   // distance units (100 m) per minute, i.e. 30 km/h
+#define TRAFFIC_IDLE_EMISSIONS 0.5    // kg CO2 per minute of stop-and-go delay
+
+// Hourly slowdown over free flow from midnight: morning peak around 9:00,
+// evening peak around 18:00
+static const double local_traffic[TRAFFIC_PROFILE_POINTS] = {
+    1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.1, 1.3, 1.6, 1.7, 1.5, 1.3,
+    1.3, 1.3, 1.3, 1.4, 1.5, 1.7, 1.8, 1.7, 1.4, 1.2, 1.1, 1.0};
+static const double arterial_traffic[TRAFFIC_PROFILE_POINTS] = {
+    1.0, 1.0, 1.0, 1.0, 1.0, 1.1, 1.3, 1.8, 2.6, 2.8, 2.2, 1.7,
+    1.6, 1.6, 1.7, 1.9, 2.3, 2.8, 3.0, 2.7, 2.0, 1.5, 1.2, 1.1};
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int delivery_problem_build_traffic(const DeliveryProblem *problem, TrafficModel *model) {
+    const RoadGraph *graph = &problem->road_graph;
+    const RouteTable *routes = &problem->routes;
+    if (traffic_model_init(model, graph, TRAFFIC_FREE_FLOW_SPEED, route_emissions(1.0)) != 0) {
+        return -1;
+    }
+    model->idle_emissions = TRAFFIC_IDLE_EMISSIONS;
+    int local = traffic_model_add_profile(model, local_traffic);
+    int arterial = traffic_model_add_profile(model, arterial_traffic);
+    double *lengths = malloc((routes->count > 0 ? routes->count : 1) * sizeof(double));
+    if (local < 0 || arterial < 0 || !lengths) {
+        free(lengths);
+        traffic_model_free(model);
+        return -1;
+    }
+    memcpy(lengths, routes->distance, routes->count * sizeof(double));
+    qsort(lengths, routes->count, sizeof(double), compare_doubles);
+    double median = routes->count > 0 ? lengths[routes->count / 2] : 0;
+    free(lengths);
+
+    for (int arc = 0; arc < graph->num_arcs; arc++) {
+        int route = graph->edges[arc];
+        traffic_model_set_arc(model, arc, routes->distance[route] >= median ? arterial : local,
+                              routes->carbon_emission_factor[route]);
+    }
+    traffic_model_set_coordinates(model, problem->points.x, problem->points.y);
+    return 0;
+}
+
+// Deadline of a package by its priority's SLA, INFINITY for none
+static double package_deadline(const DeliveryProblem *problem, int package) {
+    double sla = problem->sla_minutes[package_priority_level(problem, package)];
+    return sla > 0 ? sla : INFINITY;
+}
+
+int delivery_problem_has_time_windows(const DeliveryProblem *problem) {
+    const PointTable *points = &problem->points;
+    for (int i = 0; i < points->count; i++) {
+        if (points->window_open[i] > 0 || isfinite(points->window_close[i])) return 1;
+    }
+    for (int p = 0; p < problem->packages.count; p++) {
+        if (isfinite(package_deadline(problem, p))) return 1;
+    }
+    return 0;
+}
+
+int delivery_problem_time_windows(const DeliveryProblem *problem, TimeWindows *windows) {
+    const PointTable *points = &problem->points;
+    if (time_windows_init(windows, points->count, TRAFFIC_FREE_FLOW_SPEED) != 0) return -1;
+    for (int i = 0; i < points->count; i++) {
+        windows->open[i] = points->window_open[i];
+        windows->close[i] = points->window_close[i];
+        windows->service[i] = points->service_minutes[i];
+    }
+    const PackageTable *packages = &problem->packages;
+    for (int p = 0; p < packages->count; p++) {
+        int point = packages->destination_id[p];
+        double deadline = package_deadline(problem, p);
+        if (deadline < windows->close[point]) windows->close[point] = deadline;
+        if (package_priority_level(problem, p) == PACKAGE_PRIORITY_PREMIUM) {
+            windows->late_weight[point] = PREMIUM_LATE_WEIGHT;
+        }
+    }
+    for (int i = 0; i < points->count; i++) {
+        windows->constrained += windows->open[i] > 0 || isfinite(windows->close[i]);
+    }
+    return 0;
+}
+
+static int compute_point_matrix(const DeliveryProblem *problem, DistanceMatrix *matrix,
+                                ThreadPool *pool) {
+    int n = problem->points.count;
+    int *stops = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!stops) return -1;
+    for (int i = 0; i < n; i++) stops[i] = i;
+    int status = problem->hierarchy.num_nodes == n && n > 0
+               ? distance_matrix_compute_hierarchy(matrix, &problem->hierarchy, stops, n, pool)
+               : distance_matrix_compute(matrix, &problem->road_graph, stops, n, pool);
+    free(stops);
+    return status;
+}
+
+int delivery_problem_use_hierarchy(DeliveryProblem *problem, const char *path, int *built) {
+    contraction_hierarchy_free(&problem->hierarchy);
+    if (built) *built = 0;
+    FILE *existing = fopen(path, "rb");
+    if (existing) {
+        fclose(existing);
+        if (contraction_hierarchy_load(&problem->hierarchy, path, &problem->road_graph) == 0) {
+            return 0;
+        }
+    }
+    if (contraction_hierarchy_build(&problem->hierarchy, &problem->road_graph, NULL) != 0) {
+        return -1;
+    }
+    if (built) *built = 1;
+    return contraction_hierarchy_save(&problem->hierarchy, path);
+}
+
+int delivery_problem_build_matrix(DeliveryProblem *problem, ThreadPool *pool) {
+    distance_matrix_free(&problem->distance_matrix);
+    return compute_point_matrix(problem, &problem->distance_matrix, pool);
+}
+
+const DistanceMatrix *delivery_problem_matrix(const DeliveryProblem *problem, DistanceMatrix *scratch) {
+    memset(scratch, 0, sizeof(DistanceMatrix));
+    if (problem->distance_matrix.size == problem->points.count) return &problem->distance_matrix;
+    if (compute_point_matrix(problem, scratch, NULL) != 0) return NULL;
+    return scratch;
+}
+
+int initialize_data(DeliveryProblem *problem, unsigned int seed) {
+    static const char *locations[] = {
+        "Depot - Koramangala", "Electronic City", "Whitefield", "Banashankari",
+        "Jayanagar", "Indiranagar", "HSR Layout", "BTM Layout",
+        "Malleshwaram", "Rajajinagar", "Hebbal", "Marathahalli",
+        "Yeshwanthpur", "Kengeri", "Vijayanagar", "Ulsoor",
+        "Shivajinagar", "KR Puram", "Basavanagudi", "RT Nagar"
+    };
+    unsigned int state = seed ? seed : 1;
+    int num_points = 18;
+    int num_packages = 20;
+
+    delivery_problem_clear(problem);
+    if (delivery_problem_reserve_points(problem, num_points) != 0 ||
+        delivery_problem_reserve_packages(problem, num_packages) != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < num_points; i++) {
+        DeliveryPoint point;
+        point.id = i;
+        point.name = locations[i];
+        point.is_depot = (i == 0);
+        point.x = 100 + (i % 6) * 160 + (next_random(&state) % 20);
+        point.y = 100 + (i / 6) * 160 + (next_random(&state) % 20);
+        point.package_count = next_random(&state) % 5 + 1;
+        if (delivery_problem_add_point(problem, &point) < 0) return -1;
+    }
+
+    for (int i = 0; i < num_packages; i++) {
+        Package package;
+        package.id = i;
+        package.weight = next_random(&state) % 10 + 1;
+        package.value = next_random(&state) % 100 + 50;
+        package.priority = next_random(&state) % 3 + 1;
+        package.carbon_footprint = (next_random(&state) % 50 + 10) / 10.0;
+        package.destination_id = next_random(&state) % (num_points - 1) + 1;
+        delivery_problem_add_package(problem, &package);
+    }
+
+    delivery_problem_packages_changed(problem);
+
+    if (build_complete_routes(problem) != 0) return -1;
+    return delivery_problem_build_graph(problem);
+}
+
+void dijkstra(const int *graph, int num_nodes, int src, int dist[], int parent[]) {
+    for (int i = 0; i < num_nodes; i++) {
+        dist[i] = INF;
+        parent[i] = -1;
+    }
+
+    char *visited = calloc(num_nodes > 0 ? num_nodes : 1, 1);
+    if (!visited) return;
+
+    dist[src] = 0;
+
+    for (int count = 0; count < num_nodes - 1; count++) {
+        int min_dist = INF, u = -1;
+
+        for (int v = 0; v < num_nodes; v++) {
+            if (!visited[v] && dist[v] <= min_dist) {
+                min_dist = dist[v];
+                u = v;
+            }
+        }
+
+        if (u == -1) break;
+        visited[u] = 1;
+
+        for (int v = 0; v < num_nodes; v++) {
+            int weight = graph[u * num_nodes + v];
+            if (!visited[v] && weight && dist[u] != INF && dist[u] + weight < dist[v]) {
+                dist[v] = dist[u] + weight;
+                parent[v] = u;
+            }
+        }
+    }
+    free(visited);
+}
+
+// Knapsack value added per priority level above standard
+#define PRIORITY_VALUE_STEP 25
+
+int package_net_value(const DeliveryProblem *problem, int package) {
+    int value_with_priority = problem->packages.value[package] +
+                              PRIORITY_VALUE_STEP * (package_priority_level(problem, package) - 1);
+    int carbon_penalty = (int)(problem->packages.carbon_footprint[package] * 10);
+    return value_with_priority - carbon_penalty;
+}
+
+int delivery_route_candidate_count(const TourImproveOptions *options, int length) {
+    if (length < SPATIAL_CANDIDATE_MIN_STOPS) return 0;
+    return (options->neighbours > 0 ? options->neighbours : 1) * SPATIAL_CANDIDATE_FACTOR;
+}
+
+int delivery_route_candidates(const DeliveryProblem *problem, const int *stops, int num_stops,
+                              int count, int *candidates) {
+    if (num_stops <= 0) return 0;
+    double *x = calloc(num_stops, sizeof(double));
+    double *y = calloc(num_stops, sizeof(double));
+    SpatialIndex index;
+    int status = -1;
+    if (x && y) {
+        for (int i = 0; i < num_stops; i++) {
+            x[i] = problem->points.x[stops[i]];
+            y[i] = problem->points.y[stops[i]];
+        }
+        status = spatial_index_build(&index, x, y, num_stops);
+    }
+    if (status == 0) {
+        for (int i = 0; i < num_stops; i++) {
+            int *list = candidates + (size_t)stops[i] * count;
+            int found = spatial_index_knn(&index, x[i], y[i], count, list);
+            for (int j = 0; j < found; j++) list[j] = stops[list[j]];
+            for (int j = found; j < count; j++) list[j] = -1;
+        }
+        spatial_index_free(&index);
+    }
+    free(x);
+    free(y);
+    return status;
+}
+
+// One tour_improve() pass, with the point candidates as tour positions when
+// there are any
+static int improve_pass(const DeliveryProblem *problem, const DistanceMatrix *matrix, int *tour,
+                        int length, const int *candidates, int count,
+                        const TourImproveOptions *options, TourImproveStats *stats) {
+    if (!candidates) return tour_improve(matrix, tour, length, options, stats);
+    ArenaMark mark = arena_mark(options->arena);
+    int *position = arena_alloc(options->arena, problem->points.count * sizeof(int));
+    int *lists = arena_alloc(options->arena, (size_t)length * count * sizeof(int));
+    int status = -1;
+    if (position && lists) {
+        for (int i = 0; i < length; i++) position[tour[i]] = i;
+        for (int i = 0; i < length; i++) {
+            const int *near = candidates + (size_t)tour[i] * count;
+            int *list = lists + (size_t)i * count;
+            for (int j = 0; j < count; j++) list[j] = near[j] >= 0 ? position[near[j]] : -1;
+        }
+        status = tour_improve_with_candidates(matrix, tour, length, lists, count, options, stats);
+    }
+    arena_release(options->arena, mark);
+    return status;
+}
+
+// Folds the first of two consecutive searches on one tour into the second's
+// stats
+static void merge_stats(TourImproveStats *stats, const TourImproveStats *first) {
+    stats->two_opt_moves += first->two_opt_moves;
+    stats->or_opt_moves += first->or_opt_moves;
+    stats->evaluations += first->evaluations;
+    stats->two_opt_evaluations += first->two_opt_evaluations;
+    stats->window_rejections += first->window_rejections;
+    stats->initial_length = first->initial_length;
+    stats->elapsed += first->elapsed;
+    stats->timed_out |= first->timed_out;
+    stats->cancelled |= first->cancelled;
+}
+
+int delivery_route_improve(const DeliveryProblem *problem, const DistanceMatrix *matrix,
+                           const TimeWindows *windows, int *tour, int length,
+                           const int *candidates, const TourImproveOptions *options,
+                           TourImproveStats *stats) {
+    int count = delivery_route_candidate_count(options, length);
+    ArenaMark mark = arena_mark(options->arena);
+    int status = -1;
+    if (count > 0 && !candidates) {
+        int *own = arena_alloc(options->arena, (size_t)problem->points.count * count * sizeof(int));
+        if (!own || delivery_route_candidates(problem, tour, length, count, own) != 0) goto done;
+        candidates = own;
+    }
+    if (count == 0) candidates = NULL;
+
+    TourImproveOptions improve = *options;
+    TourImproveStats untimed_stats;
+    if (windows) {
+        // Improve on distance alone first, with half the budget, then move
+        // only the stops that tour gets to late and improve again within
+        // the windows
+        TourImproveOptions untimed = improve;
+        untimed.windows = NULL;
+        untimed.time_budget /= 2;
+        improve.time_budget -= untimed.time_budget;
+        int *seed = arena_alloc(options->arena, length * sizeof(int));
+        if (!seed ||
+            improve_pass(problem, matrix, tour, length, candidates, count, &untimed,
+                         &untimed_stats) != 0) {
+            goto done;
+        }
+        memcpy(seed, tour, length * sizeof(int));
+        if (time_window_build_tour(windows, matrix, seed, length, tour) != 0) goto done;
+        improve.windows = windows;
+    }
+    status = improve_pass(problem, matrix, tour, length, candidates, count, &improve, stats);
+    if (status == 0 && windows && stats) merge_stats(stats, &untimed_stats);
+
+done:
+    arena_release(options->arena, mark);
+    return status;
+}
+
+int calculate_optimal_route(const DeliveryProblem *problem, DeliveryPlan *plan,
+                            const TourImproveOptions *options, TourImproveStats *stats) {
+    int n = problem->points.count;
+
+    delivery_plan_clear(plan);
+    if (n == 0) return 0;
+
+    MetricScope scope = metrics_begin(METRIC_TIMER_ROUTE);
+    int status = -1;
+    DistanceMatrix local_matrix;
+    const DistanceMatrix *matrix = delivery_problem_matrix(problem, &local_matrix);
+    if (!matrix) goto end;
+
+    VehicleRoute *vehicle = delivery_plan_add_vehicle(plan, 0);
+    int *tour = malloc(n * sizeof(int));
+    SpatialIndex index;
+    if (!vehicle || !tour ||
+        spatial_index_build(&index, problem->points.x, problem->points.y, n) != 0) {
+        free(tour);
+        distance_matrix_free(&local_matrix);
+        delivery_plan_clear(plan);
+        goto end;
+    }
+    vehicle->stops = tour;
+
+    // Roads are two-way, so points the depot cannot reach are unreachable
+    // from every stop of the tour; leave them out
+    const float *depot_row = distance_matrix_row(matrix, 0);
+    for (int i = 0; i < n; i++) {
+        if (!isfinite(depot_row[i])) spatial_index_remove(&index, i);
+    }
+
+    // Greedy construction: repeatedly visit the closest unvisited point
+    int current = 0;
+    tour[vehicle->num_stops++] = current;
+    spatial_index_remove(&index, current);
+    for (;;) {
+        int next_point = spatial_index_nearest(&index, problem->points.x[current],
+                                               problem->points.y[current], INFINITY);
+        if (next_point < 0) break;
+        tour[vehicle->num_stops++] = next_point;
+        spatial_index_remove(&index, next_point);
+        current = next_point;
+    }
+    spatial_index_free(&index);
+
+    // Scratch below comes from the caller's arena when there is one, which
+    // the improvement search then shares
+    TourImproveOptions improve;
+    if (options) {
+        improve = *options;
+    } else {
+        tour_improve_default_options(&improve);
+    }
+    Arena local_arena;
+    if (!improve.arena) {
+        arena_init(&local_arena, 0);
+        improve.arena = &local_arena;
+    }
+    ArenaMark mark = arena_mark(improve.arena);
+    TimeWindows windows = {0};
+    int timed = delivery_problem_has_time_windows(problem);
+    if (timed && delivery_problem_time_windows(problem, &windows) != 0) {
+        delivery_plan_clear(plan);
+        goto done;
+    }
+    status = delivery_route_improve(problem, matrix, timed ? &windows : NULL, tour,
+                                    vehicle->num_stops, NULL, &improve, stats);
+    if (status != 0) {
+        delivery_plan_clear(plan);
+        goto done;
+    }
+    delivery_plan_update_totals(plan, matrix);
+
+done:
+    if (improve.arena == &local_arena) {
+        arena_free(&local_arena);
+    } else {
+        arena_release(improve.arena, mark);
+    }
+    time_windows_free(&windows);
+    distance_matrix_free(&local_matrix);
+end:
+    // Failed runs are timed too
+    metrics_end(&scope);
+    return status;
+}
@@ -0,0 +1,268 @@
+#ifndef DELIVERY_SOLVER_H
+#define DELIVERY_SOLVER_H
+
+#include "distance_matrix.h"
+#include "mapped_file.h"
+#include "road_graph.h"
+#include "string_pool.h"
+#include "thread_pool.h"
+#include "time_window.h"
+#include "tour_improve.h"
+#include "traffic_model.h"
+
+#define INF 999999
+// Package priorities run from 1 (standard) up to premium
+#define PACKAGE_PRIORITY_PREMIUM 3
+
+// One point, package or road as passed to the delivery_problem_add_*()
+// functions. The problem itself stores them column by column.
+typedef struct {
+    int id;
+    const char *name;
+    double x, y;
+    int is_depot;
+    int package_count;
+} DeliveryPoint;
+
+typedef struct {
+    int id;
+    int weight;
+    int value;
+    int priority;
+    double carbon_footprint;
+    int destination_id;
+} Package;
+
+typedef struct {
+    int from, to;
+    double distance;
+    double carbon_emission_factor;
+} Route;
+
+// Points as parallel arrays indexed by point number, so loops over
+// coordinates only touch x and y
+typedef struct {
+    int count;
+    int capacity;
+    int *id;
+    int *name;              // offset into DeliveryProblem.names
+    double *x, *y;
+    unsigned char *is_depot;
+    int *package_count;
+    // Delivery window in minutes after the shift starts (close is INFINITY
+    // when open-ended) and the minutes spent there; set with
+    // delivery_problem_set_window()
+    double *window_open, *window_close;
+    double *service_minutes;
+} PointTable;
+
+typedef struct {
+    int count;
+    int capacity;
+    int *id;
+    int *weight;
+    int *value;
+    int *priority;
+    double *carbon_footprint;
+    int *destination_id;    // point index
+} PackageTable;
+
+// Road segments. Only roads that exist are stored; road_graph indexes them.
+typedef struct {
+    int count;
+    int capacity;
+    int *from, *to;
+    double *distance;
+    double *carbon_emission_factor;
+} RouteTable;
+
+// Problem instance. Solver functions only read from it, so one instance can
+// be shared between threads as long as nobody is editing it.
+//
+// A loaded binary instance leaves its columns and names inside mapping
+// (tables with capacity 0). Such columns are copied out the first time the
+// table grows; clearing or freeing the problem drops the mapping.
+typedef struct {
+    PointTable points;
+    PackageTable packages;
+    RouteTable routes;
+    StringPool names;
+    MappedFile mapping;
+    // Delivery deadline in minutes after the shift starts for packages of
+    // each priority, <= 0 for none (index 0 is unused)
+    double sla_minutes[PACKAGE_PRIORITY_PREMIUM + 1];
+    // Changes whenever packages are edited; caches such as the knapsack
+    // memo compare it. Bump it with delivery_problem_packages_changed().
+    unsigned int packages_version;
+    // Built from routes by delivery_problem_build_graph(); nodes are point indices
+    RoadGraph road_graph;
+    // Optional preprocessing of road_graph for fast distance queries, see
+    // delivery_problem_use_hierarchy(); num_nodes is 0 when absent
+    ContractionHierarchy hierarchy;
+    // Point-to-point road distances shared by all routing code; built by
+    // delivery_problem_build_matrix()
+    DistanceMatrix distance_matrix;
+} DeliveryProblem;
+
+// Closed tour of one vehicle: stops[0] is its depot and the vehicle returns
+// there after stops[num_stops - 1].
+typedef struct {
+    int depot;
+    int *stops;
+    int num_stops;
+    int *packages;      // indices into problem->packages carried on this tour
+    int num_packages;
+    int load;
+    double distance;
+    double emissions;
+} VehicleRoute;
+
+typedef struct {
+    VehicleRoute *vehicles;
+    int num_vehicles;
+    int *unassigned;    // packages no vehicle could take
+    int num_unassigned;
+    double total_distance;
+    double total_emissions;
+} DeliveryPlan;
+
+DeliveryProblem *delivery_problem_new(void);
+void delivery_problem_free(DeliveryProblem *problem);
+// Removes all points, packages and routes but keeps the storage.
+void delivery_problem_clear(DeliveryProblem *problem);
+// Removes everything and frees the storage too, capacities back to 0, e.g.
+// before the tables are pointed into a mapped file.
+void delivery_problem_release(DeliveryProblem *problem);
+void delivery_problem_packages_changed(DeliveryProblem *problem);
+// Append one record and return its index, or -1 on allocation failure. Point
+// names are copied into the problem's string pool.
+int delivery_problem_add_point(DeliveryProblem *problem, const DeliveryPoint *point);
+int delivery_problem_add_package(DeliveryProblem *problem, const Package *package);
+int delivery_problem_add_route(DeliveryProblem *problem, const Route *route);
+// Grow the tables to hold at least this many records. Return 0 or -1.
+int delivery_problem_reserve_points(DeliveryProblem *problem, int count);
+int delivery_problem_reserve_packages(DeliveryProblem *problem, int count);
+int delivery_problem_reserve_routes(DeliveryProblem *problem, int count);
+
+// Sets a point's delivery window and service time. Returns 0, or -1 when
+// close < open, service < 0 or the columns cannot be copied out of a mapping.
+int delivery_problem_set_window(DeliveryProblem *problem, int point, double open, double close,
+                                double service);
+
+// Deadline for packages of one priority (1..PACKAGE_PRIORITY_PREMIUM), in
+// minutes after the shift starts. Returns 0, or -1 for a bad priority or a
+// deadline that is not positive.
+int delivery_problem_set_sla(DeliveryProblem *problem, int priority, double minutes);
+
+static inline int package_priority_level(const DeliveryProblem *problem, int package) {
+    int priority = problem->packages.priority[package];
+    return priority < 1 ? 1 : priority > PACKAGE_PRIORITY_PREMIUM ? PACKAGE_PRIORITY_PREMIUM : priority;
+}
+
+static inline const char *delivery_point_name(const DeliveryProblem *problem, int point) {
+    return string_pool_get(&problem->names, problem->points.name[point]);
+}
+
+void delivery_plan_clear(DeliveryPlan *plan);
+// Appends an empty vehicle route and returns it, or NULL on allocation failure.
+VehicleRoute *delivery_plan_add_vehicle(DeliveryPlan *plan, int depot);
+// Recomputes each vehicle's distance/emissions and the plan totals.
+void delivery_plan_update_totals(DeliveryPlan *plan, const DistanceMatrix *matrix);
+
+// Fills the problem with the Bengaluru demo instance. The seed makes the
+// randomised coordinates and packages reproducible. Returns 0 or -1.
+int initialize_data(DeliveryProblem *problem, unsigned int seed);
+// Connects every pair of points with a straight-line route. Returns 0 or -1.
+int build_complete_routes(DeliveryProblem *problem);
+// Rebuilds road_graph from routes (two-way roads). Must be called whenever
+// points or routes change. Returns 0 on success, -1 on failure.
+int delivery_problem_build_graph(DeliveryProblem *problem);
+// Incremental edits for orders that arrive while a plan is in use.
+//
+// Adds a point joined to the network by roads, whose to fields name existing
+// points (from is set to the new point). road_graph is rebuilt and, if
+// distance_matrix was up to date, it gains the new row and column from the
+// old distances in O(points * roads) instead of being recomputed; only a new
+// point that shortens paths between older ones costs O(points^2). A loaded
+// hierarchy is dropped. Returns the new point index, or -1 with the problem
+// left as it was.
+int delivery_problem_add_stop(DeliveryProblem *problem, const DeliveryPoint *point,
+                              const Route *roads, int num_roads);
+// Removes one package; later packages move down one index and the
+// package_count of its destination drops by one. Returns 0 or -1.
+int delivery_problem_remove_package(DeliveryProblem *problem, int package);
+// Loads the contraction hierarchy of road_graph from path, or builds it and
+// saves it there when the file is missing or belongs to another graph.
+// *built (may be NULL) tells which happened. Returns 0 or -1.
+int delivery_problem_use_hierarchy(DeliveryProblem *problem, const char *path, int *built);
+// Computes distance_matrix over all points from road_graph, one search per
+// point spread over pool (NULL = serial), or with many-to-many hierarchy
+// queries when a hierarchy is loaded. Returns 0 on success, -1 on failure.
+int delivery_problem_build_matrix(DeliveryProblem *problem, ThreadPool *pool);
+// Returns the problem's distance matrix, or computes one into scratch when it
+// is missing or stale. Free scratch afterwards. Returns NULL on failure.
+const DistanceMatrix *delivery_problem_matrix(const DeliveryProblem *problem, DistanceMatrix *scratch);
+
+// Straight-line distance between two points.
+double calculate_distance(const DeliveryProblem *problem, int from, int to);
+// Original O(V^2) dense-matrix Dijkstra over a row-major num_nodes x
+// num_nodes matrix (0 means "no edge"). Routing uses road_graph_dijkstra();
+// this one is kept for benchmark comparison.
+void dijkstra(const int *graph, int num_nodes, int src, int dist[], int parent[]);
+// Knapsack value of a package: its value plus a bonus per priority level,
+// less a carbon penalty (see knapsack.h for the solver)
+int package_net_value(const DeliveryProblem *problem, int package);
+// Emission estimate for driving the given road distance at the average
+// factor (traffic_tour() uses each road's own factor instead).
+double route_emissions(double distance);
+// Time-dependent costs over road_graph: every road keeps its
+// carbon_emission_factor and follows the Bengaluru weekday traffic curve,
+// with the longer half of the roads (arterials) on the heavier peak
+// profile. Free flow is 30 km/h. Returns 0 or -1.
+int delivery_problem_build_traffic(const DeliveryProblem *problem, TrafficModel *model);
+// Whether any point has a window or any package a priority deadline.
+int delivery_problem_has_time_windows(const DeliveryProblem *problem);
+// Windows of every point for routing: a point's deadline is the earliest of
+// its own close and the SLA deadlines of the packages going there, and late
+// minutes weigh PREMIUM_LATE_WEIGHT where premium packages go. Driving runs
+// at free-flow speed. Returns 0 or -1.
+int delivery_problem_time_windows(const DeliveryProblem *problem, TimeWindows *windows);
+// Single-vehicle plan: greedy nearest-neighbour tour from the depot built
+// on a spatial index of the point coordinates, then improved by
+// delivery_route_improve() on the shortest road distances from
+// distance_matrix (computed on the fly if it is missing or stale). Points the
+// depot cannot reach are left out. options NULL uses the defaults; stats may
+// be NULL. Construction scratch shares options->arena with the search.
+// Returns 0 on success, -1 on allocation failure.
+int calculate_optimal_route(const DeliveryProblem *problem, DeliveryPlan *plan,
+                            const TourImproveOptions *options, TourImproveStats *stats);
+
+// Tours at least this long take their 2-opt/Or-opt candidates from the
+// spatial index instead of an O(n^2) scan of the matrix
+#define SPATIAL_CANDIDATE_MIN_STOPS 1000
+// Straight-line candidates fetched per stop, per road-distance neighbour kept
+#define SPATIAL_CANDIDATE_FACTOR 2
+
+// Straight-line candidates per point for a tour of length stops, 0 below
+// SPATIAL_CANDIDATE_MIN_STOPS.
+int delivery_route_candidate_count(const TourImproveOptions *options, int length);
+// For every point of stops, its count nearest among stops by straight-line
+// distance (-1 padded) into candidates[point * count ...]; other points'
+// rows are left alone. Returns 0 or -1 on allocation failure.
+int delivery_route_candidates(const DeliveryProblem *problem, const int *stops, int num_stops,
+                              int count, int *candidates);
+// The search calculate_optimal_route() runs on its greedy tour, shared with
+// other constructions: 2-opt/Or-opt on the closed tour (depot first). With
+// windows it first improves on distance alone with half of the budget, then
+// time_window_build_tour() reinserts only the stops that tour reaches late
+// and the other half improves within the windows. candidates, as filled by
+// delivery_route_candidates() for every stop, may be NULL to compute them
+// here. stats, which may be NULL, covers both searches but not the repair
+// between them. windows NULL runs the search alone, under options->windows.
+// options->arena must be set. Returns 0 or -1 on allocation failure.
+int delivery_route_improve(const DeliveryProblem *problem, const DistanceMatrix *matrix,
+                           const TimeWindows *windows, int *tour, int length,
+                           const int *candidates, const TourImproveOptions *options,
+                           TourImproveStats *stats);
+
+#endif
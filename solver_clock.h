@@ -0,0 +1,17 @@
+#ifndef DELIVERY_SOLVER_CLOCK_H
+#define DELIVERY_SOLVER_CLOCK_H
+
+#include <time.h>
+
+// Monotonic wall-clock time in seconds, for budgets and timings.
+static inline double solver_clock_seconds(void) {
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#endif
@@ -0,0 +1,227 @@
+#include "spatial_index.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Node of the implicit tree over order[lo..hi): its point sits at the middle
+// position and the halves on either side are its subtrees.
+static inline int middle(int lo, int hi) {
+    return lo + (hi - lo) / 2;
+}
+
+static inline double coordinate(const double *x, const double *y, int point, int axis) {
+    return axis ? y[point] : x[point];
+}
+
+// Quickselect: puts the point with the k-th smallest coordinate at order[k],
+// smaller ones before it and larger ones after
+static void select_kth(int *order, int lo, int hi, int k, const double *x, const double *y,
+                       int axis) {
+    while (hi - lo > 1) {
+        double pivot = coordinate(x, y, order[middle(lo, hi)], axis);
+        int i = lo, j = hi - 1;
+        while (i <= j) {
+            while (coordinate(x, y, order[i], axis) < pivot) i++;
+            while (coordinate(x, y, order[j], axis) > pivot) j--;
+            if (i <= j) {
+                int swap = order[i];
+                order[i++] = order[j];
+                order[j--] = swap;
+            }
+        }
+        if (k <= j) {
+            hi = j + 1;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            return;
+        }
+    }
+}
+
+static void build_range(SpatialIndex *index, int lo, int hi, const double *x, const double *y) {
+    while (lo < hi) {
+        // Split across the wider side of the range's bounding box
+        double min_x = INFINITY, max_x = -INFINITY, min_y = INFINITY, max_y = -INFINITY;
+        for (int i = lo; i < hi; i++) {
+            int p = index->order[i];
+            if (x[p] < min_x) min_x = x[p];
+            if (x[p] > max_x) max_x = x[p];
+            if (y[p] < min_y) min_y = y[p];
+            if (y[p] > max_y) max_y = y[p];
+        }
+        int axis = max_y - min_y > max_x - min_x;
+        int mid = middle(lo, hi);
+        select_kth(index->order, lo, hi, mid, x, y, axis);
+        index->axis[mid] = (unsigned char)axis;
+        index->alive[mid] = hi - lo;
+        build_range(index, lo, mid, x, y);
+        lo = mid + 1;
+    }
+}
+
+int spatial_index_build(SpatialIndex *index, const double *x, const double *y, int count) {
+    memset(index, 0, sizeof(SpatialIndex));
+    size_t n = count > 0 ? (size_t)count : 1;
+    index->order = malloc(n * sizeof(int));
+    index->position = malloc(n * sizeof(int));
+    index->x = malloc(n * sizeof(double));
+    index->y = malloc(n * sizeof(double));
+    index->axis = malloc(n);
+    index->removed = calloc(n, 1);
+    index->alive = malloc(n * sizeof(int));
+    if (!index->order || !index->position || !index->x || !index->y || !index->axis ||
+        !index->removed || !index->alive) {
+        spatial_index_free(index);
+        return -1;
+    }
+    index->count = count;
+    for (int i = 0; i < count; i++) index->order[i] = i;
+    build_range(index, 0, count, x, y);
+    for (int i = 0; i < count; i++) {
+        int p = index->order[i];
+        index->position[p] = i;
+        index->x[i] = x[p];
+        index->y[i] = y[p];
+    }
+    return 0;
+}
+
+void spatial_index_free(SpatialIndex *index) {
+    free(index->order);
+    free(index->position);
+    free(index->x);
+    free(index->y);
+    free(index->axis);
+    free(index->removed);
+    free(index->alive);
+    memset(index, 0, sizeof(SpatialIndex));
+}
+
+void spatial_index_remove(SpatialIndex *index, int point) {
+    int target = index->position[point];
+    if (index->removed[target]) return;
+    index->removed[target] = 1;
+    int lo = 0, hi = index->count;
+    for (;;) {
+        int mid = middle(lo, hi);
+        index->alive[mid]--;
+        if (mid == target) break;
+        if (target < mid) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+}
+
+static void restore_range(SpatialIndex *index, int lo, int hi) {
+    while (lo < hi) {
+        int mid = middle(lo, hi);
+        index->removed[mid] = 0;
+        index->alive[mid] = hi - lo;
+        restore_range(index, lo, mid);
+        lo = mid + 1;
+    }
+}
+
+void spatial_index_restore_all(SpatialIndex *index) {
+    restore_range(index, 0, index->count);
+}
+
+// Candidates kept by a query, sorted by squared distance (k of them at most)
+typedef struct {
+    int *points;
+    double *distances;
+    int count;
+    int k;
+    double limit;    // squared search radius, shrinks once k are found
+} Candidates;
+
+static void offer(Candidates *found, int point, double d2) {
+    if (d2 > found->limit || (found->count == found->k && d2 >= found->distances[found->k - 1])) {
+        return;
+    }
+    int slot = found->count < found->k ? found->count++ : found->k - 1;
+    while (slot > 0 && found->distances[slot - 1] > d2) {
+        found->distances[slot] = found->distances[slot - 1];
+        found->points[slot] = found->points[slot - 1];
+        slot--;
+    }
+    found->distances[slot] = d2;
+    found->points[slot] = point;
+}
+
+static inline double search_bound(const Candidates *found) {
+    return found->count == found->k ? found->distances[found->k - 1] : found->limit;
+}
+
+static void search_knn(const SpatialIndex *index, int lo, int hi, double x, double y,
+                       Candidates *found) {
+    while (lo < hi) {
+        int mid = middle(lo, hi);
+        if (index->alive[mid] == 0) return;
+        double dx = x - index->x[mid];
+        double dy = y - index->y[mid];
+        if (!index->removed[mid]) offer(found, index->order[mid], dx * dx + dy * dy);
+        double diff = index->axis[mid] ? dy : dx;
+        // Near side first; the far side only if the split plane is in reach
+        int near_lo = diff < 0 ? lo : mid + 1, near_hi = diff < 0 ? mid : hi;
+        int far_lo = diff < 0 ? mid + 1 : lo, far_hi = diff < 0 ? hi : mid;
+        search_knn(index, near_lo, near_hi, x, y, found);
+        if (diff * diff > search_bound(found)) return;
+        lo = far_lo;
+        hi = far_hi;
+    }
+}
+
+int spatial_index_nearest(const SpatialIndex *index, double x, double y, double max_distance) {
+    int point = -1;
+    double distance;
+    Candidates found = {&point, &distance, 0, 1, max_distance * max_distance};
+    if (isinf(max_distance)) found.limit = INFINITY;
+    search_knn(index, 0, index->count, x, y, &found);
+    return found.count > 0 ? point : -1;
+}
+
+int spatial_index_knn(const SpatialIndex *index, double x, double y, int k, int *out) {
+    if (k <= 0) return 0;
+    double *distances = malloc(k * sizeof(double));
+    if (!distances) return 0;
+    Candidates found = {out, distances, 0, k, INFINITY};
+    search_knn(index, 0, index->count, x, y, &found);
+    free(distances);
+    return found.count;
+}
+
+static void search_radius(const SpatialIndex *index, int lo, int hi, double x, double y,
+                          double r2, int *out, int max_out, int *total) {
+    while (lo < hi) {
+        int mid = middle(lo, hi);
+        if (index->alive[mid] == 0) return;
+        double dx = x - index->x[mid];
+        double dy = y - index->y[mid];
+        if (!index->removed[mid] && dx * dx + dy * dy <= r2) {
+            if (*total < max_out) out[*total] = index->order[mid];
+            (*total)++;
+        }
+        double diff = index->axis[mid] ? dy : dx;
+        // Both halves are in reach when the plane is within the radius
+        if (diff * diff <= r2) {
+            search_radius(index, lo, mid, x, y, r2, out, max_out, total);
+            lo = mid + 1;
+        } else if (diff < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+}
+
+int spatial_index_radius(const SpatialIndex *index, double x, double y, double radius, int *out,
+                         int max_out) {
+    int total = 0;
+    search_radius(index, 0, index->count, x, y, radius * radius, out, max_out, &total);
+    return total;
+}
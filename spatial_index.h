@@ -0,0 +1,34 @@
+#ifndef DELIVERY_SPATIAL_INDEX_H
+#define DELIVERY_SPATIAL_INDEX_H
+
+// Static 2-d tree over planar coordinates (e.g. point x/y). Points can be
+// removed and restored, so "nearest unvisited" queries shrink as a tour is
+// built. Build is O(n log n); queries are O(log n) on typical data.
+typedef struct {
+    int count;
+    int *order;              // tree position -> point
+    int *position;           // point -> tree position
+    double *x, *y;           // coordinates in tree order
+    unsigned char *axis;     // split axis per position: 0 = x, 1 = y
+    unsigned char *removed;  // per position
+    int *alive;              // live points in the subtree rooted at each position
+} SpatialIndex;
+
+// Indexes points 0..count-1 at (x[i], y[i]). Returns 0 or -1.
+int spatial_index_build(SpatialIndex *index, const double *x, const double *y, int count);
+void spatial_index_free(SpatialIndex *index);
+
+// Hide a point from all queries / bring every point back.
+void spatial_index_remove(SpatialIndex *index, int point);
+void spatial_index_restore_all(SpatialIndex *index);
+
+// Closest live point within max_distance of (x, y), or -1.
+int spatial_index_nearest(const SpatialIndex *index, double x, double y, double max_distance);
+// Up to k closest live points, nearest first. Returns how many were found.
+int spatial_index_knn(const SpatialIndex *index, double x, double y, int k, int *out);
+// Live points within radius; writes the first max_out of them to out and
+// returns the total number found.
+int spatial_index_radius(const SpatialIndex *index, double x, double y, double radius, int *out,
+                         int max_out);
+
+#endif
@@ -0,0 +1,119 @@
+#include "string_pool.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t hash_text(const char *text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void string_pool_init(StringPool *pool) {
+    memset(pool, 0, sizeof(StringPool));
+}
+
+void string_pool_free(StringPool *pool) {
+    if (pool->capacity > 0) free(pool->data);
+    free(pool->slots);
+    string_pool_init(pool);
+}
+
+void string_pool_clear(StringPool *pool) {
+    if (pool->capacity == 0) pool->data = NULL;
+    pool->size = 0;
+    pool->count = 0;
+    if (pool->slots) memset(pool->slots, 0, pool->num_slots * sizeof(int));
+}
+
+void string_pool_attach(StringPool *pool, const char *data, size_t size) {
+    string_pool_free(pool);
+    // Only read until interning needs to copy; see string_pool_intern()
+    pool->data = (char *)data;
+    pool->size = size;
+}
+
+// Finds the slot holding text, or the empty slot where it belongs
+static int *find_slot(const StringPool *pool, const char *text, size_t length) {
+    uint32_t mask = (uint32_t)pool->num_slots - 1;
+    for (uint32_t i = hash_text(text, length) & mask;; i = (i + 1) & mask) {
+        int *slot = &pool->slots[i];
+        if (*slot == 0) return slot;
+        const char *stored = pool->data + *slot - 1;
+        if (strncmp(stored, text, length) == 0 && stored[length] == '\0') return slot;
+    }
+}
+
+static int grow_slots(StringPool *pool, int min_slots) {
+    int num_slots = pool->num_slots > 0 ? pool->num_slots * 2 : 64;
+    while (num_slots < min_slots) num_slots *= 2;
+    int *slots = calloc(num_slots, sizeof(int));
+    if (!slots) return -1;
+    int *old = pool->slots;
+    int old_count = pool->num_slots;
+    pool->slots = slots;
+    pool->num_slots = num_slots;
+    for (int i = 0; i < old_count; i++) {
+        if (old[i] == 0) continue;
+        const char *stored = pool->data + old[i] - 1;
+        *find_slot(pool, stored, strlen(stored)) = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+// Hashes the strings of an attached buffer, which has no table yet
+static int index_attached(StringPool *pool) {
+    int count = 0;
+    for (size_t i = 0; i < pool->size; i++) count += pool->data[i] == '\0';
+    if (grow_slots(pool, count * 2 + 2) != 0) return -1;
+    for (size_t i = 0; i < pool->size; i += strlen(pool->data + i) + 1) {
+        int *slot = find_slot(pool, pool->data + i, strlen(pool->data + i));
+        if (*slot == 0) {
+            *slot = (int)i + 1;
+            pool->count++;
+        }
+    }
+    return 0;
+}
+
+int string_pool_intern(StringPool *pool, const char *text, size_t length) {
+    if (pool->num_slots == 0 && pool->size > 0 && index_attached(pool) != 0) return -1;
+    // Keep the table at most half full
+    if ((pool->count + 1) * 2 > pool->num_slots && grow_slots(pool, 0) != 0) return -1;
+    int *slot = find_slot(pool, text, length);
+    if (*slot != 0) return *slot - 1;
+
+    if (pool->size + length + 1 >= (size_t)INT_MAX) return -1;
+    if (pool->size + length + 1 > pool->capacity) {
+        size_t capacity = pool->capacity > 0 ? pool->capacity * 2 : 256;
+        while (capacity < pool->size + length + 1) capacity *= 2;
+        // text may point into the buffer being moved
+        int inside = pool->data && text >= pool->data && text < pool->data + pool->size;
+        size_t text_offset = inside ? (size_t)(text - pool->data) : 0;
+        char *data;
+        if (pool->capacity > 0) {
+            data = realloc(pool->data, capacity);
+        } else {
+            // First growth of an attached buffer: take a private copy
+            data = malloc(capacity);
+            if (data && pool->size > 0) memcpy(data, pool->data, pool->size);
+        }
+        if (!data) return -1;
+        pool->data = data;
+        if (inside) text = data + text_offset;
+        pool->capacity = capacity;
+    }
+    int offset = (int)pool->size;
+    memcpy(pool->data + offset, text, length);
+    pool->data[offset + length] = '\0';
+    pool->size += length + 1;
+    pool->count++;
+    *slot = offset + 1;
+    return offset;
+}
@@ -0,0 +1,36 @@
+#ifndef DELIVERY_STRING_POOL_H
+#define DELIVERY_STRING_POOL_H
+
+#include <stddef.h>
+
+// Interned strings in one growable buffer. Each distinct string is stored
+// once, NUL terminated, and referred to by its byte offset. A pool can also
+// borrow a read-only buffer (capacity 0), which is copied on the first
+// intern that adds a string.
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+    int *slots;          // open addressing: offset + 1 per slot, 0 = empty
+    int num_slots;       // power of two
+    int count;
+} StringPool;
+
+void string_pool_init(StringPool *pool);
+void string_pool_free(StringPool *pool);
+// Forgets every string but keeps the memory for reuse.
+void string_pool_clear(StringPool *pool);
+
+// Borrows size bytes of consecutive NUL-terminated strings (e.g. from a
+// mapped file). The buffer must outlive the pool or the next clear().
+void string_pool_attach(StringPool *pool, const char *data, size_t size);
+
+// Offset of text[0..length) in the pool, adding it if needed. Returns -1 on
+// allocation failure.
+int string_pool_intern(StringPool *pool, const char *text, size_t length);
+
+static inline const char *string_pool_get(const StringPool *pool, int offset) {
+    return pool->data + offset;
+}
+
+#endif
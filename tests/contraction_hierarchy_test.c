@@ -0,0 +1,140 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "contraction_hierarchy.h"
+#include "test_check.h"
+
+#define TEST_PATH "contraction_hierarchy_test.dlch"
+#define DAMAGED_PATH "contraction_hierarchy_test_damaged.dlch"
+#define SIDE 12
+
+// Layout the tests damage; see HierarchyHeader in contraction_hierarchy.c
+#define HEADER_VERSION 8
+#define HEADER_NUM_UP_ARCS 20
+#define HEADER_SIZE 40
+
+// side x side grid with varied integer street lengths
+static int make_grid(RoadGraph *graph, int side, double extra) {
+    RoadEdge edges[2 * SIDE * SIDE];
+    int count = 0;
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++) {
+            int u = r * side + c;
+            if (c + 1 < side) edges[count++] = (RoadEdge){u, u + 1, (double)((u * 7) % 13 + 1)};
+            if (r + 1 < side) edges[count++] = (RoadEdge){u, u + side, (double)((u * 5) % 11 + 1)};
+        }
+    }
+    edges[0].weight += extra;
+    return road_graph_build(graph, side * side, edges, count, 1);
+}
+
+// Loading the file data[0..size-1] for graph must fail and leave hierarchy empty
+static int load_fails(const char *data, size_t size, const RoadGraph *graph) {
+    ContractionHierarchy hierarchy;
+    if (test_write_file(DAMAGED_PATH, data, size) != 0) return 0;
+    int failed = contraction_hierarchy_load(&hierarchy, DAMAGED_PATH, graph) != 0;
+    return failed && hierarchy.num_nodes == 0 && !hierarchy.up_offsets;
+}
+
+static void test_round_trip(const ContractionHierarchy *built, const RoadGraph *graph) {
+    ContractionHierarchy loaded;
+    CHECK(contraction_hierarchy_save(built, TEST_PATH) == 0);
+    CHECK(contraction_hierarchy_load(&loaded, TEST_PATH, graph) == 0);
+    int n = built->num_nodes;
+    CHECK(loaded.num_nodes == n && loaded.graph_hash == built->graph_hash);
+    if (test_failures) return;
+    CHECK(memcmp(loaded.up_offsets, built->up_offsets, (n + 1) * sizeof(int)) == 0);
+    CHECK(memcmp(loaded.down_offsets, built->down_offsets, (n + 1) * sizeof(int)) == 0);
+    int up = built->up_offsets[n], down = built->down_offsets[n];
+    CHECK(memcmp(loaded.up_targets, built->up_targets, up * sizeof(int)) == 0);
+    CHECK(memcmp(loaded.up_weights, built->up_weights, up * sizeof(double)) == 0);
+    CHECK(memcmp(loaded.down_targets, built->down_targets, down * sizeof(int)) == 0);
+    CHECK(memcmp(loaded.down_weights, built->down_weights, down * sizeof(double)) == 0);
+
+    // The loaded hierarchy answers like Dijkstra on the graph
+    HierarchySearch search;
+    double *dist = malloc(n * sizeof(double));
+    CHECK(dist && hierarchy_search_init(&search, n) == 0);
+    for (int src = 0; dist && src < n; src += 17) {
+        road_graph_dijkstra(graph, src, -1, dist, NULL, NULL);
+        for (int target = 0; target < n; target++) {
+            CHECK(fabs(contraction_hierarchy_distance(&loaded, src, target, &search) - dist[target]) <
+                  1e-9);
+        }
+    }
+    hierarchy_search_free(&search);
+    free(dist);
+    contraction_hierarchy_free(&loaded);
+}
+
+static void test_damaged(const RoadGraph *graph) {
+    size_t size;
+    char *file = test_read_file(TEST_PATH, &size);
+    CHECK(file && size > HEADER_SIZE + (SIDE * SIDE + 1) * sizeof(int));
+    if (!file || size <= HEADER_SIZE + (SIDE * SIDE + 1) * sizeof(int)) {
+        free(file);
+        return;
+    }
+    char *data = malloc(size);
+
+    CHECK(load_fails(file, HEADER_SIZE - 1, graph));
+    CHECK(load_fails(file, size - 8, graph));
+
+    memcpy(data, file, size);
+    data[0] ^= 1;
+    CHECK(load_fails(data, size, graph));
+
+    memcpy(data, file, size);
+    uint32_t version = 2;
+    memcpy(data + HEADER_VERSION, &version, sizeof(version));
+    CHECK(load_fails(data, size, graph));
+
+    // More arcs than the file holds
+    memcpy(data, file, size);
+    int32_t arcs = 1 << 30;
+    memcpy(data + HEADER_NUM_UP_ARCS, &arcs, sizeof(arcs));
+    CHECK(load_fails(data, size, graph));
+
+    // An up offset going backwards, and an arc to a node out of range
+    int n = SIDE * SIDE;
+    memcpy(data, file, size);
+    int32_t offset = -1;
+    memcpy(data + HEADER_SIZE + sizeof(int32_t), &offset, sizeof(offset));
+    CHECK(load_fails(data, size, graph));
+    memcpy(data, file, size);
+    int32_t target = n;
+    memcpy(data + HEADER_SIZE + (n + 1) * sizeof(int32_t), &target, sizeof(target));
+    CHECK(load_fails(data, size, graph));
+
+    // Stale: one street changed length, or another graph altogether
+    RoadGraph changed, smaller;
+    CHECK(make_grid(&changed, SIDE, 1.0) == 0 && make_grid(&smaller, SIDE - 1, 0.0) == 0);
+    CHECK(load_fails(file, size, &changed));
+    CHECK(load_fails(file, size, &smaller));
+    // Without a graph to check against it loads
+    ContractionHierarchy hierarchy;
+    CHECK(contraction_hierarchy_load(&hierarchy, TEST_PATH, NULL) == 0);
+    contraction_hierarchy_free(&hierarchy);
+    road_graph_free(&changed);
+    road_graph_free(&smaller);
+    free(data);
+    free(file);
+}
+
+int main(void) {
+    RoadGraph graph;
+    ContractionHierarchy hierarchy;
+    CHECK(make_grid(&graph, SIDE, 0.0) == 0);
+    CHECK(contraction_hierarchy_build(&hierarchy, &graph, NULL) == 0);
+    if (test_failures) return TEST_RESULT();
+
+    test_round_trip(&hierarchy, &graph);
+    test_damaged(&graph);
+
+    contraction_hierarchy_free(&hierarchy);
+    road_graph_free(&graph);
+    remove(TEST_PATH);
+    remove(DAMAGED_PATH);
+    return TEST_RESULT();
+}
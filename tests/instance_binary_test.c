@@ -0,0 +1,152 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "instance_generator.h"
+#include "instance_io.h"
+#include "test_check.h"
+
+#define TEST_PATH "instance_binary_test.dlvb"
+#define DAMAGED_PATH "instance_binary_test_damaged.dlvb"
+
+// Header fields the tests damage; see BinaryHeader in instance_binary.c
+#define HEADER_VERSION 8
+#define HEADER_OFFSETS 40
+#define HEADER_SIZE (HEADER_OFFSETS + 21 * 8)
+#define COLUMN_POINT_NAME 1
+#define COLUMN_POINT_X 2
+
+static uint64_t column_offset(const char *data, int column) {
+    uint64_t offset;
+    memcpy(&offset, data + HEADER_OFFSETS + column * sizeof(uint64_t), sizeof(offset));
+    return offset;
+}
+
+static void set_column_offset(char *data, int column, uint64_t offset) {
+    memcpy(data + HEADER_OFFSETS + column * sizeof(uint64_t), &offset, sizeof(offset));
+}
+
+// Loading the file data[0..size-1] must fail and leave problem empty
+static int load_fails(DeliveryProblem *problem, const char *data, size_t size) {
+    if (test_write_file(DAMAGED_PATH, data, size) != 0) return 0;
+    int failed = load_instance_binary(DAMAGED_PATH, problem) != 0;
+    return failed && problem->points.count == 0 && problem->packages.count == 0;
+}
+
+static void test_round_trip(const DeliveryProblem *problem, DeliveryProblem *loaded) {
+    CHECK(write_instance_binary(TEST_PATH, problem) == 0);
+    CHECK(load_instance_binary(TEST_PATH, loaded) == 0);
+    CHECK(loaded->points.count == problem->points.count);
+    CHECK(loaded->packages.count == problem->packages.count);
+    CHECK(loaded->routes.count == problem->routes.count);
+    if (test_failures) return;
+
+    const PointTable *a = &problem->points, *b = &loaded->points;
+    for (int i = 0; i < a->count; i++) {
+        CHECK(a->id[i] == b->id[i] && a->x[i] == b->x[i] && a->y[i] == b->y[i]);
+        CHECK(a->is_depot[i] == b->is_depot[i] && a->package_count[i] == b->package_count[i]);
+        CHECK(a->window_open[i] == b->window_open[i] && a->window_close[i] == b->window_close[i]);
+        CHECK(strcmp(string_pool_get(&problem->names, a->name[i]),
+                     string_pool_get(&loaded->names, b->name[i])) == 0);
+    }
+    const PackageTable *p = &problem->packages, *q = &loaded->packages;
+    for (int i = 0; i < p->count; i++) {
+        CHECK(p->id[i] == q->id[i] && p->weight[i] == q->weight[i] && p->value[i] == q->value[i]);
+        CHECK(p->priority[i] == q->priority[i] && p->destination_id[i] == q->destination_id[i]);
+    }
+    const RouteTable *r = &problem->routes, *s = &loaded->routes;
+    for (int i = 0; i < r->count; i++) {
+        CHECK(r->from[i] == s->from[i] && r->to[i] == s->to[i] && r->distance[i] == s->distance[i]);
+    }
+    CHECK(memcmp(problem->sla_minutes, loaded->sla_minutes, sizeof(problem->sla_minutes)) == 0);
+}
+
+// Loading over a problem that owns its tables frees them (LeakSanitizer
+// would see them otherwise) and leaves nothing marked as owned, so the
+// first edit copies the column out of the mapping
+static void test_load_over_owned(const DeliveryProblem *problem) {
+    DeliveryProblem *owned = delivery_problem_new();
+    InstanceSpec spec = {INSTANCE_RANDOM, 80, 9, 0};
+    CHECK(owned && generate_instance(owned, &spec) == 0 && owned->points.capacity > 0);
+    CHECK(load_instance_binary(TEST_PATH, owned) == 0);
+    CHECK(owned->points.count == problem->points.count);
+    CHECK(owned->points.capacity == 0 && owned->packages.capacity == 0);
+    CHECK(owned->routes.capacity == 0 && owned->names.capacity == 0);
+    CHECK(strcmp(string_pool_get(&owned->names, owned->points.name[1]),
+                 string_pool_get(&problem->names, problem->points.name[1])) == 0);
+
+    double close = problem->points.window_close[5];
+    CHECK(delivery_problem_set_window(owned, 5, 0, close + 60, 0) == 0);
+    CHECK(owned->points.capacity > 0 && owned->points.window_close[5] == close + 60);
+    DeliveryProblem *again = delivery_problem_new();
+    CHECK(again && load_instance_binary(TEST_PATH, again) == 0);
+    CHECK(again && again->points.window_close[5] == close);
+    delivery_problem_free(again);
+    delivery_problem_free(owned);
+}
+
+static void test_damaged(DeliveryProblem *problem) {
+    size_t size;
+    char *file = test_read_file(TEST_PATH, &size);
+    CHECK(file && size > HEADER_SIZE);
+    if (!file || size <= HEADER_SIZE) {
+        free(file);
+        return;
+    }
+    char *data = malloc(size);
+
+    // Truncated: inside the header and inside the columns
+    CHECK(load_fails(problem, file, HEADER_SIZE - 1));
+    CHECK(load_fails(problem, file, size - 8));
+    CHECK(load_fails(problem, file, 0));
+
+    memcpy(data, file, size);
+    data[0] ^= 1;
+    CHECK(load_fails(problem, data, size));
+
+    memcpy(data, file, size);
+    uint32_t version = 1;
+    memcpy(data + HEADER_VERSION, &version, sizeof(version));
+    CHECK(load_fails(problem, data, size));
+
+    // Columns past the end, wrapping around and misaligned
+    uint64_t bad_offsets[] = {size, size + 64, UINT64_MAX - 7,
+                              column_offset(file, COLUMN_POINT_X) + 4};
+    for (size_t i = 0; i < sizeof(bad_offsets) / sizeof(bad_offsets[0]); i++) {
+        memcpy(data, file, size);
+        set_column_offset(data, COLUMN_POINT_X, bad_offsets[i]);
+        CHECK(load_fails(problem, data, size));
+    }
+
+    // A point name outside the name pool
+    memcpy(data, file, size);
+    int32_t name = 1 << 30;
+    memcpy(data + column_offset(file, COLUMN_POINT_NAME), &name, sizeof(name));
+    CHECK(load_fails(problem, data, size));
+
+    // The undamaged file still loads
+    CHECK(load_instance_binary(TEST_PATH, problem) == 0);
+    free(data);
+    free(file);
+}
+
+int main(void) {
+    DeliveryProblem *problem = delivery_problem_new();
+    DeliveryProblem *loaded = delivery_problem_new();
+    InstanceSpec spec = {INSTANCE_CLUSTERED, 50, 3, 0};
+    CHECK(problem && loaded && generate_instance(problem, &spec) == 0);
+    if (test_failures) return TEST_RESULT();
+    CHECK(delivery_problem_set_window(problem, 5, 30, 90, 2) == 0);
+    CHECK(delivery_problem_set_window(problem, 7, 0, INFINITY, 5) == 0);
+    CHECK(delivery_problem_set_sla(problem, PACKAGE_PRIORITY_PREMIUM, 240) == 0);
+
+    test_round_trip(problem, loaded);
+    test_load_over_owned(problem);
+    test_damaged(loaded);
+
+    delivery_problem_free(problem);
+    delivery_problem_free(loaded);
+    remove(TEST_PATH);
+    remove(DAMAGED_PATH);
+    return TEST_RESULT();
+}
@@ -0,0 +1,174 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cvrp.h"
+#include "instance_generator.h"
+#include "plan_file.h"
+#include "test_check.h"
+
+#define TEST_PATH "plan_file_test.dlvp"
+#define DAMAGED_PATH "plan_file_test_damaged.dlvp"
+
+// Header fields the tests damage; see PlanHeader in plan_file.c
+#define HEADER_VERSION 8
+#define HEADER_NUM_STOPS 24
+#define HEADER_STOPS_OFFSET 56
+#define HEADER_VEHICLES_OFFSET 64
+#define HEADER_SIZE 72
+
+static uint64_t read_u64(const char *data, size_t at) {
+    uint64_t value;
+    memcpy(&value, data + at, sizeof(value));
+    return value;
+}
+
+static void write_u64(char *data, size_t at, uint64_t value) {
+    memcpy(data + at, &value, sizeof(value));
+}
+
+static void write_i32(char *data, size_t at, int32_t value) {
+    memcpy(data + at, &value, sizeof(value));
+}
+
+// Opening the file data[0..size-1] must fail and leave plan empty
+static int open_fails(const char *data, size_t size) {
+    PlanFile plan;
+    if (test_write_file(DAMAGED_PATH, data, size) != 0) return 0;
+    int failed = plan_file_open(&plan, DAMAGED_PATH) != 0;
+    return failed && plan.num_vehicles == 0 && !plan.vehicles;
+}
+
+// Opens the file data[0..size-1]; whether it opens and vehicle's stops are refused
+static int stops_refused(const char *data, size_t size, int vehicle) {
+    PlanFile plan;
+    if (test_write_file(DAMAGED_PATH, data, size) != 0 ||
+        plan_file_open(&plan, DAMAGED_PATH) != 0) {
+        return 0;
+    }
+    int refused = plan_file_vehicle_stops(&plan, vehicle) == NULL;
+    plan_file_close(&plan);
+    return refused;
+}
+
+static void test_round_trip(const DeliveryProblem *problem, const DeliveryPlan *solved) {
+    PlanSchedule schedule;
+    PlanFile plan;
+    CHECK(plan_schedule_build(&schedule, problem, solved) == 0);
+    CHECK(write_plan_binary(TEST_PATH, problem, solved) == 0);
+    CHECK(plan_file_open(&plan, TEST_PATH) == 0);
+    if (test_failures) return;
+    CHECK(plan.num_vehicles == schedule.num_vehicles && plan.num_stops == schedule.num_stops);
+    CHECK(plan.num_points == problem->points.count && plan_file_matches(&plan, problem));
+    CHECK(plan.total_distance == solved->total_distance);
+    CHECK(memcmp(plan.vehicles, schedule.vehicles,
+                 schedule.num_vehicles * sizeof(PlanVehicle)) == 0);
+    CHECK(memcmp(plan.stops, schedule.stops, schedule.num_stops * sizeof(PlanStop)) == 0);
+    for (int v = 0; v < plan.num_vehicles; v++) {
+        const PlanStop *stops = plan_file_vehicle_stops(&plan, v);
+        CHECK(stops && stops[0].point == solved->vehicles[v].depot);
+    }
+
+    // Stale: the same number of points elsewhere
+    DeliveryProblem *other = delivery_problem_new();
+    InstanceSpec spec = {INSTANCE_RANDOM, problem->points.count, 99, 0};
+    CHECK(other && generate_instance(other, &spec) == 0);
+    CHECK(!plan_file_matches(&plan, other));
+    delivery_problem_free(other);
+    plan_file_close(&plan);
+    plan_schedule_free(&schedule);
+}
+
+static void test_damaged(int num_points) {
+    size_t size;
+    char *file = test_read_file(TEST_PATH, &size);
+    CHECK(file && size > HEADER_SIZE);
+    if (!file || size <= HEADER_SIZE) {
+        free(file);
+        return;
+    }
+    char *data = malloc(size);
+    uint64_t stops_offset = read_u64(file, HEADER_STOPS_OFFSET);
+    uint64_t vehicles_offset = read_u64(file, HEADER_VEHICLES_OFFSET);
+    uint64_t num_stops = read_u64(file, HEADER_NUM_STOPS);
+
+    // Truncated: inside the header and inside the vehicle table
+    CHECK(open_fails(file, HEADER_SIZE - 1));
+    CHECK(open_fails(file, size - 8));
+
+    memcpy(data, file, size);
+    data[0] ^= 1;
+    CHECK(open_fails(data, size));
+
+    memcpy(data, file, size);
+    uint32_t version = 2;
+    memcpy(data + HEADER_VERSION, &version, sizeof(version));
+    CHECK(open_fails(data, size));
+
+    // Tables past the end, wrapping around or misaligned, and more stops
+    // than the file holds
+    struct {
+        size_t field;
+        uint64_t value;
+    } bad[] = {
+        {HEADER_STOPS_OFFSET, size},
+        {HEADER_STOPS_OFFSET, UINT64_MAX - 7},
+        {HEADER_STOPS_OFFSET, stops_offset + 4},
+        {HEADER_VEHICLES_OFFSET, size},
+        {HEADER_VEHICLES_OFFSET, UINT64_MAX - 7},
+        {HEADER_VEHICLES_OFFSET, vehicles_offset + 4},
+        {HEADER_NUM_STOPS, num_stops + 1000},
+        {HEADER_NUM_STOPS, UINT64_MAX / 2},
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        memcpy(data, file, size);
+        write_u64(data, bad[i].field, bad[i].value);
+        CHECK(open_fails(data, size));
+    }
+
+    // A vehicle whose stops lie outside the stop table
+    size_t first_vehicle = vehicles_offset;
+    memcpy(data, file, size);
+    write_u64(data, first_vehicle + offsetof(PlanVehicle, first_stop), num_stops);
+    CHECK(open_fails(data, size));
+    memcpy(data, file, size);
+    write_i32(data, first_vehicle + offsetof(PlanVehicle, num_stops), -1);
+    CHECK(open_fails(data, size));
+
+    // Stops and depots naming points outside the instance open, but their
+    // vehicle's stops are refused
+    memcpy(data, file, size);
+    write_i32(data, stops_offset + offsetof(PlanStop, point), num_points);
+    CHECK(stops_refused(data, size, 0));
+    memcpy(data, file, size);
+    write_i32(data, stops_offset + offsetof(PlanStop, point), -1);
+    CHECK(stops_refused(data, size, 0));
+    memcpy(data, file, size);
+    write_i32(data, first_vehicle + offsetof(PlanVehicle, depot), num_points);
+    CHECK(stops_refused(data, size, 0));
+    CHECK(!stops_refused(file, size, 0));
+    free(data);
+    free(file);
+}
+
+int main(void) {
+    DeliveryProblem *problem = delivery_problem_new();
+    InstanceSpec spec = {INSTANCE_CLUSTERED, 60, 5, 0};
+    DeliveryPlan plan = {0};
+    CvrpOptions options;
+    cvrp_default_options(&options);
+    options.vehicle_capacity = 40;
+    CHECK(problem && generate_instance(problem, &spec) == 0);
+    CHECK(delivery_problem_set_window(problem, 3, 10, 120, 4) == 0);
+    CHECK(cvrp_solve(problem, &options, NULL, &plan, NULL) == 0 && plan.num_vehicles > 1);
+    if (test_failures) return TEST_RESULT();
+
+    test_round_trip(problem, &plan);
+    test_damaged(problem->points.count);
+
+    delivery_plan_clear(&plan);
+    delivery_problem_free(problem);
+    remove(TEST_PATH);
+    remove(DAMAGED_PATH);
+    return TEST_RESULT();
+}
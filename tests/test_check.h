@@ -0,0 +1,47 @@
+#ifndef DELIVERY_TEST_CHECK_H
+#define DELIVERY_TEST_CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Minimal checks for the file format tests: a failed CHECK prints its line
+// and the test goes on, TEST_RESULT() is then the exit status.
+static int test_failures;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                    #condition);                                              \
+            test_failures++;                                                  \
+        }                                                                     \
+    } while (0)
+
+#define TEST_RESULT() (test_failures ? 1 : 0)
+
+// Whole file into a malloc'ed buffer. Returns NULL on error.
+static char *test_read_file(const char *path, size_t *size) {
+    FILE *in = fopen(path, "rb");
+    if (!in) return NULL;
+    fseek(in, 0, SEEK_END);
+    long length = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    char *data = length >= 0 ? malloc(length > 0 ? length : 1) : NULL;
+    if (data && fread(data, 1, length, in) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(in);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+static int test_write_file(const char *path, const char *data, size_t size) {
+    FILE *out = fopen(path, "wb");
+    if (!out) return -1;
+    int status = fwrite(data, 1, size, out) == size ? 0 : -1;
+    if (fclose(out) != 0) status = -1;
+    return status;
+}
+
+#endif
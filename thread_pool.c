@@ -0,0 +1,152 @@
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+struct ThreadPool {
+    int num_threads;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned long generation;  // bumped for every parallel_for call
+    int busy_workers;
+    int shutting_down;
+
+    ThreadPoolTask task;
+    void *context;
+    int count;
+    atomic_int next_index;
+};
+
+typedef struct {
+    ThreadPool *pool;
+    int worker;
+} WorkerStart;
+
+int thread_pool_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+static void run_indices(ThreadPool *pool, int worker) {
+    for (;;) {
+        int index = atomic_fetch_add_explicit(&pool->next_index, 1, memory_order_relaxed);
+        if (index >= pool->count) break;
+        pool->task(pool->context, index, worker);
+    }
+}
+
+static void *worker_main(void *arg) {
+    WorkerStart start = *(WorkerStart *)arg;
+    ThreadPool *pool = start.pool;
+    free(arg);
+
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutting_down && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutting_down) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_indices(pool, start.worker);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy_workers == 0) pthread_cond_signal(&pool->work_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ThreadPool *thread_pool_create(int num_threads) {
+    if (num_threads <= 0) num_threads = thread_pool_cpu_count();
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->threads = calloc(num_threads, sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    atomic_init(&pool->next_index, 0);
+
+    // Worker 0 is whoever calls parallel_for, so only start the others
+    pool->num_threads = 1;
+    for (int i = 1; i < num_threads; i++) {
+        WorkerStart *start = malloc(sizeof(WorkerStart));
+        if (!start) break;
+        start->pool = pool;
+        start->worker = i;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, start) != 0) {
+            free(start);
+            break;
+        }
+        pool->num_threads++;
+    }
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->work_done);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool ? pool->num_threads : 1;
+}
+
+void thread_pool_parallel_for(ThreadPool *pool, int count, ThreadPoolTask task, void *context) {
+    if (count <= 0) return;
+    if (!pool || pool->num_threads == 1 || count == 1) {
+        for (int i = 0; i < count; i++) task(context, i, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->count = count;
+    atomic_store_explicit(&pool->next_index, 0, memory_order_relaxed);
+    pool->busy_workers = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_indices(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy_workers > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
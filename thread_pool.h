@@ -0,0 +1,22 @@
+#ifndef DELIVERY_THREAD_POOL_H
+#define DELIVERY_THREAD_POOL_H
+
+typedef struct ThreadPool ThreadPool;
+
+// Called once per index. worker is in [0, thread_pool_size()) and is unique
+// among the calls running at the same time, so it can select per-thread
+// scratch memory.
+typedef void (*ThreadPoolTask)(void *context, int index, int worker);
+
+// Creates a pool with num_threads workers in total, including the calling
+// thread. num_threads <= 0 uses one worker per online CPU.
+ThreadPool *thread_pool_create(int num_threads);
+void thread_pool_destroy(ThreadPool *pool);
+int thread_pool_size(const ThreadPool *pool);
+int thread_pool_cpu_count(void);
+
+// Runs task for every index in [0, count) and returns when all are done.
+// The calling thread takes part as worker 0. A NULL pool runs serially.
+void thread_pool_parallel_for(ThreadPool *pool, int count, ThreadPoolTask task, void *context);
+
+#endif
@@ -0,0 +1,246 @@
+#include "time_window.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rounding allowance when comparing times, in minutes
+#define TIME_EPSILON 1e-6
+
+int time_windows_init(TimeWindows *windows, int count, double speed) {
+    memset(windows, 0, sizeof(TimeWindows));
+    size_t bytes = (count > 0 ? count : 1) * sizeof(double);
+    windows->open = malloc(bytes);
+    windows->close = malloc(bytes);
+    windows->service = malloc(bytes);
+    windows->late_weight = malloc(bytes);
+    if (!windows->open || !windows->close || !windows->service || !windows->late_weight) {
+        time_windows_free(windows);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        windows->open[i] = 0;
+        windows->close[i] = INFINITY;
+        windows->service[i] = 0;
+        windows->late_weight[i] = 1;
+    }
+    windows->count = count;
+    windows->speed = speed;
+    return 0;
+}
+
+void time_windows_free(TimeWindows *windows) {
+    free(windows->open);
+    free(windows->close);
+    free(windows->service);
+    free(windows->late_weight);
+    memset(windows, 0, sizeof(TimeWindows));
+}
+
+// Service start when reaching stop at arrival
+static inline double service_start(const TimeWindows *windows, int stop, double arrival) {
+    return arrival > windows->open[stop] ? arrival : windows->open[stop];
+}
+
+int tour_schedule_reserve(TourSchedule *schedule, int length) {
+    if (length + 1 <= schedule->capacity) return 0;
+    size_t bytes = (length + 1) * sizeof(double);
+    double *start = realloc(schedule->start, bytes);
+    if (start) schedule->start = start;
+    double *limit = realloc(schedule->limit, bytes);
+    if (limit) schedule->limit = limit;
+    double *latest = realloc(schedule->latest, bytes);
+    if (latest) schedule->latest = latest;
+    if (!start || !limit || !latest) return -1;
+    schedule->capacity = length + 1;
+    return 0;
+}
+
+int tour_schedule_update(TourSchedule *schedule, const TimeWindows *windows,
+                         const DistanceMatrix *matrix, const int *stops, int length) {
+    if (tour_schedule_reserve(schedule, length) != 0) return -1;
+    schedule->stops = stops;
+    schedule->length = length;
+    if (length == 0) return 0;
+
+    int depot = stops[0];
+    double *start = schedule->start, *limit = schedule->limit, *latest = schedule->latest;
+    start[0] = windows->open[depot];
+    limit[0] = start[0];
+    for (int r = 1; r <= length; r++) {
+        int from = stops[r - 1], to = stops[r < length ? r : 0];
+        double arrival = start[r - 1] + windows->service[from] +
+                         time_window_travel(windows, matrix, from, to);
+        // The return to the depot ends the tour, there is nothing to wait for
+        start[r] = r < length ? service_start(windows, to, arrival) : arrival;
+        limit[r] = windows->close[to] > start[r] ? windows->close[to] : start[r];
+    }
+    latest[length] = limit[length];
+    for (int r = length - 1; r >= 0; r--) {
+        int from = stops[r], to = stops[r + 1 < length ? r + 1 : 0];
+        double next = latest[r + 1] - windows->service[from] -
+                      time_window_travel(windows, matrix, from, to);
+        latest[r] = next < limit[r] ? next : limit[r];
+    }
+    return 0;
+}
+
+void tour_schedule_free(TourSchedule *schedule) {
+    free(schedule->start);
+    free(schedule->limit);
+    free(schedule->latest);
+    memset(schedule, 0, sizeof(TourSchedule));
+}
+
+// Whether leaving stop at depart and driving on to the stop at position
+// keeps that position and everything after it within the limits. Waiting
+// absorbs an early arrival, so only the latest start matters.
+static int rejoin(const TourSchedule *schedule, const TimeWindows *windows,
+                  const DistanceMatrix *matrix, int stop, double depart, int position) {
+    int next = schedule->stops[position < schedule->length ? position : 0];
+    double arrival = depart + time_window_travel(windows, matrix, stop, next);
+    return arrival <= schedule->latest[position] + TIME_EPSILON;
+}
+
+// Visiting stop between positions after and next
+static double visit_lateness(const TourSchedule *schedule, const TimeWindows *windows,
+                             const DistanceMatrix *matrix, int after, int stop, int next) {
+    int before = schedule->stops[after];
+    double arrival = schedule->start[after] + windows->service[before] +
+                     time_window_travel(windows, matrix, before, stop);
+    double start = service_start(windows, stop, arrival);
+    if (!rejoin(schedule, windows, matrix, stop, start + windows->service[stop], next)) {
+        return INFINITY;
+    }
+    return start > windows->close[stop] + TIME_EPSILON ? start - windows->close[stop] : 0;
+}
+
+double tour_schedule_insert_lateness(const TourSchedule *schedule, const TimeWindows *windows,
+                                     const DistanceMatrix *matrix, int position, int stop) {
+    return visit_lateness(schedule, windows, matrix, position, stop, position + 1);
+}
+
+double tour_schedule_replace_lateness(const TourSchedule *schedule, const TimeWindows *windows,
+                                      const DistanceMatrix *matrix, int position, int stop) {
+    return visit_lateness(schedule, windows, matrix, position - 1, stop, position + 1);
+}
+
+// Drives through positions first..last, forward or backward, after leaving
+// *stop at *depart; returns 0 as soon as one starts past its limit
+static int drive_segment(const TourSchedule *schedule, const TimeWindows *windows,
+                         const DistanceMatrix *matrix, int first, int last, int reversed,
+                         int *stop, double *depart) {
+    for (int i = 0; i <= last - first; i++) {
+        int r = reversed ? last - i : first + i;
+        int next = schedule->stops[r];
+        double start = service_start(windows, next,
+                                     *depart + time_window_travel(windows, matrix, *stop, next));
+        if (start > schedule->limit[r] + TIME_EPSILON) return 0;
+        *stop = next;
+        *depart = start + windows->service[next];
+    }
+    return 1;
+}
+
+int tour_schedule_reverse_ok(const TourSchedule *schedule, const TimeWindows *windows,
+                             const DistanceMatrix *matrix, int first, int last) {
+    int stop = schedule->stops[first - 1];
+    double depart = schedule->start[first - 1] + windows->service[stop];
+    return drive_segment(schedule, windows, matrix, first, last, 1, &stop, &depart) &&
+           rejoin(schedule, windows, matrix, stop, depart, last + 1);
+}
+
+int tour_schedule_move_ok(const TourSchedule *schedule, const TimeWindows *windows,
+                          const DistanceMatrix *matrix, int first, int last, int reversed,
+                          int after) {
+    // Moving the segment later, the old start at after bounds the new one
+    int stop = schedule->stops[after];
+    double depart = schedule->start[after] + windows->service[stop];
+    return drive_segment(schedule, windows, matrix, first, last, reversed, &stop, &depart) &&
+           rejoin(schedule, windows, matrix, stop, depart, after + 1);
+}
+
+void time_window_report(const TimeWindows *windows, const DistanceMatrix *matrix, const int *stops,
+                        int length, TimeWindowReport *report) {
+    memset(report, 0, sizeof(TimeWindowReport));
+    if (length == 0) return;
+    double time = windows->open[stops[0]];
+    for (int r = 1; r <= length; r++) {
+        int from = stops[r - 1], to = stops[r < length ? r : 0];
+        time += windows->service[from] + time_window_travel(windows, matrix, from, to);
+        if (r < length) time = service_start(windows, to, time);
+        double late = time - windows->close[to];
+        if (late > TIME_EPSILON) {
+            report->late_stops++;
+            if (windows->late_weight[to] >= PREMIUM_LATE_WEIGHT) report->late_premium++;
+            report->late_minutes += late;
+            report->penalty += late * windows->late_weight[to];
+        }
+    }
+    report->finish = time;
+}
+
+typedef struct {
+    double weight;
+    double close;
+    int order;
+    int stop;
+} InsertKey;
+
+// Heaviest late weight first, then earliest deadline, then given order
+static int insert_key_compare(const void *a, const void *b) {
+    const InsertKey *x = a, *y = b;
+    if (x->weight != y->weight) return x->weight > y->weight ? -1 : 1;
+    if (x->close != y->close) return x->close < y->close ? -1 : 1;
+    return x->order - y->order;
+}
+
+int time_window_build_tour(const TimeWindows *windows, const DistanceMatrix *matrix,
+                           const int *stops, int length, int *tour) {
+    if (length == 0) return 0;
+    InsertKey *keys = malloc(length * sizeof(InsertKey));
+    TourSchedule schedule = {0};
+    if (!keys || tour_schedule_update(&schedule, windows, matrix, stops, length) != 0) {
+        free(keys);
+        tour_schedule_free(&schedule);
+        return -1;
+    }
+    // The stops the seed gets to late come out, the rest keep their order
+    // and, as taking stops out only makes the others earlier, stay on time
+    int count = 0, late = 0;
+    for (int i = 0; i < length; i++) {
+        int stop = stops[i];
+        if (i > 0 && schedule.start[i] > windows->close[stop] + TIME_EPSILON) {
+            keys[late++] = (InsertKey){windows->late_weight[stop], windows->close[stop], i, stop};
+        } else {
+            tour[count++] = stop;
+        }
+    }
+    qsort(keys, late, sizeof(InsertKey), insert_key_compare);
+
+    for (int k = 0; k < late; k++) {
+        int stop = keys[k].stop;
+        tour_schedule_update(&schedule, windows, matrix, tour, count);
+        // With no position that keeps the others on time it goes last
+        int best = count - 1;
+        double best_late = INFINITY, best_added = INFINITY;
+        for (int p = 0; p < count; p++) {
+            double lateness = tour_schedule_insert_lateness(&schedule, windows, matrix, p, stop);
+            if (!isfinite(lateness) || lateness > best_late) continue;
+            int a = tour[p], b = tour[p + 1 < count ? p + 1 : 0];
+            double added = distance_matrix_get(matrix, a, stop) + distance_matrix_get(matrix, stop, b) -
+                           distance_matrix_get(matrix, a, b);
+            if (lateness < best_late || added < best_added) {
+                best = p;
+                best_late = lateness;
+                best_added = added;
+            }
+        }
+        memmove(tour + best + 2, tour + best + 1, (count - best - 1) * sizeof(int));
+        tour[best + 1] = stop;
+        count++;
+    }
+    tour_schedule_free(&schedule);
+    free(keys);
+    return 0;
+}
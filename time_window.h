@@ -0,0 +1,102 @@
+#ifndef DELIVERY_TIME_WINDOW_H
+#define DELIVERY_TIME_WINDOW_H
+
+#include "distance_matrix.h"
+
+// Late minutes at a stop with premium packages count this many times over
+#define PREMIUM_LATE_WEIGHT 10.0
+
+// Delivery windows per stop (matrix index), in minutes after the shift
+// starts. A vehicle arriving before open waits; service starting after close
+// is late. close is INFINITY for stops without a deadline. Driving time is
+// matrix distance / speed.
+typedef struct {
+    int count;
+    double *open;
+    double *close;
+    double *service;      // minutes spent at the stop
+    double *late_weight;  // penalty per late minute
+    double speed;         // distance units per minute
+    int constrained;      // stops with an opening time or a deadline
+} TimeWindows;
+
+// Schedule of one closed tour in route order: position 0 is the depot and
+// position length the return to it. The forward pass gives the earliest
+// service start at every position, the backward pass the latest start that
+// keeps every later position within its limit. A stop's limit is its close,
+// or its current start when it is already late, so moves checked against
+// the schedule never make any stop later than it may be or already was.
+// The difference latest - start is the slack a delay at that position can
+// use up, which makes the checks below O(1) plus the stops they move.
+typedef struct {
+    int length;
+    int capacity;
+    const int *stops;     // tour the arrays describe, must not change until the next update
+    double *start;
+    double *limit;
+    double *latest;
+} TourSchedule;
+
+typedef struct {
+    int late_stops;
+    int late_premium;     // late stops with late_weight >= PREMIUM_LATE_WEIGHT
+    double late_minutes;
+    double penalty;       // late minutes times late_weight
+    double finish;        // return to the depot
+} TimeWindowReport;
+
+// Every stop open from 0 with no deadline, service 0 and weight 1.
+// Returns 0 or -1.
+int time_windows_init(TimeWindows *windows, int count, double speed);
+void time_windows_free(TimeWindows *windows);
+
+static inline double time_window_travel(const TimeWindows *windows, const DistanceMatrix *matrix,
+                                        int from, int to) {
+    return distance_matrix_get(matrix, from, to) / windows->speed;
+}
+
+// Makes room for tours of up to length stops. Returns 0 or -1.
+int tour_schedule_reserve(TourSchedule *schedule, int length);
+// Recomputes both passes for the tour stops[0..length-1] in O(length).
+// Allocates only when length outgrows the reserve. Returns 0 or -1.
+int tour_schedule_update(TourSchedule *schedule, const TimeWindows *windows,
+                         const DistanceMatrix *matrix, const int *stops, int length);
+void tour_schedule_free(TourSchedule *schedule);
+
+// Inserting stop between positions position and position + 1: its own late
+// minutes, or INFINITY when a later stop would pass its limit. O(1).
+double tour_schedule_insert_lateness(const TourSchedule *schedule, const TimeWindows *windows,
+                                     const DistanceMatrix *matrix, int position, int stop);
+// The same for stop taking the place of the one at position (1 <= position
+// < length). O(1).
+double tour_schedule_replace_lateness(const TourSchedule *schedule, const TimeWindows *windows,
+                                      const DistanceMatrix *matrix, int position, int stop);
+// Whether reversing positions first..last (1 <= first <= last < length)
+// keeps every stop within its limit. O(last - first).
+int tour_schedule_reverse_ok(const TourSchedule *schedule, const TimeWindows *windows,
+                             const DistanceMatrix *matrix, int first, int last);
+// Whether moving positions first..last (possibly reversed) to between after
+// and after + 1 keeps every stop within its limit. Sufficient rather than
+// exact: with the matrix obeying the triangle inequality, stops the segment
+// no longer comes before only get earlier, and those it now comes before
+// are delayed by no more than the old tour could absorb from after + 1 on.
+// O(last - first).
+int tour_schedule_move_ok(const TourSchedule *schedule, const TimeWindows *windows,
+                          const DistanceMatrix *matrix, int first, int last, int reversed,
+                          int after);
+
+// Lateness of driving the closed tour from its depot at the depot's opening.
+void time_window_report(const TimeWindows *windows, const DistanceMatrix *matrix, const int *stops,
+                        int length, TimeWindowReport *report);
+
+// Repairs the closed tour stops[0..length-1] (depot first), e.g. the best
+// untimed one, for deadlines into tour, which must not overlap it: the
+// stops it gets to late are taken out and put back one by one, heaviest
+// late weight and then earliest close first, each where it adds the least
+// distance without making anyone late, failing that where only it is late
+// and least so, else last. Every other stop keeps its place in the order.
+// O(length * late stops). Returns 0 or -1.
+int time_window_build_tour(const TimeWindows *windows, const DistanceMatrix *matrix,
+                           const int *stops, int length, int *tour);
+
+#endif
@@ -0,0 +1,464 @@
+#include "tour_improve.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "solver_clock.h"
+
+#define GAIN_EPSILON 1e-6
+#define CLOCK_CHECK_INTERVAL 64
+
+// Search state. Stops are renumbered 0..n-1 ("local ids") so every array is
+// O(length) even when the tour only covers part of the matrix.
+typedef struct {
+    const DistanceMatrix *matrix;
+    const int *stop;     // local id -> matrix index
+    int n;
+    int *tour;           // position -> local id
+    int *pos;            // local id -> position
+    int *neighbours;     // n * k local ids, nearest first
+    int k;
+    double *best;        // k distances, used while building neighbours
+    int *queue;          // circular FIFO of stops whose don't-look bit is off
+    char *queued;
+    int queue_head;
+    int queue_size;
+    // Time windows only: the tour in route order (matrix indices, depot
+    // first) and its schedule
+    const TimeWindows *windows;
+    int *route;
+    TourSchedule schedule;
+} TourState;
+
+static inline double cost(const TourState *state, int a, int b) {
+    return distance_matrix_get(state->matrix, state->stop[a], state->stop[b]);
+}
+
+static inline int succ(const TourState *state, int a) {
+    int p = state->pos[a] + 1;
+    return state->tour[p == state->n ? 0 : p];
+}
+
+static inline int pred(const TourState *state, int a) {
+    int p = state->pos[a];
+    return state->tour[p == 0 ? state->n - 1 : p - 1];
+}
+
+// Position counted from the depot (local id 0) in route order
+static inline int rank_of(const TourState *state, int a) {
+    int r = state->pos[a] - state->pos[0];
+    return r < 0 ? r + state->n : r;
+}
+
+static void push_stop(TourState *state, int a) {
+    if (state->queued[a]) return;
+    state->queued[a] = 1;
+    state->queue[(state->queue_head + state->queue_size++) % state->n] = a;
+}
+
+static int pop_stop(TourState *state) {
+    int a = state->queue[state->queue_head];
+    state->queue_head = (state->queue_head + 1) % state->n;
+    state->queue_size--;
+    state->queued[a] = 0;
+    return a;
+}
+
+static void build_neighbours(TourState *state) {
+    int n = state->n, k = state->k;
+    double *best = state->best;
+    for (int a = 0; a < n; a++) {
+        int *list = state->neighbours + (size_t)a * k;
+        int count = 0;
+        for (int b = 0; b < n; b++) {
+            if (b == a) continue;
+            double d = cost(state, a, b);
+            if (!isfinite(d) || (count == k && d >= best[k - 1])) continue;
+            int slot = count < k ? count++ : k - 1;
+            while (slot > 0 && best[slot - 1] > d) {
+                best[slot] = best[slot - 1];
+                list[slot] = list[slot - 1];
+                slot--;
+            }
+            best[slot] = d;
+            list[slot] = b;
+        }
+        for (int i = count; i < k; i++) list[i] = -1;
+    }
+}
+
+// Reverses the stops at circular positions from..to (inclusive, walking
+// forward). Reverses the complementary side instead when that is shorter;
+// the resulting cycle is the same.
+static void reverse_path(TourState *state, int from, int to) {
+    int n = state->n;
+    int len = (to - from + n) % n + 1;
+    if (2 * len > n) {
+        int new_from = (to + 1) % n;
+        to = (from - 1 + n) % n;
+        from = new_from;
+        len = n - len;
+    }
+    for (int i = 0; i < len / 2; i++) {
+        int p = (from + i) % n;
+        int q = (to - i + n) % n;
+        int a = state->tour[p], b = state->tour[q];
+        state->tour[p] = b;
+        state->pos[b] = p;
+        state->tour[q] = a;
+        state->pos[a] = q;
+    }
+}
+
+// Plain reversal of exactly len positions starting at from.
+static void reverse_window(TourState *state, int from, int len) {
+    int n = state->n;
+    for (int i = 0; i < len / 2; i++) {
+        int p = (from + i) % n;
+        int q = (from + len - 1 - i) % n;
+        int a = state->tour[p], b = state->tour[q];
+        state->tour[p] = b;
+        state->pos[b] = p;
+        state->tour[q] = a;
+        state->pos[a] = q;
+    }
+}
+
+// Turns consecutive blocks A (len_a) B (len_b) starting at from into B A.
+static void swap_blocks(TourState *state, int from, int len_a, int len_b) {
+    reverse_window(state, from, len_a);
+    reverse_window(state, (from + len_a) % state->n, len_b);
+    reverse_window(state, from, len_a + len_b);
+}
+
+// Copies the current tour back to the caller's array, starting from the
+// original first stop.
+static void write_tour(const TourState *state, int *tour) {
+    int first = state->pos[0];
+    for (int i = 0; i < state->n; i++) {
+        tour[i] = state->stop[state->tour[(first + i) % state->n]];
+    }
+}
+
+static void refresh_schedule(TourState *state) {
+    write_tour(state, state->route);
+    // Cannot fail, the arrays were sized for this length up front
+    tour_schedule_update(&state->schedule, state->windows, state->matrix, state->route, state->n);
+}
+
+// 2-opt with time windows: reverses from..to (walking forward), or the rest
+// of the tour when the depot lies on that side, if the schedule allows it.
+static int reverse_timed(TourState *state, int from, int to, TourImproveStats *stats) {
+    int n = state->n;
+    int first = rank_of(state, from), last = rank_of(state, to);
+    if (first == 0 || first > last) {
+        int other = last + 1;
+        last = (first + n - 1) % n;
+        first = other;
+    }
+    if (!tour_schedule_reverse_ok(&state->schedule, state->windows, state->matrix, first, last)) {
+        stats->window_rejections++;
+        return 0;
+    }
+    reverse_window(state, (state->pos[0] + first) % n, last - first + 1);
+    refresh_schedule(state);
+    return 1;
+}
+
+// Or-opt with time windows: whether the segment at route positions
+// first..first + seg_len - 1 may go after stop x
+static int move_allowed(const TourState *state, int first, int seg_len, int reversed, int x,
+                        TourImproveStats *stats) {
+    if (!state->windows) return 1;
+    if (tour_schedule_move_ok(&state->schedule, state->windows, state->matrix, first,
+                              first + seg_len - 1, reversed, rank_of(state, x))) {
+        return 1;
+    }
+    stats->window_rejections++;
+    return 0;
+}
+
+static int try_two_opt(TourState *state, int a, TourImproveStats *stats) {
+    for (int forward = 1; forward >= 0; forward--) {
+        int a_next = forward ? succ(state, a) : pred(state, a);
+        double d_a = cost(state, a, a_next);
+        const int *list = state->neighbours + (size_t)a * state->k;
+
+        for (int i = 0; i < state->k && list[i] >= 0; i++) {
+            int c = list[i];
+            double g1 = d_a - cost(state, a, c);
+            if (g1 <= GAIN_EPSILON) break;
+            int c_next = forward ? succ(state, c) : pred(state, c);
+            if (c == a_next || c_next == a) continue;
+            stats->evaluations++;
+            stats->two_opt_evaluations++;
+
+            double gain = g1 + cost(state, c, c_next) - cost(state, a_next, c_next);
+            if (gain > GAIN_EPSILON) {
+                if (state->windows) {
+                    if (!reverse_timed(state, forward ? a_next : a, forward ? c : c_next, stats)) {
+                        continue;
+                    }
+                } else if (forward) {
+                    reverse_path(state, state->pos[a_next], state->pos[c]);
+                } else {
+                    reverse_path(state, state->pos[a], state->pos[c_next]);
+                }
+                push_stop(state, a);
+                push_stop(state, a_next);
+                push_stop(state, c);
+                push_stop(state, c_next);
+                stats->two_opt_moves++;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Moves the segment of seg_len stops starting at s1 between two adjacent
+// stops near either end of the segment, possibly reversed.
+static int try_or_opt(TourState *state, int s1, int seg_len, TourImproveStats *stats) {
+    int n = state->n;
+    if (seg_len + 2 >= n) return 0;
+
+    int first = 0;
+    if (state->windows) {
+        // The depot stays where it is
+        if ((state->pos[0] - state->pos[s1] + n) % n < seg_len) return 0;
+        first = rank_of(state, s1);
+    }
+
+    int s2 = state->tour[(state->pos[s1] + seg_len - 1) % n];
+    int p = pred(state, s1), nx = succ(state, s2);
+    double removal_gain = cost(state, p, s1) + cost(state, s2, nx) - cost(state, p, nx);
+    if (removal_gain <= GAIN_EPSILON) return 0;
+
+    int best_x = -1, best_reversed = 0;
+    double best_gain = GAIN_EPSILON;
+    for (int end = 0; end < 2; end++) {
+        int s = end ? s2 : s1;
+        const int *list = state->neighbours + (size_t)s * state->k;
+        for (int i = 0; i < state->k && list[i] >= 0; i++) {
+            int c = list[i];
+            if (cost(state, s, c) >= removal_gain) break;
+            // Skip stops inside the segment
+            if ((state->pos[c] - state->pos[s1] + n) % n < seg_len) continue;
+
+            // Try edge (c, succ c) and edge (pred c, c)
+            for (int side = 0; side < 2; side++) {
+                int x = side ? pred(state, c) : c;
+                int y = side ? c : succ(state, c);
+                if (x == s2 || y == s1) continue;
+                stats->evaluations++;
+                double base = removal_gain + cost(state, x, y);
+                double keep = base - cost(state, x, s1) - cost(state, s2, y);
+                double flip = base - cost(state, x, s2) - cost(state, s1, y);
+                if (keep > best_gain && move_allowed(state, first, seg_len, 0, x, stats)) {
+                    best_gain = keep;
+                    best_x = x;
+                    best_reversed = 0;
+                }
+                if (flip > best_gain && move_allowed(state, first, seg_len, 1, x, stats)) {
+                    best_gain = flip;
+                    best_x = x;
+                    best_reversed = 1;
+                }
+            }
+        }
+    }
+    if (best_x < 0) return 0;
+
+    int x = best_x, y = succ(state, x);
+    int seg_pos = state->pos[s1];
+    int forward_len = (state->pos[x] - state->pos[nx] + n) % n + 1;   // nx .. x
+    int backward_len = (state->pos[p] - state->pos[y] + n) % n + 1;   // y .. p
+    if (forward_len <= backward_len) {
+        swap_blocks(state, seg_pos, seg_len, forward_len);
+    } else {
+        swap_blocks(state, state->pos[y], backward_len, seg_len);
+    }
+    if (best_reversed) reverse_window(state, state->pos[s1], seg_len);
+    if (state->windows) refresh_schedule(state);
+
+    push_stop(state, p);
+    push_stop(state, nx);
+    push_stop(state, s1);
+    push_stop(state, s2);
+    push_stop(state, x);
+    push_stop(state, y);
+    stats->or_opt_moves++;
+    return 1;
+}
+
+// Neighbour lists from caller-supplied candidates (local ids), ordered by
+// matrix distance. Unreachable or repeated candidates are dropped.
+static void copy_candidates(TourState *state, const int *candidates, int candidate_count) {
+    int n = state->n, k = state->k;
+    double *best = state->best;
+    for (int a = 0; a < n; a++) {
+        int *list = state->neighbours + (size_t)a * k;
+        const int *offered = candidates + (size_t)a * candidate_count;
+        int count = 0;
+        for (int i = 0; i < candidate_count; i++) {
+            int b = offered[i];
+            if (b < 0 || b >= n || b == a) continue;
+            double d = cost(state, a, b);
+            if (!isfinite(d) || (count == k && d >= best[k - 1])) continue;
+            int duplicate = 0;
+            for (int j = 0; j < count && !duplicate; j++) duplicate = list[j] == b;
+            if (duplicate) continue;
+            int slot = count < k ? count++ : k - 1;
+            while (slot > 0 && best[slot - 1] > d) {
+                best[slot] = best[slot - 1];
+                list[slot] = list[slot - 1];
+                slot--;
+            }
+            best[slot] = d;
+            list[slot] = b;
+        }
+        for (int i = count; i < k; i++) list[i] = -1;
+    }
+}
+
+void tour_improve_default_options(TourImproveOptions *options) {
+    options->neighbours = 10;
+    options->two_opt = 1;
+    options->or_opt_segment = 3;
+    options->time_budget = 1.0;
+    options->windows = NULL;
+    options->progress = NULL;
+    options->progress_user = NULL;
+    options->progress_interval = 0.25;
+    options->arena = NULL;
+}
+
+static int report_progress(const TourState *state, int *tour, const TourImproveOptions *options) {
+    write_tour(state, tour);
+    double length = distance_matrix_tour_length(state->matrix, tour, state->n);
+    return options->progress(tour, state->n, length, options->progress_user);
+}
+
+int tour_improve(const DistanceMatrix *matrix, int *tour, int length,
+                 const TourImproveOptions *options, TourImproveStats *stats) {
+    return tour_improve_with_candidates(matrix, tour, length, NULL, 0, options, stats);
+}
+
+int tour_improve_with_candidates(const DistanceMatrix *matrix, int *tour, int length,
+                                 const int *candidates, int candidate_count,
+                                 const TourImproveOptions *options, TourImproveStats *stats) {
+    TourImproveOptions defaults;
+    TourImproveStats local_stats;
+    if (!options) {
+        tour_improve_default_options(&defaults);
+        options = &defaults;
+    }
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(TourImproveStats));
+    stats->initial_length = stats->final_length = distance_matrix_tour_length(matrix, tour, length);
+    if (length < 4 || (!options->two_opt && options->or_opt_segment <= 0)) return 0;
+
+    double start = solver_clock_seconds();
+    TourState state = {0};
+    state.matrix = matrix;
+    state.n = length;
+    state.k = options->neighbours > 0 ? options->neighbours : 1;
+    if (state.k > length - 1) state.k = length - 1;
+    Arena local_arena;
+    Arena *arena = options->arena;
+    if (!arena) {
+        arena_init(&local_arena, 0);
+        arena = &local_arena;
+    }
+    ArenaMark mark = arena_mark(arena);
+    int *stop = arena_alloc(arena, length * sizeof(int));
+    state.tour = arena_alloc(arena, length * sizeof(int));
+    state.pos = arena_alloc(arena, length * sizeof(int));
+    state.neighbours = arena_alloc(arena, (size_t)length * state.k * sizeof(int));
+    state.best = arena_alloc(arena, state.k * sizeof(double));
+    state.queue = arena_alloc(arena, length * sizeof(int));
+    state.queued = arena_calloc(arena, length, 1);
+    int status = 0;
+    if (!stop || !state.tour || !state.pos || !state.neighbours || !state.best || !state.queue ||
+        !state.queued) {
+        status = -1;
+        goto done;
+    }
+    memcpy(stop, tour, length * sizeof(int));
+    state.stop = stop;
+    for (int i = 0; i < length; i++) {
+        state.tour[i] = i;
+        state.pos[i] = i;
+    }
+    if (candidates) {
+        copy_candidates(&state, candidates, candidate_count);
+    } else {
+        build_neighbours(&state);
+    }
+    if (options->windows) {
+        state.windows = options->windows;
+        state.route = arena_alloc(arena, length * sizeof(int));
+        if (!state.route) {
+            status = -1;
+            goto done;
+        }
+        write_tour(&state, state.route);
+        if (tour_schedule_update(&state.schedule, state.windows, matrix, state.route, length) != 0) {
+            status = -1;
+            goto done;
+        }
+    }
+    for (int i = 0; i < length; i++) push_stop(&state, i);
+
+    double last_report = start;
+    if (options->progress && report_progress(&state, tour, options)) {
+        stats->cancelled = 1;
+        state.queue_size = 0;
+    }
+
+    int steps = 0;
+    int check_clock = options->time_budget > 0 || options->progress;
+    while (state.queue_size > 0) {
+        if (check_clock && ++steps % CLOCK_CHECK_INTERVAL == 0) {
+            double now = solver_clock_seconds();
+            if (options->time_budget > 0 && now - start > options->time_budget) {
+                stats->timed_out = 1;
+                break;
+            }
+            if (options->progress && now - last_report >= options->progress_interval) {
+                last_report = now;
+                if (report_progress(&state, tour, options)) {
+                    stats->cancelled = 1;
+                    break;
+                }
+            }
+        }
+        int a = pop_stop(&state);
+        int improved = options->two_opt && try_two_opt(&state, a, stats);
+        for (int len = 1; !improved && len <= options->or_opt_segment; len++) {
+            improved = try_or_opt(&state, a, len, stats);
+        }
+        if (improved) push_stop(&state, a);
+    }
+
+    write_tour(&state, tour);
+    stats->final_length = distance_matrix_tour_length(matrix, tour, length);
+
+done:
+    stats->elapsed = solver_clock_seconds() - start;
+    metrics_record_time(METRIC_TIMER_IMPROVE, stats->elapsed);
+    metrics_add(METRIC_TWO_OPT_TRIED, stats->two_opt_evaluations);
+    metrics_add(METRIC_TWO_OPT_APPLIED, stats->two_opt_moves);
+    metrics_add(METRIC_OR_OPT_TRIED, stats->evaluations - stats->two_opt_evaluations);
+    metrics_add(METRIC_OR_OPT_APPLIED, stats->or_opt_moves);
+    metrics_add(METRIC_WINDOW_REJECTIONS, stats->window_rejections);
+    tour_schedule_free(&state.schedule);
+    if (arena == &local_arena) {
+        arena_free(arena);
+    } else {
+        arena_release(arena, mark);
+    }
+    return status;
+}
@@ -0,0 +1,66 @@
+#ifndef DELIVERY_TOUR_IMPROVE_H
+#define DELIVERY_TOUR_IMPROVE_H
+
+#include <stdint.h>
+
+#include "arena.h"
+#include "distance_matrix.h"
+#include "time_window.h"
+
+typedef struct {
+    int neighbours;      // candidate list size per stop
+    int two_opt;         // non-zero enables 2-opt moves
+    int or_opt_segment;  // longest segment Or-opt may move, 0 disables it
+    double time_budget;  // seconds, <= 0 means run until no move improves
+    // Optional delivery windows (NULL = untimed). The tour is then driven
+    // from tour[0] in array order and a move is only made when no stop ends
+    // up later than its window, or than it already was if it was late, as
+    // checked against a TourSchedule refreshed after every move.
+    const TimeWindows *windows;
+    // Optional hook, called from the searching thread at the start and then
+    // about every progress_interval seconds with the current tour (matrix
+    // indices, original first stop first) and its length. Returning non-zero
+    // stops the search like an expired time budget; the tour so far is kept.
+    int (*progress)(const int *tour, int length, double tour_length, void *user);
+    void *progress_user;
+    double progress_interval;
+    // Optional scratch arena (NULL = a temporary one). The search allocates
+    // its working arrays there and releases them before returning, so one
+    // arena can serve many searches on the same thread.
+    Arena *arena;
+} TourImproveOptions;
+
+typedef struct {
+    uint64_t two_opt_moves;
+    uint64_t or_opt_moves;
+    uint64_t evaluations;
+    uint64_t two_opt_evaluations; // of which 2-opt, the rest are Or-opt
+    uint64_t window_rejections; // improving moves refused by the time windows
+    double initial_length;
+    double final_length;
+    double elapsed;
+    int timed_out;
+    int cancelled;       // stopped by the progress hook
+} TourImproveStats;
+
+void tour_improve_default_options(TourImproveOptions *options);
+
+// Local search on the closed tour tour[0..length-1], whose entries are
+// matrix indices. Uses neighbour lists and don't-look bits, so a pass costs
+// about O(length * neighbours) plus the array moves. tour[0] stays first.
+// Distances are assumed symmetric. With time windows a 2-opt move reverses
+// the side of the tour away from tour[0] and each improving move costs an
+// extra O(moved stops) check plus O(length) once made. stats may be NULL.
+// Returns 0 on success, -1 on allocation failure (tour is left unchanged).
+int tour_improve(const DistanceMatrix *matrix, int *tour, int length,
+                 const TourImproveOptions *options, TourImproveStats *stats);
+
+// Same, with the candidate lists supplied instead of found by the O(length^2)
+// matrix scan: candidates[i * candidate_count + j] is a candidate partner of
+// tour[i], given as a position in tour (-1 for none). Each list is reordered
+// by matrix distance and cut to options->neighbours.
+int tour_improve_with_candidates(const DistanceMatrix *matrix, int *tour, int length,
+                                 const int *candidates, int candidate_count,
+                                 const TourImproveOptions *options, TourImproveStats *stats);
+
+#endif
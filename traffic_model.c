@@ -0,0 +1,305 @@
+#include "traffic_model.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_STEP_MINUTES (TRAFFIC_DAY_MINUTES / TRAFFIC_PROFILE_POINTS)
+
+int traffic_model_init(TrafficModel *model, const RoadGraph *graph, double speed,
+                       double emission_factor) {
+    memset(model, 0, sizeof(TrafficModel));
+    if (!(speed > 0)) return -1;
+    int arcs = graph->num_arcs > 0 ? graph->num_arcs : 1;
+    model->graph = graph;
+    model->speed = speed;
+    model->arc_profile = calloc(arcs, sizeof(uint16_t));
+    model->arc_emission_factor = malloc(arcs * sizeof(float));
+    if (!model->arc_profile || !model->arc_emission_factor) {
+        traffic_model_free(model);
+        return -1;
+    }
+    if (emission_factor < 0) emission_factor = 0;
+    for (int i = 0; i < graph->num_arcs; i++) {
+        model->arc_emission_factor[i] = (float)emission_factor;
+    }
+    model->min_emission_factor = (float)emission_factor;
+
+    double free_flow[TRAFFIC_PROFILE_POINTS];
+    for (int i = 0; i < TRAFFIC_PROFILE_POINTS; i++) free_flow[i] = 1.0;
+    if (traffic_model_add_profile(model, free_flow) != 0) {
+        traffic_model_free(model);
+        return -1;
+    }
+    return 0;
+}
+
+void traffic_model_free(TrafficModel *model) {
+    free(model->arc_profile);
+    free(model->arc_emission_factor);
+    free(model->profiles);
+    free(model->profile_min);
+    memset(model, 0, sizeof(TrafficModel));
+}
+
+int traffic_model_add_profile(TrafficModel *model, const double *slowdown) {
+    if (model->num_profiles > UINT16_MAX) return -1;
+    if (model->num_profiles == model->profile_capacity) {
+        int capacity = model->profile_capacity ? 2 * model->profile_capacity : 8;
+        uint16_t *profiles = realloc(model->profiles,
+                                     (size_t)capacity * TRAFFIC_PROFILE_POINTS * sizeof(uint16_t));
+        if (!profiles) return -1;
+        model->profiles = profiles;
+        uint16_t *minimum = realloc(model->profile_min, capacity * sizeof(uint16_t));
+        if (!minimum) return -1;
+        model->profile_min = minimum;
+        model->profile_capacity = capacity;
+    }
+    int id = model->num_profiles++;
+    uint16_t *row = model->profiles + (size_t)id * TRAFFIC_PROFILE_POINTS;
+    uint16_t lowest = UINT16_MAX;
+    for (int i = 0; i < TRAFFIC_PROFILE_POINTS; i++) {
+        double factor = slowdown[i];
+        if (!(factor >= 1.0)) factor = 1.0;
+        if (factor > TRAFFIC_MAX_SLOWDOWN) factor = TRAFFIC_MAX_SLOWDOWN;
+        row[i] = (uint16_t)lround(factor * TRAFFIC_SLOWDOWN_SCALE);
+        if (row[i] < lowest) lowest = row[i];
+    }
+    model->profile_min[id] = lowest;
+    return id;
+}
+
+void traffic_model_set_arc(TrafficModel *model, int arc, int profile, double emission_factor) {
+    if (emission_factor < 0) emission_factor = 0;
+    model->arc_profile[arc] = (uint16_t)profile;
+    model->arc_emission_factor[arc] = (float)emission_factor;
+    // Only ever lowered, so it stays a valid bound
+    if ((float)emission_factor < model->min_emission_factor) {
+        model->min_emission_factor = (float)emission_factor;
+    }
+}
+
+void traffic_model_set_coordinates(TrafficModel *model, const double *x, const double *y) {
+    const RoadGraph *graph = model->graph;
+    model->x = x;
+    model->y = y;
+    // Arcs shorter than the straight line between their ends (bad data)
+    // weaken the bound instead of breaking it
+    double scale = 1.0;
+    for (int u = 0; u < graph->num_nodes; u++) {
+        for (int arc = graph->offsets[u]; arc < graph->offsets[u + 1]; arc++) {
+            int v = graph->targets[arc];
+            double straight = hypot(x[u] - x[v], y[u] - y[v]);
+            if (straight > 0 && graph->weights[arc] < scale * straight) {
+                scale = graph->weights[arc] / straight;
+            }
+        }
+    }
+    model->heuristic_scale = scale;
+}
+
+static double profile_slowdown(const uint16_t *profile, double minute) {
+    double day = fmod(minute, TRAFFIC_DAY_MINUTES);
+    if (day < 0) day += TRAFFIC_DAY_MINUTES;
+    double position = day / PROFILE_STEP_MINUTES;
+    int i = (int)position;
+    if (i >= TRAFFIC_PROFILE_POINTS) i = TRAFFIC_PROFILE_POINTS - 1;
+    int j = i + 1 == TRAFFIC_PROFILE_POINTS ? 0 : i + 1;
+    double value = profile[i] + (profile[j] - profile[i]) * (position - i);
+    return value / TRAFFIC_SLOWDOWN_SCALE;
+}
+
+double traffic_arc_arrival(const TrafficModel *model, int arc, double depart, double *travel) {
+    double free_flow = model->graph->weights[arc] / model->speed;
+    int id = model->arc_profile[arc];
+    const uint16_t *profile = model->profiles + (size_t)id * TRAFFIC_PROFILE_POINTS;
+    double best_travel = free_flow * profile_slowdown(profile, depart);
+    double best = depart + best_travel;
+    // Travel time is linear between breakpoints, so a later start can only
+    // arrive earlier when it starts on a breakpoint
+    double lower = free_flow * model->profile_min[id] / TRAFFIC_SLOWDOWN_SCALE;
+    for (double start = (floor(depart / PROFILE_STEP_MINUTES) + 1) * PROFILE_STEP_MINUTES;
+         start + lower < best; start += PROFILE_STEP_MINUTES) {
+        double time = free_flow * profile_slowdown(profile, start);
+        if (start + time < best) {
+            best = start + time;
+            best_travel = time;
+        }
+    }
+    if (travel) *travel = best_travel;
+    return best;
+}
+
+double traffic_arc_emissions(const TrafficModel *model, int arc, double travel) {
+    double length = model->graph->weights[arc];
+    double delay = travel - length / model->speed;
+    return model->arc_emission_factor[arc] * length + (delay > 0 ? model->idle_emissions * delay : 0);
+}
+
+int traffic_search_init(TrafficSearch *search, int num_nodes) {
+    memset(search, 0, sizeof(TrafficSearch));
+    int count = num_nodes > 0 ? num_nodes : 1;
+    search->cost = malloc(count * sizeof(double));
+    search->arrival = malloc(count * sizeof(double));
+    search->emissions = malloc(count * sizeof(double));
+    search->distance = malloc(count * sizeof(double));
+    search->parent = malloc(count * sizeof(int));
+    search->reached = calloc(count, sizeof(unsigned int));
+    search->num_nodes = num_nodes;
+    if (!search->cost || !search->arrival || !search->emissions || !search->distance ||
+        !search->parent || !search->reached || min_heap_init(&search->heap, num_nodes) != 0) {
+        traffic_search_free(search);
+        return -1;
+    }
+    return 0;
+}
+
+void traffic_search_free(TrafficSearch *search) {
+    min_heap_free(&search->heap);
+    free(search->cost);
+    free(search->arrival);
+    free(search->emissions);
+    free(search->distance);
+    free(search->parent);
+    free(search->reached);
+    memset(search, 0, sizeof(TrafficSearch));
+}
+
+static unsigned int next_query(TrafficSearch *search) {
+    if (++search->query == 0) {
+        memset(search->reached, 0, search->num_nodes * sizeof(unsigned int));
+        search->query = 1;
+    }
+    return search->query;
+}
+
+// Lower bound on the cost of one unit of straight-line distance
+static double heuristic_rate(const TrafficModel *model, const TrafficQuery *query) {
+    if (!model->x) return 0;
+    double time = 1.0 / model->speed;
+    double co2 = model->min_emission_factor;
+    double rate = query->objective == TRAFFIC_TIME ? time
+                : query->objective == TRAFFIC_CO2  ? co2
+                                                   : time + query->co2_weight * co2;
+    return rate * model->heuristic_scale;
+}
+
+int traffic_route(const TrafficModel *model, const TrafficQuery *query, int src, int target,
+                  TrafficSearch *search, TrafficLeg *leg) {
+    const RoadGraph *graph = model->graph;
+    if (src < 0 || src >= graph->num_nodes || target < 0 || target >= graph->num_nodes ||
+        search->num_nodes < graph->num_nodes || query->co2_weight < 0) {
+        return -1;
+    }
+
+    unsigned int stamp = next_query(search);
+    double rate = heuristic_rate(model, query);
+    double target_x = model->x ? model->x[target] : 0;
+    double target_y = model->x ? model->y[target] : 0;
+    MinHeap *heap = &search->heap;
+    min_heap_clear(heap);
+
+    search->reached[src] = stamp;
+    search->cost[src] = 0;
+    search->arrival[src] = query->depart;
+    search->emissions[src] = 0;
+    search->distance[src] = 0;
+    search->parent[src] = -1;
+    min_heap_push(heap, src, 0);
+
+    int found = 0;
+    while (!min_heap_empty(heap)) {
+        double key;
+        int u = min_heap_pop(heap, &key);
+        if (u == target) {
+            found = 1;
+            break;
+        }
+        double depart = search->arrival[u];
+        for (int arc = graph->offsets[u]; arc < graph->offsets[u + 1]; arc++) {
+            int v = graph->targets[arc];
+            double travel;
+            double arrival = traffic_arc_arrival(model, arc, depart, &travel);
+            double kg = traffic_arc_emissions(model, arc, travel);
+            double step = query->objective == TRAFFIC_TIME ? arrival - depart
+                        : query->objective == TRAFFIC_CO2  ? kg
+                                                           : arrival - depart + query->co2_weight * kg;
+            double cost = search->cost[u] + step;
+            if (search->reached[v] != stamp || cost < search->cost[v]) {
+                search->reached[v] = stamp;
+                search->cost[v] = cost;
+                search->arrival[v] = arrival;
+                search->emissions[v] = search->emissions[u] + kg;
+                search->distance[v] = search->distance[u] + graph->weights[arc];
+                search->parent[v] = u;
+                double bound = rate > 0 ? rate * hypot(model->x[v] - target_x,
+                                                       model->y[v] - target_y) : 0;
+                min_heap_push(heap, v, cost + bound);
+            }
+        }
+    }
+    min_heap_clear(heap);
+    if (!found) return 1;
+
+    leg->arrival = search->arrival[target];
+    leg->minutes = leg->arrival - query->depart;
+    leg->emissions = search->emissions[target];
+    leg->distance = search->distance[target];
+    return 0;
+}
+
+int traffic_search_path(const TrafficSearch *search, int target, int *nodes, int max_nodes) {
+    if (target < 0 || target >= search->num_nodes || search->reached[target] != search->query) {
+        return 0;
+    }
+    int length = 0;
+    for (int v = target; v >= 0; v = search->parent[v]) length++;
+    int i = length;
+    for (int v = target; v >= 0; v = search->parent[v]) {
+        if (--i < max_nodes) nodes[i] = v;
+    }
+    return length;
+}
+
+int traffic_tour(const TrafficModel *model, const TrafficQuery *query, const int *stops,
+                 int length, TrafficSearch *search, TrafficLeg *total) {
+    memset(total, 0, sizeof(TrafficLeg));
+    total->arrival = query->depart;
+    if (length < 2) return 0;
+    TrafficQuery leg_query = *query;
+    for (int i = 0; i < length; i++) {
+        int from = stops[i];
+        int to = stops[i + 1 < length ? i + 1 : 0];
+        leg_query.depart = total->arrival;
+        TrafficLeg leg;
+        int status = traffic_route(model, &leg_query, from, to, search, &leg);
+        if (status != 0) return status;
+        total->arrival = leg.arrival;
+        total->emissions += leg.emissions;
+        total->distance += leg.distance;
+    }
+    total->minutes = total->arrival - query->depart;
+    return 0;
+}
+
+const char *traffic_objective_name(TrafficObjective objective) {
+    switch (objective) {
+    case TRAFFIC_TIME: return "time";
+    case TRAFFIC_CO2: return "co2";
+    case TRAFFIC_BLEND: return "blend";
+    }
+    return "?";
+}
+
+int traffic_objective_parse(const char *name, TrafficObjective *objective) {
+    if (strcmp(name, "time") == 0) {
+        *objective = TRAFFIC_TIME;
+    } else if (strcmp(name, "co2") == 0) {
+        *objective = TRAFFIC_CO2;
+    } else if (strcmp(name, "blend") == 0) {
+        *objective = TRAFFIC_BLEND;
+    } else {
+        return -1;
+    }
+    return 0;
+}
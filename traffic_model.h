@@ -0,0 +1,113 @@
+#ifndef DELIVERY_TRAFFIC_MODEL_H
+#define DELIVERY_TRAFFIC_MODEL_H
+
+#include <stdint.h>
+
+#include "min_heap.h"
+#include "road_graph.h"
+
+#define TRAFFIC_DAY_MINUTES 1440.0
+#define TRAFFIC_PROFILE_POINTS 24         // one breakpoint per hour, from midnight
+#define TRAFFIC_SLOWDOWN_SCALE 4096       // stored slowdown of 1.0 (free flow)
+#define TRAFFIC_MAX_SLOWDOWN 15.0
+
+typedef enum {
+    TRAFFIC_TIME,   // minutes
+    TRAFFIC_CO2,    // kg CO2
+    TRAFFIC_BLEND   // minutes + co2_weight * kg CO2
+} TrafficObjective;
+
+// Time-dependent costs for the arcs of a RoadGraph. An arc's travel time is
+// its free-flow time (length / speed) times a slowdown read off a daily
+// profile: piecewise-linear between hourly breakpoints, stored as uint16
+// multiples of 1/TRAFFIC_SLOWDOWN_SCALE. Arcs refer to shared profiles by id,
+// so a graph costs 6 extra bytes per arc (profile id + emission factor).
+typedef struct {
+    const RoadGraph *graph;
+    double speed;                  // free-flow distance units per minute
+    double idle_emissions;         // kg CO2 per minute of delay over free flow
+    uint16_t *arc_profile;
+    float *arc_emission_factor;    // kg CO2 per distance unit
+    uint16_t *profiles;            // num_profiles rows of TRAFFIC_PROFILE_POINTS
+    uint16_t *profile_min;         // smallest slowdown of each profile
+    int num_profiles;
+    int profile_capacity;
+    // A* lower bounds: node coordinates (NULL = plain Dijkstra), the shortest
+    // arc length per unit of straight-line distance and the cleanest arc
+    const double *x, *y;
+    double heuristic_scale;
+    double min_emission_factor;
+} TrafficModel;
+
+// All arcs start on profile 0 (always free flow) with the given emission
+// factor. Returns 0 or -1.
+int traffic_model_init(TrafficModel *model, const RoadGraph *graph, double speed,
+                       double emission_factor);
+void traffic_model_free(TrafficModel *model);
+
+// Adds a profile from TRAFFIC_PROFILE_POINTS hourly slowdown factors,
+// clamped to [1, TRAFFIC_MAX_SLOWDOWN]. Returns its id or -1.
+int traffic_model_add_profile(TrafficModel *model, const double *slowdown);
+void traffic_model_set_arc(TrafficModel *model, int arc, int profile, double emission_factor);
+// Node coordinates for the A* bound; the arrays must outlive the model.
+void traffic_model_set_coordinates(TrafficModel *model, const double *x, const double *y);
+
+// Arrival time (minutes since midnight, not wrapped) when reaching the start
+// of arc at depart. The vehicle may wait before entering when that arrives
+// earlier, which keeps arrivals first-in first-out; *travel gets the driving
+// minutes actually spent on the arc.
+double traffic_arc_arrival(const TrafficModel *model, int arc, double depart, double *travel);
+// CO2 of driving arc in the given number of minutes.
+double traffic_arc_emissions(const TrafficModel *model, int arc, double travel);
+
+typedef struct {
+    TrafficObjective objective;
+    double co2_weight;   // TRAFFIC_BLEND: minutes that one kg CO2 is worth
+    double depart;       // minutes since midnight
+} TrafficQuery;
+
+typedef struct {
+    double arrival;      // minutes since midnight, not wrapped
+    double minutes;      // arrival - depart, including waits
+    double emissions;    // kg CO2
+    double distance;
+} TrafficLeg;
+
+// Per-thread scratch for repeated searches (labels versioned per query)
+typedef struct {
+    MinHeap heap;
+    double *cost;
+    double *arrival;
+    double *emissions;
+    double *distance;
+    int *parent;
+    unsigned int *reached;
+    unsigned int query;
+    int num_nodes;
+} TrafficSearch;
+
+int traffic_search_init(TrafficSearch *search, int num_nodes);
+void traffic_search_free(TrafficSearch *search);
+
+// Cheapest path from src to target leaving at query->depart, A* when the
+// model has coordinates. Exact for TRAFFIC_TIME. For CO2 and blends the
+// search is label-setting on that cost with arrival times carried along,
+// which is exact unless congestion makes a later arrival cheaper.
+// Returns 0 with leg filled, 1 when target is unreachable, -1 on bad input.
+int traffic_route(const TrafficModel *model, const TrafficQuery *query, int src, int target,
+                  TrafficSearch *search, TrafficLeg *leg);
+// Nodes of the path found by the last traffic_route() to target, src
+// first. Writes at most max_nodes and returns the path length.
+int traffic_search_path(const TrafficSearch *search, int target, int *nodes, int max_nodes);
+
+// Drives the closed tour stops[0] -> ... -> stops[length - 1] -> stops[0]
+// leg by leg, each leg leaving when the previous one arrives. total gets the
+// sums and the final arrival. Returns 0, 1 when a leg is unreachable or -1.
+int traffic_tour(const TrafficModel *model, const TrafficQuery *query, const int *stops,
+                 int length, TrafficSearch *search, TrafficLeg *total);
+
+const char *traffic_objective_name(TrafficObjective objective);
+// Parses "time", "co2" or "blend". Returns 0 or -1.
+int traffic_objective_parse(const char *name, TrafficObjective *objective);
+
+#endif